@@ -68,7 +68,8 @@ class Client(object):
     FMTSTR = SDS_FMTSTR
 
     def __init__(self, sds_root, sds_type="D", format="MSEED",
-                 fileborder_seconds=30, fileborder_samples=5000):
+                 fileborder_seconds=30, fileborder_samples=5000,
+                 record_index=False):
         """
         Initialize a SDS local filesystem client.
 
@@ -105,6 +106,14 @@ class Client(object):
             code of the requested channel to sampling frequency. The maximum of
             both ``fileborder_seconds`` and ``fileborder_samples`` is used when
             determining if previous/next day should be checked for data.
+        :type record_index: bool or str
+        :param record_index: Only for MiniSEED archives. If set, a cached
+            index of the records of each file is used to only read the records
+            matching a request instead of parsing all record headers of all
+            daily files, see :func:`~obspy.io.mseed.util.get_record_index`.
+            If ``True``, the index files are stored in the hidden
+            ``.record_index`` directory in the SDS root, otherwise it
+            specifies the directory for the index files.
         """
         if not os.path.isdir(sds_root):
             msg = ("SDS root is not a local directory: " + sds_root)
@@ -114,6 +123,9 @@ class Client(object):
         self.format = format
         self.fileborder_seconds = fileborder_seconds
         self.fileborder_samples = fileborder_samples
+        if record_index is True:
+            record_index = os.path.join(sds_root, ".record_index")
+        self.record_index = record_index
 
     def get_waveforms(self, network, station, location, channel, starttime,
                       endtime, merge=-1, sds_type=None, **kwargs):
@@ -169,6 +181,8 @@ class Client(object):
             network=network, station=station, location=location,
             channel=channel, starttime=starttime, endtime=endtime,
             sds_type=sds_type)
+        if self.record_index and str(self.format).upper() == "MSEED":
+            kwargs.setdefault("record_index", self.record_index)
         for full_path in full_paths:
             st += read(full_path, format=self.format, starttime=starttime,
                        endtime=endtime, sourcename=seed_pattern, **kwargs)
@@ -160,6 +160,31 @@ class SDSTestCase(unittest.TestCase):
                 st = client.get_waveforms(net, sta, loc, cha, t-200, t+200)
                 self.assertEqual(len(st), num_matching_ids)
 
+    def test_read_from_sds_with_record_index(self):
+        """
+        Test reading data using cached record indices.
+        """
+        year, doy = 2015, 1
+        t = UTCDateTime("%d-%03dT00:00:00" % (year, doy))
+        with TemporarySDSDirectory(year=year, doy=doy) as temp_sds:
+            client = Client(temp_sds.tempdir)
+            client_index = Client(temp_sds.tempdir, record_index=True)
+            index_dir = os.path.join(temp_sds.tempdir, ".record_index")
+            self.assertEqual(client_index.record_index, index_dir)
+            for _ in range(2):
+                for seed_id, t1, t2 in (("AB.XYZ..HHZ", t - 20, t + 20),
+                                        ("*.*.*.HHZ", t - 200, t + 200),
+                                        ("AB.ZZZ3.00.BH?", t + 20, t + 40)):
+                    net, sta, loc, cha = seed_id.split(".")
+                    st = client.get_waveforms(net, sta, loc, cha, t1, t2)
+                    st_index = client_index.get_waveforms(net, sta, loc, cha,
+                                                          t1, t2)
+                    self.assertEqual(st_index, st)
+                self.assertTrue(os.listdir(index_dir))
+            # The index files must not show up as archive contents.
+            self.assertEqual(client_index.get_all_nslc(),
+                             client.get_all_nslc())
+
     def test_sds_report(self):
         """
         Test command line script for generating SDS report html.
@@ -1141,35 +1141,37 @@ class Response(ComparingObject):
         output = np.empty(len(frequencies), dtype=np.complex128)
         out_units = C.c_char_p(out_units.encode('ascii', 'strict'))
 
-        # Set global variables
-        if self.resource_id:
-            clibevresp.curr_file.value = self.resource_id.encode('utf-8')
-        else:
-            clibevresp.curr_file.value = None
-
-        try:
-            rc = clibevresp._obspy_check_channel(C.byref(chan))
-            if rc:
-                e, m = ew.ENUM_ERROR_CODES[rc]
-                raise e('check_channel: ' + m)
-
-            rc = clibevresp._obspy_norm_resp(C.byref(chan), -1, 0)
-            if rc:
-                e, m = ew.ENUM_ERROR_CODES[rc]
-                raise e('norm_resp: ' + m)
-
-            rc = clibevresp._obspy_calc_resp(C.byref(chan), frequencies,
-                                             len(frequencies),
-                                             output, out_units, -1, 0, 0)
-            if rc:
-                e, m = ew.ENUM_ERROR_CODES[rc]
-                raise e('calc_resp: ' + m)
-
-            # XXX: Check if this is really not needed.
-            # output *= scale_factor[0]
-
-        finally:
-            clibevresp.curr_file.value = None
+        # evalresp uses global variables, calls must not overlap.
+        with ew.EVALRESP_LOCK:
+            # Set global variables
+            if self.resource_id:
+                clibevresp.curr_file.value = self.resource_id.encode('utf-8')
+            else:
+                clibevresp.curr_file.value = None
+
+            try:
+                rc = clibevresp._obspy_check_channel(C.byref(chan))
+                if rc:
+                    e, m = ew.ENUM_ERROR_CODES[rc]
+                    raise e('check_channel: ' + m)
+
+                rc = clibevresp._obspy_norm_resp(C.byref(chan), -1, 0)
+                if rc:
+                    e, m = ew.ENUM_ERROR_CODES[rc]
+                    raise e('norm_resp: ' + m)
+
+                rc = clibevresp._obspy_calc_resp(C.byref(chan), frequencies,
+                                                 len(frequencies),
+                                                 output, out_units, -1, 0, 0)
+                if rc:
+                    e, m = ew.ENUM_ERROR_CODES[rc]
+                    raise e('calc_resp: ' + m)
+
+                # XXX: Check if this is really not needed.
+                # output *= scale_factor[0]
+
+            finally:
+                clibevresp.curr_file.value = None
 
         return output
 
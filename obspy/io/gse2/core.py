@@ -86,9 +86,8 @@ def _write_gse2(stream, filename, inplace=False, **kwargs):  # @UnusedVariable
     :type filename: str
     :param filename: Name of file to write.
     :type inplace: bool, optional
-    :param inplace: If True, do compression not on a copy of the data but
-        on the data itself - note this will change the data values and make
-        them therefore unusable!
+    :param inplace: Without effect, the data are compressed without
+        changing them. Kept for backwards compatibility.
 
     .. rubric:: Example
 
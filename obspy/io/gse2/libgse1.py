@@ -24,7 +24,7 @@ import doctest
 
 from obspy import UTCDateTime
 
-from .libgse2 import uncompress_cm6, verify_checksum, read_integer_data
+from .libgse2 import _uncompress_cm6, verify_checksum, read_integer_data
 
 
 def read(fh, verify_chksum=True):
@@ -47,8 +47,9 @@ def read(fh, verify_chksum=True):
     """
     header = read_header(fh)
     dtype = header['gse1']['datatype']
+    chksum = None
     if dtype == 'CMP6':
-        data = uncompress_cm6(fh, header['npts'])
+        data, chksum = _uncompress_cm6(fh, header['npts'])
     elif dtype == 'INTV':
         data = read_integer_data(fh, header['npts'])
     else:
@@ -56,7 +57,7 @@ def read(fh, verify_chksum=True):
         raise NotImplementedError(msg)
     # test checksum only if enabled
     if verify_chksum:
-        verify_checksum(fh, data, version=1)
+        verify_checksum(fh, data, version=1, chksum=chksum)
     return header, data
 
 
@@ -73,6 +73,19 @@ clibgse2.compress_6b_buffer.argtypes = [
     C.CFUNCTYPE(C.c_int, C.c_char)]
 clibgse2.compress_6b_buffer.restype = C.c_int
 
+clibgse2.compress_6b_bytes.argtypes = [
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int, C.c_int, C.c_char_p, C.POINTER(C.c_int32)]
+clibgse2.compress_6b_bytes.restype = C.c_longlong
+
+clibgse2.decomp_6b_bytes.argtypes = [
+    C.c_char_p, C.c_longlong, C.c_int,
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.POINTER(C.c_int32), C.POINTER(C.c_longlong)]
+clibgse2.decomp_6b_bytes.restype = C.c_int
+
 
 class ChksumError(Exception):
     """
@@ -242,27 +255,44 @@ def uncompress_cm6(f, n_samps):
     :type n_samps: int
     :param n_samps: Number of samples
     """
-    def read83(cbuf, vptr):  # @UnusedVariable
-        line = f.readline()
-        if line == b'':
-            return None
-        # avoid buffer overflow through clipping to 82
-        sb = C.create_string_buffer(line[:82])
-        # copy also null termination "\0", that is max 83 bytes
-        C.memmove(C.addressof(cbuf.contents), C.addressof(sb), len(line) + 1)
-        return C.addressof(sb)
-
-    cread83 = C.CFUNCTYPE(C.c_char_p, C.POINTER(C.c_char), C.c_void_p)(read83)
+    return _uncompress_cm6(f, n_samps)[0]
+
+
+def _uncompress_cm6(f, n_samps):
+    """
+    Uncompress n_samps of CM6 compressed data from file pointer fp and
+    return the data and its checksum.
+
+    The lines following the DAT2 or DAT1 line are read at once and decoded
+    in C. Afterwards the file pointer is set to the line following the last
+    sample.
+    """
+    data = np.empty(n_samps, dtype=np.int32)
     if n_samps == 0:
-        data = np.empty(0, dtype=np.int32)
-    else:
-        # aborts with segmentation fault when n_samps == 0
-        data = np.empty(n_samps, dtype=np.int32)
-        n = clibgse2.decomp_6b_buffer(n_samps, data, cread83, None)
-        if n != n_samps:
-            raise GSEUtiError("Mismatching length in lib.decomp_6b")
-        clibgse2.rem_2nd_diff(data, n_samps)
-    return data
+        return data, 0
+    line = f.readline()
+    while not line.startswith((b'DAT2', b'DAT1')):
+        if not line:
+            raise GSEUtiError("Neither DAT2 or DAT1 found")
+        line = f.readline()
+    pos = f.tell()
+    # At most 6 characters per sample and lines of 80 characters. Only
+    # blank lines within the data need more.
+    size = 6 * n_samps + (6 * n_samps // 80 + 2) * 2
+    chksum = C.c_int32()
+    consumed = C.c_longlong()
+    while True:
+        buf = f.read(size)
+        n = clibgse2.decomp_6b_bytes(buf, len(buf), n_samps, data,
+                                     C.byref(chksum), C.byref(consumed))
+        if n >= 0 or len(buf) < size:
+            break
+        size *= 2
+        f.seek(pos)
+    f.seek(pos + consumed.value)
+    if n != n_samps:
+        raise GSEUtiError("Mismatching length in lib.decomp_6b")
+    return data, chksum.value
 
 
 def compress_cm6(data):
@@ -274,28 +304,31 @@ def compress_cm6(data):
     :returns: NumPy chararray containing compressed samples
     """
     data = np.ascontiguousarray(data, np.int32)
+    lines = _compress_cm6(data, diff=False)[0].splitlines()
+    return np.array(lines, dtype=native_str('|S80'))
+
+
+def _compress_cm6(data, diff=True):
+    """
+    CM6 compress data and return the lines of 80 characters, each
+    terminated by a newline, and the checksum of the data.
+
+    :type data: :class:`numpy.ndarray`, dtype=int32
+    :param data: the data to write
+    :type diff: bool
+    :param diff: If True, compress the 2nd differences of the data as
+        needed for GSE2, the data itself is not changed.
+    """
     n = len(data)
-    count = [0]  # closure, must be container
-    # 4 character bytes per int32_t
-    carr = np.zeros(n * 4, dtype=native_str('c'))
-
-    def writer(char):
-        carr[count[0]] = char
-        count[0] += 1
-        return 0
-    cwriter = C.CFUNCTYPE(C.c_int, C.c_char)(writer)
-    ierr = clibgse2.compress_6b_buffer(data, n, cwriter)
-    if ierr != 0:
-        msg = "Error status after compress_6b_buffer is NOT 0 but %d"
-        raise GSEUtiError(msg % ierr)
-    cnt = count[0]
-    if cnt < 80:
-        return carr[:cnt].view(native_str('|S%d' % cnt))
-    else:
-        return carr[:(cnt // 80 + 1) * 80].view(native_str('|S80'))
+    # at most 6 characters per sample plus the newlines
+    buf = C.create_string_buffer(6 * n + 6 * n // 80 + 1)
+    chksum = C.c_int32()
+    cnt = clibgse2.compress_6b_bytes(data, n, int(diff), buf,
+                                     C.byref(chksum))
+    return buf.raw[:cnt], chksum.value
 
 
-def verify_checksum(fh, data, version=2):
+def verify_checksum(fh, data, version=2, chksum=None):
     """
     Calculate checksum from data, as in gse_driver.c line 60
 
@@ -303,8 +336,14 @@ def verify_checksum(fh, data, version=2):
     :param fh: File Pointer
     :type version: int
     :param version: GSE version, either 1 or 2, defaults to 2.
+    :type chksum: int
+    :param chksum: Checksum of the data if it is already known, e.g. from
+        decompressing it.
     """
-    chksum_data = clibgse2.check_sum(data, len(data), C.c_int32(0))
+    if chksum is None:
+        chksum_data = clibgse2.check_sum(data, len(data), C.c_int32(0))
+    else:
+        chksum_data = chksum
     # find checksum within file
     buf = fh.readline()
     chksum_file = 0
@@ -378,8 +417,9 @@ def read(f, verify_chksum=True):
     """
     headdict = read_header(f)
     dtype = headdict['gse2']['datatype']
+    chksum = None
     if dtype == 'CM6':
-        data = uncompress_cm6(f, headdict['npts'])
+        data, chksum = _uncompress_cm6(f, headdict['npts'])
     elif dtype == 'INT':
         data = read_integer_data(f, headdict['npts'])
     else:
@@ -387,7 +427,7 @@ def read(f, verify_chksum=True):
         raise NotImplementedError(msg)
     # test checksum only if enabled
     if verify_chksum:
-        verify_checksum(f, data, version=2)
+        verify_checksum(f, data, version=2, chksum=chksum)
     return headdict, data
 
 
@@ -400,8 +440,8 @@ def write(headdict, data, f, inplace=False):
     correction of calper multiply by 2PI and calper:
     data * 2 * pi * header['calper'].
 
-    Warning: The data are actually compressed in place for performance
-    issues, if you still want to use the data afterwards use data.copy()
+    The 2nd differences, the compression and the checksum are computed in a
+    single pass in C without changing the data.
 
     :note: headdict dictionary entries C{'datatype', 'n_samps',
            'samp_rate'} are absolutely necessary
@@ -411,24 +451,17 @@ def write(headdict, data, f, inplace=False):
     :param f: Open file pointer of GSE2 file to write, opened in binary
               mode, e.g. f = open('myfile','wb')
     :type inplace: bool
-    :param inplace: If True, do compression not on a copy of the data but
-                    on the data itself --- note this will change the data
-                    values and make them therefore unusable
+    :param inplace: Without effect, the data are never changed. Kept for
+                    backwards compatibility.
     :type headdict: dict
     :param headdict: ObsPy Header
     """
-    n = len(data)
-    #
-    chksum = clibgse2.check_sum(data, n, C.c_int32(0))
+    data_cm6, chksum = _compress_cm6(data)
     # Maximum values above 2^26 will result in corrupted/wrong data!
-    # do this after chksum as chksum does the type checking for NumPy array
-    # for you
-    if not inplace:
-        data = data.copy()
+    # do this after compressing as the C function does the type checking for
+    # NumPy array for you
     if data.max() > 2 ** 26:
         raise OverflowError("Compression Error, data must be less equal 2^26")
-    clibgse2.diff_2nd(data, n, 0)
-    data_cm6 = compress_cm6(data)
     # set some defaults if not available and convert header entries
     headdict.setdefault('calib', 1.0)
     headdict.setdefault('gse2', {})
@@ -443,8 +476,7 @@ def write(headdict, data, f, inplace=False):
     # For further details, see the __doc__ of write_header
     write_header(f, headdict)
     f.write(b"DAT2\n")
-    for line in data_cm6:
-        f.write(line + b"\n")
+    f.write(data_cm6)
     f.write(("CHK2 %8ld\n\n" % chksum).encode('ascii', 'strict'))
 
 
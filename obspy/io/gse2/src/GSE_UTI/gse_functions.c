@@ -341,3 +341,159 @@ int read_header(FILE *fop, struct header *hed)
 	/*printf ("read_header: EndOfFile reached!\n");*/
 	return -1;
 }       /* end of read_header */
+
+/*********************************************************************
+  Function: compress_6b_bytes
+    Buffer version of compress_6b_buffer. The characters are written to
+    buf in lines of 80 characters, each line including the last one is
+    terminated by a newline. buf must hold at least 6 * n_of_samples +
+    6 * n_of_samples / 80 + 1 characters.
+    If diff is not 0, the 2nd differences of the data are encoded as
+    computed by diff_2nd, but the data itself is not changed. The
+    checksum of the data as computed by check_sum is stored in chksum.
+    Returns the # of characters written.
+*********************************************************************/
+long long compress_6b_bytes (const int32_t *data, int n_of_samples, int diff,
+                             char *buf, int32_t *chksum)
+{
+  static const char achar[] =
+       " +-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+  static const int32_t expo_2[] = { 0, 32, 1024, 32768, 1048576, 33554432, 134217728 };
+  static const int32_t expo_2m1_o[] = { 01, 037, 01777, 077777, 03777777, 0177777777 };
+  unsigned int t1, t2 = 0, t3 = 0;	/* unsigned to wrap around */
+  long long pos = 0;
+  int32_t value, checksum = 0;
+  int si, nflag, case_expo, column = 0;
+
+  for (si = 0; si < n_of_samples; si++)
+  {
+	value = data[si];
+	/* |value % MODULO_VALUE| and |checksum| are smaller than 10^8, so
+	 * this is the same as check_sum */
+	checksum = (checksum + value % MODULO_VALUE) % MODULO_VALUE;
+	if (diff)
+	{
+		t1 = (unsigned int)value;
+		if (si == 0) { t3 = t1; t2 = 0u - 2u * t3; }
+		else { value = (int32_t)(t1 + t2); t2 = t3 - 2u * t1; t3 = t1; }
+	}
+
+	nflag = 1;
+	if (value < 0 ) 	/* convert negative numbers */
+		{ nflag += 16; value = -value; }
+
+				/* clip at 2**27 -1 */
+	value = (value >= expo_2[6]) ? expo_2[6] - 1 : value;
+
+	/* # of leading characters, the first one holds 4 bits, all others 5 */
+	for (case_expo = 0; case_expo < 5 && value >= expo_2[case_expo + 1] / 2;
+	     case_expo++);
+
+	for ( ; case_expo > 0; case_expo--)
+	{				/* one character per turn */
+		buf[pos++] = achar[value / expo_2[case_expo] + nflag + 32];
+		if (++column == 80) { buf[pos++] = '\n'; column = 0; }
+		value = value & expo_2m1_o[case_expo];
+		nflag = 1;
+	}
+	buf[pos++] = achar[value + nflag];	/* one character to go */
+	if (++column == 80) { buf[pos++] = '\n'; column = 0; }
+  }
+  if (column > 0) buf[pos++] = '\n';
+  *chksum = checksum;
+  return pos;
+
+}	/* end of compress_6b_bytes */
+
+/*********************************************************************
+  Function: decomp_6b_bytes
+    Buffer version of decomp_6b_buffer. buf holds buf_len characters of
+    the lines following the DAT2 or DAT1 line. The 2nd differences are
+    removed as by rem_2nd_diff and the checksum of the samples as
+    computed by check_sum is stored in chksum. consumed is set to the
+    # of characters of all lines that were read.
+    Returns the actual # of samples, which is smaller than n_of_samples
+    if CHK2 or CHK1 is reached prematurely, or -1 if buf ends before.
+*********************************************************************/
+static const char *next_line (const char *line, const char *end)
+{
+  const char *p = (const char *)memchr(line, '\n', end - line);
+  return p ? p + 1 : end;
+}
+
+/* beyond the 80 columns, the end of the line or at a blank */
+#define END_OF_CHARS(line, lend, ibuf) ((ibuf) > 79 || \
+  (line) + (ibuf) >= (lend) || isspace((unsigned char)(line)[ibuf]))
+
+/* a new line is read without checking for blanks as in decomp_6b_buffer,
+ * the end of the line reads as "\0" */
+#define NEXT_CHAR(line, lend, ibuf) \
+  ((line) + (ibuf) < (lend) ? (int)(line)[ibuf] & m127 : 0)
+
+int decomp_6b_bytes (const char *buf, long long buf_len, int n_of_samples,
+                     int32_t *dta, int32_t *chksum, long long *consumed)
+{
+  static const int ichar[]={0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+             0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,2,3,4,5,6,7,
+             8,9,10,11,0,0,0,0,0,0,0,12,13,14,15,16,17,18,19,20,21,22,
+             23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,0,0,0,0,0,0,
+             38,39,40,41,42,43,44,45,46,47,48,49,50,51,52,53,54,55,56,
+             57,58,59,60,61,62,63,0,0,0,0,0,0};
+  const int isign=020, ioflow=040, mask1=017, mask2=037, m127=0177;
+  const char *end = buf + buf_len;
+  const char *line = buf, *lend = buf;
+  unsigned int first = 0, second = 0;	/* unsigned to wrap around */
+  int i, ibuf = -1, inn, jsign, joflow;
+  int32_t itemp, checksum = 0;
+
+  *chksum = 0;
+  *consumed = 0;
+  if (buf_len <= 0) return -1;		/* no line after DAT2 or DAT1 */
+  lend = next_line(line, end);
+  for (i = 0; i < n_of_samples; i++)	/* loop over expected samples */
+  {
+	ibuf += 1;
+	if (END_OF_CHARS(line, lend, ibuf))
+	{
+		if (lend >= end) return -1;	/* missing input line */
+		line = lend;
+		lend = next_line(line, end);
+		/* a space makes sure that CHK2 is not part of the data */
+		if (lend - line >= 5 &&
+		    (!strncmp(line, "CHK2 ", 5) || !strncmp(line, "CHK1 ", 5)))
+			break;
+		ibuf = 0;
+	}
+	inn = ichar[NEXT_CHAR(line, lend, ibuf)];
+	jsign = (inn & isign);
+	joflow = (inn & ioflow);
+	itemp = (int32_t)(inn & mask1);
+
+	while (joflow != 0) 		/* loop over other bytes in sample */
+	{
+		itemp <<= 5;
+		ibuf += 1;
+		if (END_OF_CHARS(line, lend, ibuf))
+		{
+			if (lend >= end) return -1;
+			line = lend;
+			lend = next_line(line, end);
+			ibuf = 0;
+		}
+		inn = ichar[NEXT_CHAR(line, lend, ibuf)];
+		joflow = (inn & ioflow);
+		itemp = itemp + (int32_t)(inn & mask2);
+	}
+	if (jsign != 0) itemp = -itemp;
+
+	/* the double sum of the 2nd differences as rem_2nd_diff */
+	first += (unsigned int)itemp;
+	second += first;
+	dta[i] = (int32_t)second;
+	checksum = (checksum + dta[i] % MODULO_VALUE) % MODULO_VALUE;
+  }
+  *chksum = checksum;
+  *consumed = lend - buf;
+  return i;
+
+}	/* end of decomp_6b_bytes */
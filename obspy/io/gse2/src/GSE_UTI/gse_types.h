@@ -8,3 +8,5 @@ void rem_2nd_diff (int32_t *, int);
 int decomp_6b (FILE *, int, int32_t *);
 int compress_6b_buffer (int32_t *data, int n_of_samples, int (* writer)(char));
 int decomp_6b_buffer (int n_of_samples, int32_t *dta, char * (* reader)(char *, void *), void * vptr);
+long long compress_6b_bytes (const int32_t *, int, int, char *, int32_t *);
+int decomp_6b_bytes (const char *, long long, int, int32_t *, int32_t *, long long *);
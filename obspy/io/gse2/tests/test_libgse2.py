@@ -7,6 +7,7 @@ from __future__ import (absolute_import, division, print_function,
                         unicode_literals)
 from future.builtins import *  # NOQA
 
+import ctypes as C
 import io
 import os
 import unittest
@@ -101,6 +102,51 @@ class LibGSE2TestCase(unittest.TestCase):
         self.assertEqual(header, newheader)
         np.testing.assert_equal(data, newdata)
 
+    def test_cm6_single_pass(self):
+        """
+        Compares writing and reading CM6 in a single pass with the separate
+        2nd differences, checksum and character wise compression routines.
+        """
+        gse2file = os.path.join(self.path, 'loc_RNON20040609200559.z')
+        with open(gse2file, 'rb') as f:
+            header = libgse2.read_header(f)
+        clib = libgse2.clibgse2
+        np.random.seed(42)
+        fout = io.BytesIO()
+        expected = []
+        for npts in (1, 2, 79, 80, 81, 1000):
+            data = np.random.randint(-2 ** 24, 2 ** 24, npts).astype(np.int32)
+            # mix of short and long encoded samples
+            data[:npts // 2] //= 1000
+            original = data.copy()
+            header['npts'] = npts
+            libgse2.write(header, data, fout)
+            # the data are not changed
+            np.testing.assert_array_equal(data, original)
+            # compress in separate passes
+            chksum = clib.check_sum(data, npts, C.c_int32(0))
+            clib.diff_2nd(data, npts, 0)
+            chars = []
+
+            def writer(char):
+                chars.append(char)
+                return 0
+            cwriter = C.CFUNCTYPE(C.c_int, C.c_char)(writer)
+            self.assertEqual(clib.compress_6b_buffer(data, npts, cwriter), 0)
+            chars = b"".join(chars)
+            lines = b"".join(chars[i:i + 80] + b"\n"
+                             for i in range(0, len(chars), 80))
+            cm6 = b"DAT2\n" + lines + \
+                ("CHK2 %8ld\n\n" % chksum).encode('ascii', 'strict')
+            self.assertTrue(fout.getvalue().endswith(cm6))
+            expected.append(original)
+        # read all traces one after another
+        fout.seek(0)
+        for original in expected:
+            newheader, newdata = libgse2.read(fout, verify_chksum=True)
+            self.assertEqual(newheader['npts'], len(original))
+            np.testing.assert_array_equal(newdata, original)
+
     def test_read_header(self):
         """
         Reads and compares header info from the first record.
@@ -10,6 +10,7 @@ from future.utils import native_str
 import ctypes as C
 import io
 import os
+import re
 import warnings
 from struct import pack
 
@@ -19,11 +20,15 @@ from obspy import Stream, Trace, UTCDateTime
 from obspy.core.util import NATIVE_BYTEORDER
 from . import util, InternalMSEEDReadingError, InternalMSEEDReadingWarning
 from .headers import (DATATYPES, ENCODINGS, HPTERROR, HPTMODULUS, SAMPLETYPE,
-                      SEED_CONTROL_HEADERS, UNSUPPORTED_ENCODINGS,
-                      VALID_CONTROL_HEADERS, VALID_RECORD_LENGTHS, Selections,
+                      UNSUPPORTED_ENCODINGS, VALID_RECORD_LENGTHS, Selections,
                       SelectTime, Blkt100S, Blkt1001S, clibmseed)
 
 
+# Logging callback installed by the last _write_mseed(). libmseed keeps
+# calling it after the write returned, so it must stay alive.
+_pack_log = None
+
+
 def _is_mseed(filename):
     """
     Checks whether a file is Mini-SEED/full SEED or not.
@@ -143,7 +148,8 @@ def __is_mseed(fp, file_size):  # NOQA
 
 def _read_mseed(mseed_object, starttime=None, endtime=None, headonly=False,
                 sourcename=None, reclen=None, details=False,
-                header_byteorder=None, verbose=None, **kwargs):
+                header_byteorder=None, verbose=None, threads=1,
+                record_index=False, **kwargs):
     """
     Reads a Mini-SEED file and returns a Stream object.
 
@@ -189,6 +195,20 @@ def _read_mseed(mseed_object, starttime=None, endtime=None, headonly=False,
         little-endian, ``1`` or ``'>'`` for MBF or big-endian. ``'='`` is the
         native byte order. Used to enforce the header byte order. Useful in
         some rare cases where the automatic byte order detection fails.
+    :type threads: int, optional
+    :param threads: Number of threads used to decode the data records. Once
+        all record headers have been parsed every record is decoded into its
+        own part of the final arrays so the decoding can be distributed over
+        several cores. Only has an effect if ObsPy has been compiled with
+        OpenMP support. Defaults to ``1``.
+    :type record_index: bool or str, optional
+    :param record_index: Use a cached index of all records to only read the
+        records possibly matching ``starttime``, ``endtime`` and
+        ``sourcename`` instead of parsing all record headers. If ``True``,
+        the index is stored next to the file, if a string, it is used as the
+        directory for the index files. See
+        :func:`~obspy.io.mseed.util.get_record_index`. Only used for file
+        names and if a selection is given. Defaults to ``False``.
 
     .. rubric:: Example
 
@@ -285,35 +305,40 @@ def _read_mseed(mseed_object, starttime=None, endtime=None, headonly=False,
 
     # If it's a file name just read it.
     if isinstance(mseed_object, (str, native_str)):
-        # Read to NumPy array which is used as a buffer.
-        bfr_np = np.fromfile(mseed_object, dtype=np.int8)
+        # Memory map the file and use it as the buffer instead of copying
+        # it to memory.
+        bfr_np = util._memory_map(mseed_object)
     elif hasattr(mseed_object, 'read'):
         bfr_np = np.fromstring(mseed_object.read(), dtype=np.int8)
 
-    # Get the record length
-    record_length = info["record_length"]
-
     # Search for data records and pass only the data part to the underlying C
     # routine.
-    offset = 0
-    # 0 to 9 are defined in a row in the ASCII charset.
-    min_ascii = ord('0')
+    offset = util._get_first_data_record_offset(bfr_np, info["record_length"])
+    buffer_offsets = None
+
+    # With a record index only the records possibly matching the selection
+    # have to be handed to the C routine. They are passed in file order so
+    # the result is the same as when reading the whole file.
+    if record_index and isinstance(mseed_object, (str, native_str)) and \
+            header_byteorder == -1 and \
+            (starttime is not None or endtime is not None or
+             sourcename is not None) and \
+            (starttime is None or isinstance(starttime, UTCDateTime)) and \
+            (endtime is None or isinstance(endtime, UTCDateTime)) and \
+            (sourcename is None or isinstance(sourcename, (str, native_str))):
+        index = util.get_record_index(
+            mseed_object,
+            index_dir=None if record_index is True else record_index,
+            reclen=None if reclen == -1 else reclen)
+        offsets, reclens = util._select_records_from_index(
+            index, starttime=starttime, endtime=endtime,
+            sourcename=sourcename)
+        if not len(offsets):
+            return Stream()
+        bfr_np = util._gather_records(bfr_np, offsets, reclens)
+        buffer_offsets = (np.cumsum(reclens) - reclens, offsets)
+        offset = 0
 
-    # Small function to check whether an array of ASCII values contains only
-    # digits.
-    def isdigit(x):
-        return True if (x - min_ascii).max() <= 9 else False
-
-    while True:
-        # This should never happen
-        if (isdigit(bfr_np[offset:offset + 6]) is False) or \
-                (bfr_np[offset + 6] not in VALID_CONTROL_HEADERS):
-            msg = 'Not a valid (Mini-)SEED file'
-            raise Exception(msg)
-        elif bfr_np[offset + 6] in SEED_CONTROL_HEADERS:
-            offset += record_length
-            continue
-        break
     bfr_np = bfr_np[offset:]
     buflen = len(bfr_np)
 
@@ -375,20 +400,26 @@ def _read_mseed(mseed_object, starttime=None, endtime=None, headonly=False,
     # could never be caught then. They are collected an raised later on.
     _errs_and_warnings = []
 
+    # The C code reports offsets in the buffer it reads, which starts after
+    # the dataless part of full SEED files or only holds the records
+    # selected with the record index. Translate them to file offsets.
+    def file_offset(match):
+        position = int(match.group(2))
+        if buffer_offsets is None:
+            position += offset
+        else:
+            starts, offsets = buffer_offsets
+            k = np.searchsorted(starts, position, side='right') - 1
+            position += int(offsets[k] - starts[k])
+        return match.group(1) + str(position)
+
     def log_error_or_warning(msg):
         msg = msg.decode()
         if msg.startswith("ERROR: "):
             _errs_and_warnings.append(
                 InternalMSEEDReadingError(msg[7:].strip()))
         if msg.startswith("INFO: "):
-            msg = msg[6:].strip()
-            # Append the offset of the full SEED header if necessary. That way
-            # the C code does not have to deal with it.
-            if offset and "offset" in msg:
-                msg = ("%s The file contains a %i byte dataless part at the "
-                       "beginning. Make sure to add that to the reported "
-                       "offset to get the actual location in the file." % (
-                           msg, offset))
+            msg = re.sub(r"(offset[ =])(\d+)", file_offset, msg[6:].strip())
             _errs_and_warnings.append((msg, InternalMSEEDReadingWarning))
 
     diag_print = C.CFUNCTYPE(C.c_void_p, C.c_char_p)(log_error_or_warning)
@@ -402,10 +433,17 @@ def _read_mseed(mseed_object, starttime=None, endtime=None, headonly=False,
     except:
         verbose = 0
 
+    threads = int(threads)
+    if threads < 1:
+        msg = 'threads needs to be a positive integer'
+        raise ValueError(msg)
+
     lil = clibmseed.readMSEEDBuffer(
         bfr_np, buflen, selections, C.c_int8(unpack_data),
         reclen, C.c_int8(verbose), C.c_int8(details), header_byteorder,
-        alloc_data, diag_print, log_print)
+        alloc_data, diag_print, log_print, threads)
+    # All data has been copied, release the buffer or memory map.
+    del bfr_np
 
     for _i in _errs_and_warnings:
         if isinstance(_i, InternalMSEEDReadingError):
@@ -806,6 +844,23 @@ def _write_mseed(stream, filename, encoding=None, reclen=None, byteorder=None,
     else:
         f = filename
 
+    # libmseed still logs to the callbacks of the last read which might not
+    # exist anymore. Collect its messages while packing instead, they are
+    # part of the error message and printed if verbose.
+    pack_messages = []
+
+    def log_pack_message(msg):
+        msg = msg.decode().strip()
+        for prefix in ("ERROR: ", "Error: ", "INFO: "):
+            if msg.startswith(prefix):
+                msg = msg[len(prefix):]
+        pack_messages.append(msg)
+        if verbose:
+            print(msg)
+    global _pack_log
+    _pack_log = C.CFUNCTYPE(C.c_void_p, C.c_char_p)(log_pack_message)
+    clibmseed.ms_loginit(_pack_log, None, _pack_log, None)
+
     # Loop over every trace and finally write it to the filehandler.
     for trace, data, trace_attr in zip(stream, trace_data, trace_attributes):
         if not len(data):
@@ -918,7 +973,7 @@ def _write_mseed(stream, filename, encoding=None, reclen=None, byteorder=None,
         if errcode == -1:
             clibmseed.msr_free(C.pointer(msr))  # NOQA
             del mst, msr  # NOQA
-            raise Exception('Error in mst_pack')
+            raise Exception('Error in mst_pack: ' + ' '.join(pack_messages))
         # Deallocate any allocated memory.
         clibmseed.msr_free(C.pointer(msr))  # NOQA
         del mst, msr  # NOQA
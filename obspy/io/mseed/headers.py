@@ -540,6 +540,19 @@ clibmseed.msr_decode_steim1.argtypes = [
     C.c_int, C.c_char_p, C.c_int]
 clibmseed.msr_decode_steim1.restype = C.c_int
 
+# Steim decoders with runtime selected SIMD code paths. They behave exactly
+# like the libmseed decoders above.
+for _decode in (clibmseed.obspy_decode_steim1, clibmseed.obspy_decode_steim2):
+    _decode.argtypes = clibmseed.msr_decode_steim1.argtypes
+    _decode.restype = C.c_int
+del _decode
+
+clibmseed.obspy_steim_simd_level.argtypes = []
+clibmseed.obspy_steim_simd_level.restype = C.c_int
+
+clibmseed.obspy_set_steim_simd_level.argtypes = [C.c_int]
+clibmseed.obspy_set_steim_simd_level.restype = C.c_int
+
 # tricky, C.POINTER(C.c_char) is a pointer to single character fields
 # this is completely different to C.c_char_p which is a string
 clibmseed.mst_packgroup.argtypes = [
@@ -645,7 +658,7 @@ Selections._fields_ = [
 ]
 
 
-# Container for a continuous linked list of records.
+# Container for a continuous list of records.
 class ContinuousSegment(C.Structure):
     pass
 
@@ -660,8 +673,6 @@ ContinuousSegment._fields_ = [
     ('calibration_type', C.c_int8),
     ('datasamples', C.c_void_p),  # Data samples, 'numsamples' of type
                                   # 'sampletype'
-    ('firstRecord', C.c_void_p),
-    ('lastRecord', C.c_void_p),
     ('next', C.POINTER(ContinuousSegment)),
     ('previous', C.POINTER(ContinuousSegment))
 ]
@@ -688,6 +699,30 @@ LinkedIDList._fields_ = [
 ]
 
 
+# Entry of a record index as built by indexMSEEDBuffer(). Mirrors the
+# RecordIndexEntry C structure. Times are in high precision time ticks.
+RECORD_INDEX_DTYPE = np.dtype([
+    (native_str('starttime'), np.int64),
+    (native_str('endtime'), np.int64),
+    (native_str('offset'), np.int64),
+    (native_str('reclen'), np.int32),
+    (native_str('network'), native_str('S11')),
+    (native_str('station'), native_str('S11')),
+    (native_str('location'), native_str('S11')),
+    (native_str('channel'), native_str('S11')),
+    (native_str('dataquality'), native_str('S1'))], align=True)
+
+# Record index files always store the entries in little endian byte order
+# after a fixed size header.
+RECORD_INDEX_FILE_DTYPE = RECORD_INDEX_DTYPE.newbyteorder(native_str('<'))
+RECORD_INDEX_MAGIC = b'OBSPYMSI'
+RECORD_INDEX_VERSION = 2
+# Magic, version, size and modification time of the indexed file, record
+# length used to build the index (-1 if determined per record), number of
+# entries.
+RECORD_INDEX_HEADER = native_str('<8sIqdiq')
+
+
 #########################################
 # Done with the C structures definitions.
 #########################################
@@ -705,11 +740,24 @@ clibmseed.readMSEEDBuffer.argtypes = [
     C.c_int,
     C.CFUNCTYPE(C.c_longlong, C.c_int, C.c_char),
     C.CFUNCTYPE(C.c_void_p, C.c_char_p),
-    C.CFUNCTYPE(C.c_void_p, C.c_char_p)
+    C.CFUNCTYPE(C.c_void_p, C.c_char_p),
+    C.c_int
 ]
 
 clibmseed.readMSEEDBuffer.restype = C.POINTER(LinkedIDList)
 
+clibmseed.indexMSEEDBuffer.argtypes = [
+    np.ctypeslib.ndpointer(dtype=np.int8, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int,
+    C.c_int,
+    C.c_int,
+    C.CFUNCTYPE(C.c_longlong, C.c_int),
+    C.CFUNCTYPE(C.c_void_p, C.c_char_p),
+    C.CFUNCTYPE(C.c_void_p, C.c_char_p)
+]
+clibmseed.indexMSEEDBuffer.restype = C.c_int
+
 clibmseed.msr_free.argtypes = [C.POINTER(C.POINTER(MSRecord))]
 clibmseed.msr_free.restype = C.c_void_p
 
@@ -740,6 +788,15 @@ clibmseed.ms_nomsamprate.argtypes = [
 clibmseed.ms_nomsamprate.restype = C.c_double
 
 
+clibmseed.ms_loginit.argtypes = [
+    C.CFUNCTYPE(C.c_void_p, C.c_char_p),
+    C.c_char_p,
+    C.CFUNCTYPE(C.c_void_p, C.c_char_p),
+    C.c_char_p
+]
+clibmseed.ms_loginit.restype = C.c_void_p
+
+
 # Python callback functions for C
 def _py_file_callback(_f):
     return 1
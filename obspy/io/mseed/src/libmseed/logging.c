@@ -233,6 +233,9 @@ int
 ms_log_main (MSLogParam *logp, int level, va_list *varlist)
 {
   static char message[MAX_LOG_MSG_LENGTH];
+  /* ObsPy: readMSEEDBuffer() might decode records from several OpenMP
+   * threads, give each of them its own message buffer. */
+  #pragma omp threadprivate(message)
   int retvalue = 0;
   int presize;
   const char *format;
@@ -18,6 +18,11 @@
 #include "libmseed.h"
 #include "packdata.h"
 
+/* ObsPy: Use the SIMD Steim2 encoder if compiled as part of ObsPy. */
+#ifdef OBSPY_STEIM_ENCODER
+#include "../obspy-steim.h"
+#endif
+
 /* Function(s) internal to this file */
 static int msr_pack_header_raw (MSRecord *msr, char *rawrec, int maxheaderlen,
                                 flag swapflag, flag normalize,
@@ -1032,6 +1037,11 @@ msr_pack_data (void *dest, void *src, int maxsamples, int maxdatabytes,
     if (verbose > 1)
       ms_log (1, "%s: Packing Steim2 data frames\n", srcname);
 
+#ifdef OBSPY_STEIM_ENCODER
+    if (!encodedebug)
+      nsamples = obspy_encode_steim2 (src, maxsamples, dest, maxdatabytes, d0, srcname, swapflag);
+    else
+#endif
     nsamples = msr_encode_steim2 (src, maxsamples, dest, maxdatabytes, d0, srcname, swapflag);
 
     /* If a previous sample is supplied update it with the last sample value */
@@ -16,6 +16,7 @@
 
 #include "libmseed/libmseed.h"
 #include "libmseed/unpackdata.h"
+#include "obspy-steim.h"
 
 
 // Similar to MS_ISVALIDBLANK but also works for blocks consisting only of
@@ -55,15 +56,7 @@ void * allocate_bytes(int count) {
 }
 
 
-// Linkable container of MSRecords
-typedef struct LinkedRecordList_s {
-    struct MSRecord_s      *record;       // This record
-    struct LinkedRecordList_s  *previous; // The previous record container
-    struct LinkedRecordList_s  *next;     // The next record container
-}
-LinkedRecordList;
-
-// Container for a continuous linked list of records.
+// Container for a continuous list of records.
 typedef struct ContinuousSegment_s {
     hptime_t starttime;                     // Time of the first sample
     hptime_t endtime;                       // Time of the last sample
@@ -78,8 +71,6 @@ typedef struct ContinuousSegment_s {
      * BLK 390 = 4, BLK 395 = -2 */
     int8_t calibration_type;
     void *datasamples;                      // Actual data samples
-    struct LinkedRecordList_s *firstRecord; // First item
-    struct LinkedRecordList_s *lastRecord;  // Last item
     struct ContinuousSegment_s *next;       // Next segment
     struct ContinuousSegment_s *previous;   // Previous segment
 }
@@ -99,12 +90,40 @@ typedef struct LinkedIDList_s {
 }
 LinkedIDList;
 
+// Compact description of a single record as gathered by the header pass. It
+// holds everything needed to later decode the record's payload straight into
+// its slice of the final segment array.
+typedef struct RecordSlot_s {
+    int offset;                         // Offset of the record in the buffer
+    int reclen;                         // Record length in bytes
+    int32_t samplecnt;                  // Number of samples in the record
+    uint16_t data_offset;               // Offset of the data section
+    int8_t encoding;                    // Data encoding format
+    int8_t swapflag;                    // Swap the data samples?
+    int64_t sample_offset;              // Index of first sample in segment
+    struct ContinuousSegment_s *segment; // Segment the record belongs to
+}
+RecordSlot;
+
+// Entry of a record index as built by indexMSEEDBuffer(). Mirrored by
+// RecordIndexEntry in headers.py and the numpy dtype of the index files.
+typedef struct RecordIndexEntry_s {
+    hptime_t starttime;                 // Time of the first sample
+    hptime_t endtime;                   // Time of the last sample
+    int64_t offset;                     // Offset of the record in the buffer
+    int32_t reclen;                     // Record length in bytes
+    char network[11];                   // Network designation, NULL terminated
+    char station[11];                   // Station designation, NULL terminated
+    char location[11];                  // Location designation, NULL terminated
+    char channel[11];                   // Channel designation, NULL terminated
+    char dataquality;                   // Data quality indicator
+}
+RecordIndexEntry;
+
 
 // Forward declarations
 LinkedIDList * lil_init(void);
-LinkedRecordList * lrl_init (void);
 ContinuousSegment * seg_init(void);
-void lrl_free(LinkedRecordList * lrl);
 void seg_free(ContinuousSegment * seg);
 void lil_free(LinkedIDList * lil);
 
@@ -123,21 +142,7 @@ lil_init(void)
     return lil;
 }
 
-// Init function for the LinkedRecordList
-LinkedRecordList *
-lrl_init (void)
-{
-    // Allocate 0 initialized memory.
-    LinkedRecordList *lrl = (LinkedRecordList *) malloc (sizeof(LinkedRecordList));
-    if ( lrl == NULL ) {
-        ms_log (2, "lrl_init(): Cannot allocate memory\n");
-        return NULL;
-    }
-    memset (lrl, 0, sizeof (LinkedRecordList));
-    return lrl;
-}
-
-// Init a Segment with a linked record list.
+// Init a Segment.
 ContinuousSegment *
 seg_init(void)
 {
@@ -150,24 +155,6 @@ seg_init(void)
     return seg;
 }
 
-// Frees a LinkedRecordList. The given Record is assumed to be the head of the
-// list.
-void
-lrl_free(LinkedRecordList * lrl)
-{
-    LinkedRecordList * next;
-    while ( lrl != NULL) {
-        next = lrl->next;
-        msr_free(&lrl->record);
-        free(lrl);
-        if (next == NULL) {
-            break;
-        }
-        lrl = next;
-    }
-    lrl = NULL;
-}
-
 // Frees a ContinuousSegment and all structures associated with it.
 // The given segment is supposed to be the head of the linked list.
 void
@@ -176,10 +163,7 @@ seg_free(ContinuousSegment * seg)
     ContinuousSegment * next;
     while (seg != NULL) {
         next = seg->next;
-        // free(seg->datasamples);
-        if (seg->firstRecord != NULL) {
-            lrl_free(seg->firstRecord);
-        }
+        // The data samples are owned by the caller (allocData).
         free(seg);
         if (next == NULL) {
             break;
@@ -208,6 +192,121 @@ lil_free(LinkedIDList * lil)
     lil = NULL;
 }
 
+// Sample type a record with the given encoding decodes to. Mirrors the
+// mapping in msr_unpack_data(). Returns 0 for unknown encodings.
+char
+encoding_sampletype(int encoding)
+{
+    switch (encoding) {
+        case DE_ASCII:
+            return 'a';
+        case DE_INT16:
+        case DE_INT32:
+        case DE_STEIM1:
+        case DE_STEIM2:
+        case DE_CDSN:
+        case DE_SRO:
+        case DE_DWWSSN:
+            return 'i';
+        case DE_FLOAT32:
+        case DE_GEOSCOPE24:
+        case DE_GEOSCOPE163:
+        case DE_GEOSCOPE164:
+            return 'f';
+        case DE_FLOAT64:
+            return 'd';
+        default:
+            return 0;
+    }
+}
+
+// Decode the payload of a single record directly into output which has to
+// have room for samplecnt samples. This is msr_unpack_data() without the
+// intermediate per-record sample buffer. Returns the number of decoded
+// samples or a negative libmseed error code.
+int
+decode_record_into(char *record, RecordSlot *slot, void *output,
+                   char *srcname, flag verbose)
+{
+    int nsamples;
+    int datasize = slot->reclen - slot->data_offset;
+    int unpacksize = slot->samplecnt *
+        ms_samplesize(encoding_sampletype(slot->encoding));
+    char *dbuf = record + slot->data_offset;
+
+    if (verbose > 2) {
+        ms_log (1, "%s: Unpacking %d samples\n", srcname, slot->samplecnt);
+    }
+
+    switch (slot->encoding) {
+        case DE_ASCII:
+            nsamples = slot->samplecnt;
+            memcpy (output, dbuf, nsamples);
+            break;
+        case DE_INT16:
+            nsamples = msr_decode_int16 ((int16_t *)dbuf, slot->samplecnt,
+                                         output, unpacksize, slot->swapflag);
+            break;
+        case DE_INT32:
+            nsamples = msr_decode_int32 ((int32_t *)dbuf, slot->samplecnt,
+                                         output, unpacksize, slot->swapflag);
+            break;
+        case DE_FLOAT32:
+            nsamples = msr_decode_float32 ((float *)dbuf, slot->samplecnt,
+                                           output, unpacksize, slot->swapflag);
+            break;
+        case DE_FLOAT64:
+            nsamples = msr_decode_float64 ((double *)dbuf, slot->samplecnt,
+                                           output, unpacksize, slot->swapflag);
+            break;
+        case DE_STEIM1:
+            nsamples = obspy_decode_steim1 ((int32_t *)dbuf, datasize, slot->samplecnt,
+                                          output, unpacksize, srcname, slot->swapflag);
+            if (nsamples < 0) {
+                return MS_GENERROR;
+            }
+            break;
+        case DE_STEIM2:
+            nsamples = obspy_decode_steim2 ((int32_t *)dbuf, datasize, slot->samplecnt,
+                                          output, unpacksize, srcname, slot->swapflag);
+            if (nsamples < 0) {
+                return MS_GENERROR;
+            }
+            break;
+        case DE_GEOSCOPE24:
+        case DE_GEOSCOPE163:
+        case DE_GEOSCOPE164:
+            nsamples = msr_decode_geoscope (dbuf, slot->samplecnt, output,
+                                            unpacksize, slot->encoding, srcname,
+                                            slot->swapflag);
+            break;
+        case DE_CDSN:
+            nsamples = msr_decode_cdsn ((int16_t *)dbuf, slot->samplecnt, output,
+                                        unpacksize, slot->swapflag);
+            break;
+        case DE_SRO:
+            nsamples = msr_decode_sro ((int16_t *)dbuf, slot->samplecnt, output,
+                                       unpacksize, srcname, slot->swapflag);
+            break;
+        case DE_DWWSSN:
+            nsamples = msr_decode_dwwssn ((int16_t *)dbuf, slot->samplecnt, output,
+                                          unpacksize, slot->swapflag);
+            break;
+        default:
+            ms_log (2, "%s: Unsupported encoding format %d (%s)\n",
+                    srcname, slot->encoding, (char *)ms_encodingstr (slot->encoding));
+            return MS_UNKNOWNFORMAT;
+    }
+
+    if (nsamples != slot->samplecnt) {
+        ms_log (2, "msr_unpack_data(%s): only decoded %d samples of %d expected\n",
+                srcname, nsamples, slot->samplecnt);
+        return MS_GENERROR;
+    }
+
+    return nsamples;
+}
+
 // Print function that does nothing.
 void empty_print(char *string) {}
 
@@ -260,25 +359,119 @@ void log_error(int errcode, int offset) {
 }
 
 
+// Parses the header of the record starting at *offset into msr without
+// unpacking its data. Blank blocks are skipped by advancing *offset.
+//
+// Returns 1 if a record header has been parsed, 0 if a blank block has been
+// skipped and -1 if the rest of the buffer cannot be read.
+static int
+parse_record_header (char *mseed, int buflen, int *offset, MSRecord **msr,
+                     int reclen, flag verbose)
+{
+    int retcode = 0;
+    flag dataflag = 0;
+
+    if (verbose > 1) {
+        ms_log(0, "readMSEEDBuffer(): calling msr_parse with "
+                  "mseed+offset=%d+%d, buflen=%d, reclen=%d, dataflag=%d, verbose=%d\n",
+                  mseed, *offset, buflen, reclen, dataflag, verbose);
+    }
+
+    // If the record length is given, make sure at least that amount of data is available.
+    if (reclen != -1) {
+        if (*offset + reclen > buflen) {
+            ms_log(1, "readMSEEDBuffer(): Last reclen exceeds buflen, skipping.\n");
+            return -1;
+        }
+    }
+    // Otherwise assume the smallest possible record length and assure that enough
+    // data is present.
+    else {
+        if (*offset + MINRECLEN > buflen) {
+            ms_log(1, "readMSEEDBuffer(): Last record only has %i byte(s) which "
+                      "is not enough to constitute a full SEED record. Corrupt data? "
+                      "Record will be skipped.\n", buflen - *offset);
+            return -1;
+        }
+    }
+
+    // Skip empty or noise records.
+    if (OBSPY_ISVALIDBLANK(mseed + *offset)) {
+        *offset += MINRECLEN;
+        return 0;
+    }
+
+    // Pass (buflen - offset) because msr_parse() expects only a single record. This
+    // way libmseed can take care to not overstep bounds.
+    // Return values:
+    //   0 : Success, populates the supplied MSRecord.
+    //  >0 : Data record detected but not enough data is present, the
+    //       return value is a hint of how many more bytes are needed.
+    //  <0 : libmseed error code (listed in libmseed.h) is returned.
+    retcode = msr_parse ((mseed + *offset), buflen - *offset, msr, reclen, dataflag, verbose);
+    // Handle error.
+    if (retcode < 0) {
+        log_error(retcode, *offset);
+        return -1;
+    }
+    // msr_parse() returns > 0 if a data record has been detected but the buffer either has not enough
+    // data (this cannot happen with ObsPy's logic) or the last record has no Blockette 1000 and it cannot
+    // determine the record length because there is no next record (this can happen in ObsPy) - handle that
+    // case by just calling msr_parse() with an explicit record length set.
+    else if ( retcode > 0 && retcode < (buflen - *offset)) {
+
+        // Check if the remaining bytes can exactly make up a record length.
+        int r_bytes = buflen - *offset;
+        float exp = log10((float)r_bytes) / log10(2.0);
+        if ((fmodf(exp, 1.0) < 0.0000001) && ((int)roundf_(exp) >= 7) && ((int)roundf_(exp) <= 256)) {
+
+            retcode = msr_parse((mseed + *offset), buflen - *offset, msr, r_bytes, dataflag, verbose);
+
+            if ( retcode != 0 ) {
+                log_error(retcode, *offset);
+                return -1;
+            }
+
+        }
+        else {
+            return -1;
+        }
+    }
+
+    if (*offset + (*msr)->reclen > buflen) {
+        ms_log(1, "readMSEEDBuffer(): Last msr->reclen exceeds buflen, skipping.\n");
+        return -1;
+    }
+
+    return 1;
+}
+
+
 // Function that reads from a MiniSEED binary file from a char buffer and
 // returns a LinkedIDList.
+//
+// The buffer is read in two passes. The first pass only parses the record
+// headers and builds the id/segment layout together with a compact slot per
+// record. Once all segment sizes are known the final sample arrays are
+// allocated via the allocData callback and the second pass decodes every
+// record's payload straight into its slice of these arrays.
+//
+// As the records write to disjoint parts of the arrays the second pass can be
+// distributed over the given number of threads if compiled with OpenMP.
 LinkedIDList *
 readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
                  unpack_data, int reclen, flag verbose, flag details,
                  int header_byteorder, long long (*allocData) (int, char),
-                 void (*diag_print) (char*), void (*log_print) (char*))
+                 void (*diag_print) (char*), void (*log_print) (char*),
+                 int threads)
 {
     int retcode = 0;
-    int retval = 0;
     flag swapflag = 0;
     flag bigendianhost = ms_bigendianhost();
 
     // current offset of mseed char pointer
     int offset = 0;
 
-    // Unpack without reading the data first
-    flag dataflag = 0;
-
     // the timing_qual of BLK 1001
     uint8_t timing_qual = 0xFF;
 
@@ -294,12 +487,12 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
     hptime_t lastgap = 0;
     hptime_t hptimetol = 0;
     hptime_t nhptimetol = 0;
-    long long data_offset;
-    LinkedRecordList *recordHead = NULL;
-    LinkedRecordList *recordPrevious = NULL;
-    LinkedRecordList *recordCurrent = NULL;
-    int datasize;
+    char sampletype;
+    RecordSlot *slots = NULL;
+    RecordSlot *slot = NULL;
+    int slot_capacity = 0;
     int record_count = 0;
+    int i;
 
     // A negative verbosity suppresses as much as possible.
     if (verbose < 0) {
@@ -323,89 +516,22 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
         MS_UNPACKHEADERBYTEORDER(-1);
     }
 
-    // Read all records and save them in a linked list.
-    while (offset < buflen) {
-        msr = msr_init(NULL);
-        if ( msr == NULL ) {
-            ms_log (2, "readMSEEDBuffer(): Error initializing msr\n");
-            return NULL;
-        }
-        if (verbose > 1) {
-            ms_log(0, "readMSEEDBuffer(): calling msr_parse with "
-                      "mseed+offset=%d+%d, buflen=%d, reclen=%d, dataflag=%d, verbose=%d\n",
-                      mseed, offset, buflen, reclen, dataflag, verbose);
-        }
-
-        // If the record length is given, make sure at least that amount of data is available.
-        if (reclen != -1) {
-            if (offset + reclen > buflen) {
-                ms_log(1, "readMSEEDBuffer(): Last reclen exceeds buflen, skipping.\n");
-                msr_free(&msr);
-                break;
-            }
-        }
-        // Otherwise assume the smallest possible record length and assure that enough
-        // data is present.
-        else {
-            if (offset + MINRECLEN > buflen) {
-                ms_log(1, "readMSEEDBuffer(): Last record only has %i byte(s) which "
-                          "is not enough to constitute a full SEED record. Corrupt data? "
-                          "Record will be skipped.\n", buflen - offset);
-                msr_free(&msr);
-                break;
-            }
-        }
-
-        // Skip empty or noise records.
-        if (OBSPY_ISVALIDBLANK(mseed + offset)) {
-            offset += MINRECLEN;
-            continue;
-        }
+    // The same MSRecord is reused for all headers.
+    msr = msr_init(NULL);
+    if ( msr == NULL ) {
+        ms_log (2, "readMSEEDBuffer(): Error initializing msr\n");
+        return NULL;
+    }
 
-        // Pass (buflen - offset) because msr_parse() expects only a single record. This
-        // way libmseed can take care to not overstep bounds.
-        // Return values:
-        //   0 : Success, populates the supplied MSRecord.
-        //  >0 : Data record detected but not enough data is present, the
-        //       return value is a hint of how many more bytes are needed.
-        //  <0 : libmseed error code (listed in libmseed.h) is returned.
-        retcode = msr_parse ((mseed+offset), buflen - offset, &msr, reclen, dataflag, verbose);
-        // Handle error.
+    // First pass: Parse all headers and sort the records by matching ids
+    // and then by time.
+    while (offset < buflen) {
+        retcode = parse_record_header(mseed, buflen, &offset, &msr, reclen, verbose);
         if (retcode < 0) {
-            log_error(retcode, offset);
-            msr_free(&msr);
             break;
         }
-        // msr_parse() returns > 0 if a data record has been detected but the buffer either has not enough
-        // data (this cannot happen with ObsPy's logic) or the last record has no Blockette 1000 and it cannot
-        // determine the record length because there is no next record (this can happen in ObsPy) - handle that
-        // case by just calling msr_parse() with an explicit record length set.
-        else if ( retcode > 0 && retcode < (buflen - offset)) {
-
-            // Check if the remaining bytes can exactly make up a record length.
-            int r_bytes = buflen - offset;
-            float exp = log10((float)r_bytes) / log10(2.0);
-            if ((fmodf(exp, 1.0) < 0.0000001) && ((int)roundf_(exp) >= 7) && ((int)roundf_(exp) <= 256)) {
-
-                retcode = msr_parse((mseed + offset), buflen - offset, &msr, r_bytes, dataflag, verbose);
-
-                if ( retcode != 0 ) {
-                    log_error(retcode, offset);
-                    msr_free(&msr);
-                    break;
-                }
-
-            }
-            else {
-                msr_free(&msr);
-                break;
-            }
-        }
-
-        if (offset + msr->reclen > buflen) {
-            ms_log(1, "readMSEEDBuffer(): Last msr->reclen exceeds buflen, skipping.\n");
-            msr_free(&msr);
-            break;
+        else if (retcode == 0) {
+            continue;
         }
 
         // Test against selections if supplied
@@ -417,29 +543,26 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
             if ( ms_matchselect (selections, srcname, msr->starttime, endtime, NULL) == NULL ) {
                 // Add the record length for the next iteration
                 offset += msr->reclen;
-                // Free record.
-                msr_free(&msr);
                 continue;
             }
         }
-        record_count += 1;
 
-        recordCurrent = lrl_init ();
-        // Append to linked record list if one exists.
-        if ( recordHead != NULL ) {
-            recordPrevious->next = recordCurrent;
-            recordCurrent->previous = recordPrevious;
-            recordCurrent->next = NULL;
-            recordPrevious = recordCurrent;
-        }
-        // Otherwise create a new one.
-        else {
-            recordHead = recordCurrent;
-            recordCurrent->previous = NULL;
-            recordPrevious = recordCurrent;
+        // Grow the slot array geometrically.
+        if (record_count == slot_capacity) {
+            RecordSlot *grown;
+            slot_capacity = slot_capacity ? 2 * slot_capacity : 1024;
+            grown = (RecordSlot *) realloc (slots, slot_capacity * sizeof(RecordSlot));
+            if (grown == NULL) {
+                ms_log (2, "readMSEEDBuffer(): Cannot allocate memory\n");
+                free(slots);
+                msr_free(&msr);
+                lil_free(idListHead);
+                return NULL;
+            }
+            slots = grown;
         }
-        recordCurrent->record = msr;
-
+        slot = &slots[record_count];
+        record_count += 1;
 
         // Figure out if the byte-order of the data has to be swapped.
         swapflag = 0;
@@ -467,16 +590,21 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
             }
         }
 
-        // Actually unpack the data if the flag is not set and if the data
-        // offset is valid.
+        slot->offset = offset;
+        slot->reclen = msr->reclen;
+        slot->samplecnt = (int32_t) msr->samplecnt;
+        slot->data_offset = msr->fsdh->data_offset;
+        slot->encoding = msr->encoding;
+        slot->swapflag = swapflag;
+
+        // The data will only be unpacked if the flag is set and if the data
+        // offset is valid. Records that are not unpacked do not have a
+        // sample type.
+        sampletype = 0;
         if ((unpack_data != 0) && (msr->fsdh->data_offset >= 48) &&
             (msr->fsdh->data_offset < msr->reclen) &&
             (msr->samplecnt > 0)) {
-            retval = msr_unpack_data (msr, swapflag, verbose);
-        }
-
-        if ( retval > 0 ) {
-            msr->numsamples = retval;
+            sampletype = encoding_sampletype(msr->encoding);
         }
 
         if ( msr->fsdh->start_time.fract > 9999 ) {
@@ -489,30 +617,17 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
 
         // Add the record length for the next iteration
         offset += msr->reclen;
-    }
-
-    // Return empty id list if no records could be found.
-    if (record_count == 0) {
-        idListHead = lil_init();
-        return idListHead;
-    }
-
 
-    // All records that match the selection are now stored in a LinkedRecordList
-    // that starts at recordHead. The next step is to sort them by matching ids
-    // and then by time.
-    recordCurrent = recordHead;
-    while (recordCurrent != NULL) {
         // Check if the ID of the record is already available and if not create a
         // new one.
         // Start with the last id as it is most likely to be the correct one.
         idListCurrent = idListLast;
         while (idListCurrent != NULL) {
-            if (strcmp(idListCurrent->network, recordCurrent->record->network) == 0 &&
-                strcmp(idListCurrent->station, recordCurrent->record->station) == 0 &&
-                strcmp(idListCurrent->location, recordCurrent->record->location) == 0 &&
-                strcmp(idListCurrent->channel, recordCurrent->record->channel) == 0 &&
-                idListCurrent->dataquality == recordCurrent->record->dataquality) {
+            if (strcmp(idListCurrent->network, msr->network) == 0 &&
+                strcmp(idListCurrent->station, msr->station) == 0 &&
+                strcmp(idListCurrent->location, msr->location) == 0 &&
+                strcmp(idListCurrent->channel, msr->channel) == 0 &&
+                idListCurrent->dataquality == msr->dataquality) {
                 break;
             }
             else {
@@ -533,11 +648,11 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
             }
 
             // Set the IdList attributes.
-            strcpy(idListCurrent->network, recordCurrent->record->network);
-            strcpy(idListCurrent->station, recordCurrent->record->station);
-            strcpy(idListCurrent->location, recordCurrent->record->location);
-            strcpy(idListCurrent->channel, recordCurrent->record->channel);
-            idListCurrent->dataquality = recordCurrent->record->dataquality;
+            strcpy(idListCurrent->network, msr->network);
+            strcpy(idListCurrent->station, msr->station);
+            strcpy(idListCurrent->location, msr->location);
+            strcpy(idListCurrent->channel, msr->channel);
+            idListCurrent->dataquality = msr->dataquality;
         }
 
         // Now check if the current record fits exactly to the end of the last
@@ -548,13 +663,13 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
         if (segmentCurrent != NULL) {
             hptimetol = (hptime_t) (0.5 * segmentCurrent->hpdelta);
             nhptimetol = ( hptimetol ) ? -hptimetol : 0;
-            lastgap = recordCurrent->record->starttime - segmentCurrent->endtime - segmentCurrent->hpdelta;
+            lastgap = msr->starttime - segmentCurrent->endtime - segmentCurrent->hpdelta;
         }
         if (details == 1) {
             /* extract information on calibration BLKs */
             calibration_type = -1;
-            if (recordCurrent->record->blkts) {
-                BlktLink *cur_blkt = recordCurrent->record->blkts;
+            if (msr->blkts) {
+                BlktLink *cur_blkt = msr->blkts;
                 while (cur_blkt) {
                     switch (cur_blkt->blkt_type) {
                     case 300:
@@ -580,8 +695,8 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
             }
             /* extract information based on timing quality */
             timing_qual = 0xFF;
-            if (recordCurrent->record->Blkt1001 != 0) {
-                timing_qual = recordCurrent->record->Blkt1001->timing_qual;
+            if (msr->Blkt1001 != 0) {
+                timing_qual = msr->Blkt1001->timing_qual;
             }
         }
         if ( segmentCurrent != NULL &&
@@ -589,19 +704,18 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
              // This is important for zero data record coupled with not unpacking
              // the data. It needs to be split in two places: Before the zero data
              // record and after it.
-             recordCurrent->record->samplecnt > 0 && segmentCurrent->samplecnt > 0 &&
+             msr->samplecnt > 0 && segmentCurrent->samplecnt > 0 &&
 
-             segmentCurrent->sampletype == recordCurrent->record->sampletype &&
+             segmentCurrent->sampletype == sampletype &&
              // Test the default sample rate tolerance: abs(1-sr1/sr2) < 0.0001
-             MS_ISRATETOLERABLE (segmentCurrent->samprate, recordCurrent->record->samprate) &&
+             MS_ISRATETOLERABLE (segmentCurrent->samprate, msr->samprate) &&
              // Check if the times are within the time tolerance
              lastgap <= hptimetol && lastgap >= nhptimetol &&
              segmentCurrent->timing_qual == timing_qual &&
              segmentCurrent->calibration_type == calibration_type) {
-            recordCurrent->previous = segmentCurrent->lastRecord;
-            segmentCurrent->lastRecord = segmentCurrent->lastRecord->next = recordCurrent;
-            segmentCurrent->samplecnt += recordCurrent->record->samplecnt;
-            segmentCurrent->endtime = msr_endtime(recordCurrent->record);
+            slot->sample_offset = segmentCurrent->samplecnt;
+            segmentCurrent->samplecnt += msr->samplecnt;
+            segmentCurrent->endtime = msr_endtime(msr);
         }
         // Otherwise create a new segment and add the current record.
         else {
@@ -615,57 +729,161 @@ readMSEEDBuffer (char *mseed, int buflen, Selections *selections, flag
             }
             idListCurrent->lastSegment = segmentCurrent;
 
-            segmentCurrent->starttime = recordCurrent->record->starttime;
-            segmentCurrent->endtime = msr_endtime(recordCurrent->record);
-            segmentCurrent->samprate = recordCurrent->record->samprate;
-            segmentCurrent->sampletype = recordCurrent->record->sampletype;
-            segmentCurrent->samplecnt = recordCurrent->record->samplecnt;
+            segmentCurrent->starttime = msr->starttime;
+            segmentCurrent->endtime = msr_endtime(msr);
+            segmentCurrent->samprate = msr->samprate;
+            segmentCurrent->sampletype = sampletype;
+            segmentCurrent->samplecnt = msr->samplecnt;
             // Calculate high-precision sample period
-            segmentCurrent->hpdelta = (hptime_t) (( recordCurrent->record->samprate ) ?
-                           (HPTMODULUS / recordCurrent->record->samprate) : 0.0);
+            segmentCurrent->hpdelta = (hptime_t) (( msr->samprate ) ?
+                           (HPTMODULUS / msr->samprate) : 0.0);
             segmentCurrent->timing_qual = timing_qual;
             segmentCurrent->calibration_type = calibration_type;
-            segmentCurrent->firstRecord = segmentCurrent->lastRecord = recordCurrent;
-            recordCurrent->previous = NULL;
+            slot->sample_offset = 0;
         }
-        recordPrevious = recordCurrent->next;
-        recordCurrent->next = NULL;
-        recordCurrent = recordPrevious;
+        slot->segment = segmentCurrent;
     }
 
+    msr_free(&msr);
 
-    // Now loop over all segments, combine the records and free the msr
-    // structures.
-    idListCurrent = idListHead;
-    while (idListCurrent != NULL)
-    {
-        segmentCurrent = idListCurrent->firstSegment;
+    // Return empty id list if no records could be found.
+    if (record_count == 0) {
+        free(slots);
+        idListHead = lil_init();
+        return idListHead;
+    }
 
-        while (segmentCurrent != NULL) {
-            if (segmentCurrent->datasamples) {
-                free(segmentCurrent->datasamples);
-            }
-            // Allocate data via a callback function.
-            if (unpack_data != 0) {
+    // Allocate the final data arrays via a callback function. This has to
+    // happen in id and segment order as the caller relies on it.
+    if (unpack_data != 0) {
+        idListCurrent = idListHead;
+        while (idListCurrent != NULL) {
+            segmentCurrent = idListCurrent->firstSegment;
+            while (segmentCurrent != NULL) {
                 segmentCurrent->datasamples = (void *) allocData(segmentCurrent->samplecnt, segmentCurrent->sampletype);
+                segmentCurrent = segmentCurrent->next;
             }
+            idListCurrent = idListCurrent->next;
+        }
+    }
+
+    // Second pass: Decode all records straight into the segment arrays.
+    if (threads < 1) {
+        threads = 1;
+    }
+    #pragma omp parallel for num_threads(threads) schedule(dynamic, 64) if(threads > 1 && unpack_data != 0)
+    for (i = 0; i < record_count; i++) {
+        char srcname[50];
+        RecordSlot *s = &slots[i];
+        ContinuousSegment *seg = s->segment;
+        char *output;
+        if (seg->sampletype == 0 || s->samplecnt <= 0 ||
+                seg->datasamples == NULL) {
+            continue;
+        }
+        output = (char *) seg->datasamples +
+            s->sample_offset * ms_samplesize(seg->sampletype);
+        ms_recsrcname(mseed + s->offset, srcname, 1);
+        if (decode_record_into(mseed + s->offset, s, output, srcname,
+                               verbose) < 0) {
+            // Do not hand out uninitialized memory as data.
+            memset(output, 0, s->samplecnt * ms_samplesize(seg->sampletype));
+            ms_log(1, "readMSEEDBuffer(): Could not decode the data of the "
+                      "record starting at offset %lld. Its %d samples are "
+                      "set to zero.\n", (long long) s->offset, s->samplecnt);
+        }
+    }
 
-            // Loop over all records, write the data to the buffer and free the msr structures.
-            recordCurrent = segmentCurrent->firstRecord;
-            data_offset = (long long)(segmentCurrent->datasamples);
-            while (recordCurrent != NULL) {
-                datasize = recordCurrent->record->samplecnt * ms_samplesize(recordCurrent->record->sampletype);
-                memcpy((void *)data_offset, recordCurrent->record->datasamples, datasize);
-                // Free the record.
-                msr_free(&(recordCurrent->record));
-                // Increase the data_offset and the record.
-                data_offset += (long long)datasize;
-                recordCurrent = recordCurrent->next;
+    free(slots);
+    return idListHead;
+}
+
+
+// Builds an index of all data records in a MiniSEED buffer by only parsing
+// the record headers. The records are parsed exactly like in the first pass
+// of readMSEEDBuffer() so the index covers the same records.
+//
+// Once the number of records is known the memory for the index is requested
+// via the allocIndex callback and filled in buffer order. Returns the number
+// of indexed records or -1 on error.
+int
+indexMSEEDBuffer (char *mseed, int buflen, int reclen, int header_byteorder,
+                  long long (*allocIndex) (int),
+                  void (*diag_print) (char*), void (*log_print) (char*))
+{
+    int retcode = 0;
+    int offset = 0;
+    MSRecord *msr = NULL;
+    RecordIndexEntry *entries = NULL;
+    RecordIndexEntry *entry = NULL;
+    RecordIndexEntry *output = NULL;
+    int capacity = 0;
+    int count = 0;
+
+    ms_loginit(log_print, "INFO: ", diag_print, "ERROR: ");
+
+    if (header_byteorder >= 0) {
+        MS_UNPACKHEADERBYTEORDER(header_byteorder == 0 ? 0 : 1);
+    }
+    else {
+        MS_UNPACKHEADERBYTEORDER(-1);
+    }
+
+    msr = msr_init(NULL);
+    if ( msr == NULL ) {
+        ms_log (2, "indexMSEEDBuffer(): Error initializing msr\n");
+        return -1;
+    }
+
+    while (offset < buflen) {
+        retcode = parse_record_header(mseed, buflen, &offset, &msr, reclen, 0);
+        if (retcode < 0) {
+            break;
+        }
+        else if (retcode == 0) {
+            continue;
+        }
+
+        // Grow the entry array geometrically.
+        if (count == capacity) {
+            RecordIndexEntry *grown;
+            capacity = capacity ? 2 * capacity : 1024;
+            grown = (RecordIndexEntry *) realloc (entries, capacity * sizeof(RecordIndexEntry));
+            if (grown == NULL) {
+                ms_log (2, "indexMSEEDBuffer(): Cannot allocate memory\n");
+                free(entries);
+                msr_free(&msr);
+                return -1;
             }
+            entries = grown;
+        }
+        entry = &entries[count];
+        count += 1;
+
+        memset (entry, 0, sizeof (RecordIndexEntry));
+        entry->starttime = msr->starttime;
+        entry->endtime = msr_endtime(msr);
+        entry->offset = offset;
+        entry->reclen = msr->reclen;
+        strcpy(entry->network, msr->network);
+        strcpy(entry->station, msr->station);
+        strcpy(entry->location, msr->location);
+        strcpy(entry->channel, msr->channel);
+        entry->dataquality = msr->dataquality;
 
-            segmentCurrent = segmentCurrent->next;
+        offset += msr->reclen;
+    }
+
+    msr_free(&msr);
+
+    if (count > 0) {
+        output = (RecordIndexEntry *) allocIndex(count);
+        if (output == NULL) {
+            free(entries);
+            return -1;
         }
-        idListCurrent = idListCurrent->next;
+        memcpy(output, entries, count * sizeof(RecordIndexEntry));
     }
-    return idListHead;
+    free(entries);
+    return count;
 }
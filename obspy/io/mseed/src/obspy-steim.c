@@ -0,0 +1,559 @@
+/***************************************************************************
+ * obspy-steim.c:
+ *
+ * Steim1 and Steim2 decoders with SIMD (SSE4.1 and AVX2) code paths and a
+ * Steim2 encoder with an SSE4.1 code path.
+ *
+ * The fastest code path supported by the CPU is selected at runtime. The
+ * SIMD decoders expand all differences of a frame into a buffer, one 32-bit
+ * word at a time with a single broadcast/shift/arithmetic shift sequence
+ * driven by a small layout table, and then integrate them with a SIMD prefix
+ * sum. Anything out of the ordinary (invalid control codes, missing frames)
+ * is handed to the scalar libmseed decoders which thus define the exact
+ * behaviour, including all log messages.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "obspy-steim.h"
+#include "libmseed/unpackdata.h"
+#include "libmseed/packdata.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define OBSPY_STEIM_X86 1
+#include <immintrin.h>
+#endif
+
+
+// Currently used SIMD level, -1 if not yet determined.
+static int steim_simd_level = -1;
+
+
+// Position of the k-th of count differences each width bits wide in a 32-bit
+// word, given as the left shift moving it to the most significant bits. The
+// first difference is either stored in the most or in the least significant
+// bits. Unused lanes get a shift of zero.
+#define LS(c, w, k, msb) ((k) < (c) ? ((msb) ? 32 - (w) - ((c) - 1 - (k)) * (w) \
+                                             : 32 - (w) - (k) * (w)) : 0)
+#define LSHIFTS(c, w, msb) {LS(c, w, 0, msb), LS(c, w, 1, msb), LS(c, w, 2, msb), \
+                            LS(c, w, 3, msb), LS(c, w, 4, msb), LS(c, w, 5, msb), \
+                            LS(c, w, 6, msb), LS(c, w, 7, msb)}
+#define FACTORS(c, w, msb) {1u << LS(c, w, 0, msb), 1u << LS(c, w, 1, msb), \
+                            1u << LS(c, w, 2, msb), 1u << LS(c, w, 3, msb), \
+                            1u << LS(c, w, 4, msb), 1u << LS(c, w, 5, msb), \
+                            1u << LS(c, w, 6, msb), 1u << LS(c, w, 7, msb)}
+#define LAYOUT(c, w, msb) {c, 32 - (w), LSHIFTS(c, w, msb), FACTORS(c, w, msb)}
+#define NODIFF {0, 0, {0}, {0}}
+#define INVALID {-1, 0, {0}, {0}}
+
+// Layout of the differences packed in a single 32-bit word.
+typedef struct SteimWordLayout_s {
+    int count;              // Number of differences, -1 for invalid codes
+    int rshift;             // 32 - bit width of the differences
+    int32_t lshift[8];      // Left shift moving each difference to the top
+    uint32_t factor[8];     // The same as a multiplication factor
+}
+SteimWordLayout;
+
+// Steim1 layouts indexed by the word's nibble. The byte and 16-bit
+// differences are stored in memory order, i.e. the first one is in the most
+// significant bits of the (swapped) word if the data has to be swapped and
+// in the least significant bits otherwise (little endian host).
+static const SteimWordLayout steim1_layouts[2][4] = {
+    {NODIFF, LAYOUT(4, 8, 0), LAYOUT(2, 16, 0), LAYOUT(1, 32, 0)},
+    {NODIFF, LAYOUT(4, 8, 1), LAYOUT(2, 16, 1), LAYOUT(1, 32, 1)}
+};
+
+// Steim2 layouts indexed by (nibble << 2) | dnib.
+static const SteimWordLayout steim2_layouts[2][16] = {
+    {NODIFF, NODIFF, NODIFF, NODIFF,
+     LAYOUT(4, 8, 0), LAYOUT(4, 8, 0), LAYOUT(4, 8, 0), LAYOUT(4, 8, 0),
+     INVALID, LAYOUT(1, 30, 1), LAYOUT(2, 15, 1), LAYOUT(3, 10, 1),
+     LAYOUT(5, 6, 1), LAYOUT(6, 5, 1), LAYOUT(7, 4, 1), INVALID},
+    {NODIFF, NODIFF, NODIFF, NODIFF,
+     LAYOUT(4, 8, 1), LAYOUT(4, 8, 1), LAYOUT(4, 8, 1), LAYOUT(4, 8, 1),
+     INVALID, LAYOUT(1, 30, 1), LAYOUT(2, 15, 1), LAYOUT(3, 10, 1),
+     LAYOUT(5, 6, 1), LAYOUT(6, 5, 1), LAYOUT(7, 4, 1), INVALID}
+};
+
+
+#ifdef OBSPY_STEIM_X86
+
+// Swaps the byte order of all 16 words of a frame.
+__attribute__((target("sse4.1")))
+static void
+swap_frame_sse41 (uint32_t *frame)
+{
+    const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+                                      4, 5, 6, 7, 0, 1, 2, 3);
+    int i;
+    for (i = 0; i < 16; i += 4) {
+        __m128i v = _mm_loadu_si128((__m128i *)(frame + i));
+        _mm_storeu_si128((__m128i *)(frame + i), _mm_shuffle_epi8(v, mask));
+    }
+}
+
+// Inclusive prefix sum of diff[0..count) added to carry, in place.
+__attribute__((target("sse4.1")))
+static void
+integrate_sse41 (int32_t *diff, int count, int32_t carry)
+{
+    __m128i c = _mm_set1_epi32(carry);
+    int i;
+    for (i = 0; i < count; i += 4) {
+        __m128i x = _mm_loadu_si128((__m128i *)(diff + i));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, c);
+        _mm_storeu_si128((__m128i *)(diff + i), x);
+        c = _mm_shuffle_epi32(x, 0xFF);
+    }
+}
+
+__attribute__((target("avx2")))
+static void
+integrate_avx2 (int32_t *diff, int count, int32_t carry)
+{
+    __m256i c = _mm256_set1_epi32(carry);
+    const __m256i last = _mm256_set1_epi32(7);
+    int i;
+    for (i = 0; i < count; i += 8) {
+        __m256i x = _mm256_loadu_si256((__m256i *)(diff + i));
+        __m256i t;
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        // Carry the sum of the lower half into the upper half.
+        t = _mm256_shuffle_epi32(x, 0xFF);
+        t = _mm256_permute2x128_si256(t, t, 0x08);
+        x = _mm256_add_epi32(x, _mm256_add_epi32(t, c));
+        _mm256_storeu_si256((__m256i *)(diff + i), x);
+        c = _mm256_permutevar8x32_epi32(x, last);
+    }
+}
+
+// Expands the differences of one word to diff, which needs room for 8 values.
+__attribute__((target("sse4.1")))
+static void
+expand_word_sse41 (uint32_t word, const SteimWordLayout *layout, int32_t *diff)
+{
+    __m128i v = _mm_set1_epi32((int32_t) word);
+    __m128i shift = _mm_cvtsi32_si128(layout->rshift);
+    __m128i lo = _mm_mullo_epi32(v, _mm_loadu_si128((__m128i *)layout->factor));
+    _mm_storeu_si128((__m128i *)diff, _mm_sra_epi32(lo, shift));
+    if (layout->count > 4) {
+        __m128i hi = _mm_mullo_epi32(v, _mm_loadu_si128((__m128i *)(layout->factor + 4)));
+        _mm_storeu_si128((__m128i *)(diff + 4), _mm_sra_epi32(hi, shift));
+    }
+}
+
+__attribute__((target("avx2")))
+static void
+expand_word_avx2 (uint32_t word, const SteimWordLayout *layout, int32_t *diff)
+{
+    __m256i v = _mm256_set1_epi32((int32_t) word);
+    v = _mm256_sllv_epi32(v, _mm256_loadu_si256((__m256i *)layout->lshift));
+    v = _mm256_sra_epi32(v, _mm_cvtsi32_si128(layout->rshift));
+    _mm256_storeu_si256((__m256i *)diff, v);
+}
+
+// Generates the frame loop for one SIMD level. Returns the number of
+// decoded samples or -1 if an invalid control code is encountered in which
+// case the caller has to fall back to the scalar decoder.
+#define STEIM_DECODE_FRAMES(NAME, TARGET, EXPAND, INTEGRATE)                    \
+__attribute__((target(TARGET)))                                                \
+static int                                                                     \
+NAME (int32_t *input, int maxframes, int samplecount, int32_t *output,         \
+      int swapflag, int steim2, int32_t *Xn)                                   \
+{                                                                              \
+    uint32_t frame[16];                                                        \
+    int32_t diff[15 * 7 + 8];                                                  \
+    const SteimWordLayout *layouts = steim2 ? steim2_layouts[swapflag != 0] :  \
+                                              steim1_layouts[swapflag != 0];   \
+    int32_t X0 = 0;                                                            \
+    int32_t carry = 0;                                                         \
+    int decoded = 0;                                                           \
+    int frameidx;                                                              \
+    int widx;                                                                  \
+    int n;                                                                     \
+                                                                               \
+    for (frameidx = 0; frameidx < maxframes && decoded < samplecount;          \
+         frameidx++) {                                                         \
+        int left = samplecount - decoded;                                      \
+        memcpy (frame, input + (16 * frameidx), 64);                           \
+        if (swapflag) {                                                        \
+            swap_frame_sse41(frame);                                           \
+        }                                                                      \
+        if (frameidx == 0) {                                                   \
+            X0 = (int32_t) frame[1];                                           \
+            *Xn = (int32_t) frame[2];                                          \
+        }                                                                      \
+        n = 0;                                                                 \
+        for (widx = frameidx ? 1 : 3; widx < 16 && n < left; widx++) {         \
+            uint32_t nibble = (frame[0] >> (30 - 2 * widx)) & 0x3;             \
+            const SteimWordLayout *layout = steim2 ?                           \
+                &layouts[(nibble << 2) | (frame[widx] >> 30)] :                \
+                &layouts[nibble];                                              \
+            if (layout->count <= 0) {                                          \
+                if (layout->count < 0) {                                       \
+                    return -1;                                                 \
+                }                                                              \
+                continue;                                                      \
+            }                                                                  \
+            EXPAND(frame[widx], layout, diff + n);                             \
+            n += layout->count;                                                \
+        }                                                                      \
+        if (n > left) {                                                        \
+            n = left;                                                          \
+        }                                                                      \
+        if (n == 0) {                                                          \
+            continue;                                                          \
+        }                                                                      \
+        /* The first difference is replaced by the first sample. */            \
+        if (decoded == 0) {                                                    \
+            diff[0] = X0;                                                      \
+        }                                                                      \
+        INTEGRATE(diff, n, carry);                                             \
+        memcpy (output + decoded, diff, n * sizeof(int32_t));                  \
+        carry = diff[n - 1];                                                   \
+        decoded += n;                                                          \
+    }                                                                          \
+    return decoded;                                                            \
+}
+
+STEIM_DECODE_FRAMES(decode_frames_sse41, "sse4.1", expand_word_sse41, integrate_sse41)
+STEIM_DECODE_FRAMES(decode_frames_avx2, "avx2", expand_word_avx2, integrate_avx2)
+
+
+// Number of differences the Steim2 encoder looks ahead, and the size of its
+// sliding window of precomputed differences.
+#define STEIM2_LOOKAHEAD 8
+#define STEIM2_WINDOW 512
+#define STEIM2_BLOCK 64
+
+// Sliding window of differences and their width classes for the encoder.
+// The class of a difference is the index of the narrowest Steim2 packing
+// (4, 5, 6, 8, 10, 15 or 30 bit) it fits into, 7 if it does not fit at all.
+typedef struct Steim2Window_s {
+    int32_t *input;         // Samples to encode
+    int ndiffs;             // Total number of differences
+    int32_t diff0;          // First difference
+    int base;               // Index of the first difference in the window
+    int filled;             // Index of the first not yet computed difference
+    int32_t diffs[STEIM2_WINDOW + STEIM2_LOOKAHEAD];
+    uint8_t classes[STEIM2_WINDOW + 2 * STEIM2_LOOKAHEAD];
+}
+Steim2Window;
+
+// Computes the differences and classes of the next block in bulk.
+__attribute__((target("sse4.1")))
+static void
+steim2_window_fill (Steim2Window *win)
+{
+    int end = win->filled + STEIM2_BLOCK;
+    int i = win->filled;
+    int32_t *d = win->diffs - win->base;
+    uint8_t *c = win->classes - win->base;
+    const __m128i t4 = _mm_set1_epi32(7);
+    const __m128i t5 = _mm_set1_epi32(15);
+    const __m128i t6 = _mm_set1_epi32(31);
+    const __m128i t8 = _mm_set1_epi32(127);
+    const __m128i t10 = _mm_set1_epi32(511);
+    const __m128i t15 = _mm_set1_epi32(16383);
+    const __m128i t30 = _mm_set1_epi32(536870911);
+
+    if (end > win->ndiffs) {
+        end = win->ndiffs;
+    }
+    if (i == 0 && i < end) {
+        d[0] = win->diff0;
+        i = 1;
+    }
+    for (; i + 4 <= end; i += 4) {
+        __m128i x = _mm_sub_epi32(_mm_loadu_si128((__m128i *)(win->input + i)),
+                                  _mm_loadu_si128((__m128i *)(win->input + i - 1)));
+        _mm_storeu_si128((__m128i *)(d + i), x);
+    }
+    for (; i < end; i++) {
+        d[i] = (int32_t) ((uint32_t) win->input[i] - (uint32_t) win->input[i - 1]);
+    }
+    for (i = win->filled; i < end; i += 4) {
+        __m128i x = _mm_loadu_si128((__m128i *)(d + i));
+        // Magnitude, -v - 1 for negative values.
+        __m128i m = _mm_xor_si128(x, _mm_srai_epi32(x, 31));
+        __m128i cls = _mm_setzero_si128();
+        cls = _mm_sub_epi32(cls, _mm_cmpgt_epi32(m, t4));
+        cls = _mm_sub_epi32(cls, _mm_cmpgt_epi32(m, t5));
+        cls = _mm_sub_epi32(cls, _mm_cmpgt_epi32(m, t6));
+        cls = _mm_sub_epi32(cls, _mm_cmpgt_epi32(m, t8));
+        cls = _mm_sub_epi32(cls, _mm_cmpgt_epi32(m, t10));
+        cls = _mm_sub_epi32(cls, _mm_cmpgt_epi32(m, t15));
+        cls = _mm_sub_epi32(cls, _mm_cmpgt_epi32(m, t30));
+        cls = _mm_packs_epi32(cls, cls);
+        cls = _mm_packus_epi16(cls, cls);
+        *(int32_t *)(c + i) = _mm_cvtsi128_si32(cls);
+    }
+    win->filled = end;
+    // Differences past the end never fit.
+    memset (c + end, 0xFF, STEIM2_LOOKAHEAD);
+}
+
+// Makes sure the differences pos .. pos + 7 are available, if they exist.
+__attribute__((target("sse4.1")))
+static void
+steim2_window_advance (Steim2Window *win, int pos)
+{
+    if (pos + STEIM2_LOOKAHEAD <= win->filled || win->filled == win->ndiffs) {
+        return;
+    }
+    if (win->filled + STEIM2_BLOCK - win->base > STEIM2_WINDOW) {
+        int keep = win->filled - pos;
+        memmove (win->diffs, win->diffs + (pos - win->base), keep * sizeof(int32_t));
+        memmove (win->classes, win->classes + (pos - win->base), keep);
+        win->base = pos;
+    }
+    steim2_window_fill(win);
+}
+
+// Shifts of the differences within a word for 1 to 7 differences per word.
+static const int steim2_shifts[8][7] = {
+    {0}, {0}, {15, 0}, {20, 10, 0},
+    {0, 8, 16, 24},             // Bytes in memory order on a little endian host
+    {24, 18, 12, 6, 0}, {25, 20, 15, 10, 5, 0}, {24, 20, 16, 12, 8, 4, 0}
+};
+static const uint32_t steim2_masks[8] = {
+    0, 0x3FFFFFFF, 0x7FFF, 0x3FF, 0xFF, 0x3F, 0x1F, 0xF};
+static const uint32_t steim2_dnibs[8] = {
+    0, 0x1u << 30, 0x2u << 30, 0x3u << 30, 0, 0, 0x1u << 30, 0x2u << 30};
+static const uint32_t steim2_nibbles[8] = {0, 2, 2, 2, 1, 3, 3, 3};
+
+// Steim2 encoder with the same signature and output as msr_encode_steim2().
+// Returns -1 if a difference needs more than 30 bits in which case the caller
+// has to fall back to the scalar encoder to get the exact same error
+// handling.
+__attribute__((target("sse4.1")))
+static int
+encode_steim2_sse41 (int32_t *input, int samplecount, int32_t *output,
+                     int outputlength, int32_t diff0, int swapflag)
+{
+    const __m128i thresholds = _mm_setr_epi8(6, 5, 4, 3, 2, 1, 0, -1,
+                                             -1, -1, -1, -1, -1, -1, -1, -1);
+    Steim2Window *win;
+    uint32_t frame[16];
+    int maxframes = outputlength / 64;
+    int outputsamples = 0;
+    int frameidx;
+    int widx;
+    int i;
+
+    win = (Steim2Window *) malloc (sizeof(Steim2Window));
+    if (win == NULL) {
+        return -1;
+    }
+    win->input = input;
+    win->diff0 = diff0;
+    win->base = 0;
+    win->filled = 0;
+    // No more differences than can possibly fit into the output are needed.
+    win->ndiffs = samplecount;
+    if (win->ndiffs > maxframes * 15 * 7) {
+        win->ndiffs = maxframes * 15 * 7;
+    }
+
+    for (frameidx = 0; frameidx < maxframes && outputsamples < samplecount; frameidx++) {
+        memset (frame, 0, 64);
+        if (frameidx == 0) {
+            frame[1] = input[0];
+        }
+        for (widx = frameidx ? 1 : 3; widx < 16 && outputsamples < samplecount; widx++) {
+            __m128i x;
+            int32_t *d;
+            unsigned int fits;
+            int k;
+            uint32_t word;
+
+            steim2_window_advance(win, outputsamples);
+            d = win->diffs + (outputsamples - win->base);
+
+            // Prefix maximum of the next 7 classes. k differences can be
+            // packed together if the maximum of the first k classes is at
+            // most 7 - k. Take the largest such k.
+            x = _mm_loadl_epi64((__m128i *)(win->classes + (outputsamples - win->base)));
+            x = _mm_max_epu8(x, _mm_slli_si128(x, 1));
+            x = _mm_max_epu8(x, _mm_slli_si128(x, 2));
+            x = _mm_max_epu8(x, _mm_slli_si128(x, 4));
+            fits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(x, thresholds), x)) & 0x7F;
+            if (!fits) {
+                free(win);
+                return -1;
+            }
+            k = 1;
+            while (fits >> k) {
+                k++;
+            }
+
+            word = steim2_dnibs[k];
+            for (i = 0; i < k; i++) {
+                word |= ((uint32_t) d[i] & steim2_masks[k]) << steim2_shifts[k][i];
+            }
+            // The 4 x 8-bit differences are stored in memory order.
+            if (swapflag && k != 4) {
+                ms_gswap4a (&word);
+            }
+            frame[widx] = word;
+            frame[0] |= steim2_nibbles[k] << (30 - 2 * widx);
+            outputsamples += k;
+        }
+
+        // The data words are already swapped, only swap the nibbles and X0.
+        if (swapflag) {
+            ms_gswap4a (&frame[0]);
+            if (frameidx == 0) {
+                ms_gswap4a (&frame[1]);
+            }
+        }
+        memcpy (output + 16 * frameidx, frame, 64);
+    }
+    free(win);
+
+    /* Set Xn (reverse integration constant) in first frame to last sample */
+    output[2] = input[outputsamples - 1];
+    if (swapflag) {
+        ms_gswap4a (&output[2]);
+    }
+
+    /* Pad any remaining bytes */
+    if ((frameidx * 64) < outputlength) {
+        memset (output + (frameidx * 16), 0, outputlength - (frameidx * 64));
+    }
+
+    return outputsamples;
+}
+
+#endif
+
+
+// Returns the SIMD level used for decoding and encoding. Determined on first
+// use.
+int
+obspy_steim_simd_level (void)
+{
+    if (steim_simd_level < 0) {
+        int level = STEIM_SIMD_SCALAR;
+#ifdef OBSPY_STEIM_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.1")) {
+            level = STEIM_SIMD_SSE41;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            level = STEIM_SIMD_AVX2;
+        }
+#endif
+        steim_simd_level = level;
+    }
+    return steim_simd_level;
+}
+
+// Sets the SIMD level, e.g. to force the scalar decoders. Levels not
+// supported by the CPU are capped. Returns the now active level.
+int
+obspy_set_steim_simd_level (int level)
+{
+    steim_simd_level = -1;
+    if (level < obspy_steim_simd_level()) {
+        steim_simd_level = level < 0 ? STEIM_SIMD_SCALAR : level;
+    }
+    return steim_simd_level;
+}
+
+
+// Common driver for both Steim versions. Same signature and semantics as
+// msr_decode_steim1() and msr_decode_steim2().
+static int
+decode_steim (int32_t *input, int inputlength, int samplecount,
+              int32_t *output, int outputlength, char *srcname,
+              int swapflag, int steim2)
+{
+#ifdef OBSPY_STEIM_X86
+    int32_t Xn = 0;
+    int maxframes = inputlength / 64;
+    int level = obspy_steim_simd_level();
+    int nsamples;
+
+    // The SIMD paths only cover the regular case and rely on a little
+    // endian host which x86 always is.
+    if (level > STEIM_SIMD_SCALAR && inputlength > 0 && input && output &&
+        outputlength > 0 && maxframes > 0) {
+        if (level >= STEIM_SIMD_AVX2) {
+            nsamples = decode_frames_avx2(input, maxframes, samplecount,
+                                          output, swapflag, steim2, &Xn);
+        }
+        else {
+            nsamples = decode_frames_sse41(input, maxframes, samplecount,
+                                           output, swapflag, steim2, &Xn);
+        }
+        if (nsamples >= 0) {
+            /* Check data integrity by comparing last sample to Xn (reverse integration constant) */
+            if (nsamples > 0 && output[nsamples - 1] != Xn) {
+                ms_log (1, "%s: Warning: Data integrity check for Steim%d failed, Last sample=%d, Xn=%d\n",
+                        srcname, steim2 ? 2 : 1, output[nsamples - 1], Xn);
+            }
+            return nsamples;
+        }
+    }
+#endif
+    if (steim2) {
+        return msr_decode_steim2 (input, inputlength, samplecount, output,
+                                  outputlength, srcname, swapflag);
+    }
+    return msr_decode_steim1 (input, inputlength, samplecount, output,
+                              outputlength, srcname, swapflag);
+}
+
+
+int
+obspy_decode_steim1 (int32_t *input, int inputlength, int samplecount,
+                     int32_t *output, int outputlength, char *srcname,
+                     int swapflag)
+{
+    return decode_steim (input, inputlength, samplecount, output,
+                         outputlength, srcname, swapflag, 0);
+}
+
+
+int
+obspy_decode_steim2 (int32_t *input, int inputlength, int samplecount,
+                     int32_t *output, int outputlength, char *srcname,
+                     int swapflag)
+{
+    return decode_steim (input, inputlength, samplecount, output,
+                         outputlength, srcname, swapflag, 1);
+}
+
+
+// Steim2 encoder, a drop-in replacement for msr_encode_steim2(). The SIMD
+// path computes the differences and the bit width classes in bulk and then
+// selects the packing of each word with a vectorized prefix maximum instead
+// of testing the candidate widths one by one. The resulting frames are
+// identical to the ones of the libmseed encoder, which is used as fallback.
+int
+obspy_encode_steim2 (int32_t *input, int samplecount, int32_t *output,
+                     int outputlength, int32_t diff0, char *srcname,
+                     int swapflag)
+{
+#ifdef OBSPY_STEIM_X86
+    int nsamples;
+
+    if (obspy_steim_simd_level() >= STEIM_SIMD_SSE41 && samplecount > 0 &&
+        input && output && outputlength >= 64) {
+        nsamples = encode_steim2_sse41(input, samplecount, output,
+                                       outputlength, diff0, swapflag);
+        if (nsamples >= 0) {
+            return nsamples;
+        }
+    }
+#endif
+    return msr_encode_steim2 (input, samplecount, output, outputlength,
+                              diff0, srcname, swapflag);
+}
@@ -0,0 +1,33 @@
+/***************************************************************************
+ * obspy-steim.h:
+ *
+ * Steim1 and Steim2 decoders and a Steim2 encoder with SIMD code paths
+ * which are selected at runtime. The libmseed decoders and encoders serve as
+ * the scalar reference.
+ ***************************************************************************/
+
+#ifndef OBSPY_STEIM_H
+#define OBSPY_STEIM_H 1
+
+#include "libmseed/libmseed.h"
+
+// SIMD levels. Higher levels imply the lower ones.
+#define STEIM_SIMD_SCALAR 0
+#define STEIM_SIMD_SSE41  1
+#define STEIM_SIMD_AVX2   2
+
+extern int obspy_steim_simd_level (void);
+extern int obspy_set_steim_simd_level (int level);
+
+extern int obspy_decode_steim1 (int32_t *input, int inputlength, int samplecount,
+                                int32_t *output, int outputlength, char *srcname,
+                                int swapflag);
+extern int obspy_decode_steim2 (int32_t *input, int inputlength, int samplecount,
+                                int32_t *output, int outputlength, char *srcname,
+                                int swapflag);
+
+extern int obspy_encode_steim2 (int32_t *input, int samplecount, int32_t *output,
+                                int outputlength, int32_t diff0, char *srcname,
+                                int swapflag);
+
+#endif
@@ -9,6 +9,7 @@ import glob
 import io
 import re
 import os
+import shutil
 import unittest
 import warnings
 from datetime import datetime
@@ -19,6 +20,7 @@ import numpy as np
 from obspy import Stream, Trace, UTCDateTime, read
 from obspy.core import AttribDict
 from obspy.core.util import CatchOutput, NamedTemporaryFile
+from obspy.core.util.misc import TemporaryWorkingDirectory
 from obspy.io.mseed import (util, InternalMSEEDReadingWarning,
                             InternalMSEEDReadingError)
 from obspy.io.mseed.core import _is_mseed, _read_mseed, _write_mseed
@@ -1306,6 +1308,204 @@ class MSEEDReadingAndWritingTestCase(unittest.TestCase):
             self.assertRaises(ValueError, st.write, tf, format="mseed",
                               encoding=11, reclen=512)
 
+    def test_read_memory_mapped_file(self):
+        """
+        Files are memory mapped when read by name. Make sure this results in
+        the same data as reading from a file-like object, also with time
+        selections, and that the mapping is released again.
+        """
+        filename = os.path.join(self.path, 'data', 'gaps.mseed')
+        with open(filename, 'rb') as fh:
+            data = fh.read()
+        kwargs = [{}, {'headonly': True},
+                  {'starttime': UTCDateTime('2008-01-01T00:00:04'),
+                   'endtime': UTCDateTime('2008-01-01T00:00:11')}]
+        with NamedTemporaryFile() as tf:
+            tf.write(data)
+            tf.flush()
+            for kw in kwargs:
+                st = _read_mseed(tf.name, **kw)
+                st_ref = _read_mseed(io.BytesIO(data), **kw)
+                self.assertEqual(st, st_ref)
+            # The file can be changed again after reading.
+            with open(tf.name, 'wb') as fh:
+                fh.write(data[:512])
+            self.assertEqual(len(_read_mseed(tf.name)), 1)
+
+    def test_read_with_record_index(self):
+        """
+        Reading with a cached record index must result in the same traces as
+        scanning the whole file. The index is stored next to the file or in a
+        separate directory and is rebuilt if the file changes.
+        """
+        t = UTCDateTime('2010-06-20T00:00:01')
+        cases = [
+            ('two_channels.mseed', [{'starttime': t},
+                                    {'sourcename': '*.?HZ'},
+                                    {'starttime': t, 'endtime': t + 0.5,
+                                     'sourcename': 'BW.UH3.*'},
+                                    {'sourcename': 'XX.*'}]),
+            ('gaps.mseed',
+             [{'starttime': UTCDateTime('2008-01-01T00:00:04'),
+               'endtime': UTCDateTime('2008-01-01T00:00:11')},
+              {'endtime': UTCDateTime('2008-01-01T00:00:04')},
+              {'starttime': UTCDateTime('2009-01-01')}]),
+            ('fullseed.mseed', [{'sourcename': '*.*.*.*'}])]
+        with TemporaryWorkingDirectory():
+            for filename, kwargs in cases:
+                shutil.copy(os.path.join(self.path, 'data', filename), '.')
+                for kw in kwargs:
+                    st_ref = _read_mseed(filename, **kw)
+                    for record_index in (True, 'index'):
+                        st = _read_mseed(filename, record_index=record_index,
+                                         **kw)
+                        self.assertEqual(st, st_ref)
+                self.assertTrue(os.path.exists(filename + '.msidx'))
+            self.assertEqual(len(os.listdir('index')), len(cases))
+
+            index = util.get_record_index('two_channels.mseed')
+            self.assertEqual(index['channel'].tolist(), [b'EHE', b'EHZ'])
+            self.assertEqual(index['offset'].tolist(), [0, 512])
+            self.assertEqual(index['reclen'].tolist(), [512, 512])
+            self.assertEqual(
+                index['starttime'][0],
+                util._convert_datetime_to_mstime(
+                    UTCDateTime('2010-06-20T00:00:00.279999')))
+
+            # Changing the file invalidates the cached index.
+            with open('gaps.mseed', 'rb') as fh:
+                data = fh.read()
+            with open('gaps.mseed', 'wb') as fh:
+                fh.write(data[:512])
+            self.assertEqual(len(util.get_record_index('gaps.mseed')), 1)
+            self.assertEqual(
+                len(util.get_record_index('gaps.mseed', index_dir='index')),
+                1)
+            # The index is built with the given record length.
+            index = util.get_record_index('two_channels.mseed', reclen=512)
+            self.assertEqual(index['offset'].tolist(), [0, 512])
+            self.assertEqual(index['reclen'].tolist(), [512, 512])
+
+            # Warnings report offsets in the file, also for records that are
+            # selected with the index.
+            wrap = os.path.join(self.path, 'data', 'microsecond_wrap.mseed')
+            with warnings.catch_warnings(record=True):
+                warnings.simplefilter('ignore')
+                sourcename = _read_mseed(wrap)[0].id
+            with open('two_channels.mseed', 'rb') as fh:
+                data = fh.read()
+            with open(wrap, 'rb') as fh:
+                with open('wrap.mseed', 'wb') as fh2:
+                    fh2.write(data + fh.read())
+            for record_index in (False, True):
+                with warnings.catch_warnings(record=True) as w:
+                    warnings.simplefilter('always')
+                    _read_mseed('wrap.mseed', sourcename=sourcename,
+                                record_index=record_index)
+                msgs = [str(_i.message) for _i in w
+                        if 'Record with offset' in str(_i.message)]
+                self.assertEqual(len(msgs), 1)
+                self.assertIn('offset=%i ' % len(data), msgs[0])
+
+    def test_read_with_multiple_threads(self):
+        """
+        Decoding the records with several threads must result in exactly
+        the same traces as decoding them with a single one.
+        """
+        for filename in ['gaps.mseed', 'two_channels.mseed',
+                         'BW.BGLD.__.EHE.D.2008.001.first_10_records',
+                         'timingquality.mseed', 'steim2.mseed']:
+            filename = os.path.join(self.path, 'data', filename)
+            st_ref = _read_mseed(filename)
+            for threads in (2, 4):
+                st = _read_mseed(filename, threads=threads)
+                self.assertEqual(st, st_ref)
+        with self.assertRaises(ValueError):
+            _read_mseed(filename, threads=0)
+
+    def test_steim_simd_decoders(self):
+        """
+        The SIMD Steim decoders must produce exactly the same data as the
+        scalar ones, also for byte swapped and corrupt records.
+        """
+        files = ['steim2.mseed', 'test.mseed', 'gaps.mseed',
+                 'BW.BGLD.__.EHE.D.2008.001.first_10_records']
+        files = [os.path.join(self.path, 'data', _i) for _i in files]
+        files += glob.glob(os.path.join(
+            self.path, os.pardir, 'src', 'libmseed', 'test', 'data',
+            'Steim*.mseed'))
+        best_level = clibmseed.obspy_steim_simd_level()
+        try:
+            for filename in files:
+                clibmseed.obspy_set_steim_simd_level(0)
+                st_ref = _read_mseed(filename)
+                for level in range(1, best_level + 1):
+                    clibmseed.obspy_set_steim_simd_level(level)
+                    st = _read_mseed(filename)
+                    self.assertEqual(st, st_ref, msg=filename)
+        finally:
+            clibmseed.obspy_set_steim_simd_level(best_level)
+
+    def test_steim2_simd_encoder_round_trip(self):
+        """
+        Random data written with the SIMD Steim2 encoder must result in
+        exactly the same records as written by the scalar libmseed encoder
+        and must read back unchanged. Differences that do not fit into 30
+        bits make the SIMD encoder fall back to the scalar one and have to
+        fail in the same way.
+        """
+        rng = np.random.RandomState(815)
+        best_level = clibmseed.obspy_steim_simd_level()
+
+        def assert_round_trip(data, reclen, byteorder):
+            tr = Trace(data=data)
+            written = []
+            for level in range(best_level + 1):
+                clibmseed.obspy_set_steim_simd_level(level)
+                with io.BytesIO() as buf:
+                    _write_mseed(Stream([tr]), buf, encoding='STEIM2',
+                                 reclen=reclen, byteorder=byteorder)
+                    written.append(buf.getvalue())
+                buf = io.BytesIO(written[-1])
+                st = _read_mseed(buf)
+                self.assertEqual(len(st), 1)
+                np.testing.assert_array_equal(st[0].data, data)
+            for other in written[1:]:
+                self.assertEqual(other, written[0])
+
+        try:
+            for _i in range(50):
+                npts = rng.randint(1, 20000)
+                # Mix of differences of all possible packing widths.
+                bits = rng.randint(0, 30, npts)
+                diffs = rng.randint(-2 ** 29, 2 ** 29, npts) >> (29 - bits)
+                data = np.cumsum(diffs).astype(np.int32)
+                reclen = 2 ** rng.randint(8, 13)
+                byteorder = ['<', '>'][_i % 2]
+                assert_round_trip(data, reclen, byteorder)
+            # Differences at both limits of the 30 bit packing.
+            diffs = np.tile([2 ** 29 - 1, -2 ** 29], 3000)
+            assert_round_trip(np.cumsum(diffs).astype(np.int32), 512, '>')
+            # Alternating values just beyond them, starting in the first
+            # and in a later record.
+            for start in (1, 5000):
+                data = np.zeros(6000, dtype=np.int32)
+                data[start::2] = 2 ** 29 + 7
+                data[start + 1::2] = -2 ** 29 - 7
+                tr = Trace(data=data)
+                for level in range(best_level + 1):
+                    clibmseed.obspy_set_steim_simd_level(level)
+                    with io.BytesIO() as buf:
+                        with self.assertRaises(Exception) as e:
+                            _write_mseed(Stream([tr]), buf,
+                                         encoding='STEIM2', reclen=512)
+                    msg = str(e.exception)
+                    self.assertTrue(msg.startswith('Error in mst_pack'))
+                    self.assertIn('Unable to represent difference in <= 30 '
+                                  'bits', msg)
+        finally:
+            clibmseed.obspy_set_steim_simd_level(best_level)
+
     def test_libmseed_test_cases(self):
         """
         Test that uses all the test files and reference data coming with
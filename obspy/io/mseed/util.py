@@ -9,22 +9,29 @@ from future.utils import native_str
 
 import collections
 import ctypes as C
+import fnmatch
+import hashlib
+import io
 import math
 import os
 import sys
 import warnings
 from datetime import datetime
-from struct import pack, unpack
+from struct import calcsize, pack, unpack
 
 import numpy as np
 
 from obspy import UTCDateTime
 from obspy.core.util.decorator import ObsPyDeprecationWarning
+from . import InternalMSEEDReadingError
 from .headers import (ENCODINGS, ENDIAN, FIXED_HEADER_ACTIVITY_FLAGS,
                       FIXED_HEADER_DATA_QUAL_FLAGS,
                       FIXED_HEADER_IO_CLOCK_FLAGS, HPTMODULUS,
-                      SAMPLESIZES, UNSUPPORTED_ENCODINGS, MSRecord,
-                      MS_NOERROR, clibmseed)
+                      RECORD_INDEX_DTYPE, RECORD_INDEX_FILE_DTYPE,
+                      RECORD_INDEX_HEADER, RECORD_INDEX_MAGIC,
+                      RECORD_INDEX_VERSION, SAMPLESIZES,
+                      SEED_CONTROL_HEADERS, UNSUPPORTED_ENCODINGS,
+                      VALID_CONTROL_HEADERS, MSRecord, MS_NOERROR, clibmseed)
 
 
 def get_start_and_end_time(file_or_file_object):
@@ -777,6 +784,247 @@ def _get_record_information(file_object, offset=0, endian=None):
     return info
 
 
+def get_record_index(filename, index_dir=None, reclen=None):
+    """
+    Returns an index of all data records in a MiniSEED file.
+
+    The index is built by parsing only the record headers and is cached in a
+    small binary index file. It is rebuilt whenever the size or the
+    modification time of the MiniSEED file changes. If the index file cannot
+    be written, e.g. for read-only archives, the index is just not cached.
+
+    :type filename: str
+    :param filename: Name of the MiniSEED file.
+    :type index_dir: str, optional
+    :param index_dir: Directory to store the index file in. Index files in
+        this directory are named after a hash of the absolute path of the
+        MiniSEED file. If ``None``, the index is stored next to the MiniSEED
+        file with an additional ``.msidx`` suffix.
+    :type reclen: int, optional
+    :param reclen: Record length in bytes of all records, as for
+        :func:`~obspy.io.mseed.core._read_mseed`. If ``None``, it is
+        determined for every record. The index is rebuilt if it was built
+        for another record length.
+    :rtype: :class:`numpy.ndarray`
+    :return: Structured array with the fields ``starttime``, ``endtime``,
+        ``offset``, ``reclen``, ``network``, ``station``, ``location``,
+        ``channel`` and ``dataquality`` of all data records sorted by start
+        time. Start and end time are given in microseconds since 1970, the
+        offset is the position of the record in the file in bytes.
+
+    .. rubric:: Example
+
+    >>> from obspy.core.util import get_example_file
+    >>> filename = get_example_file("two_channels.mseed")
+    >>> index = get_record_index(filename)  # doctest: +SKIP
+    >>> print(index['channel'], index['offset'])  # doctest: +SKIP
+    [b'EHE' b'EHZ'] [  0 512]
+    """
+    stat = os.stat(filename)
+    if index_dir is None:
+        index_file = filename + '.msidx'
+    else:
+        path_hash = hashlib.sha1(
+            os.path.abspath(filename).encode('utf-8')).hexdigest()
+        index_file = os.path.join(index_dir, path_hash + '.msidx')
+
+    if reclen is None:
+        reclen = -1
+    index = _read_record_index(index_file, stat, reclen)
+    if index is not None:
+        return index
+
+    index = _build_record_index(filename, reclen)
+    try:
+        if index_dir is not None and not os.path.isdir(index_dir):
+            os.makedirs(index_dir)
+        _write_record_index(index_file, index, stat, reclen)
+    except EnvironmentError:
+        pass
+    return index
+
+
+def _build_record_index(filename, reclen=-1):
+    """
+    Builds the record index of a MiniSEED file with a header-only pass of the
+    C reader. reclen is the record length of all records or -1 to determine
+    it for every record.
+    """
+    record_length = get_record_information(filename)['record_length']
+    bfr_np = _memory_map(filename)
+    offset = _get_first_data_record_offset(bfr_np, record_length)
+    bfr_np = bfr_np[offset:]
+
+    index = []
+
+    def allocate_index(count):
+        index.append(np.empty(count, dtype=RECORD_INDEX_DTYPE))
+        return index[-1].ctypes.data
+    alloc_index = C.CFUNCTYPE(C.c_longlong, C.c_int)(allocate_index)
+
+    # Broken records end the index just like they end the actual reading.
+    # The corresponding errors and warnings are raised when reading.
+    def ignore_message(msg):
+        pass
+    diag_print = C.CFUNCTYPE(C.c_void_p, C.c_char_p)(ignore_message)
+    log_print = C.CFUNCTYPE(C.c_void_p, C.c_char_p)(ignore_message)
+
+    count = clibmseed.indexMSEEDBuffer(bfr_np, len(bfr_np), reclen, -1,
+                                       alloc_index, diag_print, log_print)
+    del bfr_np
+    if count < 0:
+        msg = "Could not build the record index of '%s'." % filename
+        raise InternalMSEEDReadingError(msg)
+    if count == 0:
+        return np.empty(0, dtype=RECORD_INDEX_DTYPE)
+    index = index[0]
+    index['offset'] += offset
+    # A stable sort keeps the file order of records starting at the same
+    # time.
+    return index[np.argsort(index['starttime'], kind='mergesort')]
+
+
+def _read_record_index(index_file, stat, reclen=-1):
+    """
+    Reads a record index file. Returns ``None`` if it does not exist, is
+    damaged or does not match the given stat result of the indexed file or
+    the record length.
+    """
+    header_size = calcsize(RECORD_INDEX_HEADER)
+    try:
+        with io.open(index_file, 'rb') as fh:
+            header = fh.read(header_size)
+            if len(header) != header_size:
+                return None
+            magic, version, size, mtime, index_reclen, count = \
+                unpack(RECORD_INDEX_HEADER, header)
+            if magic != RECORD_INDEX_MAGIC or \
+                    version != RECORD_INDEX_VERSION or \
+                    size != stat.st_size or mtime != stat.st_mtime or \
+                    index_reclen != reclen:
+                return None
+            data = fh.read(count * RECORD_INDEX_FILE_DTYPE.itemsize)
+    except EnvironmentError:
+        return None
+    if count == 0:
+        return np.empty(0, dtype=RECORD_INDEX_DTYPE)
+    if len(data) != count * RECORD_INDEX_FILE_DTYPE.itemsize:
+        return None
+    return np.frombuffer(data, dtype=RECORD_INDEX_FILE_DTYPE).astype(
+        RECORD_INDEX_DTYPE)
+
+
+def _write_record_index(index_file, index, stat, reclen=-1):
+    """
+    Writes a record index file for a file with the given stat result, built
+    with the given record length.
+    """
+    header = pack(RECORD_INDEX_HEADER, RECORD_INDEX_MAGIC,
+                  RECORD_INDEX_VERSION, stat.st_size, stat.st_mtime, reclen,
+                  len(index))
+    with io.open(index_file, 'wb') as fh:
+        fh.write(header)
+        fh.write(index.astype(RECORD_INDEX_FILE_DTYPE).tostring())
+
+
+def _select_records_from_index(index, starttime=None, endtime=None,
+                               sourcename=None):
+    """
+    Returns the offsets and record lengths of all records in a record index
+    that might match the given selection, in file order.
+
+    Uses the same matching rules as libmseed's selections so the selection
+    can be refined by the C reader afterwards.
+    """
+    start = index['starttime']
+    # Records are sorted by start time. All records that end at or after the
+    # start time follow the first one for which the running maximum of the
+    # end times passes the start time.
+    if endtime is not None:
+        end_idx = np.searchsorted(
+            start, _convert_datetime_to_mstime(endtime), side='right')
+    else:
+        end_idx = len(index)
+    if starttime is not None:
+        t0 = _convert_datetime_to_mstime(starttime)
+        start_idx = np.searchsorted(np.maximum.accumulate(index['endtime']),
+                                    t0, side='left')
+        candidates = index[start_idx:end_idx]
+        candidates = candidates[candidates['endtime'] >= t0]
+    else:
+        candidates = index[:end_idx]
+
+    if sourcename is not None and len(candidates):
+        # Same source name format as used by the C reader.
+        srcnames = candidates['network']
+        for key in ('station', 'location', 'channel', 'dataquality'):
+            srcnames = np.char.add(np.char.add(srcnames, b'_'),
+                                   candidates[key])
+        pattern = sourcename.replace('.', '_') + '_*'
+        unique_srcnames = np.unique(srcnames)
+        matching = np.array([_i for _i in unique_srcnames
+                             if fnmatch.fnmatchcase(_i.decode(), pattern)],
+                            dtype=srcnames.dtype)
+        candidates = candidates[np.in1d(srcnames, matching)]
+
+    candidates = np.sort(candidates, order=native_str('offset'))
+    return candidates['offset'], candidates['reclen']
+
+
+def _gather_records(bfr_np, offsets, reclens):
+    """
+    Copies the given records of a buffer into one continuous buffer. Adjacent
+    records are copied in one go.
+    """
+    ends = offsets + reclens
+    breaks = np.nonzero(offsets[1:] != ends[:-1])[0] + 1
+    run_starts = offsets[np.r_[0, breaks]]
+    run_ends = ends[np.r_[breaks - 1, len(offsets) - 1]]
+    return np.concatenate([bfr_np[_s:_e]
+                           for _s, _e in zip(run_starts, run_ends)])
+
+
+def _memory_map(filename):
+    """
+    Memory maps a file as an int8 array.
+
+    The file is not copied to memory. The mapping is released once the
+    array is deleted.
+    """
+    try:
+        return np.memmap(filename, dtype=np.int8, mode='r')
+    # Empty files and special files cannot be memory mapped.
+    except (ValueError, EnvironmentError):
+        return np.fromfile(filename, dtype=np.int8)
+
+
+def _get_first_data_record_offset(bfr_np, record_length):
+    """
+    Returns the offset of the first data record in a buffer, skipping the
+    control headers of full SEED files.
+    """
+    offset = 0
+    # 0 to 9 are defined in a row in the ASCII charset.
+    min_ascii = ord('0')
+
+    # Small function to check whether an array of ASCII values contains only
+    # digits.
+    def isdigit(x):
+        return True if (x - min_ascii).max() <= 9 else False
+
+    while True:
+        # This should never happen
+        if (isdigit(bfr_np[offset:offset + 6]) is False) or \
+                (bfr_np[offset + 6] not in VALID_CONTROL_HEADERS):
+            msg = 'Not a valid (Mini-)SEED file'
+            raise Exception(msg)
+        elif bfr_np[offset + 6] in SEED_CONTROL_HEADERS:
+            offset += record_length
+            continue
+        break
+    return offset
+
+
 def _ctypes_array_2_numpy_array(buffer_, buffer_elements, sampletype):
     """
     Takes a Ctypes array and its length and type and returns it as a
@@ -842,7 +1090,7 @@ def _unpack_steim_1(data, npts, swapflag=0, verbose=0):
     samplecnt = npts
     datasamples = np.empty(npts, dtype=np.int32)
 
-    nsamples = clibmseed.msr_decode_steim1(
+    nsamples = clibmseed.obspy_decode_steim1(
         data.ctypes.data,
         datasize, samplecnt, datasamples,
         npts, None, swapflag)
@@ -865,7 +1113,7 @@ def _unpack_steim_2(data, npts, swapflag=0, verbose=0):
     samplecnt = npts
     datasamples = np.empty(npts, dtype=np.int32)
 
-    nsamples = clibmseed.msr_decode_steim2(
+    nsamples = clibmseed.obspy_decode_steim2(
         data.ctypes.data,
         datasize, samplecnt, datasamples,
         npts, None, swapflag)
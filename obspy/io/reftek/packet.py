@@ -320,9 +320,9 @@ def _unpack_C0_C2_data_fast(packets, encoding):  # noqa
         packet, either ``'C0'`` or ``'C2'``.
     """
     if encoding == 'C0':
-        decode_steim = clibmseed.msr_decode_steim1
+        decode_steim = clibmseed.obspy_decode_steim1
     elif encoding == 'C2':
-        decode_steim = clibmseed.msr_decode_steim2
+        decode_steim = clibmseed.obspy_decode_steim2
     else:
         msg = "Unregonized encoding: '{}'".format(encoding)
         raise ValueError(msg)
@@ -361,9 +361,9 @@ def _unpack_C0_C2_data_safe(packets, encoding):  # noqa
         packet, either ``'C0'`` or ``'C2'``.
     """
     if encoding == 'C0':
-        decode_steim = clibmseed.msr_decode_steim1
+        decode_steim = clibmseed.obspy_decode_steim1
     elif encoding == 'C2':
-        decode_steim = clibmseed.msr_decode_steim2
+        decode_steim = clibmseed.obspy_decode_steim2
     else:
         msg = "Unregonized encoding: '{}'".format(encoding)
         raise ValueError(msg)
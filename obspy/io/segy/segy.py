@@ -13,22 +13,26 @@ Routines to read and write SEG Y rev 1 encoded seismic data files.
 from __future__ import (absolute_import, division, print_function,
                         unicode_literals)
 from future.builtins import *  # NOQA
+from future.utils import native_str
 
 import io
+import mmap
+import multiprocessing
 import os
 from struct import pack, unpack
 
 import numpy as np
 
-from obspy import Trace, UTCDateTime
+from obspy import Stream, Trace, UTCDateTime
 from obspy.core import AttribDict
 
 from .header import (BINARY_FILE_HEADER_FORMAT,
+                     DATA_SAMPLE_FORMAT_CODE_DTYPE,
                      DATA_SAMPLE_FORMAT_PACK_FUNCTIONS,
                      DATA_SAMPLE_FORMAT_SAMPLE_SIZE,
                      DATA_SAMPLE_FORMAT_UNPACK_FUNCTIONS, ENDIAN,
                      TRACE_HEADER_FORMAT, TRACE_HEADER_KEYS)
-from .unpack import OnTheFlyDataUnpacker
+from .unpack import OnTheFlyDataUnpacker, unpack_ibm_bytes
 from .util import unpack_header_value
 
 
@@ -556,7 +560,7 @@ class SEGYTrace(object):
         data_left = self.filesize - pos
         data_needed = DATA_SAMPLE_FORMAT_SAMPLE_SIZE[self.data_encoding] * \
             npts
-        if npts < 1 or data_needed > data_left:
+        if data_needed > data_left:
             msg = """
                   Too little data left in the file to unpack it according to
                   its trace header. This is most likely either due to a wrong
@@ -1362,3 +1366,285 @@ def autodetect_endian_and_sanity_check_su(file):
             the ObsPy developers so they can implement additional tests.
             """.strip()
         raise Exception(msg)
+
+
+def trace_header_dtype(endian='>'):
+    """
+    Returns the structured NumPy dtype of the 240 byte trace header.
+
+    The field names are the ones of the
+    :class:`~obspy.io.segy.segy.SEGYTraceHeader` attributes.
+
+    :type endian: str
+    :param endian: Byte order of the header, '>' or '<'.
+    """
+    fields = []
+    for length, name, special_format, _ in TRACE_HEADER_FORMAT:
+        if length == 8:
+            format = 'V8'
+        elif special_format:
+            format = endian + special_format
+        else:
+            format = '%si%i' % (endian, length)
+        fields.append((native_str(name), native_str(format)))
+    return np.dtype(fields)
+
+
+class SEGYMappedFile(object):
+    """
+    Random access to the traces of a SEG Y or SU file through a memory map.
+
+    Opening the file reads the file headers and the sample count of every
+    trace header to locate the traces, no samples are unpacked. The trace
+    headers of all traces are available as one structured array in
+    ``headers``. For files with traces of equal length, which are detected
+    from the file size and the sample counts, it is a view on the mapped
+    file. Files with traces of different length are walked through trace by
+    trace and their headers are copied.
+
+    Indexing returns ObsPy Traces, a single one for an integer and a
+    :class:`~obspy.core.stream.Stream` for a slice. The samples of a slice
+    are decoded with a single call, :meth:`read_data` returns them as a
+    plain array.
+
+    The map is released by :meth:`close` or at the end of a ``with`` block.
+
+    >>> from obspy.core.util import get_example_file
+    >>> from obspy.io.segy.segy import SEGYMappedFile
+    >>> filename = get_example_file("00001034.sgy_first_trace")
+    >>> with SEGYMappedFile(filename) as segy:
+    ...     print(len(segy))
+    ...     print(segy.headers['number_of_samples_in_this_trace'])
+    ...     tr = segy[0]
+    1
+    [2001]
+    >>> print(int(tr.data.sum() * 1E9))
+    -5
+    """
+    # Number of traces decoded at once while iterating.
+    iter_block_size = 1024
+
+    def __init__(self, filename, endian=None, textual_header_encoding=None,
+                 su=False, threads=None):
+        """
+        :type filename: str
+        :param filename: Name of the SEG Y or SU file.
+        :type endian: str
+        :param endian: The endianness of the file. If None, autodetection
+            will be used.
+        :param textual_header_encoding: The encoding of the textual header.
+            Either 'EBCDIC', 'ASCII' or None. If it is None, autodetection
+            will be attempted. Ignored for SU files.
+        :type su: bool
+        :param su: The file is a Seismic Unix file without file headers.
+        :type threads: int
+        :param threads: Number of threads for decoding IBM floating point
+            samples. Defaults to the number of CPUs.
+        """
+        self.filename = filename
+        self.su = su
+        if threads is None:
+            threads = multiprocessing.cpu_count()
+        self.threads = threads
+        with open(filename, 'rb') as file:
+            if su:
+                su_file = SUFile(file, endian=endian, read_traces=False)
+                self.endian = su_file.endian
+                # SU files are always IEEE encoded.
+                self.data_encoding = 5
+                start = 0
+            else:
+                segy_file = SEGYFile(
+                    file, endian=endian,
+                    textual_header_encoding=textual_header_encoding,
+                    read_traces=False)
+                self.endian = segy_file.endian
+                self.data_encoding = segy_file.data_encoding
+                self.textual_file_header = segy_file.textual_file_header
+                self.textual_header_encoding = \
+                    segy_file.textual_header_encoding
+                self.binary_file_header = segy_file.binary_file_header
+                start = file.tell()
+            # The map stays valid after closing the file.
+            self._mmap = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+        if self.data_encoding not in DATA_SAMPLE_FORMAT_SAMPLE_SIZE:
+            msg = 'Unsupported data sample format code: %s' % \
+                self.data_encoding
+            raise SEGYError(msg)
+        self._raw = np.frombuffer(self._mmap, dtype=np.uint8)
+        self._index_traces(start)
+
+    def _index_traces(self, start):
+        """
+        Determines the position and the sample count of all traces starting
+        at byte start and sets up the header array.
+        """
+        size = len(self._mmap)
+        sample_size = DATA_SAMPLE_FORMAT_SAMPLE_SIZE[self.data_encoding]
+        header_dtype = trace_header_dtype(self.endian)
+        npts_format = ('%sH' % self.endian).encode('ascii', 'strict')
+        # Assume traces of equal length and check it with the headers. A
+        # rest smaller than a trace header is ignored as in SEGYFile.
+        self._samples = None
+        if size - start >= 240:
+            npts = unpack(npts_format, self._mmap[start + 114:start + 116])[0]
+            trace_length = 240 + npts * sample_size
+            count, rest = divmod(size - start, trace_length)
+            if rest < 240:
+                headers = np.ndarray(shape=(count,), dtype=header_dtype,
+                                     buffer=self._mmap, offset=start,
+                                     strides=(trace_length,))
+                if np.all(headers['number_of_samples_in_this_trace'] ==
+                          npts):
+                    self.headers = headers
+                    self.npts = np.empty(count, dtype=np.int64)
+                    self.npts.fill(npts)
+                    self.offsets = start + 240 + trace_length * \
+                        np.arange(count, dtype=np.int64)
+                    # The sample bytes of all traces as rows of a 2D view.
+                    self._samples = np.ndarray(
+                        shape=(count, npts * sample_size), dtype=np.uint8,
+                        buffer=self._mmap, offset=start + 240,
+                        strides=(trace_length, 1))
+                    return
+        # Otherwise walk through the traces.
+        offsets = []
+        sample_counts = []
+        pos = start
+        while size - pos >= 240:
+            npts = unpack(npts_format, self._mmap[pos + 114:pos + 116])[0]
+            pos += 240
+            if npts * sample_size > size - pos:
+                msg = """
+                      Too little data left in the file to unpack it according
+                      to its trace header. This is most likely either due to
+                      a wrong byte order or a corrupt file.
+                      """.strip()
+                raise SEGYTraceReadingError(msg)
+            offsets.append(pos)
+            sample_counts.append(npts)
+            pos += npts * sample_size
+        self.offsets = np.array(offsets, dtype=np.int64)
+        self.npts = np.array(sample_counts, dtype=np.int64)
+        # The headers are scattered over the file and thus copied.
+        header_bytes = self._raw[np.add.outer(self.offsets - 240,
+                                              np.arange(240))]
+        self.headers = header_bytes.reshape(-1, 240).view(
+            header_dtype).reshape(-1)
+
+    def __len__(self):
+        return len(self.offsets)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+
+    def close(self):
+        """
+        Releases the memory map. The header array is not available anymore
+        and no more traces can be read afterwards.
+
+        The map is unmapped as soon as no array obtained from ``headers``
+        refers to it anymore.
+        """
+        self.headers = None
+        self._samples = None
+        self._raw = None
+        self._mmap = None
+
+    def __str__(self):
+        """
+        Prints some information about the mapped file.
+        """
+        return '%i traces in the memory mapped %s file.' % (
+            len(self), 'SU' if self.su else 'SEG Y')
+
+    def _repr_pretty_(self, p, cycle):
+        p.text(str(self))
+
+    def read_data(self, index):
+        """
+        Unpacks the samples of the selected traces.
+
+        :param index: Trace number, slice or sequence of trace numbers.
+        :returns: A 1D array for a single trace and a 2D array with one row
+            per trace otherwise. All selected traces need to have the same
+            number of samples.
+        """
+        if self._mmap is None:
+            raise ValueError('The mapped file has already been closed.')
+        sample_size = DATA_SAMPLE_FORMAT_SAMPLE_SIZE[self.data_encoding]
+        if self._samples is not None:
+            raw = self._samples[index]
+        else:
+            npts = np.unique(self.npts[index])
+            if len(npts) > 1:
+                msg = 'The selected traces have different numbers of ' + \
+                    'samples. Read them one by one.'
+                raise SEGYError(msg)
+            nbytes = npts[0] * sample_size if len(npts) else 0
+            raw = self._raw[np.add.outer(self.offsets[index],
+                                         np.arange(nbytes))]
+        shape = raw.shape[:-1] + (raw.shape[-1] // sample_size,)
+        raw = np.ascontiguousarray(raw).reshape(-1)
+        if self.data_encoding == 1:
+            data = unpack_ibm_bytes(raw, endian=self.endian,
+                                    threads=self.threads)
+        elif self.data_encoding in DATA_SAMPLE_FORMAT_CODE_DTYPE:
+            dtype = np.dtype(DATA_SAMPLE_FORMAT_CODE_DTYPE[self.data_encoding])
+            # Always copies, the result does not refer to the mapped file.
+            data = raw.view(dtype.newbyteorder(self.endian)).astype(dtype)
+        else:
+            msg = 'Reading data sample format code %i is not supported ' + \
+                'yet. Please contact the developers.'
+            raise NotImplementedError(msg % self.data_encoding)
+        return data.reshape(shape)
+
+    def _to_obspy_trace(self, index, data):
+        """
+        Creates the ObsPy Trace of trace number index with the given data.
+        """
+        offset = int(self.offsets[index])
+        trace = SEGYTrace(data_encoding=self.data_encoding,
+                          endian=self.endian)
+        trace.header = SEGYTraceHeader(self._mmap[offset - 240:offset],
+                                       endian=self.endian)
+        trace.data = data
+        trace.npts = len(data)
+        tr = trace.to_obspy_trace()
+        if self.su:
+            tr.stats.su = tr.stats.segy
+            del tr.stats.segy
+            stats = tr.stats.su
+            tr.stats._format = "SU"
+        else:
+            stats = tr.stats.segy
+            stats.textual_file_header = self.textual_file_header
+            stats.binary_file_header = self.binary_file_header
+            stats.textual_file_header_encoding = \
+                self.textual_header_encoding.upper()
+            tr.stats._format = "SEGY"
+        stats.data_encoding = self.data_encoding
+        stats.endian = self.endian
+        return tr
+
+    def __getitem__(self, index):
+        """
+        Returns a Trace for an integer and a Stream for a slice.
+        """
+        if isinstance(index, slice):
+            indices = np.arange(len(self))[index]
+            if len(np.unique(self.npts[indices])) > 1:
+                traces = [self[i] for i in indices]
+            else:
+                traces = [self._to_obspy_trace(i, data) for i, data in
+                          zip(indices, self.read_data(index))]
+            return Stream(traces=traces)
+        return self._to_obspy_trace(index, self.read_data(index))
+
+    def __iter__(self):
+        for i in range(0, len(self), self.iter_block_size):
+            for tr in self[i:i + self.iter_block_size]:
+                yield tr
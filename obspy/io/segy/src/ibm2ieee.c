@@ -6,52 +6,112 @@
 #---------------------------------------------------------------------*/
 #include <math.h>
 #include <stdlib.h>
-#include <stdio.h>
+#include <string.h>
+
+
+/* Number of samples converted by a thread at once. */
+#define IBM_CHUNK 65536
+
+typedef unsigned int uint32;
+typedef unsigned long long uint64;
+
+
+/* Converts a single 32 bit IBM floating point number given as its four
+ * bytes from the most to the least significant one.
+ *
+ * The value is (-1)^sign * fraction * 16^(exponent - 64) / 2^24
+ * = (-1)^sign * fraction * 2^(4 * exponent - 280). The fraction has at most
+ * 24 bits, so the product with the power of two is exact in double
+ * precision. The power of two is built directly in the exponent bits. The
+ * conversion to single precision rounds once. That makes all values that
+ * are normal in single precision exact. Smaller values become correctly
+ * rounded denormals or zero, larger ones infinity. An IBM zero with any
+ * exponent keeps its sign. */
+static float ibm_to_float(uint32 b0, uint32 b1, uint32 b2, uint32 b3) {
+    int sign = (b0 >> 7) & 0x01;
+    int exponent = b0 & 0x7f;
+    int fraction = (b1 << 16) | (b2 << 8) | b3;
+    uint64 scale_bits = (uint64)(4 * exponent - 280 + 1023) << 52;
+    double scale;
+
+    memcpy(&scale, &scale_bits, sizeof(double));
+    /* IEEE 754 conversion, overflows to infinity */
+    return (float)((1 - 2 * sign) * (double)fraction * scale);
+}
+
+
+/* Converts the samples first ... last - 1 of raw bytes in the given byte
+ * order. The loops have no branches and are vectorized by the compiler. */
+static void ibm_bytes_range(const unsigned char *ibm, float *ieee,
+                            long long first, long long last, int big_endian) {
+    long long i;
+
+    if (big_endian) {
+        for (i = first; i < last; i++) {
+            const unsigned char *b = ibm + 4 * i;
+            ieee[i] = ibm_to_float(b[0], b[1], b[2], b[3]);
+        }
+    }
+    else {
+        for (i = first; i < last; i++) {
+            const unsigned char *b = ibm + 4 * i;
+            ieee[i] = ibm_to_float(b[3], b[2], b[1], b[0]);
+        }
+    }
+}
+
+
+/* Converts an array of 32 bit IBM floating point numbers stored as raw bytes
+ * to IEEE floating point numbers.
+ *
+ * Parameters:
+ *	ibm: The raw bytes, 4 per sample.
+ *	ieee: Output array of len samples. May be the same memory as ibm.
+ *	len: Number of samples in the array.
+ *	big_endian: Byte order of the raw bytes, 1 for big endian (the SEG Y
+ *	    standard) and 0 for little endian.
+ *	threads: Number of threads if compiled with OpenMP.
+ *
+ * The byte swap is done while loading the samples, independent of the byte
+ * order of the machine. Chunks of IBM_CHUNK samples are distributed over the
+ * threads.
+ */
+void ibm2ieee_bytes(const unsigned char *ibm, float *ieee, long long len,
+                    int big_endian, int threads) {
+    int nchunks = (int)((len + IBM_CHUNK - 1) / IBM_CHUNK);
+    int chunk;
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    #pragma omp parallel for num_threads(threads) schedule(static) if(threads > 1 && nchunks > 1)
+    for (chunk = 0; chunk < nchunks; chunk++) {
+        long long first = (long long)chunk * IBM_CHUNK;
+        long long last = first + IBM_CHUNK < len ? first + IBM_CHUNK : len;
+        ibm_bytes_range(ibm, ieee, first, last, big_endian);
+    }
+    return;
+}
 
 
 /* Converts an array of 32 bit IBM floating point numbers to IEEE
  * floating point numbers.
  *
  * Parameters:
- *	ibm: Array of 32 bit IBM floating point numbers.
+ *	ibm: Array of 32 bit IBM floating point numbers in the byte order of
+ *	    the machine.
  *	len: Number of samples in the array.
  *
  * It works inplace and thus will not return anything.
  */
-
 void ibm2ieee(float *ibm, int len) {
-    int i = 0;
-    for (i=0; i<len; i++) {
-	/* This very condensed statement was created in an attempt to make it
-	 * work with OpenMP but that still seems to suffer from some problems.
-	 * See the comment below for a cleaner version.
-	 */
-	ibm[i] = (((( (*(int*)&ibm[i]) >> 31) & 0x01) * (-2)) + 1) *
-	         ((float)((*(int*)&ibm[i]) & 0x00ffffff) / 0x1000000) *
-		 ((float)pow(16, (( (*(int*)&ibm[i]) >> 24) & 0x7f) - 64));
+    int i;
+    uint32 bits;
+
+    for (i = 0; i < len; i++) {
+        memcpy(&bits, &ibm[i], sizeof(float));
+        ibm[i] = ibm_to_float(bits >> 24, (bits >> 16) & 0xff,
+                              (bits >> 8) & 0xff, bits & 0xff);
     }
     return;
 }
-
-/* Easier to read version of the above code. */
-
-//void ibm2ieee(float *ibm, int len) {
-//    int sign = 0;
-//    int exponent = 0;
-//    int mantissa_int = 0;
-//    float mantissa_float = 0.0;
-//    int ibm_int;
-//    int i = 0;
-//    for (i=0; i<len; i++) {
-//	// Interpret the float as an integer for easier bitshifting.
-//	ibm_int = *(int*)&ibm[i];
-//	// Get the components of the floating point number.
-//	sign = ((( ibm_int >> 31) & 0x01) * (-2)) + 1;
-//	exponent = ( ibm_int >> 24) & 0x7f;
-//	mantissa_int = ibm_int & 0x00ffffff;
-//	double power = (float)pow(16, exponent - 64);
-//	mantissa_float = sign * ((float)mantissa_int / 0x1000000) * power;
-//	ibm[i] = mantissa_float;
-//    }
-//    return;
-//}
@@ -9,6 +9,7 @@ from future.builtins import *  # NOQA
 import io
 import os
 import unittest
+import warnings
 
 import numpy as np
 
@@ -16,8 +17,9 @@ import obspy
 from obspy.core.util import NamedTemporaryFile
 from obspy.io.segy.header import (DATA_SAMPLE_FORMAT_PACK_FUNCTIONS,
                                   DATA_SAMPLE_FORMAT_UNPACK_FUNCTIONS)
-from obspy.io.segy.segy import (SEGYBinaryFileHeader, SEGYFile,
-                                SEGYTraceHeader, _read_segy, iread_segy)
+from obspy.io.segy.segy import (SEGYBinaryFileHeader, SEGYError, SEGYFile,
+                                SEGYMappedFile, SEGYTrace, SEGYTraceHeader,
+                                _read_segy, _read_su, iread_segy)
 from obspy.io.segy.tests.header import DTYPES, FILES
 
 
@@ -263,6 +265,50 @@ class SEGYTestCase(unittest.TestCase):
             # Test both.
             np.testing.assert_array_equal(new_data, data)
 
+    def test_unpack_ibm_float_exact(self):
+        """
+        Tests the conversion of raw IBM floating points against the exact
+        values including zeros, denormals and overflows in both byte orders.
+        """
+        np.random.seed(5)
+        words = np.concatenate([
+            np.random.randint(0, 2 ** 16, 100000).astype(np.uint32) << 16 |
+            np.random.randint(0, 2 ** 16, 100000).astype(np.uint32),
+            # zeros with any exponent and sign, smallest and largest values
+            [0x00000000, 0x80000000, 0x7f000000, 0x40000000, 0x00000001,
+             0x00ffffff, 0x21100000, 0x7fffffff, 0xffffffff, 0x60100000,
+             0x61100000]]).astype(np.uint32)
+        sign = np.where(words >> 31, -1.0, 1.0)
+        exponent = ((words >> 24) & 0x7f).astype(np.float64)
+        fraction = (words & 0x00ffffff).astype(np.float64)
+        with np.errstate(over='ignore'):
+            # exact in double precision and rounded once
+            expected = (sign * fraction * 2.0 ** (4 * exponent - 280)).astype(
+                np.float32)
+        for endian in ('>', '<'):
+            raw = words.astype(endian + 'u4').tostring()
+            for threads in (1, 4):
+                data = DATA_SAMPLE_FORMAT_UNPACK_FUNCTIONS[1](
+                    io.BytesIO(raw), len(words), endian, threads=threads)
+                self.assertEqual(data.dtype, np.float32)
+                np.testing.assert_array_equal(data.view(np.uint32),
+                                              expected.view(np.uint32))
+        # a few known values
+        raw = np.array([0xc276a000, 0x41100000, 0x00000000, 0x80000000,
+                        0x7fffffff], dtype='>u4').tostring()
+        data = DATA_SAMPLE_FORMAT_UNPACK_FUNCTIONS[1](io.BytesIO(raw), 5)
+        np.testing.assert_array_equal(data, [-118.625, 1.0, 0.0, 0.0,
+                                             np.inf])
+        self.assertTrue(np.signbit(data[3]))
+        # incomplete values are not cut off silently
+        with warnings.catch_warnings(record=True) as w:
+            warnings.simplefilter('always')
+            data = DATA_SAMPLE_FORMAT_UNPACK_FUNCTIONS[1](io.BytesIO(raw), 6)
+        self.assertEqual(len(data), 5)
+        self.assertEqual(len(w), 1)
+        self.assertRaises(ValueError, DATA_SAMPLE_FORMAT_UNPACK_FUNCTIONS[1],
+                          io.BytesIO(raw[:-2]), 5)
+
     def test_read_and_write_binary_file_header(self):
         """
         Reading and writing should not change the binary file header.
@@ -596,6 +642,80 @@ class SEGYTestCase(unittest.TestCase):
 
         self.assertEqual(st.traces, ist)
 
+    def test_memory_mapped_file(self):
+        """
+        Tests the random access to traces through a memory map against the
+        normal reading for traces of equal and of different lengths,
+        including traces without samples.
+        """
+        file = os.path.join(self.path, 'ld0042_file_00018.sgy_first_trace')
+        segy = _read_segy(file)
+        np.random.seed(7)
+        encodings = {1: np.float32,
+                     2: np.int32,
+                     3: np.int16,
+                     5: np.float32}
+        for data_encoding, dtype in encodings.items():
+            for lengths in ([100] * 7, [100, 50, 100, 80, 3, 3],
+                            [100, 0, 50, 0, 3, 3], [0] * 6):
+                segy.traces = []
+                for i, npts in enumerate(lengths):
+                    trace = SEGYTrace()
+                    trace.header.trace_sequence_number_within_line = i + 1
+                    trace.header.sample_interval_in_ms_for_this_trace = 4000
+                    trace.data = (np.random.randn(npts) * 1000).astype(dtype)
+                    segy.traces.append(trace)
+                with NamedTemporaryFile() as tf:
+                    segy.write(tf.name, data_encoding=data_encoding)
+                    expected = _read_segy(tf.name).traces
+                    with SEGYMappedFile(tf.name, threads=2) as mapped:
+                        self.assertEqual(len(mapped), len(lengths))
+                        np.testing.assert_array_equal(mapped.npts, lengths)
+                        headers = mapped.headers
+                        np.testing.assert_array_equal(
+                            headers['trace_sequence_number_within_line'],
+                            np.arange(1, len(lengths) + 1))
+                        for i, trace in enumerate(expected):
+                            data = mapped.read_data(i)
+                            self.assertEqual(data.dtype, dtype)
+                            np.testing.assert_array_equal(data, trace.data)
+                            tr = mapped[i - len(lengths)]
+                            np.testing.assert_array_equal(tr.data, trace.data)
+                            self.assertEqual(tr.stats.delta, 0.004)
+                            self.assertEqual(
+                                tr.stats.segy.trace_header.
+                                trace_sequence_number_within_line, i + 1)
+                            self.assertEqual(tr.stats.segy.data_encoding,
+                                             data_encoding)
+                        # Slices are decoded at once if possible.
+                        st = mapped[1:]
+                        self.assertEqual(len(st), len(lengths) - 1)
+                        for tr, trace in zip(st, expected[1:]):
+                            np.testing.assert_array_equal(tr.data, trace.data)
+                        self.assertEqual(len(list(mapped)), len(lengths))
+                        data = mapped.read_data([5, 4])
+                        self.assertEqual(data.shape, (2, lengths[4]))
+                        np.testing.assert_array_equal(data[0],
+                                                      expected[5].data)
+                        np.testing.assert_array_equal(data[1],
+                                                      expected[4].data)
+                        if len(set(lengths)) > 1:
+                            self.assertRaises(SEGYError, mapped.read_data,
+                                              slice(0, 2))
+                    # The map is released at the end of the with block.
+                    self.assertIsNone(mapped.headers)
+                    self.assertRaises(ValueError, mapped.read_data, 0)
+        # Seismic Unix file.
+        file = os.path.join(self.path, '1.su_first_trace')
+        expected = _read_su(file).traces
+        with SEGYMappedFile(file, su=True) as mapped:
+            self.assertEqual(len(mapped), len(expected))
+            tr = mapped[0]
+        np.testing.assert_array_equal(tr.data, expected[0].data)
+        self.assertEqual(
+            tr.stats.su.trace_header.number_of_samples_in_this_trace,
+            len(expected[0].data))
+
 
 def rms(x, y):
     """
@@ -17,6 +17,7 @@ from future.builtins import *  # NOQA
 from future.utils import native_str
 
 import ctypes as C
+import multiprocessing
 import os
 import sys
 import warnings
@@ -40,19 +41,42 @@ clibsegy.ibm2ieee.argtypes = [
     C.c_int]
 clibsegy.ibm2ieee.restype = C.c_void_p
 
+clibsegy.ibm2ieee_bytes.argtypes = [
+    np.ctypeslib.ndpointer(dtype=np.uint8, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    np.ctypeslib.ndpointer(dtype=np.float32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_longlong, C.c_int, C.c_int]
+clibsegy.ibm2ieee_bytes.restype = C.c_void_p
+
 
-def unpack_4byte_ibm(file, count, endian='>'):
+def unpack_4byte_ibm(file, count, endian='>', threads=None):
     """
     Unpacks 4 byte IBM floating points.
+
+    The C code swaps the bytes and converts the values in a single pass,
+    long arrays are converted on ``threads`` threads (defaults to the number
+    of CPUs).
     """
-    # Read as 4 byte integer so bit shifting works.
-    data = np.fromstring(file.read(count * 4), dtype=np.float32)
-    # Swap the byte order if necessary.
-    if BYTEORDER != endian:
-        data = data.byteswap()
-    length = len(data)
-    # Call the C code which transforms the data inplace.
-    clibsegy.ibm2ieee(data, length)
+    raw = np.frombuffer(file.read(count * 4), dtype=np.uint8)
+    if len(raw) < count * 4:
+        msg = "Only %i of %i bytes of IBM floating points could be read."
+        warnings.warn(msg % (len(raw), count * 4))
+    return unpack_ibm_bytes(raw, endian=endian, threads=threads)
+
+
+def unpack_ibm_bytes(raw, endian='>', threads=None):
+    """
+    Converts a contiguous uint8 array of 4 byte IBM floating points to
+    IEEE single precision floats.
+    """
+    if len(raw) % 4:
+        msg = "%i bytes are not a multiple of 4 byte IBM floating points."
+        raise ValueError(msg % len(raw))
+    data = np.empty(len(raw) // 4, dtype=np.float32)
+    if threads is None:
+        threads = multiprocessing.cpu_count()
+    clibsegy.ibm2ieee_bytes(raw, data, len(data), endian == '>', threads)
     return data
 
 
@@ -634,3 +634,62 @@ def kurtosis(trace, win=3.0, rtmemory_list=None):
     rtmemory_k4_bar.input[0] = k4_bar_last
 
     return kappa4
+
+
+def filter(trace, type, corners=4, rtmemory_list=None, **options):
+    """
+    Apply a causal Butterworth filter that carries its state over to the next
+    appended trace.
+
+    The filter is designed like the filters of :mod:`obspy.signal.filter`
+    and applied with :class:`~obspy.signal.filter.StreamingFilter`, so the
+    processed data is the same as filtering the whole data at once.
+
+    :type trace: :class:`~obspy.core.trace.Trace`
+    :param trace:  :class:`~obspy.core.trace.Trace` object to append to this
+        RtTrace
+    :type type: str
+    :param type: One of ``'bandpass'``, ``'bandstop'``, ``'lowpass'`` or
+        ``'highpass'``.
+    :type corners: int
+    :param corners: Filter corners / order.
+    :type rtmemory_list: list of :class:`~obspy.realtime.rtmemory.RtMemory`,
+        optional
+    :param rtmemory_list: Persistent memory used by this process for specified
+        trace.
+    :param options: Corner frequencies of the filter, ``freqmin`` and
+        ``freqmax`` for band filters and ``freq`` for low- and highpass
+        filters.
+    :rtype: NumPy :class:`numpy.ndarray`
+    :return: Processed trace data from appended Trace object.
+    """
+    from obspy.signal.filter import StreamingFilter
+
+    if not isinstance(trace, Trace):
+        msg = "trace parameter must be an obspy.core.trace.Trace object."
+        raise ValueError(msg)
+
+    if not rtmemory_list:
+        rtmemory_list = [RtMemory()]
+
+    sample = trace.data
+    if np.size(sample) < 1:
+        return sample
+
+    rtmemory = rtmemory_list[0]
+
+    # initialize memory object, the output memory holds the delay line of
+    # all filter sections and the filter is designed only once
+    if not rtmemory.initialized or not hasattr(rtmemory, 'filter'):
+        filt = StreamingFilter(type, trace.stats.sampling_rate,
+                               corners=corners, **options)
+        memory_size_input = 0
+        memory_size_output = filt.sos.shape[0] * 2
+        rtmemory.initialize(np.float64, memory_size_input,
+                            memory_size_output, 0, 0)
+        rtmemory.filter = filt
+    filt = rtmemory.filter
+
+    # the filter updates the delay line in place
+    filt.zi = rtmemory.output.reshape(1, -1, 2)
+    return filt(sample)
@@ -14,6 +14,7 @@ import numpy as np
 from obspy import read
 from obspy.core.stream import Stream
 from obspy.realtime import RtTrace, signal
+from obspy.signal.filter import bandpass
 
 
 # some debug flags
@@ -230,6 +231,23 @@ class RealTimeSignalTestCase(unittest.TestCase):
         np.testing.assert_almost_equal(self.filt_trace_data,
                                        self.rt_trace.data)
 
+    def test_filter(self):
+        """
+        Testing filter function against a one-shot causal filter.
+        """
+        trace = self.orig_trace.copy()
+        options = {'type': 'bandpass', 'freqmin': 0.01, 'freqmax': 0.1,
+                   'corners': 4}
+        # filtering manual
+        self.filt_trace_data = bandpass(trace.data, 0.01, 0.1,
+                                        trace.stats.sampling_rate, corners=4)
+        # filtering real time
+        process_list = [('filter', options)]
+        self._run_rt_process(process_list)
+        # check results
+        np.testing.assert_allclose(self.filt_trace_data, self.rt_trace.data,
+                                   rtol=1e-10, atol=1e-6)
+
     def test_combined(self):
         """
         Testing combining integrate and differentiate functions.
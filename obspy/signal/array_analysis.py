@@ -21,8 +21,14 @@ from __future__ import (absolute_import, division, print_function,
                         unicode_literals)
 from future.builtins import *  # NOQA
 
+import hashlib
 import math
+import multiprocessing
+import os
+import tempfile
 import warnings
+import zipfile
+from collections import OrderedDict
 
 import numpy as np
 from scipy.integrate import cumtrapz
@@ -834,6 +840,168 @@ def array_transff_freqslowness(coords, slim, sstep, fmin, fmax, fstep,
     return transff
 
 
+class SteeringVectors(object):
+    """
+    Steering vectors of an array for a grid of slownesses and a band of
+    frequencies as used by
+    :func:`~obspy.signal.array_analysis.array_processing`.
+
+    They only depend on the time shift table of the array geometry and the
+    slowness grid (see
+    :func:`~obspy.signal.array_analysis.get_timeshift`) and on the
+    frequency band. Use :meth:`get` to reuse them for repeated calls with the
+    same array, optionally also across sessions via files in a cache
+    directory.
+
+    :type time_shift_table: :class:`numpy.ndarray`
+    :param time_shift_table: Time shifts of all stations and grid points.
+    :type nlow: int
+    :param nlow: Index of the lowest frequency in the spectrum.
+    :type nf: int
+    :param nf: Number of frequencies.
+    :type deltaf: float
+    :param deltaf: Frequency step of the spectrum.
+    :type threads: int
+    :param threads: Number of threads used for the computation. Defaults to
+        the number of CPUs.
+    """
+    #: Total size in bytes of the steering vectors kept in memory by
+    #: :meth:`get`, the least recently used ones are dropped first. Zero
+    #: disables the memory cache.
+    cache_bytes = 256 * 1024 ** 2
+    _cache = OrderedDict()
+
+    def __init__(self, time_shift_table, nlow, nf, deltaf, threads=None):
+        self.time_shift_table = np.require(time_shift_table, np.float32,
+                                           ['C_CONTIGUOUS'])
+        self.nlow = int(nlow)
+        self.nf = int(nf)
+        self.deltaf = float(deltaf)
+        nstat, grdpts_x, grdpts_y = self.time_shift_table.shape
+        if threads is None:
+            threads = multiprocessing.cpu_count()
+        # real and imaginary parts are stored separately for each station
+        # and contiguous along the grid points
+        self.steer = np.empty((self.nf, 2, nstat, grdpts_x * grdpts_y),
+                              dtype=np.float64)
+        errcode = clibsignal.calcSteer(nstat, grdpts_x, grdpts_y, self.nf,
+                                       self.nlow, self.deltaf,
+                                       self.time_shift_table, self.steer,
+                                       threads)
+        if errcode != 0:
+            msg = 'calcSteer exited with error %d'
+            raise Exception(msg % errcode)
+
+    @staticmethod
+    def key(time_shift_table, nlow, nf, deltaf):
+        """
+        Returns the hexadecimal key identifying the steering vectors of the
+        given time shift table and frequency band.
+        """
+        time_shift_table = np.require(time_shift_table, np.float32,
+                                      ['C_CONTIGUOUS'])
+        sha = hashlib.sha1(time_shift_table.tobytes())
+        sha.update(repr((time_shift_table.shape, int(nlow), int(nf),
+                         # deltaf is single precision in the C code
+                         float(np.float32(deltaf)))).encode())
+        return sha.hexdigest()
+
+    @classmethod
+    def get(cls, time_shift_table, nlow, nf, deltaf, cache_dir=None,
+            threads=None):
+        """
+        Returns the steering vectors for the given time shift table and
+        frequency band.
+
+        The most recently used ones are kept in memory up to
+        :attr:`cache_bytes`. If ``cache_dir`` is given they are also looked
+        up there and saved there after they have been computed. Unreadable
+        files are replaced.
+        """
+        key = cls.key(time_shift_table, nlow, nf, deltaf)
+        steer = cls._cache.pop(key, None)
+        filename = None
+        if cache_dir is not None:
+            filename = os.path.join(cache_dir, 'steer_%s.npz' % key)
+        if steer is None and filename and os.path.exists(filename):
+            try:
+                steer = cls.load(filename)
+            except (EnvironmentError, EOFError, KeyError, ValueError,
+                    zipfile.BadZipfile):
+                # Unreadable, it is computed again and replaced.
+                steer = None
+        if steer is None:
+            steer = cls(time_shift_table, nlow, nf, deltaf, threads=threads)
+            if filename:
+                steer._try_save(filename)
+        if steer.steer.nbytes <= cls.cache_bytes:
+            cls._cache[key] = steer
+        while sum(_i.steer.nbytes for _i in cls._cache.values()) > \
+                max(cls.cache_bytes, 0):
+            cls._cache.popitem(last=False)
+        return steer
+
+    @classmethod
+    def clear_cache(cls):
+        """
+        Drops all steering vectors kept in memory by :meth:`get`.
+        """
+        cls._cache.clear()
+
+    def _try_save(self, filename):
+        """
+        Saves the steering vectors with a warning if that fails.
+        """
+        try:
+            self.save(filename)
+        except EnvironmentError as e:
+            msg = "Could not store steering vectors in '%s': %s"
+            warnings.warn(msg % (filename, e))
+
+    def save(self, filename):
+        """
+        Saves the steering vectors to a NumPy ``.npz`` file.
+
+        The file is written under a temporary name in the same directory and
+        renamed afterwards, so processes sharing a cache directory never see
+        incomplete files. The directory is created if needed.
+        """
+        directory = os.path.dirname(filename) or '.'
+        if not os.path.isdir(directory):
+            os.makedirs(directory)
+        fd, temp_filename = tempfile.mkstemp(dir=directory, suffix='.tmp')
+        try:
+            with os.fdopen(fd, 'wb') as fh:
+                np.savez(fh, time_shift_table=self.time_shift_table,
+                         band=np.array([self.nlow, self.nf]),
+                         deltaf=np.array(self.deltaf), steer=self.steer)
+            try:
+                getattr(os, 'replace', os.rename)(temp_filename, filename)
+            except OSError:
+                # Another process was faster (Python 2 on Windows does not
+                # replace files).
+                if not os.path.exists(filename):
+                    raise
+                os.remove(temp_filename)
+        except Exception:
+            if os.path.exists(temp_filename):
+                os.remove(temp_filename)
+            raise
+
+    @classmethod
+    def load(cls, filename):
+        """
+        Loads steering vectors saved with :meth:`save`.
+        """
+        obj = cls.__new__(cls)
+        with np.load(filename) as npz:
+            obj.time_shift_table = npz['time_shift_table']
+            obj.nlow, obj.nf = (int(_i) for _i in npz['band'])
+            obj.deltaf = float(npz['deltaf'])
+            obj.steer = npz['steer']
+        return obj
+
+
 def dump(pow_map, apow_map, i):
     """
     Example function to use with `store` kwarg in
@@ -846,7 +1014,8 @@ def dump(pow_map, apow_map, i):
 def array_processing(stream, win_len, win_frac, sll_x, slm_x, sll_y, slm_y,
                      sl_s, semb_thres, vel_thres, frqlow, frqhigh, stime,
                      etime, prewhiten, verbose=False, coordsys='lonlat',
-                     timestamp='mlabday', method=0, store=None):
+                     timestamp='mlabday', method=0, store=None,
+                     threads=None, steer_cache_dir=None):
     """
     Method for Seismic-Array-Beamforming/FK-Analysis/Capon
 
@@ -898,11 +1067,20 @@ def array_processing(stream, win_len, win_frac, sll_x, slm_x, sll_y, slm_y,
         second arguments and the iteration number as third argument. Useful for
         storing or plotting the map for each iteration. For this purpose the
         dump function of this module can be used.
+    :type threads: int
+    :param threads: Number of threads, consecutive windows are processed on
+        separate threads. Defaults to the number of CPUs.
+    :type steer_cache_dir: str
+    :param steer_cache_dir: Directory in which the steering vectors are saved
+        and looked up, see
+        :class:`~obspy.signal.array_analysis.SteeringVectors`. They are kept
+        in memory for repeated calls up to
+        :attr:`SteeringVectors.cache_bytes
+        <obspy.signal.array_analysis.SteeringVectors.cache_bytes>`.
     :return: :class:`numpy.ndarray` of timestamp, relative relpow, absolute
         relpow, backazimuth, slowness
     """
     res = []
-    eotr = True
 
     # check that sampling rates do not vary
     fs = stream[0].stats.sampling_rate
@@ -942,76 +1120,67 @@ def array_processing(stream, win_len, win_frac, sll_x, slm_x, sll_y, slm_y,
     nlow = max(1, nlow)  # avoid using the offset
     nhigh = min(nfft // 2 - 1, nhigh)  # avoid using nyquist
     nf = nhigh - nlow + 1  # include upper and lower frequency
-    # to speed up the routine a bit we estimate all steering vectors in advance
-    steer = np.empty((nf, grdpts_x, grdpts_y, nstat), dtype=np.complex128)
-    clibsignal.calcSteer(nstat, grdpts_x, grdpts_y, nf, nlow,
-                         deltaf, time_shift_table, steer)
-    _r = np.empty((nf, nstat, nstat), dtype=np.complex128)
-    ft = np.empty((nstat, nf), dtype=np.complex128)
-    newstart = stime
+    if threads is None:
+        threads = multiprocessing.cpu_count()
+    # to speed up the routine a bit we estimate all steering vectors in
+    # advance, they are reused for repeated calls with the same array
+    steer = SteeringVectors.get(time_shift_table, nlow, nf, deltaf,
+                                cache_dir=steer_cache_dir,
+                                threads=threads).steer
     # 0.22 matches 0.2 of historical C bbfk.c
     tap = cosine_taper(nsamp, p=0.22)
+    # start times and offsets of all windows
+    windows = []
+    newstart = stime
     offset = 0
-    relpow_map = np.empty((grdpts_x, grdpts_y), dtype=np.float64)
-    abspow_map = np.empty((grdpts_x, grdpts_y), dtype=np.float64)
-    while eotr:
-        try:
-            for i, tr in enumerate(stream):
-                dat = tr.data[spoint[i] + offset:
-                              spoint[i] + offset + nsamp]
-                dat = (dat - dat.mean()) * tap
-                ft[i, :] = np.fft.rfft(dat, nfft)[nlow:nlow + nf]
-        except IndexError:
+    while all(spoint[i] + offset + nsamp <= len(tr.data)
+              for i, tr in enumerate(stream)):
+        windows.append((newstart, offset))
+        if (newstart + (nsamp + nstep) / fs) > etime:
             break
-        ft = np.ascontiguousarray(ft, np.complex128)
-        relpow_map.fill(0.)
-        abspow_map.fill(0.)
-        # computing the covariances of the signal at different receivers
-        dpow = 0.
-        for i in range(nstat):
-            for j in range(i, nstat):
-                _r[:, i, j] = ft[i, :] * ft[j, :].conj()
-                if method == 1:
-                    _r[:, i, j] /= np.abs(_r[:, i, j].sum())
-                if i != j:
-                    _r[:, j, i] = _r[:, i, j].conjugate()
-                else:
-                    dpow += np.abs(_r[:, i, j].sum())
-        dpow *= nstat
-        if method == 1:
-            # P(f) = 1/(e.H R(f)^-1 e)
-            for n in range(nf):
-                _r[n, :, :] = np.linalg.pinv(_r[n, :, :], rcond=1e-6)
-
-        errcode = clibsignal.generalizedBeamformer(
-            relpow_map, abspow_map, steer, _r, nstat, prewhiten,
-            grdpts_x, grdpts_y, nf, dpow, method)
+        offset += nstep
+        newstart += nstep / fs
+    # the windows are processed in batches, one window per thread
+    for first in range(0, len(windows), threads):
+        batch = windows[first:first + threads]
+        data = np.empty((len(batch), nstat, nsamp), dtype=np.float64)
+        for k, (_, offset) in enumerate(batch):
+            for i, tr in enumerate(stream):
+                data[k, i, :] = tr.data[spoint[i] + offset:
+                                        spoint[i] + offset + nsamp]
+        relpow_maps = np.zeros((len(batch), grdpts_x, grdpts_y),
+                               dtype=np.float64)
+        abspow_maps = np.zeros((len(batch), grdpts_x, grdpts_y),
+                               dtype=np.float64)
+        # taper, spectra, covariances of the signal at different receivers,
+        # their inverse for capon and beamforming of all windows in C
+        errcode = clibsignal.arrayProcessingWindows(
+            data, len(batch), nstat, nsamp, tap, nfft, nlow, nf, steer,
+            prewhiten, grdpts_x, grdpts_y, method, relpow_maps, abspow_maps,
+            threads)
         if errcode != 0:
             msg = 'generalizedBeamforming exited with error %d'
             raise Exception(msg % errcode)
-        ix, iy = np.unravel_index(relpow_map.argmax(), relpow_map.shape)
-        relpow, abspow = relpow_map[ix, iy], abspow_map[ix, iy]
-        if store is not None:
-            store(relpow_map, abspow_map, offset)
-        # here we compute baz, slow
-        slow_x = sll_x + ix * sl_s
-        slow_y = sll_y + iy * sl_s
-
-        slow = np.sqrt(slow_x ** 2 + slow_y ** 2)
-        if slow < 1e-8:
-            slow = 1e-8
-        azimut = 180 * math.atan2(slow_x, slow_y) / math.pi
-        baz = azimut % -360 + 180
-        if relpow > semb_thres and 1. / slow > vel_thres:
-            res.append(np.array([newstart.timestamp, relpow, abspow, baz,
-                                 slow]))
-            if verbose:
-                print(newstart, (newstart + (nsamp / fs)), res[-1][1:])
-        if (newstart + (nsamp + nstep) / fs) > etime:
-            eotr = False
-        offset += nstep
-
-        newstart += nstep / fs
+        for (newstart, offset), relpow_map, abspow_map in zip(
+                batch, relpow_maps, abspow_maps):
+            ix, iy = np.unravel_index(relpow_map.argmax(), relpow_map.shape)
+            relpow, abspow = relpow_map[ix, iy], abspow_map[ix, iy]
+            if store is not None:
+                store(relpow_map, abspow_map, offset)
+            # here we compute baz, slow
+            slow_x = sll_x + ix * sl_s
+            slow_y = sll_y + iy * sl_s
+
+            slow = np.sqrt(slow_x ** 2 + slow_y ** 2)
+            if slow < 1e-8:
+                slow = 1e-8
+            azimut = 180 * math.atan2(slow_x, slow_y) / math.pi
+            baz = azimut % -360 + 180
+            if relpow > semb_thres and 1. / slow > vel_thres:
+                res.append(np.array([newstart.timestamp, relpow, abspow,
+                                     baz, slow]))
+                if verbose:
+                    print(newstart, (newstart + (nsamp / fs)), res[-1][1:])
     res = np.array(res)
     if timestamp == 'julsec':
         pass
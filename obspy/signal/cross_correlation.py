@@ -22,6 +22,7 @@ from future.builtins import *  # NOQA
 from future.utils import native_str
 
 import ctypes as C
+import multiprocessing
 import warnings
 
 import numpy as np
@@ -29,11 +30,17 @@ import scipy
 
 from obspy import Stream, Trace
 from obspy.core.util.misc import MatplotlibBackend
-from obspy.signal.headers import clibsignal
+from obspy.signal.headers import MATCHED_FILTER_DETECTION_DTYPE, clibsignal
 from obspy.signal.invsim import cosine_taper
+from obspy.signal.util import next_pow_2
 
 
-def xcorr(tr1, tr2, shift_len, full_xcorr=False):
+# Rough cost of a FFT in terms of multiply and add operations of the direct
+# cross correlation, used to choose the faster method.
+_XCORR_FFT_COST = 8
+
+
+def xcorr(tr1, tr2, shift_len, full_xcorr=False, method='auto'):
     """
     Cross correlation of tr1 and tr2 in the time domain using window_len.
 
@@ -55,6 +62,12 @@ def xcorr(tr1, tr2, shift_len, full_xcorr=False):
     :type full_xcorr: bool
     :param full_xcorr: If ``True``, the complete xcorr function will be
         returned as :class:`~numpy.ndarray`
+    :type method: str
+    :param method: ``'direct'`` sums up the products for every shift in C,
+        ``'fft'`` computes all shifts at once via FFT. Both give the same
+        result up to rounding errors. ``'auto'`` (default) uses the FFT if
+        it is estimated to be faster, which is the case for all but small
+        values of ``shift_len``.
     :return: **index, value[, fct]** - Index of maximum xcorr value and the
         value itself. The complete xcorr function is returned only if
         ``full_xcorr=True``.
@@ -85,36 +98,85 @@ def xcorr(tr1, tr2, shift_len, full_xcorr=False):
     1.0
     """
     # if we get Trace objects, use their data arrays
-    for tr in [tr1, tr2]:
-        if isinstance(tr, Trace):
-            tr = tr.data
-
-    # check if shift_len parameter is in an acceptable range.
-    # if not the underlying c code tampers with shift_len and uses shift_len/2
-    # instead. we want to avoid this silent automagic and raise an error in the
-    # python layer right here.
-    # see ticket #249 and src/xcorr.c lines 43-57
+    if isinstance(tr1, Trace):
+        tr1 = tr1.data
+    if isinstance(tr2, Trace):
+        tr2 = tr2.data
+
+    # check if shift_len parameter is in an acceptable range. the original
+    # C code X_corr silently used shift_len/2 in that case, which is still
+    # raised as an error instead, see ticket #249.
     if min(len(tr1), len(tr2)) - 2 * shift_len <= 0:
-        msg = "shift_len too large. The underlying C code would silently " + \
-              "use shift_len/2 which we want to avoid."
+        msg = "shift_len too large. It has to be less than half the length " \
+              "of the shorter trace."
         raise ValueError(msg)
-    # be nice and adapt type if necessary
-    tr1 = np.ascontiguousarray(tr1, np.float32)
-    tr2 = np.ascontiguousarray(tr2, np.float32)
-    corp = np.empty(2 * shift_len + 1, dtype=np.float64, order='C')
-
-    shift = C.c_int()
-    coe_p = C.c_double()
+    if method not in ('auto', 'direct', 'fft'):
+        msg = "method has to be one of 'auto', 'direct' or 'fft'."
+        raise ValueError(msg)
+    ndat1, ndat2 = len(tr1), len(tr2)
+    corp = np.zeros(2 * shift_len + 1, dtype=np.float64, order='C')
+    if min(ndat1, ndat2) - 2 * shift_len <= shift_len // 2:
+        msg = "Window of support is too small, not correlating."
+        warnings.warn(msg)
+        return (0, 0.0, corp) if full_xcorr else (0, 0.0)
+
+    # demean and normalize to a maximum amplitude of one, in single
+    # precision like the C code of X_corr
+    tra1, mean1 = _xcorr_normalize(tr1)
+    tra2, mean2 = _xcorr_normalize(tr2)
+    if abs(mean1) < np.finfo(np.float64).eps or \
+            abs(mean2) < np.finfo(np.float64).eps:
+        return (0, 0.0, corp) if full_xcorr else (0, 0.0)
+
+    nfft = next_pow_2(ndat1 + shift_len)
+    if method == 'auto':
+        cost_direct = len(corp) * min(ndat1, ndat2)
+        cost_fft = _XCORR_FFT_COST * nfft * np.log2(nfft)
+        method = 'fft' if cost_fft < cost_direct else 'direct'
+    if method == 'fft':
+        # without wrap around for all needed shifts as nfft >= ndat1 +
+        # shift_len. NumPy caches the FFT setup for every length, so the
+        # power of two lengths are reused for windows of similar length.
+        spec = np.fft.rfft(tra1, nfft) * \
+            np.conj(np.fft.rfft(tra2[:ndat1], nfft))
+        cc = np.fft.irfft(spec, nfft)
+        corp[:shift_len] = cc[nfft - shift_len:]
+        corp[shift_len:] = cc[:shift_len + 1]
+    else:
+        clibsignal.X_corr_lags(tra1, tra2, corp, shift_len, ndat1, ndat2)
 
-    res = clibsignal.X_corr(tr1, tr2, corp, shift_len, len(tr1), len(tr2),
-                            C.byref(shift), C.byref(coe_p))
-    if res:
-        raise MemoryError
+    abs_corp = np.abs(corp)
+    index = np.argmax(abs_corp)
+    if not abs_corp[index] > 0:
+        index = shift_len
+        shift = 0
+    else:
+        shift = index - shift_len
+    # normalize xcorr function
+    energy1 = np.sum(tra1 * tra1, dtype=np.float64)
+    energy2 = np.sum(tra2[:ndat1] * tra2[:ndat1], dtype=np.float64)
+    corp *= 1.0 / (np.sqrt(energy1) * np.sqrt(energy2))
+    value = float(corp[index])
 
     if full_xcorr:
-        return shift.value, coe_p.value, corp
+        return shift, value, corp
     else:
-        return shift.value, coe_p.value
+        return shift, value
+
+
+def _xcorr_normalize(data):
+    """
+    Removes the mean and normalizes data to a maximum amplitude of one.
+
+    Works in single precision like the C code of X_corr. Returns the
+    normalized data and the mean.
+    """
+    data = np.ascontiguousarray(data, np.float32)
+    mean = np.sum(data, dtype=np.float64) / len(data)
+    data = data - np.float32(mean)
+    with np.errstate(divide='ignore', invalid='ignore'):
+        data /= np.abs(data).max()
+    return data, mean
 
 
 def xcorr_3c(st1, st2, shift_len, components=["Z", "N", "E"],
@@ -539,6 +601,99 @@ def templates_max_similarity(st, time, streams_templates):
         return 0
 
 
+def matched_filter(data, templates, threshold, threads=None,
+                   return_cc=False):
+    """
+    Matched filter detection of many multi channel templates at once.
+
+    For every template and channel the normalized cross correlation (the
+    correlation coefficient of the template and the data window at every
+    sample) is computed and averaged over all channels. Channels of a
+    template that have zero energy, e.g. because they are not available for
+    that template, are left out of the average. Every stretch of the
+    averaged correlation at or above ``threshold`` yields one detection at
+    its maximum.
+
+    The work is done in C with FFT overlap-save, the templates are
+    distributed over several threads if ObsPy has been compiled with OpenMP
+    support. Only the averaged correlation functions are kept in memory and
+    only if ``return_cc`` is ``True``.
+
+    :type data: :class:`numpy.ndarray`
+    :param data: Continuous data, one channel per row. All channels have to
+        start at the same time and share the sampling rate of the templates.
+    :type templates: :class:`numpy.ndarray`
+    :param templates: Templates with the shape (number of templates, number
+        of channels, template length). A 2D array is a single template.
+    :type threshold: float
+    :param threshold: Detection threshold for the averaged correlation
+        coefficient.
+    :type threads: int
+    :param threads: Number of threads to use. Defaults to the number of
+        CPUs.
+    :type return_cc: bool
+    :param return_cc: Also return the averaged correlation functions.
+    :rtype: :class:`numpy.ndarray`
+    :return: Detections sorted by time as a structured array with the
+        fields ``template_id``, ``index`` (sample of the data where the
+        template starts) and ``cc`` (averaged correlation coefficient). If
+        ``return_cc`` is ``True`` a tuple of the detections and an array of
+        the averaged correlation functions with one row per template.
+
+    .. rubric:: Example
+
+    >>> np.random.seed(42)
+    >>> data = np.random.randn(2, 10000)
+    >>> templates = np.array([data[:, 2000:2200], data[:, 7000:7200]])
+    >>> detections = matched_filter(data, templates, 0.9)
+    >>> print(detections['template_id'], detections['index'])
+    [0 1] [2000 7000]
+    """
+    data = np.array(data, dtype=np.float64, order='C', ndmin=2)
+    templates = np.array(templates, dtype=np.float64, order='C', ndmin=3)
+    if data.ndim != 2 or templates.ndim != 3:
+        msg = "data has to be a 2D and templates a 3D array."
+        raise ValueError(msg)
+    ntmpl, nchan, tlen = templates.shape
+    ndat = data.shape[1]
+    if data.shape[0] != nchan:
+        msg = "Templates and data need the same number of channels."
+        raise ValueError(msg)
+    if tlen < 1 or ndat < tlen:
+        msg = "Data has to be at least as long as the templates."
+        raise ValueError(msg)
+    if threads is None:
+        threads = multiprocessing.cpu_count()
+
+    cc = None
+    cc_ptr = None
+    if return_cc:
+        cc = np.empty((ntmpl, ndat - tlen + 1), dtype=np.float64)
+        cc_ptr = cc.ctypes.data
+    # the detections are collected in C and copied to an array allocated
+    # here once their number is known
+    buffers = []
+
+    def allocate_detections(count):
+        buffers.append(np.empty(count, dtype=MATCHED_FILTER_DETECTION_DTYPE))
+        return buffers[-1].ctypes.data
+    alloc = C.CFUNCTYPE(C.c_longlong, C.c_int)(allocate_detections)
+
+    count = clibsignal.matched_filter(data, nchan, ndat, templates, ntmpl,
+                                      tlen, threshold, cc_ptr, alloc, threads)
+    if count < 0:
+        raise MemoryError("Matched filter could not allocate memory.")
+    if buffers:
+        detections = buffers[0]
+    else:
+        detections = np.empty(0, dtype=MATCHED_FILTER_DETECTION_DTYPE)
+    detections = detections[np.lexsort((detections['template_id'],
+                                        detections['index']))]
+    if return_cc:
+        return detections, cc
+    return detections
+
+
 if __name__ == '__main__':
     import doctest
     doctest.testmod(exclude_empty=True)
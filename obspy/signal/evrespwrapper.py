@@ -5,6 +5,7 @@ from future.builtins import *  # NOQA
 from future.utils import native_str
 
 import ctypes as C
+import threading
 
 import numpy as np
 
@@ -227,6 +228,10 @@ Channel._fields_ = [
 
 clibevresp.curr_file = C.c_char_p.in_dll(clibevresp, 'curr_file')
 
+# evalresp keeps the state of parsing and error handling in global variables,
+# all calls using them have to hold this lock.
+EVALRESP_LOCK = threading.Lock()
+
 
 # int _obspy_calc_resp(struct channel *chan, double *freq, int nfreqs,
 #                      struct complex *output,
@@ -258,6 +263,66 @@ clibevresp._obspy_norm_resp.argtypes = [C.POINTER(Channel), C.c_int, C.c_int]
 clibevresp._obspy_norm_resp.restype = C.c_int
 
 
+# int _obspy_parse_response(char *file, char *sta, char *cha, char *net,
+#                           char *locid, char *datime, int start_stage,
+#                           int stop_stage, struct _obspy_response **result)
+# The response starts with the parsed channel.
+clibevresp._obspy_parse_response.argtypes = [
+    C.c_char_p,
+    C.c_char_p,
+    C.c_char_p,
+    C.c_char_p,
+    C.c_char_p,
+    C.c_char_p,
+    C.c_int,
+    C.c_int,
+    C.POINTER(C.POINTER(Channel))]
+clibevresp._obspy_parse_response.restype = C.c_int
+
+
+# void _obspy_free_response(struct _obspy_response *resp)
+clibevresp._obspy_free_response.argtypes = [C.POINTER(Channel)]
+clibevresp._obspy_free_response.restype = None
+
+
+# int _obspy_response_in_epoch(const struct _obspy_response *resp,
+#                              const char *datime)
+clibevresp._obspy_response_in_epoch.argtypes = [C.POINTER(Channel),
+                                                C.c_char_p]
+clibevresp._obspy_response_in_epoch.restype = C.c_int
+
+
+# int _obspy_response_list_freqs(const struct _obspy_response *resp,
+#                                double *freqs, int n)
+clibevresp._obspy_response_list_freqs.argtypes = [
+    C.POINTER(Channel),
+    np.ctypeslib.ndpointer(dtype=np.float64,  # freqs
+                           ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int]
+clibevresp._obspy_response_list_freqs.restype = C.c_int
+
+
+# int _obspy_eval_response(const struct _obspy_response *resp, double *freq,
+#                          int nfreqs, struct complex *output,
+#                          char *out_units, int start_stage, int stop_stage,
+#                          int useTotalSensitivityFlag)
+clibevresp._obspy_eval_response.argtypes = [
+    C.POINTER(Channel),
+    np.ctypeslib.ndpointer(dtype=np.float64,  # freqs
+                           ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int,
+    np.ctypeslib.ndpointer(dtype=np.complex128,  # output
+                           ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_char_p,
+    C.c_int,
+    C.c_int,
+    C.c_int]
+clibevresp._obspy_eval_response.restype = C.c_int
+
+
 # Only useful for debugging thus not officially included as every import of
 # this file results in the function pointer being created thus slowing it down.
 # void print_chan(struct channel *chan, int start_stage, int stop_stage,
@@ -21,6 +21,7 @@ from __future__ import (absolute_import, division, print_function,
                         unicode_literals)
 from future.builtins import *  # NOQA
 
+import multiprocessing
 import warnings
 
 import numpy as np
@@ -35,6 +36,8 @@ except ImportError:
     from ._sosfilt import _sosfilt as sosfilt
     from ._sosfilt import _zpk2sos as zpk2sos
 
+from obspy.signal.headers import BWORTH_MAX_SECTIONS, BWORTH_TYPES, clibsignal
+
 
 def bandpass(data, freqmin, freqmax, df, corners=4, zerophase=False):
     """
@@ -56,6 +59,14 @@ def bandpass(data, freqmin, freqmax, df, corners=4, zerophase=False):
         the resulting filtered trace.
     :return: Filtered data.
     """
+    sos = _bandpass_sos(freqmin, freqmax, df, corners)
+    return _apply_sos(sos, data, zerophase)
+
+
+def _bandpass_sos(freqmin, freqmax, df, corners):
+    """
+    Second order sections of a Butterworth bandpass, see :func:`bandpass`.
+    """
     fe = 0.5 * df
     low = freqmin / fe
     high = freqmax / fe
@@ -65,19 +76,13 @@ def bandpass(data, freqmin, freqmax, df, corners=4, zerophase=False):
                "above Nyquist ({}). Applying a high-pass instead.").format(
                     freqmax, fe)
         warnings.warn(msg)
-        return highpass(data, freq=freqmin, df=df, corners=corners,
-                        zerophase=zerophase)
+        return _highpass_sos(freqmin, df, corners)
     if low > 1:
         msg = "Selected low corner frequency is above Nyquist."
         raise ValueError(msg)
     z, p, k = iirfilter(corners, [low, high], btype='band',
                         ftype='butter', output='zpk')
-    sos = zpk2sos(z, p, k)
-    if zerophase:
-        firstpass = sosfilt(sos, data)
-        return sosfilt(sos, firstpass[::-1])[::-1]
-    else:
-        return sosfilt(sos, data)
+    return zpk2sos(z, p, k)
 
 
 def bandstop(data, freqmin, freqmax, df, corners=4, zerophase=False):
@@ -100,6 +105,14 @@ def bandstop(data, freqmin, freqmax, df, corners=4, zerophase=False):
         the resulting filtered trace.
     :return: Filtered data.
     """
+    sos = _bandstop_sos(freqmin, freqmax, df, corners)
+    return _apply_sos(sos, data, zerophase)
+
+
+def _bandstop_sos(freqmin, freqmax, df, corners):
+    """
+    Second order sections of a Butterworth bandstop, see :func:`bandstop`.
+    """
     fe = 0.5 * df
     low = freqmin / fe
     high = freqmax / fe
@@ -114,12 +127,7 @@ def bandstop(data, freqmin, freqmax, df, corners=4, zerophase=False):
         raise ValueError(msg)
     z, p, k = iirfilter(corners, [low, high],
                         btype='bandstop', ftype='butter', output='zpk')
-    sos = zpk2sos(z, p, k)
-    if zerophase:
-        firstpass = sosfilt(sos, data)
-        return sosfilt(sos, firstpass[::-1])[::-1]
-    else:
-        return sosfilt(sos, data)
+    return zpk2sos(z, p, k)
 
 
 def lowpass(data, freq, df, corners=4, zerophase=False):
@@ -141,6 +149,14 @@ def lowpass(data, freq, df, corners=4, zerophase=False):
         the resulting filtered trace.
     :return: Filtered data.
     """
+    sos = _lowpass_sos(freq, df, corners)
+    return _apply_sos(sos, data, zerophase)
+
+
+def _lowpass_sos(freq, df, corners):
+    """
+    Second order sections of a Butterworth lowpass, see :func:`lowpass`.
+    """
     fe = 0.5 * df
     f = freq / fe
     # raise for some bad scenarios
@@ -151,12 +167,7 @@ def lowpass(data, freq, df, corners=4, zerophase=False):
         warnings.warn(msg)
     z, p, k = iirfilter(corners, f, btype='lowpass', ftype='butter',
                         output='zpk')
-    sos = zpk2sos(z, p, k)
-    if zerophase:
-        firstpass = sosfilt(sos, data)
-        return sosfilt(sos, firstpass[::-1])[::-1]
-    else:
-        return sosfilt(sos, data)
+    return zpk2sos(z, p, k)
 
 
 def highpass(data, freq, df, corners=4, zerophase=False):
@@ -178,6 +189,14 @@ def highpass(data, freq, df, corners=4, zerophase=False):
         the resulting filtered trace.
     :return: Filtered data.
     """
+    sos = _highpass_sos(freq, df, corners)
+    return _apply_sos(sos, data, zerophase)
+
+
+def _highpass_sos(freq, df, corners):
+    """
+    Second order sections of a Butterworth highpass, see :func:`highpass`.
+    """
     fe = 0.5 * df
     f = freq / fe
     # raise for some bad scenarios
@@ -186,7 +205,14 @@ def highpass(data, freq, df, corners=4, zerophase=False):
         raise ValueError(msg)
     z, p, k = iirfilter(corners, f, btype='highpass', ftype='butter',
                         output='zpk')
-    sos = zpk2sos(z, p, k)
+    return zpk2sos(z, p, k)
+
+
+def _apply_sos(sos, data, zerophase):
+    """
+    Applies second order sections once or, if ``zerophase`` is ``True``, once
+    forwards and once backwards.
+    """
     if zerophase:
         firstpass = sosfilt(sos, data)
         return sosfilt(sos, firstpass[::-1])[::-1]
@@ -194,6 +220,171 @@ def highpass(data, freq, df, corners=4, zerophase=False):
         return sosfilt(sos, data)
 
 
+# Filter designs supported by StreamingFilter
+_SOS_DESIGNS = {
+    'bandpass': _bandpass_sos,
+    'bandstop': _bandstop_sos,
+    'lowpass': _lowpass_sos,
+    'highpass': _highpass_sos}
+
+
+class StreamingFilter(object):
+    """
+    Butterworth filter that keeps its state between calls.
+
+    The filter is designed exactly like in :func:`bandpass`,
+    :func:`bandstop`, :func:`lowpass` and :func:`highpass` but keeps the
+    delay line of its second order sections after every call. Filtering
+    consecutive chunks of continuous data thus gives the same result as
+    filtering all data at once, without edge effects at the chunk borders
+    and without the need for overlapping chunks. Only causal filtering is
+    possible this way.
+
+    Several channels can be filtered at once by passing 2D arrays with one
+    channel per row, every channel has its own state.
+
+    :type type: str
+    :param type: One of ``'bandpass'``, ``'bandstop'``, ``'lowpass'`` or
+        ``'highpass'``.
+    :param df: Sampling rate in Hz.
+    :param corners: Filter corners / order.
+    :type threads: int
+    :param threads: Number of threads used to filter several channels if
+        ObsPy has been compiled with OpenMP support.
+    :param options: Corner frequencies of the filter, ``freqmin`` and
+        ``freqmax`` for band filters and ``freq`` for low- and highpass
+        filters.
+
+    .. rubric:: Example
+
+    >>> from obspy import read
+    >>> tr = read()[0]
+    >>> filt = StreamingFilter('bandpass', df=tr.stats.sampling_rate,
+    ...                        freqmin=1.0, freqmax=5.0)
+    >>> first = filt(tr.data[:1000])
+    >>> second = filt(tr.data[1000:])
+    >>> full = bandpass(tr.data, 1.0, 5.0, df=tr.stats.sampling_rate)
+    >>> np.allclose(np.concatenate([first, second]), full)
+    True
+    """
+    def __init__(self, type, df, corners=4, threads=1, **options):
+        type = type.lower()
+        if type not in _SOS_DESIGNS:
+            msg = "Filter type '%s' not supported by StreamingFilter." % type
+            raise ValueError(msg)
+        self.type = type
+        self.df = df
+        self.corners = corners
+        self.threads = threads
+        self.options = options
+        sos = _SOS_DESIGNS[type](df=df, corners=corners, **options)
+        self.sos = np.require(sos, dtype=np.float64, requirements=['C'])
+        self.zi = None
+
+    def reset(self):
+        """
+        Resets the filter state to zero, e.g. after a gap in the data.
+        """
+        self.zi = None
+
+    def __call__(self, data):
+        """
+        Filters the next chunk of data.
+
+        :type data: numpy.ndarray
+        :param data: Next chunk of data, 1D for a single channel or 2D with
+            one channel per row. The number of channels must not change
+            between calls.
+        :return: Filtered chunk as a new :class:`numpy.float64` array.
+        """
+        data = np.array(data, dtype=np.float64, order='C')
+        if data.ndim not in (1, 2):
+            msg = "data has to be a 1D or 2D array."
+            raise ValueError(msg)
+        if data.size == 0:
+            return data
+        data_2d = data.reshape(-1, data.shape[-1])
+        ntr, ndat = data_2d.shape
+        nsec = len(self.sos)
+        if self.zi is None:
+            self.zi = np.zeros((ntr, nsec, 2), dtype=np.float64)
+        elif self.zi.shape != (ntr, nsec, 2):
+            msg = "Number of channels must not change between calls."
+            raise ValueError(msg)
+        clibsignal.spr_sos_filter(data_2d, ntr, ndat, self.sos, nsec,
+                                  self.zi, self.threads)
+        return data
+
+
+def bworth_batch(data, df, freqmin=None, freqmax=None, sections=2,
+                 zerophase=False, threads=None):
+    """
+    Fast Butterworth filter applied to many traces at once.
+
+    Applies the recursive Butterworth filters of ``filt_util.c`` (also used
+    by :func:`~obspy.signal.trigger.ar_pick`) to all rows of a 2D array. The
+    traces are distributed over several threads if ObsPy has been compiled
+    with OpenMP support. Depending on the given corner frequencies a bandpass
+    (``freqmin`` and ``freqmax``), highpass (only ``freqmin``) or lowpass
+    (only ``freqmax``) is applied.
+
+    :type data: numpy.ndarray
+    :param data: Traces to filter, one trace per row. Traces have to be of
+        equal length. Filtering is done in single precision.
+    :param df: Sampling rate in Hz.
+    :param freqmin: Pass band low corner frequency.
+    :param freqmax: Pass band high corner frequency.
+    :type sections: int
+    :param sections: Number of filter sections, at most 10. Every section of
+        a bandpass is of fourth order, of a high- or lowpass of second order.
+    :param zerophase: If True, apply filter once forwards and once backwards.
+        This results in twice the filter order but zero phase shift in
+        the resulting filtered traces.
+    :type threads: int
+    :param threads: Number of threads to use. Defaults to the number of
+        CPUs.
+    :return: Filtered data as a new :class:`numpy.float32` array.
+    """
+    if freqmin is not None and freqmax is not None:
+        if freqmin >= freqmax:
+            msg = "freqmin has to be smaller than freqmax."
+            raise ValueError(msg)
+        btype = 'bandpass'
+    elif freqmin is not None:
+        btype = 'highpass'
+    elif freqmax is not None:
+        btype = 'lowpass'
+    else:
+        msg = "At least one of freqmin and freqmax has to be given."
+        raise ValueError(msg)
+    if not 1 <= sections <= BWORTH_MAX_SECTIONS:
+        msg = "sections has to be between 1 and %d." % BWORTH_MAX_SECTIONS
+        raise ValueError(msg)
+    fe = 0.5 * df
+    for freq in (freqmin, freqmax):
+        if freq is not None and freq >= fe:
+            msg = "Selected corner frequency is at or above Nyquist."
+            raise ValueError(msg)
+    if threads is None:
+        threads = multiprocessing.cpu_count()
+
+    data = np.array(data, dtype=np.float32, order='C', ndmin=2)
+    if data.ndim != 2:
+        msg = "data has to be a 2D array with one trace per row."
+        raise ValueError(msg)
+    f1 = freqmin if freqmin is not None else freqmax
+    f2 = freqmax if freqmax is not None else freqmin
+    ntr, ndat = data.shape
+    errcode = clibsignal.spr_bworth_batch(data, ntr, ndat, 1.0 / df,
+                                          BWORTH_TYPES[btype], f1, f2,
+                                          sections, int(bool(zerophase)),
+                                          threads)
+    if errcode != 0:
+        msg = "Invalid number of sections or filter type."
+        raise ValueError(msg)
+    return data
+
+
 def envelope(data):
     """
     Envelope of a function.
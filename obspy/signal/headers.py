@@ -23,26 +23,53 @@ clibsignal.calcSteer.argtypes = [
     C.c_int, C.c_int, C.c_int, C.c_int, C.c_int, C.c_float,
     np.ctypeslib.ndpointer(dtype=np.float32, ndim=3,
                            flags=native_str('C_CONTIGUOUS')),
-    np.ctypeslib.ndpointer(dtype=np.complex128, ndim=4,
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=4,
                            flags=native_str('C_CONTIGUOUS')),
+    C.c_int,
 ]
-clibsignal.calcSteer.restype = C.c_void_p
+clibsignal.calcSteer.restype = C.c_int
 
 clibsignal.generalizedBeamformer.argtypes = [
     np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
                            flags=native_str('C_CONTIGUOUS')),
     np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
                            flags=native_str('C_CONTIGUOUS')),
-    np.ctypeslib.ndpointer(dtype=np.complex128, ndim=4,
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=4,
                            flags=native_str('C_CONTIGUOUS')),
     np.ctypeslib.ndpointer(dtype=np.complex128, ndim=3,
                            flags=native_str('C_CONTIGUOUS')),
     C.c_int, C.c_int, C.c_int, C.c_int, C.c_int,
     C.c_double,
     C.c_int,
+    C.c_int,
 ]
 clibsignal.generalizedBeamformer.restype = C.c_int
 
+clibsignal.arrayProcessingWindows.argtypes = [
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=3,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int, C.c_int, C.c_int,
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int, C.c_int, C.c_int,
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=4,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int, C.c_int, C.c_int, C.c_int,
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=3,
+                           flags=native_str('C_CONTIGUOUS')),
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=3,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int,
+]
+clibsignal.arrayProcessingWindows.restype = C.c_int
+
+clibsignal.hermitianPseudoInverse.argtypes = [
+    np.ctypeslib.ndpointer(dtype=np.complex128, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int,
+]
+clibsignal.hermitianPseudoInverse.restype = C.c_int
+
 clibsignal.X_corr.argtypes = [
     np.ctypeslib.ndpointer(dtype=np.float32, ndim=1,
                            flags=native_str('C_CONTIGUOUS')),
@@ -54,6 +81,32 @@ clibsignal.X_corr.argtypes = [
     C.POINTER(C.c_int), C.POINTER(C.c_double)]
 clibsignal.X_corr.restype = C.c_int
 
+clibsignal.X_corr_lags.argtypes = [
+    np.ctypeslib.ndpointer(dtype=np.float32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    np.ctypeslib.ndpointer(dtype=np.float32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int, C.c_int, C.c_int]
+clibsignal.X_corr_lags.restype = None
+
+MATCHED_FILTER_DETECTION_DTYPE = np.dtype([
+    (native_str('template_id'), np.int32),
+    (native_str('index'), np.int64),
+    (native_str('cc'), np.float64),
+], align=True)
+
+clibsignal.matched_filter.argtypes = [
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int, C.c_int,
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=3,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int, C.c_int, C.c_double, C.c_void_p,
+    C.CFUNCTYPE(C.c_longlong, C.c_int), C.c_int]
+clibsignal.matched_filter.restype = C.c_int
+
 clibsignal.recstalta.argtypes = [
     np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
                            flags=native_str('C_CONTIGUOUS')),
@@ -62,6 +115,19 @@ clibsignal.recstalta.argtypes = [
     C.c_int, C.c_int, C.c_int]
 clibsignal.recstalta.restype = C.c_void_p
 
+# sample types accepted by recstalta_trigger
+RECSTALTA_DTYPES = {
+    np.dtype(np.float32): 0,
+    np.dtype(np.float64): 1,
+    np.dtype(np.int32): 2}
+
+clibsignal.recstalta_trigger.argtypes = [
+    np.ctypeslib.ndpointer(ndim=1, flags=native_str('C_CONTIGUOUS')),
+    C.c_int, C.c_int, C.c_int, C.c_int, C.c_void_p,
+    C.c_double, C.c_double, C.c_longlong, C.c_int,
+    C.CFUNCTYPE(C.c_longlong, C.c_int)]
+clibsignal.recstalta_trigger.restype = C.c_int
+
 clibsignal.ppick.argtypes = [
     np.ctypeslib.ndpointer(dtype=np.float32, ndim=1,
                            flags=native_str('C_CONTIGUOUS')),
@@ -102,6 +168,16 @@ clibsignal.stalta.argtypes = [
 ]
 clibsignal.stalta.restype = C.c_int
 
+clibsignal.stalta_batch.argtypes = [
+    np.ctypeslib.ndpointer(dtype=head_stalta_t, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    C.c_int, C.c_int]
+clibsignal.stalta_batch.restype = C.c_int
+
 clibsignal.hermite_interpolation.argtypes = [
     np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
                            flags=native_str('C_CONTIGUOUS')),
@@ -133,7 +209,7 @@ clibsignal.lanczos_resample.argtypes = [
     C.c_int,
     # window
     C.c_int]
-clibsignal.lanczos_resample.restype = None
+clibsignal.lanczos_resample.restype = C.c_int
 
 clibsignal.calculate_kernel.argtypes = [
     # double *x
@@ -152,6 +228,44 @@ clibsignal.calculate_kernel.argtypes = [
     C.c_int]
 clibsignal.calculate_kernel.restype = None
 
+# Butterworth filter types of filt_util.c
+BWORTH_TYPES = {'bandpass': 0, 'highpass': 1, 'lowpass': 2}
+BWORTH_MAX_SECTIONS = 10
+
+clibsignal.spr_bworth_batch.argtypes = [
+    # float *data
+    np.ctypeslib.ndpointer(dtype=np.float32, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    # int ntr, int ndat
+    C.c_int, C.c_int,
+    # float tsa
+    C.c_float,
+    # int type
+    C.c_int,
+    # float f1, float f2
+    C.c_float, C.c_float,
+    # int ns, int zph, int threads
+    C.c_int, C.c_int, C.c_int]
+clibsignal.spr_bworth_batch.restype = C.c_int
+
+clibsignal.spr_sos_filter.argtypes = [
+    # double *data
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    # int ntr, int ndat
+    C.c_int, C.c_int,
+    # const double *sos
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    # int nsec
+    C.c_int,
+    # double *zi
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=3,
+                           flags=native_str('C_CONTIGUOUS')),
+    # int threads
+    C.c_int]
+clibsignal.spr_sos_filter.restype = None
+
 STALEN = 64
 NETLEN = 64
 CHALEN = 64
@@ -232,6 +232,12 @@ def lanczos_interpolation(data, old_start, old_dt, new_start, new_dt, new_npts,
     different windows, please use the
     :func:`~obspy.signal.interpolation.plot_lanczos_windows` function.
 
+    If the ratio of the new and the old sampling interval is a fraction
+    with a denominator of at most 4096, e.g. for resampling from 100 Hz to
+    40 Hz, the kernel weights repeat after a few samples. They are then
+    computed only once for each distinct fractional sample position
+    (polyphase filter).
+
     Also be aware of any boundary effects. All values outside the data
     range are assumed to be zero which matters when calculating interpolated
     values at the boundaries. At each side the area with potential boundary
@@ -301,11 +307,20 @@ def lanczos_interpolation(data, old_start, old_dt, new_start, new_dt, new_npts,
     if a < 1:
         raise ValueError("a must be at least 1.")
 
+    window = window.lower()
+    if window not in _LANCZOS_KERNEL_MAP:
+        msg = "Invalid window. Valid windows: %s" % ", ".join(
+            sorted(_LANCZOS_KERNEL_MAP.keys()))
+        raise ValueError(msg)
+
     return_data = np.zeros(new_npts, dtype=np.float64)
 
-    clibsignal.lanczos_resample(
-        np.require(data, dtype=np.float64), return_data, dt_factor, offset,
-        len(data), len(return_data), int(a), 0)
+    errcode = clibsignal.lanczos_resample(
+        np.require(data, dtype=np.float64, requirements=["C_CONTIGUOUS"]),
+        return_data, dt_factor, offset, len(data), len(return_data), int(a),
+        _LANCZOS_KERNEL_MAP[window])
+    if errcode != 0:
+        raise MemoryError("Could not allocate the Lanczos kernel weights.")
     return return_data
 
 
@@ -25,9 +25,12 @@ from future.builtins import *  # NOQA
 from future.utils import native_str
 
 import ctypes as C
+import hashlib
 import math as M
 import os
+import threading
 import warnings
+from collections import OrderedDict
 
 import numpy as np
 import scipy.signal
@@ -35,6 +38,7 @@ import scipy.signal
 from obspy.core.util.attribdict import AttribDict
 from obspy.core.util.base import NamedTemporaryFile
 from obspy.core.inventory.response import Response
+from obspy.signal import evrespwrapper as ew
 from obspy.signal import util
 from obspy.signal.detrend import simple as simple_detrend
 from obspy.signal.headers import clibevresp
@@ -48,6 +52,12 @@ from obspy.signal.util import _npts2nfft
 WOODANDERSON = {'poles': [-6.283 + 4.7124j, -6.283 - 4.7124j],
                 'zeros': [0 + 0j], 'gain': 1.0, 'sensitivity': 2080}
 
+# Number of parsed RESP responses kept in memory by parse_resp().
+RESP_CACHE_SIZE = 64
+
+_resp_cache = OrderedDict()
+_resp_cache_lock = threading.Lock()
+
 
 def cosine_taper(npts, p=0.1, freqs=None, flimit=None, halfcosine=True,
                  sactaper=False):
@@ -213,6 +223,179 @@ def cosine_sac_taper(freqs, flimit):
     return taper
 
 
+def _read_resp_data(filename):
+    if isinstance(filename, (str, native_str)):
+        with open(filename, 'rb') as fh:
+            return fh.read()
+    return filename.read()
+
+
+class EvalrespResponse(object):
+    """
+    Response of a single channel parsed from a SEED RESP file by evalresp.
+
+    Parsing uses the global state of evalresp and is serialized, evaluating
+    a parsed response is reentrant and runs without the GIL, so many
+    frequencies and channels can be evaluated on several threads at once.
+    Usually created and cached by :func:`parse_resp`.
+    """
+    def __init__(self, data, date, station='*', channel='*', network='*',
+                 locid='*'):
+        """
+        :type data: bytes
+        :param data: Content of the SEED RESP file.
+        :type date: :class:`~obspy.core.utcdatetime.UTCDateTime`
+        :param date: Date of interest
+        :type station: str
+        :param station: Station id
+        :type channel: str
+        :param channel: Channel id
+        :type network: str
+        :param network: Network id
+        :type locid: str
+        :param locid: Location id
+        """
+        self._handle = None
+        handle = C.POINTER(ew.Channel)()
+        # evalresp needs files with correct line separators depending on OS
+        with NamedTemporaryFile() as fh:
+            tempfile = fh.name
+            fh.write(os.linesep.encode('ascii', 'strict').join(
+                data.splitlines()))
+            fh.close()
+            with ew.EVALRESP_LOCK:
+                # start at zero to get zero for offset/ DC of fft
+                rc = clibevresp._obspy_parse_response(
+                    tempfile.encode('ascii', 'strict'),
+                    station.encode('ascii', 'strict'),
+                    channel.encode('ascii', 'strict'),
+                    network.encode('ascii', 'strict'),
+                    locid.encode('ascii', 'strict'),
+                    date.format_seed().encode('ascii', 'strict'),
+                    -1, 0, C.byref(handle))
+        if rc == -1:
+            # out of memory
+            e, m = ew.ENUM_ERROR_CODES[rc]
+            raise e(m)
+        if rc:
+            msg = "evalresp failed to calculate a response."
+            raise ValueError(msg)
+        self._handle = handle
+        chan = handle.contents
+        self.id = ".".join(x.decode('ascii', 'strict') for x in (
+            chan.network, chan.staname, chan.locid, chan.chaname))
+        nfreqs = clibevresp._obspy_response_list_freqs(
+            handle, np.empty(0, dtype=np.float64), 0)
+        if nfreqs:
+            self.list_frequencies = np.empty(nfreqs, dtype=np.float64)
+            clibevresp._obspy_response_list_freqs(
+                handle, self.list_frequencies, nfreqs)
+        else:
+            self.list_frequencies = None
+
+    def __del__(self):
+        if self._handle:
+            clibevresp._obspy_free_response(self._handle)
+            self._handle = None
+
+    def in_epoch(self, date):
+        """
+        Whether the given date is within the epoch of the response.
+
+        :type date: :class:`~obspy.core.utcdatetime.UTCDateTime`
+        """
+        return bool(clibevresp._obspy_response_in_epoch(
+            self._handle, date.format_seed().encode('ascii', 'strict')))
+
+    def evaluate(self, frequencies, units="VEL"):
+        """
+        Evaluate the response for the given frequencies.
+
+        Responses given as a list of values (blockette 55) are evaluated at
+        their own frequencies, :attr:`list_frequencies`, only.
+
+        :type frequencies: list of float
+        :param frequencies: Discrete frequencies to calculate response for.
+        :type units: str
+        :param units: Units to return response in. Can be either DEF, DIS,
+            VEL or ACC
+        :rtype: :class:`numpy.ndarray` complex128
+        """
+        if self.list_frequencies is not None:
+            frequencies = self.list_frequencies
+        frequencies = np.ascontiguousarray(frequencies, dtype=np.float64)
+        h = np.empty(len(frequencies), dtype=np.complex128)
+        rc = clibevresp._obspy_eval_response(
+            self._handle, frequencies, len(frequencies), h,
+            units.encode('ascii', 'strict'), -1, 0, 0)
+        if rc:
+            e, m = ew.ENUM_ERROR_CODES[rc]
+            raise e(m)
+        return h
+
+
+def parse_resp(filename, date, station='*', channel='*', network='*',
+               locid='*'):
+    """
+    Parse the response of a channel from a SEED RESP file, cached in memory.
+
+    The last :const:`RESP_CACHE_SIZE` responses are kept. Files are
+    identified by their path, size and modification time, file like objects
+    by their content. The responses are cached per channel epoch the
+    identifiers resolved to, including wildcards, and a cached response is
+    reused for all dates between the start and end time of its epoch.
+
+    :type filename: str or file
+    :param filename: SEED RESP-filename or open file like object with RESP
+        information. Any object that provides a read() method will be
+        considered to be a file like object.
+    :type date: :class:`~obspy.core.utcdatetime.UTCDateTime`
+    :param date: Date of interest
+    :type station: str
+    :param station: Station id
+    :type channel: str
+    :param channel: Channel id
+    :type network: str
+    :param network: Network id
+    :type locid: str
+    :param locid: Location id
+    :rtype: :class:`EvalrespResponse`
+    """
+    data = None
+    if isinstance(filename, (str, native_str)):
+        stat = os.stat(filename)
+        file_id = (os.path.abspath(filename), stat.st_size, stat.st_mtime)
+    else:
+        data = _read_resp_data(filename)
+        file_id = hashlib.sha1(data).hexdigest()
+    key = (file_id, (station, channel, network, locid))
+
+    with _resp_cache_lock:
+        for resp in _resp_cache.get(key, []):
+            if resp.in_epoch(date):
+                # mark as most recently used
+                _resp_cache[key] = _resp_cache.pop(key)
+                return resp
+
+    if data is None:
+        data = _read_resp_data(filename)
+    resp = EvalrespResponse(data, date, station, channel, network, locid)
+
+    with _resp_cache_lock:
+        _resp_cache[key] = _resp_cache.pop(key, []) + [resp]
+        while sum(len(x) for x in _resp_cache.values()) > RESP_CACHE_SIZE:
+            _resp_cache.popitem(last=False)
+    return resp
+
+
+def clear_resp_cache():
+    """
+    Remove all responses cached by :func:`parse_resp`.
+    """
+    with _resp_cache_lock:
+        _resp_cache.clear()
+
+
 def evalresp_for_frequencies(t_samp, frequencies, filename, date, station='*',
                              channel='*', network='*', locid='*', units="VEL",
                              debug=False):
@@ -221,7 +404,8 @@ def evalresp_for_frequencies(t_samp, frequencies, filename, date, station='*',
     SEED RESP-file for the specified frequencies.
 
     :type t_samp: float
-    :param t_samp: Sampling interval in seconds
+    :param t_samp: Sampling interval in seconds. It is not used, the
+        response is evaluated at the given frequencies only.
     :type frequencies: list of float
     :param frequencies: Discrete frequencies to calculate response for.
     :type filename: str or file
@@ -241,15 +425,18 @@ def evalresp_for_frequencies(t_samp, frequencies, filename, date, station='*',
     :type units: str
     :param units: Units to return response in. Can be either DIS, VEL or ACC
     :type debug: bool
-    :param debug: Verbose output to stdout. Disabled by default.
+    :param debug: Verbose output to stdout. Disabled by default. The RESP
+        file is parsed again by evalresp and not cached in that case.
     :rtype: :class:`numpy.ndarray` complex128
     :return: Frequency response from SEED RESP-file for given frequencies
+
+    The parsed response is cached, see :func:`parse_resp`.
     """
-    if isinstance(filename, (str, native_str)):
-        with open(filename, 'rb') as fh:
-            data = fh.read()
-    elif hasattr(filename, 'read'):
-        data = filename.read()
+    if not debug:
+        resp = parse_resp(filename, date, station=station, channel=channel,
+                          network=network, locid=locid)
+        return resp.evaluate(frequencies, units=units)
+    data = _read_resp_data(filename)
     # evalresp needs files with correct line separators depending on OS
     with NamedTemporaryFile() as fh:
         tempfile = fh.name
@@ -265,19 +452,18 @@ def evalresp_for_frequencies(t_samp, frequencies, filename, date, station='*',
         net = C.create_string_buffer(network.encode('ascii', 'strict'))
         locid = C.create_string_buffer(locid.encode('ascii', 'strict'))
         unts = C.create_string_buffer(units.encode('ascii', 'strict'))
-        if debug:
-            vbs = C.create_string_buffer(b"-v")
-        else:
-            vbs = C.create_string_buffer(b"")
+        vbs = C.create_string_buffer(b"-v")
         rtyp = C.create_string_buffer(b"CS")
         datime = C.create_string_buffer(
             date.format_seed().encode('ascii', 'strict'))
         fn = C.create_string_buffer(tempfile.encode('ascii', 'strict'))
         frequencies = np.asarray(frequencies)
         nfreqs = C.c_int(frequencies.shape[0])
-        res = clibevresp.evresp(sta, cha, net, locid, datime, unts, fn,
-                                frequencies, nfreqs, rtyp, vbs, start_stage,
-                                stop_stage, stdio_flag, C.c_int(0))
+        with ew.EVALRESP_LOCK:
+            res = clibevresp.evresp(sta, cha, net, locid, datime, unts, fn,
+                                    frequencies, nfreqs, rtyp, vbs,
+                                    start_stage, stop_stage, stdio_flag,
+                                    C.c_int(0))
         # optimizing performance, see
         # https://wiki.python.org/moin/PythonSpeed/PerformanceTips
         try:
@@ -5,6 +5,7 @@
 # Copyright (C) J. Wassermann
 #---------------------------------------------------------------------*/
 #include "arpicker.h"
+#include "filt_util.h"
 #include "platform.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -53,6 +54,7 @@ int ar_picker(float *tr, float *tr_1, float *tr_2, int ndat, float sample_rate,
     int n65,n32;
     int trace_flag=0;
     int errcode = 0;
+    bworth_state bp_state;
 
 #define EXIT(code) \
     free(buff1); \
@@ -117,12 +119,19 @@ int ar_picker(float *tr, float *tr_1, float *tr_2, int ndat, float sample_rate,
 
     // we follow the recipes of Akazawa and Leonardt & Kennet
 
-    // first we apply a bandpassfilter for lta sta trigger of p wave
-    spr_bp_fast_bworth(buff1,ndat,1/sample_rate,f1,f2,2,1);
+    // first we apply a bandpassfilter for lta sta trigger of p wave, the
+    // zero phase filter is designed once and reset for every component
+    spr_bworth_design(&bp_state,BWORTH_BANDPASS,1/sample_rate,f1,f2,2);
+    spr_bworth_apply(&bp_state,buff1,ndat,FALSE);
+    spr_bworth_apply(&bp_state,buff1,ndat,TRUE);
     memcpy(buff4,buff1,ndat*sizeof(float));
 
-    spr_bp_fast_bworth(buff1_s,ndat,1/sample_rate,f1,f2,2,1);
-    spr_bp_fast_bworth(buff4_s,ndat,1/sample_rate,f1,f2,2,1);
+    spr_bworth_reset(&bp_state);
+    spr_bworth_apply(&bp_state,buff1_s,ndat,FALSE);
+    spr_bworth_apply(&bp_state,buff1_s,ndat,TRUE);
+    spr_bworth_reset(&bp_state);
+    spr_bworth_apply(&bp_state,buff4_s,ndat,FALSE);
+    spr_bworth_apply(&bp_state,buff4_s,ndat,TRUE);
     // estimate which of the horizontals has the maximum
     buff4_max = 0.0;
     for(i=0;i<ndat;i++){
@@ -10,16 +10,24 @@
 # Copyright (C) 2010 M. Beyreuther, J. Wassermann, M. Ohrnberger
 #---------------------------------------------------------------------*/
 #include <stdlib.h>
+#include <string.h>
 #define _USE_MATH_DEFINES  // for Visual Studio
 #include <math.h>
 #include "platform.h"
+#include "fft_util.h"
 
-#define STEER(I, J, K, L) steer[(I)*nstat*grdpts_y*grdpts_x + (J)*nstat*grdpts_y + (K)*nstat + (L)]
-#define RPTR(I, J, K) Rptr[(I)*nstat*nstat + (J)*nstat + (K)]
-#define P_N(I, J) p_n[(I)*grdpts_y + (J)]
-#define RELPOW(I, J) relpow[(I)*grdpts_y + (J)]
-#define ABSPOW(I, J) abspow[(I)*grdpts_y + (J)]
-#define STAT_TSHIFT_TABLE(I, J, K) stat_tshift_table[(I) * grdpts_x * grdpts_y + (J) * grdpts_y + K]
+/* relative cutoff of small eigenvalues in the pseudo inverse for Capon,
+ * the same as the rcond of numpy.linalg.pinv used before */
+#define PINV_RCOND 1e-6
+/* maximum number of QL iterations for a single eigenvalue */
+#define QL_MAX_ITER 60
+
+/* frequencies between direct evaluations of the steering vectors */
+#define STEER_RESYNC 32
+
+/* number of grid points evaluated together, the steering vectors of a tile
+ * of 40 stations still fit into the L1 cache */
+#define GRID_TILE 64
 
 typedef struct cplxS {
     double re;
@@ -33,46 +41,147 @@ typedef enum _methodE
 } methodE;
 
 
+/**
+   Steering vectors of all frequencies and grid points. They are stored with
+   real and imaginary part split and contiguous along the grid points, i.e.
+   the real part of station i at grid point (x, y) and frequency n is
+   steer[((n * 2 + 0) * nstat + i) * grdpts_x * grdpts_y + x * grdpts_y + y]
+   and the imaginary part the same with 1 instead of 0.
 
-void calcSteer(const int nstat, const int grdpts_x, const int grdpts_y,
+   Consecutive frequencies are computed by multiplication with the phasor of
+   a single frequency step, cos and sin are only evaluated every
+   STEER_RESYNC frequencies to avoid the accumulation of rounding errors.
+   The stations are distributed over the threads. Returns 1 if memory
+   allocation failed.
+**/
+int calcSteer(const int nstat, const int grdpts_x, const int grdpts_y,
         const int nf, const int nlow, const float deltaf,
-        const float * const stat_tshift_table, cplx * const steer) {
+        const float * const stat_tshift_table, double * const steer,
+        int threads) {
+    const int npts = grdpts_x * grdpts_y;
+    const size_t fstride = (size_t) 2 * nstat * npts;
     int i;
-    int x;
-    int y;
-    int n;
-    double wtau;
-    for (i=0; i < nstat; i++) {
-        for (x=0; x < grdpts_x; x++) {
-            for (y=0; y < grdpts_y; y++) {
-                for (n=0; n < nf; n++) {
-                    wtau = 2.*M_PI*(float)(nlow+n)*deltaf*STAT_TSHIFT_TABLE(i, x, y);
-                    STEER(n,x,y,i).re = cos(wtau);
-                    STEER(n,x,y,i).im = -sin(wtau);
+    int err = 0;
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    #pragma omp parallel num_threads(threads) if(threads > 1)
+    {
+        double *step_re = (double *) malloc(npts * sizeof(double));
+        double *step_im = (double *) malloc(npts * sizeof(double));
+        double wtau;
+        int n, g;
+
+        if (step_re == NULL || step_im == NULL) {
+            #pragma omp critical (calc_steer_err)
+            err = 1;
+        }
+        #pragma omp barrier
+
+        #pragma omp for schedule(static)
+        for (i = 0; i < nstat; i++) {
+            const float *tshift = stat_tshift_table + (size_t) i * npts;
+            if (err) {
+                continue;
+            }
+            for (g = 0; g < npts; g++) {
+                wtau = 2. * M_PI * deltaf * tshift[g];
+                step_re[g] = cos(wtau);
+                step_im[g] = -sin(wtau);
+            }
+            for (n = 0; n < nf; n++) {
+                double *re = steer + n * fstride + (size_t) i * npts;
+                double *im = re + (size_t) nstat * npts;
+                if (n % STEER_RESYNC == 0) {
+                    for (g = 0; g < npts; g++) {
+                        wtau = 2.*M_PI*(float)(nlow+n)*deltaf*tshift[g];
+                        re[g] = cos(wtau);
+                        im[g] = -sin(wtau);
+                    }
+                }
+                else {
+                    const double *pre = re - fstride;
+                    const double *pim = im - fstride;
+                    for (g = 0; g < npts; g++) {
+                        re[g] = pre[g] * step_re[g] - pim[g] * step_im[g];
+                        im[g] = pre[g] * step_im[g] + pim[g] * step_re[g];
+                    }
                 }
             }
         }
+        free(step_re);
+        free(step_im);
+    }
+    return err;
+}
+
+
+/* e.H R e for the ntile grid points of a tile starting at re and im. R has
+ * to be hermitian, only its upper triangle is used:
+ * e.H R e = sum_i R_ii |e_i|^2 + 2 Re sum_i conj(e_i) sum_j>i R_ij e_j */
+static void beamTile(const double * const re, const double * const im,
+        const cplx * const R, const int nstat, const int npts,
+        const int ntile, double * const out) {
+    double u[GRID_TILE];
+    double v[GRID_TILE];
+    int i, j, k;
+
+    for (k = 0; k < ntile; ++k) {
+        out[k] = 0.;
+    }
+    for (i = 0; i < nstat; ++i) {
+        const double *ai = re + (size_t) i * npts;
+        const double *bi = im + (size_t) i * npts;
+        const double rii = R[i * nstat + i].re;
+
+        for (k = 0; k < ntile; ++k) {
+            u[k] = 0.;
+            v[k] = 0.;
+        }
+        for (j = i + 1; j < nstat; ++j) {
+            const double *aj = re + (size_t) j * npts;
+            const double *bj = im + (size_t) j * npts;
+            const double rr = R[i * nstat + j].re;
+            const double ri = R[i * nstat + j].im;
+            for (k = 0; k < ntile; ++k) {
+                u[k] += rr * aj[k] - ri * bj[k];
+                v[k] += rr * bj[k] + ri * aj[k];
+            }
+        }
+        for (k = 0; k < ntile; ++k) {
+            out[k] += 2. * (ai[k] * u[k] + bi[k] * v[k]) +
+                rii * (ai[k] * ai[k] + bi[k] * bi[k]);
+        }
     }
 }
 
 
-int generalizedBeamformer(double *relpow, double *abspow, const cplx * const steer,
-        const cplx * const Rptr,
+int generalizedBeamformer(double *relpow, double *abspow,
+        const double * const steer, const cplx * const Rptr,
         const int nstat, const int prewhiten, const int grdpts_x,
         const int grdpts_y, const int nf, double dpow,
-        const methodE method) {
+        const methodE method, int threads) {
     /* method: 0 == "bf, 1 == "capon"
      * start the code -------------------------------------------------
      * This assumes that all stations and components have the same number of
      * time samples, nt */
 
-    int x, y, i, j, n;
-    const cplx cplx_zero = {0., 0.};
+    const int npts = grdpts_x * grdpts_y;
+    const int ntiles = (npts + GRID_TILE - 1) / GRID_TILE;
     double *p_n;
+    double *white;
 
-    /* we allocate the taper buffer, size nsamp! */
-    p_n = (double *) calloc(grdpts_x * grdpts_y, sizeof(double));
-    if (p_n == NULL ) {
+    if (threads < 1) {
+        threads = 1;
+    }
+    /* powers of all frequencies, the relative power of each frequency is
+     * scaled with the maximum over the whole grid */
+    p_n = (double *) malloc((size_t) nf * npts * sizeof(double));
+    white = (double *) calloc(nf > 0 ? nf : 1, sizeof(double));
+    if (p_n == NULL || white == NULL) {
+        free(p_n);
+        free(white);
         return 1;
     }
 
@@ -84,48 +193,479 @@ int generalizedBeamformer(double *relpow, double *abspow, const cplx * const ste
      * the signal at different receivers and than steer the matrix R with
      * "weights" which are the trial-DOAs e.g., Kirlin & Done, 1999:
      * BF: P(f) = e.H R(f) e
-     * CAPON: P(f) = 1/(e.H R(f)^-1 e) */
-    for (n = 0; n < nf; ++n) {
-        double inv_fac;
-        double white = 0.;
-        for (x = 0; x < grdpts_x; ++x) {
-            for (y = 0; y < grdpts_y; ++y) {
-                double pow;
-                cplx eHR_ne = cplx_zero;
-                for (i = 0; i < nstat; ++i) {
-                    cplx R_ne = cplx_zero;
-                    for (j = 0; j < nstat; ++j) {
-                        const cplx s = STEER(n,x,y,j);
-                        const cplx r = RPTR(n,i,j);
-                        R_ne.re += r.re * s.re - r.im * s.im;
-                        R_ne.im += r.re * s.im + r.im * s.re;
-                    }
-                    eHR_ne.re += STEER(n,x,y,i).re * R_ne.re + STEER(n,x,y,i).im * R_ne.im ; /* eH, conjugate */
-                    eHR_ne.im += STEER(n,x,y,i).re * R_ne.im - STEER(n,x,y,i).im * R_ne.re; /* eH, conjugate */
-                }
-                pow = sqrt(eHR_ne.re * eHR_ne.re + eHR_ne.im * eHR_ne.im);
-                pow = (method == CAPON) ? 1. / pow : pow;
-                white = fmax(pow, white);
-                P_N(x,y)= pow;
-                ABSPOW(x,y) += pow;
+     * CAPON: P(f) = 1/(e.H R(f)^-1 e)
+     * Frequencies and tiles of grid points are distributed over the
+     * threads, the loops over the grid points of a tile are vectorized by
+     * the compiler. */
+    #pragma omp parallel num_threads(threads) if(threads > 1)
+    {
+        int t, k, g, n;
+
+        #pragma omp for schedule(dynamic)
+        for (t = 0; t < nf * ntiles; ++t) {
+            const int nn = t / ntiles;
+            const int first = (t % ntiles) * GRID_TILE;
+            const int ntile = npts - first < GRID_TILE ? npts - first : GRID_TILE;
+            const double *re = steer + (size_t) nn * 2 * nstat * npts;
+            const double *im = re + (size_t) nstat * npts;
+            double *pow = p_n + (size_t) nn * npts + first;
+
+            beamTile(re + first, im + first, Rptr + (size_t) nn * nstat * nstat,
+                     nstat, npts, ntile, pow);
+            for (k = 0; k < ntile; ++k) {
+                pow[k] = fabs(pow[k]);
+                pow[k] = (method == CAPON) ? 1. / pow[k] : pow[k];
+            }
+        }
+
+        #pragma omp for schedule(static)
+        for (n = 0; n < nf; ++n) {
+            const double *pow = p_n + (size_t) n * npts;
+            double w = 0.;
+            for (g = 0; g < npts; ++g) {
+                w = fmax(pow[g], w);
             }
+            white[n] = w;
         }
+
         /* scale for each frequency individually */
-        if (prewhiten == 1) {
-            inv_fac = 1. / (white * nf * nstat);
+        #pragma omp for schedule(static)
+        for (t = 0; t < ntiles; ++t) {
+            const int first = t * GRID_TILE;
+            const int last = npts - first < GRID_TILE ? npts : first + GRID_TILE;
+            for (n = 0; n < nf; ++n) {
+                const double *pow = p_n + (size_t) n * npts;
+                double inv_fac;
+                if (prewhiten == 1) {
+                    inv_fac = 1. / (white[n] * nf * nstat);
+                }
+                else {
+                    inv_fac = 1. / dpow;
+                }
+                for (g = first; g < last; ++g) {
+                    abspow[g] += pow[g];
+                    relpow[g] += pow[g] * inv_fac;
+                }
+            }
+        }
+    }
+
+    free(p_n);
+    free(white);
+
+    return 0;
+}
+
+
+/* Householder reduction of the symmetric n x n matrix v (row major) to
+ * tridiagonal form with diagonal d and subdiagonal e[1 .. n - 1]. v is
+ * overwritten with the orthogonal transformation. This follows tred2 of
+ * EISPACK. */
+static void tridiagonalize(double *v, double *d, double *e, const int n) {
+    int i, j, k;
+    double f, g, h, hh, scale;
+
+#define V(I, J) v[(I) * n + (J)]
+    for (j = 0; j < n; j++) {
+        d[j] = V(n - 1, j);
+    }
+    for (i = n - 1; i > 0; i--) {
+        scale = 0.;
+        h = 0.;
+        for (k = 0; k < i; k++) {
+            scale += fabs(d[k]);
+        }
+        if (scale == 0.) {
+            e[i] = d[i - 1];
+            for (j = 0; j < i; j++) {
+                d[j] = V(i - 1, j);
+                V(i, j) = 0.;
+                V(j, i) = 0.;
+            }
         }
         else {
-            inv_fac = 1. / dpow;
+            for (k = 0; k < i; k++) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+            f = d[i - 1];
+            g = sqrt(h);
+            if (f > 0) {
+                g = -g;
+            }
+            e[i] = scale * g;
+            h -= f * g;
+            d[i - 1] = f - g;
+            for (j = 0; j < i; j++) {
+                e[j] = 0.;
+            }
+            for (j = 0; j < i; j++) {
+                f = d[j];
+                V(j, i) = f;
+                g = e[j] + V(j, j) * f;
+                for (k = j + 1; k <= i - 1; k++) {
+                    g += V(k, j) * d[k];
+                    e[k] += V(k, j) * f;
+                }
+                e[j] = g;
+            }
+            f = 0.;
+            for (j = 0; j < i; j++) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+            hh = f / (h + h);
+            for (j = 0; j < i; j++) {
+                e[j] -= hh * d[j];
+            }
+            for (j = 0; j < i; j++) {
+                f = d[j];
+                g = e[j];
+                for (k = j; k <= i - 1; k++) {
+                    V(k, j) -= (f * e[k] + g * d[k]);
+                }
+                d[j] = V(i - 1, j);
+                V(i, j) = 0.;
+            }
         }
-        for (x = 0; x < grdpts_x; ++x) {
-            for (y = 0; y < grdpts_y; ++y) {
-                RELPOW(x,y) += P_N(x,y) * inv_fac;
+        d[i] = h;
+    }
+    /* accumulate the transformations */
+    for (i = 0; i < n - 1; i++) {
+        V(n - 1, i) = V(i, i);
+        V(i, i) = 1.;
+        h = d[i + 1];
+        if (h != 0.) {
+            for (k = 0; k <= i; k++) {
+                d[k] = V(k, i + 1) / h;
             }
+            for (j = 0; j <= i; j++) {
+                g = 0.;
+                for (k = 0; k <= i; k++) {
+                    g += V(k, i + 1) * V(k, j);
+                }
+                for (k = 0; k <= i; k++) {
+                    V(k, j) -= g * d[k];
+                }
+            }
+        }
+        for (k = 0; k <= i; k++) {
+            V(k, i + 1) = 0.;
         }
     }
+    for (j = 0; j < n; j++) {
+        d[j] = V(n - 1, j);
+        V(n - 1, j) = 0.;
+    }
+    V(n - 1, n - 1) = 1.;
+    e[0] = 0.;
+}
 
 
-    free(p_n);
+/* Eigenvalues d and eigenvectors (columns of v) of the tridiagonal matrix
+ * from tridiagonalize() with the implicit QL method, following tql2 of
+ * EISPACK. Returns 1 if an eigenvalue did not converge. */
+static int tridiagonalQL(double *v, double *d, double *e, const int n) {
+    int i, k, l, m, iter;
+    double f = 0., tst1 = 0.;
+    double c, c2, c3, dl1, el1, g, h, p, r, s, s2;
+    const double eps = pow(2., -52.);
+
+    for (i = 1; i < n; i++) {
+        e[i - 1] = e[i];
+    }
+    e[n - 1] = 0.;
+    for (l = 0; l < n; l++) {
+        tst1 = fmax(tst1, fabs(d[l]) + fabs(e[l]));
+        for (m = l; m < n - 1; m++) {
+            if (fabs(e[m]) <= eps * tst1) {
+                break;
+            }
+        }
+        if (m > l) {
+            iter = 0;
+            do {
+                if (++iter > QL_MAX_ITER) {
+                    return 1;
+                }
+                g = d[l];
+                p = (d[l + 1] - g) / (2. * e[l]);
+                r = sqrt(p * p + 1.);
+                if (p < 0) {
+                    r = -r;
+                }
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+                dl1 = d[l + 1];
+                h = g - d[l];
+                for (i = l + 2; i < n; i++) {
+                    d[i] -= h;
+                }
+                f += h;
+                p = d[m];
+                c = 1.;
+                c2 = c;
+                c3 = c;
+                el1 = e[l + 1];
+                s = 0.;
+                s2 = 0.;
+                for (i = m - 1; i >= l; i--) {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = sqrt(p * p + e[i] * e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+                    for (k = 0; k < n; k++) {
+                        h = V(k, i + 1);
+                        V(k, i + 1) = s * V(k, i) + c * h;
+                        V(k, i) = c * V(k, i) - s * h;
+                    }
+                }
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (fabs(e[l]) > eps * tst1);
+        }
+        d[l] += f;
+        e[l] = 0.;
+    }
+#undef V
+    return 0;
+}
+
 
+/* Pseudo inverse of the hermitian n x n matrix A in place. The eigenvalues
+ * of A are computed from the real symmetric 2n x 2n matrix
+ * [[Re A, -Im A], [Im A, Re A]], whose pseudo inverse has the same
+ * structure. Eigenvalues below PINV_RCOND times the largest one in
+ * magnitude are discarded like the singular values in numpy.linalg.pinv.
+ * work has to hold 4 n^2 + 4 n doubles. Returns 1 if the eigenvalues did
+ * not converge. */
+static int hermitianPinv(cplx *A, const int n, double *work) {
+    const int m = 2 * n;
+    double *v = work;
+    double *d = v + (size_t) m * m;
+    double *e = d + m;
+    double cutoff = 0.;
+    int i, j, k;
+
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < n; j++) {
+            v[i * m + j] = A[i * n + j].re;
+            v[(i + n) * m + j + n] = A[i * n + j].re;
+            v[(i + n) * m + j] = A[i * n + j].im;
+            v[i * m + j + n] = -A[i * n + j].im;
+        }
+    }
+    tridiagonalize(v, d, e, m);
+    if (tridiagonalQL(v, d, e, m)) {
+        return 1;
+    }
+    for (k = 0; k < m; k++) {
+        cutoff = fmax(cutoff, fabs(d[k]));
+    }
+    cutoff *= PINV_RCOND;
+    for (k = 0; k < m; k++) {
+        e[k] = fabs(d[k]) > cutoff ? 1. / d[k] : 0.;
+    }
+    /* the upper left and lower left blocks of V diag(e) V^T */
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < n; j++) {
+            double re = 0., im = 0.;
+            for (k = 0; k < m; k++) {
+                re += v[i * m + k] * e[k] * v[j * m + k];
+                im += v[(i + n) * m + k] * e[k] * v[j * m + k];
+            }
+            A[i * n + j].re = re;
+            A[i * n + j].im = im;
+        }
+    }
     return 0;
 }
+
+
+/**
+   Pseudo inverse of the hermitian n x n matrix A in place as used for
+   Capon in arrayProcessingWindows(). Returns 1 if memory allocation failed
+   and 2 if the eigenvalues did not converge.
+**/
+int hermitianPseudoInverse(cplx *A, const int n) {
+    double *work;
+    int ret;
+
+    work = (double *) malloc((4 * (size_t) n * n + 4 * n) * sizeof(double));
+    if (work == NULL) {
+        return 1;
+    }
+    ret = hermitianPinv(A, n, work) ? 2 : 0;
+    free(work);
+    return ret;
+}
+
+
+/* Cross spectral matrices of the nf frequencies starting at nlow from the
+ * nsamp samples of each of the nstat stations in window. Returns dpow. */
+static double crossSpectra(const double * const window, const int nstat,
+        const int nsamp, const double * const taper, const rfft_plan *plan,
+        const int nlow, const int nf, const methodE method, double *buf,
+        double *spec, cplx *ft, cplx *R) {
+    const int nfft = plan->n;
+    double dpow = 0.;
+    int i, j, k, n;
+
+    for (i = 0; i < nstat; i++) {
+        const double *dat = window + (size_t) i * nsamp;
+        double mean = 0.;
+        for (k = 0; k < nsamp; k++) {
+            mean += dat[k];
+        }
+        mean /= nsamp;
+        for (k = 0; k < nsamp; k++) {
+            buf[k] = (dat[k] - mean) * taper[k];
+        }
+        memset(buf + nsamp, 0, (nfft - nsamp) * sizeof(double));
+        rfft_forward(plan, buf, spec);
+        for (n = 0; n < nf; n++) {
+            ft[i * nf + n].re = spec[2 * (nlow + n)];
+            ft[i * nf + n].im = spec[2 * (nlow + n) + 1];
+        }
+    }
+    /* computing the covariances of the signal at different receivers */
+    for (i = 0; i < nstat; i++) {
+        for (j = i; j < nstat; j++) {
+            double sum_re = 0., sum_im = 0., norm;
+            for (n = 0; n < nf; n++) {
+                const cplx a = ft[i * nf + n];
+                const cplx b = ft[j * nf + n];
+                cplx *r = R + (size_t) n * nstat * nstat + i * nstat + j;
+                r->re = a.re * b.re + a.im * b.im;
+                r->im = a.im * b.re - a.re * b.im;
+                sum_re += r->re;
+                sum_im += r->im;
+            }
+            norm = sqrt(sum_re * sum_re + sum_im * sum_im);
+            for (n = 0; n < nf; n++) {
+                cplx *r = R + (size_t) n * nstat * nstat + i * nstat + j;
+                if (method == CAPON) {
+                    r->re /= norm;
+                    r->im /= norm;
+                }
+                if (i != j) {
+                    cplx *rt = R + (size_t) n * nstat * nstat + j * nstat + i;
+                    rt->re = r->re;
+                    rt->im = -r->im;
+                }
+            }
+            if (i == j) {
+                dpow += method == CAPON ? 1. : norm;
+            }
+        }
+    }
+    return dpow * nstat;
+}
+
+
+/**
+   Beamforming of nwin windows at once. windows holds nsamp samples of all
+   nstat stations for every window (nwin x nstat x nsamp). Each window is
+   demeaned and multiplied with taper, the cross spectral matrices of the
+   frequencies nlow .. nlow + nf - 1 of a real FFT of nfft points are
+   computed and inverted for Capon. The relative and absolute power maps of
+   every window (nwin x grdpts_x x grdpts_y) are written to relpow and
+   abspow, see generalizedBeamformer() for the steering vectors.
+
+   The windows are distributed over the threads, a single window uses all
+   threads for the beamforming. Returns 1 if memory allocation failed and 2
+   if the pseudo inverse for Capon did not converge.
+**/
+int arrayProcessingWindows(const double * const windows, const int nwin,
+        const int nstat, const int nsamp, const double * const taper,
+        const int nfft, const int nlow, const int nf,
+        const double * const steer, const int prewhiten, const int grdpts_x,
+        const int grdpts_y, const methodE method, double *relpow,
+        double *abspow, int threads) {
+    const int npts = grdpts_x * grdpts_y;
+    int outer, inner, w;
+    int err = 0;
+    rfft_plan *plan;
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    outer = nwin > 1 ? (threads < nwin ? threads : nwin) : 1;
+    inner = outer > 1 ? 1 : threads;
+    plan = rfft_plan_create(nfft);
+    if (plan == NULL) {
+        return 1;
+    }
+
+    #pragma omp parallel num_threads(outer) if(outer > 1)
+    {
+        double *buf = (double *) malloc(nfft * sizeof(double));
+        double *spec = (double *) malloc((nfft + 2) * sizeof(double));
+        cplx *ft = (cplx *) malloc((size_t) nstat * nf * sizeof(cplx));
+        cplx *R = (cplx *) malloc((size_t) nf * nstat * nstat * sizeof(cplx));
+        double *work = NULL;
+        int ret;
+
+        if (method == CAPON) {
+            work = (double *) malloc((4 * (size_t) nstat * nstat + 4 * nstat) *
+                                     sizeof(double));
+        }
+        if (buf == NULL || spec == NULL || ft == NULL || R == NULL ||
+                (method == CAPON && work == NULL)) {
+            #pragma omp critical (array_processing_err)
+            err = 1;
+        }
+        #pragma omp barrier
+
+        #pragma omp for schedule(dynamic)
+        for (w = 0; w < nwin; w++) {
+            double dpow;
+            int n;
+
+            if (err) {
+                continue;
+            }
+            dpow = crossSpectra(windows + (size_t) w * nstat * nsamp, nstat,
+                                nsamp, taper, plan, nlow, nf, method, buf,
+                                spec, ft, R);
+            if (method == CAPON) {
+                /* P(f) = 1/(e.H R(f)^-1 e) */
+                for (n = 0; n < nf; n++) {
+                    if (hermitianPinv(R + (size_t) n * nstat * nstat, nstat,
+                                      work)) {
+                        #pragma omp critical (array_processing_err)
+                        err = 2;
+                        break;
+                    }
+                }
+                if (n < nf) {
+                    continue;
+                }
+            }
+            ret = generalizedBeamformer(
+                relpow + (size_t) w * npts, abspow + (size_t) w * npts, steer,
+                R, nstat, prewhiten, grdpts_x, grdpts_y, nf, dpow, method,
+                inner);
+            if (ret) {
+                #pragma omp critical (array_processing_err)
+                err = ret;
+            }
+        }
+        free(buf);
+        free(spec);
+        free(ft);
+        free(R);
+        free(work);
+    }
+
+    rfft_plan_destroy(plan);
+    return err;
+}
@@ -13,8 +13,34 @@
  */
 
 
+#include <math.h>
 #include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "evresp.h"
+#include "../fft_util.h"
+
+/* not declared in evresp.h */
+int in_epoch(const char *datime, const char *beg_t, const char *end_t);
+
+
+/* FIR blockettes with at least FIR_FFT_MIN_COEFFS coefficients are
+ * evaluated by FFT for at least FIR_FFT_MIN_FREQS equally spaced
+ * frequencies, with FFTs of at least FIR_FFT_MIN_SIZE points. */
+#define FIR_FFT_MIN_COEFFS 8
+#define FIR_FFT_MIN_FREQS 1024
+#define FIR_FFT_MIN_SIZE 1024
+
+
+/* A response parsed from a RESP file. The channel is normalized and checked
+ * once, after that it is only read, so the response can be evaluated from
+ * several threads at once by _obspy_eval_response(). */
+struct _obspy_response {
+  struct channel chan;
+  /* factor to MKS units, the global unitScaleFact at the time of parsing */
+  double unit_scale;
+};
 
 
 int _obspy_check_channel(struct channel *chan)
@@ -51,22 +77,627 @@ int _obspy_norm_resp(struct channel *chan, int start_stage, int stop_stage)
 }
 
 
+static int eval_channel(const struct channel *chan, double unit_scale,
+                        const double *freq, int nfreqs,
+                        struct complex *output, char *out_units,
+                        int start_stage, int stop_stage,
+                        int useTotalSensitivityFlag);
+
+
+/* Same as calc_resp(), evaluated by eval_channel() with the global unit
+ * scale factor set while checking the channel. */
 int _obspy_calc_resp(struct channel *chan, double *freq, int nfreqs,
                      struct complex *output, char *out_units,
                      int start_stage, int stop_stage,
                      int useTotalSensitivityFlag)
 {
-  int rc;
-  if ((rc = setjmp(jump_buffer)) == 0) {
-    /* Direct invocation */
-    GblChanPtr = chan;
-    calc_resp(chan, freq, nfreqs, output, out_units, start_stage, stop_stage,
-              useTotalSensitivityFlag);
-    GblChanPtr = NULL;
+  return eval_channel(chan, unitScaleFact, freq, nfreqs, output, out_units,
+                      start_stage, stop_stage, useTotalSensitivityFlag);
+}
+
+
+/* Parses the response of the first channel of a RESP file matching the
+ * station, channel, network and location patterns at the given date
+ * ("YYYY,DDD,HH:MM:SS") and normalizes it for the stages start_stage ...
+ * stop_stage, as done by evresp().
+ *
+ * Parsing uses the global state of evalresp, so calls must not overlap.
+ * Returns 0 and the response in *result, to be freed with
+ * _obspy_free_response(), 1 if no response matches or an evalresp error
+ * code, OUT_OF_MEMORY if the response could not be allocated. */
+int _obspy_parse_response(char *file, char *sta, char *cha, char *net,
+                          char *locid, char *datime, int start_stage,
+                          int stop_stage, struct _obspy_response **result)
+{
+  struct _obspy_response *resp;
+  struct scn_list *scns;
+  struct scn *scn;
+  FILE *fptr;
+  volatile int rc = -1;
+  int err;
+
+  *result = NULL;
+  if ((fptr = fopen(file, "r")) == NULL) {
+    fprintf(stderr, "%s failed to open file %s\n", myLabel, file);
+    return OPEN_FILE_ERROR;
+  }
+  resp = (struct _obspy_response *)calloc(1, sizeof(struct _obspy_response));
+  if (resp == NULL) {
+    fclose(fptr);
+    return OUT_OF_MEMORY;
+  }
+  scns = alloc_scn_list(1);
+  scn = scns->scn_vec[0];
+  strncpy(scn->station, sta, STALEN - 1);
+  strncpy(scn->channel, cha, CHALEN - 1);
+  strncpy(scn->network, net, NETLEN - 1);
+  strncpy(scn->locid, locid, LOCIDLEN - 1);
+
+  curr_file = file;
+  GblChanPtr = &resp->chan;
+  memset(FirstLine, 0, MAXLINELEN);
+  myLabel[0] = '\0';
+
+  /* skip responses that fail to parse, as evresp() does */
+  while (rc < 0) {
+    if ((err = setjmp(jump_buffer)) == 0) {
+      if (find_resp(fptr, scns, datime, &resp->chan) < 0) {
+        rc = 1;
+        break;
+      }
+      parse_channel(fptr, &resp->chan);
+      check_channel(&resp->chan);
+      norm_resp(&resp->chan, start_stage, stop_stage);
+      resp->unit_scale = unitScaleFact;
+      rc = 0;
+    }
+    else {
+      free_channel(&resp->chan);
+      resp->chan.first_stage = NULL;
+      if (err == PARSE_ERROR || err == UNRECOG_FILTYPE ||
+          err == UNDEF_SEPSTR || err == IMPROP_DATA_TYPE ||
+          err == RE_COMP_FAILED || err == UNRECOG_UNITS) {
+        strncpy(FirstLine, "", MAXLINELEN);
+        if (!next_resp(fptr))
+          rc = 1;
+      }
+      else {
+        rc = err;
+      }
+    }
+  }
+  fclose(fptr);
+  GblChanPtr = NULL;
+  curr_file = NULL;
+
+  if (rc == 1) {
+    fprintf(stderr, "%s WARNING: no response found for NET=%s,STA=%s,"
+            "LOCID=%s,CHAN=%s,DATE=%s\n", myLabel, scn->network,
+            scn->station, scn->locid, scn->channel, datime);
+    fflush(stderr);
+  }
+  free_scn_list(scns);
+  if (rc) {
+    free_channel(&resp->chan);
+    free(resp);
+    return rc;
+  }
+  *result = resp;
+  return 0;
+}
+
+
+void _obspy_free_response(struct _obspy_response *resp)
+{
+  if (resp != NULL) {
+    free_channel(&resp->chan);
+    free(resp);
+  }
+}
+
+
+/* Whether the date ("YYYY,DDD,HH:MM:SS") is within the epoch of a parsed
+ * response. */
+int _obspy_response_in_epoch(const struct _obspy_response *resp,
+                             const char *datime)
+{
+  return in_epoch(datime, resp->chan.beg_t, resp->chan.end_t);
+}
+
+
+/* Frequencies of a response given as a list (blockette 55), at which alone
+ * it can be evaluated. Copies at most n of them to freqs and returns their
+ * number, 0 for other responses. */
+int _obspy_response_list_freqs(const struct _obspy_response *resp,
+                               double *freqs, int n)
+{
+  const struct blkt *blkt_ptr = resp->chan.first_stage->first_blkt;
+  int nresp;
+
+  if (blkt_ptr == NULL || blkt_ptr->type != LIST)
     return 0;
-  } else {
-    /* Error called by longjmp */
-    GblChanPtr = NULL;
+  nresp = blkt_ptr->blkt_info.list.nresp;
+  memcpy(freqs, blkt_ptr->blkt_info.list.freq,
+         sizeof(double) * (n < nresp ? n : nresp));
+  return nresp;
+}
+
+
+/* Whether a stage takes part in the response of the stages start_stage ...
+ * stop_stage, as in calc_resp(). */
+static int stage_selected(const struct stage *stage_ptr, int start_stage,
+                          int stop_stage)
+{
+  if (start_stage >= 0 && stop_stage)
+    return stage_ptr->sequence_no >= start_stage &&
+           stage_ptr->sequence_no <= stop_stage;
+  if (start_stage >= 0)
+    return stage_ptr->sequence_no == start_stage;
+  return 1;
+}
+
+
+/* Code of the output units, -1 for the default units of the response and
+ * BAD_OUT_UNITS for unknown ones, see convert_to_units(). */
+static int out_units_code(const char *out_units)
+{
+  if (out_units == NULL || !strlen(out_units))
+    return VEL;
+  if (!strncmp(out_units, "DEF", 3))
+    return -1;
+  if (!strncmp(out_units, "DIS", 3))
+    return DIS;
+  if (!strncmp(out_units, "VEL", 3))
+    return VEL;
+  if (!strncmp(out_units, "ACC", 3))
+    return ACC;
+  return BAD_OUT_UNITS;
+}
+
+
+/* Same as convert_to_units() for the output units code out. */
+static void convert_units(int inp, int out, struct complex *data, double w)
+{
+  struct complex scale_val;
+
+  if (out < 0)
+    return;
+  if (inp == DIS) {
+    if (out == DIS) return;
+    if (w != 0.0) {
+      scale_val.real = 0.0; scale_val.imag = -1.0/w;
+      zmul(data, &scale_val);
+    }
+    else data->real = data->imag = 0.0;
+  }
+  else if (inp == ACC) {
+    if (out == ACC) return;
+    scale_val.real = 0.0; scale_val.imag = w;
+    zmul(data, &scale_val);
+  }
+
+  if (out == DIS) {
+    scale_val.real = 0.0; scale_val.imag = w;
+    zmul(data, &scale_val);
+  }
+  else if (out == ACC) {
+    if (w != 0.0) {
+      scale_val.real = 0.0; scale_val.imag = -1.0/w;
+      zmul(data, &scale_val);
+    }
+    else data->real = data->imag = 0.0;
+  }
+}
+
+
+/* Whether all coefficients of an asymmetric FIR blockette are equal, which
+ * fir_asym_trans() evaluates in closed form. */
+static int boxcar(const struct blkt *blkt_ptr)
+{
+  const double *a = blkt_ptr->blkt_info.fir.coeffs;
+  int k;
+
+  for (k = 1; k < blkt_ptr->blkt_info.fir.ncoeffs; k++) {
+    if (a[k] != a[0])
+      return 0;
+  }
+  return 1;
+}
+
+
+/* Whether the frequencies are equally spaced and increasing, with the
+ * first one and the spacing in *f0 and *df. */
+static int uniform_grid(const double *freq, int nfreqs, double *f0,
+                        double *df)
+{
+  double tol;
+  int i;
+
+  if (nfreqs < 2)
+    return 0;
+  *f0 = freq[0];
+  *df = (freq[nfreqs - 1] - freq[0]) / (nfreqs - 1);
+  if (!(*df > 0.0))
+    return 0;
+  tol = 1e-9 * (fabs(freq[0]) > fabs(freq[nfreqs - 1]) ?
+                fabs(freq[0]) : fabs(freq[nfreqs - 1]));
+  for (i = 1; i < nfreqs - 1; i++) {
+    if (fabs(freq[i] - (*f0 + i * *df)) > tol)
+      return 0;
+  }
+  return 1;
+}
+
+
+/* Evaluates X[j] = sum_k c[k] exp(-i (theta0 + j delta) k) for
+ * j = 0 ... nout - 1 with the chirp z-transform. With
+ * j k = (j^2 + k^2 - (j - k)^2) / 2 the sum becomes the convolution of
+ * c[k] exp(-i (theta0 k + delta k^2 / 2)) with exp(i delta m^2 / 2),
+ * which is done by FFT for blocks of outputs. The FFT of the chirp is the
+ * same for all blocks. Returns 0 or OUT_OF_MEMORY. */
+static int chirp_z(const double *c, int nc, double theta0, double delta,
+                   int nout, double *xre, double *xim)
+{
+  rfft_plan *plan;
+  double *kernel, *work, *post;
+  double theta, phase, scale, wr, wi;
+  int nfft, block, j0, j, k, m;
+
+  nfft = next_pow_2(4 * nc);
+  if (nfft < FIR_FFT_MIN_SIZE)
+    nfft = FIR_FFT_MIN_SIZE;
+  if (nfft > next_pow_2(nout + nc - 1))
+    nfft = next_pow_2(nout + nc - 1);
+  block = nfft - nc + 1;
+  scale = 1.0 / nfft;
+
+  /* the plan of a real FFT of length n holds a complex one of length n/2 */
+  plan = rfft_plan_create(2 * nfft);
+  kernel = (double *)calloc(2 * nfft, sizeof(double));
+  work = (double *)malloc(2 * nfft * sizeof(double));
+  post = (double *)malloc(2 * block * sizeof(double));
+  if (plan == NULL || kernel == NULL || work == NULL || post == NULL) {
+    rfft_plan_destroy(plan);
+    free(kernel);
+    free(work);
+    free(post);
+    return OUT_OF_MEMORY;
+  }
+  for (m = -(nc - 1); m < block; m++) {
+    phase = 0.5 * delta * (double)m * (double)m;
+    k = m < 0 ? m + nfft : m;
+    kernel[2 * k] = cos(phase) * scale;
+    kernel[2 * k + 1] = sin(phase) * scale;
+  }
+  complex_fft(plan, kernel, -1);
+  for (j = 0; j < block; j++) {
+    phase = 0.5 * delta * (double)j * (double)j;
+    post[2 * j] = cos(phase);
+    post[2 * j + 1] = -sin(phase);
+  }
+
+  for (j0 = 0; j0 < nout; j0 += block) {
+    theta = theta0 + j0 * delta;
+    for (k = 0; k < nc; k++) {
+      phase = theta * k + 0.5 * delta * (double)k * (double)k;
+      work[2 * k] = c[k] * cos(phase);
+      work[2 * k + 1] = -c[k] * sin(phase);
+    }
+    memset(work + 2 * nc, 0, 2 * (nfft - nc) * sizeof(double));
+    complex_fft(plan, work, -1);
+    for (k = 0; k < nfft; k++) {
+      wr = work[2 * k] * kernel[2 * k] - work[2 * k + 1] * kernel[2 * k + 1];
+      wi = work[2 * k + 1] * kernel[2 * k] + work[2 * k] * kernel[2 * k + 1];
+      work[2 * k] = wr;
+      work[2 * k + 1] = wi;
+    }
+    complex_fft(plan, work, 1);
+    for (j = 0; j < block && j0 + j < nout; j++) {
+      xre[j0 + j] = work[2 * j] * post[2 * j] -
+                    work[2 * j + 1] * post[2 * j + 1];
+      xim[j0 + j] = work[2 * j + 1] * post[2 * j] +
+                    work[2 * j] * post[2 * j + 1];
+    }
+  }
+
+  rfft_plan_destroy(plan);
+  free(kernel);
+  free(work);
+  free(post);
+  return 0;
+}
+
+
+/* Response of a FIR blockette on a uniform frequency grid by FFT, the same
+ * as fir_sym_trans() and fir_asym_trans(). Returns 0 or OUT_OF_MEMORY. */
+static int fir_trans_fft(const struct blkt *blkt_ptr, double f0, double df,
+                         int nfreqs, double *ore, double *oim)
+{
+  const double *a = blkt_ptr->blkt_info.fir.coeffs;
+  int na = blkt_ptr->blkt_info.fir.ncoeffs;
+  double h0 = blkt_ptr->blkt_info.fir.h0;
+  double sint = blkt_ptr->next_blkt->blkt_info.decimation.sample_int;
+  double *c, wsint;
+  int i, k, rc;
+
+  if ((c = (double *)malloc(na * sizeof(double))) == NULL)
+    return OUT_OF_MEMORY;
+  /* symmetric filters are evaluated without their delay as cosine sums
+   * over the distance to the centre, the real part of a Fourier sum */
+  if (blkt_ptr->type == FIR_SYM_1) {
+    c[0] = a[na - 1];
+    for (k = 1; k < na; k++)
+      c[k] = 2.0 * a[na - 1 - k];
+  }
+  else if (blkt_ptr->type == FIR_SYM_2) {
+    for (k = 0; k < na; k++)
+      c[k] = 2.0 * a[na - 1 - k];
+  }
+  else {
+    memcpy(c, a, na * sizeof(double));
+  }
+  rc = chirp_z(c, na, twoPi * f0 * sint, twoPi * df * sint, nfreqs, ore, oim);
+  free(c);
+  if (rc)
     return rc;
+
+  if (blkt_ptr->type == FIR_SYM_1) {
+    for (i = 0; i < nfreqs; i++) {
+      ore[i] *= h0;
+      oim[i] = 0.0;
+    }
+  }
+  else if (blkt_ptr->type == FIR_SYM_2) {
+    /* the centre is half a sample off */
+    for (i = 0; i < nfreqs; i++) {
+      wsint = twoPi * (f0 + i * df) * sint;
+      ore[i] = (cos(0.5 * wsint) * ore[i] + sin(0.5 * wsint) * oim[i]) * h0;
+      oim[i] = 0.0;
+    }
+  }
+  else {
+    for (i = 0; i < nfreqs; i++) {
+      ore[i] *= h0;
+      oim[i] *= h0;
+    }
+  }
+  return 0;
+}
+
+
+/* Response of an analog pole zero blockette for all frequencies, the same
+ * as analog_trans(). The products over the zeros and the poles run over
+ * the frequencies in the inner loops. */
+static void analog_pz(const struct blkt *blkt_ptr, const double *freq,
+                      int nfreqs, double *ore, double *oim, double *dre,
+                      double *dim)
+{
+  const struct complex *ze = blkt_ptr->blkt_info.pole_zero.zeros;
+  const struct complex *po = blkt_ptr->blkt_info.pole_zero.poles;
+  int nz = blkt_ptr->blkt_info.pole_zero.nzeros;
+  int np = blkt_ptr->blkt_info.pole_zero.npoles;
+  double h0 = blkt_ptr->blkt_info.pole_zero.a0;
+  double scale = blkt_ptr->type == LAPLACE_PZ ? twoPi : 1.0;
+  double tr, ti, r, im, mod_squared;
+  int i, k;
+
+  /* as in analog_trans(), both products start at 1 + 1i */
+  for (i = 0; i < nfreqs; i++)
+    ore[i] = oim[i] = dre[i] = dim[i] = 1.0;
+  for (k = 0; k < nz; k++) {
+    for (i = 0; i < nfreqs; i++) {
+      tr = 0.0 - ze[k].real;
+      ti = scale * freq[i] - ze[k].imag;
+      r = ore[i] * tr - oim[i] * ti;
+      oim[i] = oim[i] * tr + ore[i] * ti;
+      ore[i] = r;
+    }
+  }
+  for (k = 0; k < np; k++) {
+    for (i = 0; i < nfreqs; i++) {
+      tr = 0.0 - po[k].real;
+      ti = scale * freq[i] - po[k].imag;
+      r = dre[i] * tr - dim[i] * ti;
+      dim[i] = dim[i] * tr + dre[i] * ti;
+      dre[i] = r;
+    }
   }
+  for (i = 0; i < nfreqs; i++) {
+    /* conj(denom) * num / |denom|^2 */
+    r = dre[i] * ore[i] - (-dim[i]) * oim[i];
+    im = (-dim[i]) * ore[i] + dre[i] * oim[i];
+    mod_squared = dre[i] * dre[i] + dim[i] * dim[i];
+    ore[i] = h0 * (r / mod_squared);
+    oim[i] = h0 * (im / mod_squared);
+  }
+}
+
+
+/* Evaluates the stages start_stage ... stop_stage of a normalized channel
+ * like calc_resp(), but without any global state apart from the constants
+ * of evalresp. Instead of looping over the stages for every frequency, the
+ * response of every blockette is computed for all frequencies at once into
+ * separate arrays of real and imaginary parts and multiplied into the
+ * total response. FIR blockettes with many coefficients on a uniform grid
+ * of many frequencies are evaluated by FFT.
+ * Returns 0 or an evalresp error code. */
+static int eval_channel(const struct channel *chan, double unit_scale,
+                        const double *freq, int nfreqs,
+                        struct complex *output, char *out_units,
+                        int start_stage, int stop_stage,
+                        int useTotalSensitivityFlag)
+{
+  const struct blkt *blkt_ptr;
+  const struct stage *stage_ptr;
+  double *buf, *re, *im, *ore, *oim, *tre, *tim;
+  double w, r, sensit, delay, f0 = 0.0, df = 0.0;
+  struct complex of;
+  int i, j, out, units_code, eval_flag, nc, sym_fir, uniform, rc = 0;
+  int matching_stages = 0;
+
+  if ((out = out_units_code(out_units)) == BAD_OUT_UNITS)
+    return BAD_OUT_UNITS;
+  stage_ptr = chan->first_stage;
+  for (j = 0; j < chan->nstages; j++, stage_ptr = stage_ptr->next_stage) {
+    if (!stage_selected(stage_ptr, start_stage, stop_stage))
+      continue;
+    matching_stages++;
+    for (blkt_ptr = stage_ptr->first_blkt; blkt_ptr;
+         blkt_ptr = blkt_ptr->next_blkt) {
+      if (blkt_ptr->type == LIST && nfreqs > blkt_ptr->blkt_info.list.nresp)
+        return ARRAY_BOUNDS_EXCEEDED;
+    }
+  }
+  if (!matching_stages)
+    return NO_STAGE_MATCHED;
+  if (nfreqs < 1)
+    return 0;
+
+  buf = (double *)malloc(6 * (size_t)nfreqs * sizeof(double));
+  if (buf == NULL)
+    return OUT_OF_MEMORY;
+  re = buf;
+  im = re + nfreqs;
+  ore = im + nfreqs;
+  oim = ore + nfreqs;
+  tre = oim + nfreqs;
+  tim = tre + nfreqs;
+  uniform = nfreqs >= FIR_FFT_MIN_FREQS && uniform_grid(freq, nfreqs, &f0,
+                                                         &df);
+
+  for (i = 0; i < nfreqs; i++) {
+    re[i] = 1.0;
+    im[i] = 0.0;
+  }
+  stage_ptr = chan->first_stage;
+  for (j = 0; j < chan->nstages; j++, stage_ptr = stage_ptr->next_stage) {
+    nc = 0;
+    sym_fir = 0;
+    if (!stage_selected(stage_ptr, start_stage, stop_stage))
+      continue;
+    for (blkt_ptr = stage_ptr->first_blkt; blkt_ptr;
+         blkt_ptr = blkt_ptr->next_blkt) {
+      eval_flag = 1;
+      switch (blkt_ptr->type) {
+      case ANALOG_PZ:
+      case LAPLACE_PZ:
+        analog_pz(blkt_ptr, freq, nfreqs, ore, oim, tre, tim);
+        break;
+      case IIR_PZ:
+        if (blkt_ptr->blkt_info.pole_zero.nzeros ||
+            blkt_ptr->blkt_info.pole_zero.npoles) {
+          for (i = 0; i < nfreqs; i++) {
+            iir_pz_trans((struct blkt *)blkt_ptr, twoPi * freq[i], &of);
+            ore[i] = of.real;
+            oim[i] = of.imag;
+          }
+        }
+        else
+          eval_flag = 0;
+        break;
+      case FIR_SYM_1:
+      case FIR_SYM_2:
+      case FIR_ASYM:
+        if (blkt_ptr->type == FIR_SYM_1)
+          nc = blkt_ptr->blkt_info.fir.ncoeffs * 2 - 1;
+        else if (blkt_ptr->type == FIR_SYM_2)
+          nc = blkt_ptr->blkt_info.fir.ncoeffs * 2;
+        else
+          nc = blkt_ptr->blkt_info.fir.ncoeffs;
+        if (!blkt_ptr->blkt_info.fir.ncoeffs) {
+          eval_flag = 0;
+          break;
+        }
+        sym_fir = blkt_ptr->type == FIR_ASYM ? -1 : 1;
+        if (uniform && blkt_ptr->blkt_info.fir.ncoeffs >= FIR_FFT_MIN_COEFFS &&
+            !(blkt_ptr->type == FIR_ASYM && boxcar(blkt_ptr))) {
+          if ((rc = fir_trans_fft(blkt_ptr, f0, df, nfreqs, ore, oim)))
+            goto cleanup;
+        }
+        else {
+          for (i = 0; i < nfreqs; i++) {
+            if (sym_fir == 1)
+              fir_sym_trans((struct blkt *)blkt_ptr, twoPi * freq[i], &of);
+            else
+              fir_asym_trans((struct blkt *)blkt_ptr, twoPi * freq[i], &of);
+            ore[i] = of.real;
+            oim[i] = of.imag;
+          }
+        }
+        break;
+      case DECIMATION:
+        if (nc != 0) {
+          /* asymmetric FIR coefficients require a delay correction,
+             otherwise it has already been handled in fir_sym_trans() */
+          delay = 0;
+          if (sym_fir == -1) {
+            if (TRUE == use_delay(QUERY_DELAY))
+              delay = blkt_ptr->blkt_info.decimation.estim_delay;
+            else
+              delay = blkt_ptr->blkt_info.decimation.applied_corr;
+          }
+          for (i = 0; i < nfreqs; i++) {
+            w = twoPi * freq[i];
+            ore[i] = cos(w * delay);
+            oim[i] = sin(w * delay);
+          }
+        }
+        else
+          eval_flag = 0;
+        break;
+      case LIST:
+        for (i = 0; i < nfreqs; i++) {
+          calc_list((struct blkt *)blkt_ptr, i, &of);
+          ore[i] = of.real;
+          oim[i] = of.imag;
+        }
+        break;
+      case IIR_COEFFS:
+        for (i = 0; i < nfreqs; i++) {
+          iir_trans((struct blkt *)blkt_ptr, twoPi * freq[i], &of);
+          ore[i] = of.real;
+          oim[i] = of.imag;
+        }
+        break;
+      default:
+        eval_flag = 0;
+        break;
+      }
+      if (eval_flag) {
+        /* same operations as zmul() */
+        for (i = 0; i < nfreqs; i++) {
+          r = re[i] * ore[i] - im[i] * oim[i];
+          im[i] = im[i] * ore[i] + re[i] * oim[i];
+          re[i] = r;
+        }
+      }
+    }
+  }
+
+  sensit = useTotalSensitivityFlag ? chan->sensit : chan->calc_sensit;
+  units_code = chan->first_stage->input_units;
+  for (i = 0; i < nfreqs; i++) {
+    output[i].real = re[i] * sensit * unit_scale;
+    output[i].imag = im[i] * sensit * unit_scale;
+    convert_units(units_code, out, &output[i], twoPi * freq[i]);
+  }
+
+cleanup:
+  free(buf);
+  return rc;
+}
+
+
+/* Evaluates a parsed response at the given frequencies like calc_resp(),
+ * but reentrant: errors are returned instead of jumping to the global
+ * jump_buffer and no global state is used, so it can be called from
+ * several threads at once. Returns 0 or an evalresp error code. */
+int _obspy_eval_response(const struct _obspy_response *resp, double *freq,
+                         int nfreqs, struct complex *output, char *out_units,
+                         int start_stage, int stop_stage,
+                         int useTotalSensitivityFlag)
+{
+  return eval_channel(&resp->chan, resp->unit_scale, freq, nfreqs, output,
+                      out_units, start_stage, stop_stage,
+                      useTotalSensitivityFlag);
 }
@@ -0,0 +1,214 @@
+/*--------------------------------------------------------------------
+# Filename: fft_util.c
+#  Purpose: Real FFT of power of two length for the C signal routines
+# Copyright (C) ObsPy-Developer-Team
+#---------------------------------------------------------------------*/
+
+#define _USE_MATH_DEFINES  // for Visual Studio
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fft_util.h"
+
+
+int next_pow_2(int n)
+{
+    int p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+
+rfft_plan *rfft_plan_create(int n)
+{
+    rfft_plan *plan;
+    int k, j, bits;
+
+    if (n < 2 || (n & (n - 1))) {
+        return NULL;
+    }
+    plan = (rfft_plan *) calloc(1, sizeof(rfft_plan));
+    if (plan == NULL) {
+        return NULL;
+    }
+    plan->n = n;
+    plan->m = n / 2;
+    plan->twiddle = (double *) malloc(2 * (plan->m + 1) * sizeof(double));
+    plan->bitrev = (int *) malloc(plan->m * sizeof(int));
+    if (plan->twiddle == NULL || plan->bitrev == NULL) {
+        rfft_plan_destroy(plan);
+        return NULL;
+    }
+    for (k = 0; k <= plan->m; k++) {
+        plan->twiddle[2 * k] = cos(2.0 * M_PI * k / n);
+        plan->twiddle[2 * k + 1] = -sin(2.0 * M_PI * k / n);
+    }
+    for (bits = 0; (1 << bits) < plan->m; bits++);
+    for (k = 0; k < plan->m; k++) {
+        int r = 0;
+        for (j = 0; j < bits; j++) {
+            r |= ((k >> j) & 1) << (bits - 1 - j);
+        }
+        plan->bitrev[k] = r;
+    }
+    return plan;
+}
+
+
+void rfft_plan_destroy(rfft_plan *plan)
+{
+    if (plan == NULL) {
+        return;
+    }
+    free(plan->twiddle);
+    free(plan->bitrev);
+    free(plan);
+}
+
+
+/* In place radix 2 complex FFT of length plan->m, sign -1 for the forward
+ * and +1 for the unscaled inverse transform. */
+static void cfft(const rfft_plan *plan, double *z, int sign)
+{
+    int m = plan->m;
+    int k, i, j, len, half, step;
+    double tr, ti, wr, wi;
+
+    for (k = 0; k < m; k++) {
+        int r = plan->bitrev[k];
+        if (r > k) {
+            tr = z[2 * k];
+            ti = z[2 * k + 1];
+            z[2 * k] = z[2 * r];
+            z[2 * k + 1] = z[2 * r + 1];
+            z[2 * r] = tr;
+            z[2 * r + 1] = ti;
+        }
+    }
+    for (len = 2; len <= m; len <<= 1) {
+        half = len / 2;
+        /* exp(-2 pi i j / len) is entry 2 * j * step of the twiddle table */
+        step = 2 * (m / len);
+        for (i = 0; i < m; i += len) {
+            for (j = 0; j < half; j++) {
+                double *u = z + 2 * (i + j);
+                double *v = z + 2 * (i + j + half);
+                wr = plan->twiddle[2 * j * step];
+                if (sign > 0) {
+                    wi = -plan->twiddle[2 * j * step + 1];
+                }
+                else {
+                    wi = plan->twiddle[2 * j * step + 1];
+                }
+                tr = v[0] * wr - v[1] * wi;
+                ti = v[0] * wi + v[1] * wr;
+                v[0] = u[0] - tr;
+                v[1] = u[1] - ti;
+                u[0] += tr;
+                u[1] += ti;
+            }
+        }
+    }
+}
+
+
+/**
+   In place complex FFT of plan->m = n / 2 values given as interleaved real
+   and imaginary parts, sign -1 for the forward and +1 for the unscaled
+   inverse transform.
+**/
+void complex_fft(const rfft_plan *plan, double *z, int sign)
+{
+    cfft(plan, z, sign);
+}
+
+
+/**
+   Forward FFT of n real samples. The samples are transformed as n / 2
+   complex values and the spectra of even and odd samples are separated
+   afterwards.
+**/
+void rfft_forward(const rfft_plan *plan, const double *data, double *spec)
+{
+    int m = plan->m;
+    int k;
+    double zr, zi, cr, ci, er, ei, or_, oi, wr, wi;
+
+    memcpy(spec, data, plan->n * sizeof(double));
+    cfft(plan, spec, -1);
+    /* spec[2 * m] is free, keep Z[0] there for k = m */
+    spec[2 * m] = spec[0];
+    spec[2 * m + 1] = spec[1];
+    for (k = 0; k <= m / 2; k++) {
+        int l = m - k;
+        /* Z[k] and conj(Z[m - k]) */
+        zr = spec[2 * k];
+        zi = spec[2 * k + 1];
+        cr = spec[2 * l];
+        ci = -spec[2 * l + 1];
+        /* X[k] = E + w^k O with E = (Z[k] + conj(Z[m - k])) / 2 and
+         * O = (Z[k] - conj(Z[m - k])) / 2i */
+        er = 0.5 * (zr + cr);
+        ei = 0.5 * (zi + ci);
+        or_ = 0.5 * (zi - ci);
+        oi = -0.5 * (zr - cr);
+        wr = plan->twiddle[2 * k];
+        wi = plan->twiddle[2 * k + 1];
+        spec[2 * k] = er + wr * or_ - wi * oi;
+        spec[2 * k + 1] = ei + wr * oi + wi * or_;
+        if (l != k) {
+            /* X[m - k] = conj(E) + w^(m - k) conj(O) */
+            wr = plan->twiddle[2 * l];
+            wi = plan->twiddle[2 * l + 1];
+            spec[2 * l] = er + wr * or_ + wi * oi;
+            spec[2 * l + 1] = -ei - wr * oi + wi * or_;
+        }
+    }
+}
+
+
+/**
+   Inverse of rfft_forward(), scaled by 1 / n. Overwrites spec.
+**/
+void rfft_inverse(const rfft_plan *plan, double *spec, double *data)
+{
+    int m = plan->m;
+    int k;
+    double xr, xi, cr, ci, er, ei, dr, di, or_, oi, wr, wi;
+    double scale = 1.0 / m;
+
+    for (k = 0; k <= m / 2; k++) {
+        int l = m - k;
+        /* X[k] and conj(X[m - k]) */
+        xr = spec[2 * k];
+        xi = spec[2 * k + 1];
+        cr = spec[2 * l];
+        ci = -spec[2 * l + 1];
+        /* E = (X[k] + conj(X[m - k])) / 2,
+         * O = (X[k] - conj(X[m - k])) / 2 * exp(2 pi i k / n) */
+        er = 0.5 * (xr + cr);
+        ei = 0.5 * (xi + ci);
+        dr = 0.5 * (xr - cr);
+        di = 0.5 * (xi - ci);
+        wr = plan->twiddle[2 * k];
+        wi = -plan->twiddle[2 * k + 1];
+        or_ = dr * wr - di * wi;
+        oi = dr * wi + di * wr;
+        /* Z[k] = E + i O */
+        spec[2 * k] = er - oi;
+        spec[2 * k + 1] = ei + or_;
+        if (l != k && l != m) {
+            /* E and O of m - k are conj(E) and conj(O), so
+             * Z[m - k] = conj(E) + i conj(O) */
+            spec[2 * l] = er + oi;
+            spec[2 * l + 1] = -ei + or_;
+        }
+    }
+    cfft(plan, spec, 1);
+    for (k = 0; k < plan->n; k++) {
+        data[k] = spec[k] * scale;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef FFT_UTIL_H
+#define FFT_UTIL_H
+
+/**
+   Setup of a real FFT of power of two length n. It holds the twiddle factors
+   and the bit reversal permutation and can be shared by any number of
+   threads, the transforms themselves do not allocate any memory.
+**/
+typedef struct rfft_plan_s {
+    int n;                      /* transform length, power of two >= 2 */
+    int m;                      /* length of the inner complex FFT, n / 2 */
+    double *twiddle;            /* exp(-2 pi i k / n) for k = 0 .. m */
+    int *bitrev;                /* bit reversal permutation of length m */
+} rfft_plan;
+
+rfft_plan *rfft_plan_create(int n);
+void rfft_plan_destroy(rfft_plan *plan);
+
+/* spec holds n / 2 + 1 complex values as interleaved real and imaginary
+ * parts, i.e. n + 2 doubles */
+void rfft_forward(const rfft_plan *plan, const double *data, double *spec);
+/* overwrites spec, the result is scaled by 1 / n */
+void rfft_inverse(const rfft_plan *plan, double *spec, double *data);
+/* complex FFT of length n / 2, z holds n doubles */
+void complex_fft(const rfft_plan *plan, double *z, int sign);
+
+int next_pow_2(int n);
+
+#endif
@@ -24,100 +24,138 @@
 #include <math.h>
 #include <time.h>
 
+#include "filt_util.h"
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
 
-#define MAX_SEC 10
 #define TRUE 1
 #define FALSE 0
 
 /**
-   NAME: spr_bp_fast_bworth
+   NAME: spr_bworth_design
    SYNOPSIS:
-   float flo;          low cut corner frequency
-   float fhi;          high cut corner frequency
-   int ns;            number of filter sections
-   int zph;          TRUE -> zero phase filter
-   spr_bp_bworth(header1,header2,flo,fhi,ns,zph);
-   DESCRIPTION: Butterworth bandpass filter.
+   bworth_state *state; filter to design
+   int type;          BWORTH_BANDPASS, BWORTH_HIGHPASS or BWORTH_LOWPASS
+   float tsa;         sampling interval
+   float f1;          low cut corner frequency or corner frequency
+   float f2;          high cut corner frequency (bandpass only)
+   int ns;            number of filter sections, 1 <= ns <= MAX_SEC
+   DESCRIPTION: Designs the filter weights of a Butterworth filter and
+   resets its past values. Returns 0 on success and 1 for invalid arguments.
 **/
-void spr_bp_fast_bworth(float *tr, int ndat, float tsa, float flo, float fhi, int ns, int zph)
+int spr_bworth_design(bworth_state *state, int type, float tsa, float f1, float f2, int ns)
 {
     int k;                   /* index */
-    int n,m,mm;
-    static double a[MAX_SEC+1];
-    static double b[MAX_SEC+1];
-    static double c[MAX_SEC+1];
-    static double d[MAX_SEC+1];
-    static double e[MAX_SEC+1];
-    static double f[MAX_SEC+1][6];
-
-    double temp;
     double c1,c2,c3;
     double w1,w2,wc,q,p,r,s,cs,x;
- 
-    /* Applying Butterworth bandpass: flo <-> fhi, sections: ns, ZP: zph */
-    /* design filter weights */
-    /* bandpass */
-    w1=sin(flo*M_PI*tsa)/cos(flo*M_PI*tsa);
-    w2=sin(fhi*M_PI*tsa)/cos(fhi*M_PI*tsa);
-    wc=w2-w1;
-    q=wc*wc +2.0*w1*w2;
-    s=w1*w1*w2*w2;
-    for (k=1;k<=ns;k++)
-    {
-            c1=(double)(k+ns);
-            c2=(double)(4*ns);
-            c3=(2.0*c1-1.0)*M_PI/c2;
-            cs=cos(c3);
-            p = -2.0*wc*cs;
-            r=p*w1*w2;
-            x=1.0+p+q+r+s;
-            a[k]=wc*wc/x;
-            b[k]=(-4.0 -2.0*p+ 2.0*r+4.0*s)/x;
-            c[k]=(6.0 - 2.0*q +6.0*s)/x;
-            d[k]=(-4.0 +2.0*p -2.0*r +4.0*s)/x;
-            e[k]=(1.0 - p +q-r +s)/x;
+    double wcp;
+
+    if (ns < 1 || ns > MAX_SEC) {
+        return 1;
     }
- 
-    /* set initial values to 0 */
-    for(n=0;n<=MAX_SEC;n++)
-    {
-            for(m=0;m<=5;m++)
-            {
-                    f[n][m]=0.0;
-            }
+    memset(state, 0, sizeof(bworth_state));
+    state->type = type;
+    state->ns = ns;
+
+    switch (type) {
+    case BWORTH_BANDPASS:
+        w1=sin(f1*M_PI*tsa)/cos(f1*M_PI*tsa);
+        w2=sin(f2*M_PI*tsa)/cos(f2*M_PI*tsa);
+        wc=w2-w1;
+        q=wc*wc +2.0*w1*w2;
+        s=w1*w1*w2*w2;
+        for (k=1;k<=ns;k++)
+        {
+                c1=(double)(k+ns);
+                c2=(double)(4*ns);
+                c3=(2.0*c1-1.0)*M_PI/c2;
+                cs=cos(c3);
+                p = -2.0*wc*cs;
+                r=p*w1*w2;
+                x=1.0+p+q+r+s;
+                state->a[k]=wc*wc/x;
+                state->b[k]=(-4.0 -2.0*p+ 2.0*r+4.0*s)/x;
+                state->c[k]=(6.0 - 2.0*q +6.0*s)/x;
+                state->d[k]=(-4.0 +2.0*p -2.0*r +4.0*s)/x;
+                state->e[k]=(1.0 - p +q-r +s)/x;
+        }
+        break;
+    case BWORTH_HIGHPASS:
+        wcp=sin(f1*M_PI*tsa)/cos(f1*M_PI*tsa);
+        for (k=1;k<=ns;k++)
+        {
+                cs=cos((2.0*(k+ns)-1.0)*M_PI/(4.0*ns));
+                state->a[k]=1.0/(1.0+wcp*wcp-2.0*wcp*cs);
+                state->b[k]=2.0*(wcp*wcp-1.0)*state->a[k];
+                state->c[k]=(1.0 +wcp*wcp +2.0*wcp*cs)*state->a[k];
+        }
+        break;
+    case BWORTH_LOWPASS:
+        wcp=sin(f1*M_PI*tsa)/cos(f1*M_PI*tsa);
+        for (k=1;k<=ns;k++)
+        {
+                cs=cos((2.0*(k+ns)-1.0)*M_PI/(4.0*ns));
+                x=1.0/(1.0+wcp*wcp -2.0*wcp*cs);
+                state->a[k]=wcp*wcp*x;
+                state->b[k]=2.0*(wcp*wcp-1.0)*x;
+                state->c[k]=(1.0 +wcp*wcp +2.0*wcp*cs)*x;
+        }
+        break;
+    default:
+        return 1;
     }
-    /* filtering */
-    for (m=1;m<=ndat;m++)
-    {
-            f[1][5]= *(tr + m-1);
-            /* go thru ns filter sections */
-            for(n=1;n<=ns;n++)
-            {
-                    temp=a[n]*(f[n][5]-2.0*f[n][3] +f[n][1]);
-                    temp=temp-b[n]*f[n+1][4]-c[n]*f[n+1][3];
-                    f[n+1][5]=temp-d[n]*f[n+1][2]-e[n]*f[n+1][1];
-            }
-            /* update past values */
-            for(n=1;n<=ns+1;n++)
-            {
-                    for(mm=1;mm<=4;mm++)
-                    {
-                            f[n][mm]=f[n][mm+1];
-                    }
-            }
-            /* set present data value and continue */
-            *(tr+m-1) = (float) f[ns+1][5];
+    return 0;
+}
+
+/**
+   NAME: spr_bworth_reset
+   DESCRIPTION: Sets all past values of a Butterworth filter to 0.
+**/
+void spr_bworth_reset(bworth_state *state)
+{
+    memset(state->f, 0, sizeof(state->f));
+}
+
+/**
+   NAME: spr_bworth_apply
+   SYNOPSIS:
+   bworth_state *state; designed filter
+   int reverse;       TRUE -> filter from the last to the first sample
+   DESCRIPTION: Filters a trace in place, continuing with the past values
+   left by the previous call.
+**/
+void spr_bworth_apply(bworth_state *state, float *tr, int ndat, int reverse)
+{
+    int n,m,mm;
+    int step;
+    int ns = state->ns;
+    double temp;
+    double *a = state->a;
+    double *b = state->b;
+    double *c = state->c;
+    double *d = state->d;
+    double *e = state->e;
+    double (*f)[6] = state->f;
+
+    if (ndat < 1) {
+        return;
     }
-    if (zph == TRUE)
+    if (reverse == TRUE) {
+        tr += ndat - 1;
+        step = -1;
+    }
+    else {
+        step = 1;
+    }
+
+    if (state->type == BWORTH_BANDPASS)
     {
-        /* filtering reverse signal*/
-        for (m=ndat;m>=1;m--)
+        for (m=1;m<=ndat;m++,tr+=step)
         {
-                f[1][5]= *(tr+m-1);
+                f[1][5]= *tr;
                 /* go thru ns filter sections */
                 for(n=1;n<=ns;n++)
                 {
@@ -134,10 +172,115 @@ void spr_bp_fast_bworth(float *tr, int ndat, float tsa, float flo, float fhi, in
                         }
                 }
                 /* set present data value and continue */
-                *(tr+m-1)= (float) f[ns+1][5];
+                *tr = (float) f[ns+1][5];
+        }
+    }
+    else
+    {
+        /* the numerators of high- and lowpass only differ in sign */
+        double sgn = state->type == BWORTH_LOWPASS ? 2.0 : -2.0;
+        for (m=1;m<=ndat;m++,tr+=step)
+        {
+                f[1][3]= *tr;
+                /* go thru ns filter sections */
+                for(n=1;n<=ns;n++)
+                {
+                        temp=a[n]*(f[n][3]+sgn*f[n][2] +f[n][1]);
+                        f[n+1][3]=temp-b[n]*f[n+1][2]-c[n]*f[n+1][1];
+                }
+                /* update past values */
+                for(n=1;n<=ns+1;n++)
+                {
+                        for(mm=1;mm<=2;mm++)
+                        {
+                                f[n][mm]=f[n][mm+1];
+                        }
+                }
+                /* set present data value and continue */
+                *tr = (float) f[ns+1][3];
         }
     }
-    return;
+}
+
+/* Filters with freshly designed weights and zero past values. For zero phase
+ * filters the reverse pass continues with the past values of the forward
+ * pass. Returns 1 without touching tr for invalid arguments. */
+static int spr_bworth_run(float *tr, int ndat, float tsa, int type, float f1, float f2, int ns, int zph, bworth_state *state)
+{
+    if (spr_bworth_design(state, type, tsa, f1, f2, ns) != 0) {
+        return 1;
+    }
+    spr_bworth_apply(state, tr, ndat, FALSE);
+    if (zph == TRUE)
+    {
+        spr_bworth_apply(state, tr, ndat, TRUE);
+    }
+    return 0;
+}
+
+/**
+   NAME: spr_bp_fast_bworth_r
+   SYNOPSIS:
+   float flo;          low cut corner frequency
+   float fhi;          high cut corner frequency
+   int ns;            number of filter sections
+   int zph;          TRUE -> zero phase filter
+   bworth_state *state; caller owned filter state
+   DESCRIPTION: Reentrant Butterworth bandpass filter. Returns 0 on success
+   and 1 for invalid arguments.
+**/
+int spr_bp_fast_bworth_r(float *tr, int ndat, float tsa, float flo, float fhi, int ns, int zph, bworth_state *state)
+{
+    /* Applying Butterworth bandpass: flo <-> fhi, sections: ns, ZP: zph */
+    return spr_bworth_run(tr, ndat, tsa, BWORTH_BANDPASS, flo, fhi, ns, zph, state);
+}
+
+/**
+   NAME: spr_hp_fast_bworth_r
+   SYNOPSIS:
+   float fc;          corner frequency
+   int ns;            number of filter sections
+   int zph;          TRUE -> zero phase filter
+   bworth_state *state; caller owned filter state
+   DESCRIPTION: Reentrant Butterworth highpass filter. Returns 0 on success
+   and 1 for invalid arguments.
+**/
+int spr_hp_fast_bworth_r(float *tr, int ndat, float tsa, float fc, int ns, int zph, bworth_state *state)
+{
+    return spr_bworth_run(tr, ndat, tsa, BWORTH_HIGHPASS, fc, fc, ns, zph, state);
+}
+
+/**
+   NAME: spr_lp_fast_bworth_r
+   SYNOPSIS:
+   float fc;          corner frequency
+   int ns;            number of filter sections
+   int zph;          TRUE -> zero phase filter
+   bworth_state *state; caller owned filter state
+   DESCRIPTION: Reentrant Butterworth lowpass filter. Returns 0 on success
+   and 1 for invalid arguments.
+**/
+int spr_lp_fast_bworth_r(float *tr, int ndat, float tsa, float fc, int ns, int zph, bworth_state *state)
+{
+    /* Applying Butterworth lowpass: <- fc, sections: ns, ZP: zph */
+    return spr_bworth_run(tr, ndat, tsa, BWORTH_LOWPASS, fc, fc, ns, zph, state);
+}
+
+/**
+   NAME: spr_bp_fast_bworth
+   SYNOPSIS:
+   float flo;          low cut corner frequency
+   float fhi;          high cut corner frequency
+   int ns;            number of filter sections
+   int zph;          TRUE -> zero phase filter
+   spr_bp_bworth(header1,header2,flo,fhi,ns,zph);
+   DESCRIPTION: Butterworth bandpass filter. Returns 0 on success and 1 for
+   invalid arguments.
+**/
+int spr_bp_fast_bworth(float *tr, int ndat, float tsa, float flo, float fhi, int ns, int zph)
+{
+    bworth_state state;
+    return spr_bp_fast_bworth_r(tr, ndat, tsa, flo, fhi, ns, zph, &state);
 }
 
 /**
@@ -147,86 +290,15 @@ void spr_bp_fast_bworth(float *tr, int ndat, float tsa, float flo, float fhi, in
    int ns;            number of filter sections
    int zph;          TRUE -> zero phase filter
    spr_hp_bworth(header1,header2,fc,ns,zph);
-   DESCRIPTION: Butterworth highpass filter.
+   DESCRIPTION: Butterworth highpass filter. Returns 0 on success and 1 for
+   invalid arguments.
 **/
-void spr_hp_fast_bworth(float *tr, int ndat, float tsa, float fc, int ns, int zph)
+int spr_hp_fast_bworth(float *tr, int ndat, float tsa, float fc, int ns, int zph)
 {
-    int k;                   /* index */
-    int n,m,mm;
-    static double a[MAX_SEC+1];
-    static double b[MAX_SEC+1];
-    static double c[MAX_SEC+1];
-    static double f[MAX_SEC+1][6];
- 
-    double temp;
-    double wcp,cs;
- 
-    /* design filter weights */
-    wcp=sin(fc*M_PI*tsa)/cos(fc*M_PI*tsa);
-    for (k=1;k<=ns;k++)
-    {
-            cs=cos((2.0*(k+ns)-1.0)*M_PI/(4.0*ns));
-            a[k]=1.0/(1.0+wcp*wcp-2.0*wcp*cs);
-            b[k]=2.0*(wcp*wcp-1.0)*a[k];
-            c[k]=(1.0 +wcp*wcp +2.0*wcp*cs)*a[k];
-    }
- 
-    /* set initial values to 0 */
-    for(n=0;n<=MAX_SEC;n++)
-    {
-            for(m=0;m<=5;m++)
-            {
-                    f[n][m]=0.0;
-            }
-    }
-    /* set initial values to 0 */
-    /* filtering */
-    for (m=1;m<=ndat;m++)
-    {
-            f[1][3]= *(tr+m-1);
-            /* go thru ns filter sections */
-            for(n=1;n<=ns;n++)
-            {
-                    temp=a[n]*(f[n][3]-2.0*f[n][2] +f[n][1]);
-                    f[n+1][3]=temp-b[n]*f[n+1][2]-c[n]*f[n+1][1];
-            }
-            /* update past values */
-            for(n=1;n<=ns+1;n++)
-            {
-                    for(mm=1;mm<=2;mm++)
-                    {
-                            f[n][mm]=f[n][mm+1];
-                    }
-            }
-            /* set present data value and continue */
-            *(tr+m-1)= (float) f[ns+1][3];
-    }
-    if (zph == TRUE)
-    {
-        /* filtering reverse signal*/
-        for (m=ndat;m>=1;m--)
-        {
-            f[1][3]= *(tr+m-1);
-            /* go thru ns filter sections */
-            for(n=1;n<=ns;n++)
-            {
-                    temp=a[n]*(f[n][3]-2.0*f[n][2] +f[n][1]);
-                    f[n+1][3]=temp-b[n]*f[n+1][2]-c[n]*f[n+1][1];
-            }
-            /* update past values */
-            for(n=1;n<=ns+1;n++)
-            {
-                    for(mm=1;mm<=2;mm++)
-                    {
-                            f[n][mm]=f[n][mm+1];
-                    }
-            }
-            /* set present data value and continue */
-            *(tr+m-1)= (float) f[ns+1][3];
-        }
-    }
+    bworth_state state;
+    return spr_hp_fast_bworth_r(tr, ndat, tsa, fc, ns, zph, &state);
 }
- 
+
 /**
    NAME: spr_lp_fast_bworth
    SYNOPSIS:
@@ -234,88 +306,93 @@ void spr_hp_fast_bworth(float *tr, int ndat, float tsa, float fc, int ns, int zp
    int ns;            number of filter sections
    int zph;          TRUE -> zero phase filter
    spr_lp_bworth(header1,header2,fc,ns,zph);
-   DESCRIPTION: Butterworth lowpass filter.
+   DESCRIPTION: Butterworth lowpass filter. Returns 0 on success and 1 for
+   invalid arguments.
 **/
-void spr_lp_fast_bworth(float *tr, int ndat, float tsa, float fc, int ns, int zph)
+int spr_lp_fast_bworth(float *tr, int ndat, float tsa, float fc, int ns, int zph)
 {
-    int k;                       /* index */
-    int n,m,mm;
-    static double a[MAX_SEC+1];
-    static double b[MAX_SEC+1];
-    static double c[MAX_SEC+1];
-    static double f[MAX_SEC+1][6];
- 
-    double temp;
-    double wcp,cs,x;
- 
- 
-    /* Applying Butterworth lowpass: <- fc, sections: ns, ZP: zph */
-    wcp=sin(fc*M_PI*tsa)/cos(fc*M_PI*tsa);
-    for (k=1;k<=ns;k++)
-    {
-            cs=cos((2.0*(k+ns)-1.0)*M_PI/(4.0*ns));
-            x=1.0/(1.0+wcp*wcp -2.0*wcp*cs);
-            a[k]=wcp*wcp*x;
-            b[k]=2.0*(wcp*wcp-1.0)*x;
-            c[k]=(1.0 +wcp*wcp +2.0*wcp*cs)*x;
-    }
-    /* set initial values to 0 */
-    for(n=0;n<=MAX_SEC;n++)
-    {
-            for(m=0;m<=5;m++)
-            {
-                    f[n][m]=0.0;
-            }
+    bworth_state state;
+    return spr_lp_fast_bworth_r(tr, ndat, tsa, fc, ns, zph, &state);
+}
+
+/**
+   NAME: spr_bworth_batch
+   SYNOPSIS:
+   float *data;       ntr traces of ndat samples each, row by row
+   int type;          BWORTH_BANDPASS, BWORTH_HIGHPASS or BWORTH_LOWPASS
+   int threads;       number of threads to filter with
+   DESCRIPTION: Applies the same Butterworth filter to many traces in place.
+   The filter is designed once and every trace gets its own copy of the state
+   so the traces can be distributed over several threads if compiled with
+   OpenMP. Returns 0 on success and 1 for invalid arguments.
+**/
+int spr_bworth_batch(float *data, int ntr, int ndat, float tsa, int type, float f1, float f2, int ns, int zph, int threads)
+{
+    int i;
+    bworth_state design;
+
+    if (spr_bworth_design(&design, type, tsa, f1, f2, ns) != 0) {
+        return 1;
     }
-    /* set initial values to 0 */
-    /* filtering */
-    for (m=1;m<=ndat;m++)
-    {
-            f[1][3]= *(tr+m-1);
-            /* go thru ns filter sections */
-            for(n=1;n<=ns;n++)
-            {
-                    temp=a[n]*(f[n][3]+2.0*f[n][2] +f[n][1]);
-                    f[n+1][3]=temp-b[n]*f[n+1][2]-c[n]*f[n+1][1];
-            }
-            /* update past values */
-            for(n=1;n<=ns+1;n++)
-            {
-                    for(mm=1;mm<=2;mm++)
-                    {
-                            f[n][mm]=f[n][mm+1];
-                    }
-            }
-            /* set present data value and continue */
-            *(tr+m-1)= (float) f[ns+1][3];
+    if (threads < 1) {
+        threads = 1;
     }
-    if (zph == TRUE)
-    {
- 
-        /* filtering reverse signal*/
-        for (m=ndat;m>=1;m--)
+    #pragma omp parallel for num_threads(threads) schedule(dynamic) if(threads > 1)
+    for (i = 0; i < ntr; i++) {
+        bworth_state state = design;
+        float *tr = data + (size_t) i * ndat;
+        spr_bworth_apply(&state, tr, ndat, FALSE);
+        if (zph == TRUE)
         {
-            f[1][3]= *(tr+m-1);
-            /* go thru ns filter sections */
-            for(n=1;n<=ns;n++)
-            {
-                    temp=a[n]*(f[n][3]+2.0*f[n][2] +f[n][1]);
-                    f[n+1][3]=temp-b[n]*f[n+1][2]-c[n]*f[n+1][1];
-            }
-            /* update past values */
-            for(n=1;n<=ns+1;n++)
-            {
-                    for(mm=1;mm<=2;mm++)
-                    {
-                            f[n][mm]=f[n][mm+1];
-                    }
+            spr_bworth_apply(&state, tr, ndat, TRUE);
+        }
+    }
+    return 0;
+}
+
+/**
+   NAME: spr_sos_filter
+   SYNOPSIS:
+   double *data;      ntr traces of ndat samples each, row by row
+   double *sos;       nsec second order sections, rows of b0 b1 b2 a0 a1 a2
+   double *zi;        ntr x nsec x 2 delay line values, updated in place
+   int threads;       number of threads to filter with
+   DESCRIPTION: Filters traces in place with a cascade of second order
+   sections in transposed direct form II, starting from and leaving behind
+   the given delay line values. Feeding consecutive chunks of a trace with
+   the same delay line gives the same result as filtering the whole trace
+   at once. The a0 coefficients are assumed to be normalized to 1. The traces
+   are distributed over several threads if compiled with OpenMP.
+**/
+void spr_sos_filter(double *data, int ntr, int ndat, const double *sos, int nsec, double *zi, int threads)
+{
+    int i;
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    #pragma omp parallel for num_threads(threads) schedule(dynamic) if(threads > 1 && ntr > 1)
+    for (i = 0; i < ntr; i++) {
+        int m, n;
+        double x, y;
+        double *tr = data + (size_t) i * ndat;
+        double *z = zi + (size_t) i * nsec * 2;
+        const double *s;
+
+        for (m = 0; m < ndat; m++) {
+            x = tr[m];
+            for (n = 0; n < nsec; n++) {
+                s = sos + 6 * n;
+                y = s[0] * x + z[2 * n];
+                z[2 * n] = s[1] * x - s[4] * y + z[2 * n + 1];
+                z[2 * n + 1] = s[2] * x - s[5] * y;
+                x = y;
             }
-            /* set present data value and continue */
-            *(tr+m-1)= (float) f[ns+1][3];
+            tr[m] = x;
         }
     }
 }
- 
+
 /**
  * NAME: spr_time_fast_int()
  *      SYNOPSIS:
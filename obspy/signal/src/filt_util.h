@@ -0,0 +1,44 @@
+#ifndef FILT_UTIL_H
+#define FILT_UTIL_H
+
+#define MAX_SEC 10
+
+/* Butterworth filter types */
+#define BWORTH_BANDPASS 0
+#define BWORTH_HIGHPASS 1
+#define BWORTH_LOWPASS  2
+
+/**
+   Coefficients and delay line of a cascade of Butterworth filter sections.
+   Bandpass sections are of fourth order and use all coefficients, high- and
+   lowpass sections are of second order and only use a, b and c. The state is
+   owned by the caller so that any number of filters can run at the same time.
+**/
+typedef struct bworth_state_s {
+    int type;                   /* BWORTH_BANDPASS, _HIGHPASS or _LOWPASS */
+    int ns;                     /* number of filter sections */
+    double a[MAX_SEC+1];
+    double b[MAX_SEC+1];
+    double c[MAX_SEC+1];
+    double d[MAX_SEC+1];
+    double e[MAX_SEC+1];
+    double f[MAX_SEC+2][6];     /* past values of all sections */
+} bworth_state;
+
+int spr_bworth_design(bworth_state *state, int type, float tsa, float f1, float f2, int ns);
+void spr_bworth_reset(bworth_state *state);
+void spr_bworth_apply(bworth_state *state, float *tr, int ndat, int reverse);
+
+int spr_bp_fast_bworth_r(float *tr, int ndat, float tsa, float flo, float fhi, int ns, int zph, bworth_state *state);
+int spr_hp_fast_bworth_r(float *tr, int ndat, float tsa, float fc, int ns, int zph, bworth_state *state);
+int spr_lp_fast_bworth_r(float *tr, int ndat, float tsa, float fc, int ns, int zph, bworth_state *state);
+
+int spr_bp_fast_bworth(float *tr, int ndat, float tsa, float flo, float fhi, int ns, int zph);
+int spr_hp_fast_bworth(float *tr, int ndat, float tsa, float fc, int ns, int zph);
+int spr_lp_fast_bworth(float *tr, int ndat, float tsa, float fc, int ns, int zph);
+
+void spr_sos_filter(double *data, int ntr, int ndat, const double *sos, int nsec, double *zi, int threads);
+
+int spr_bworth_batch(float *data, int ntr, int ndat, float tsa, int type, float f1, float f2, int ns, int zph, int threads);
+
+#endif
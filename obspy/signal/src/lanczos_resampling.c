@@ -10,6 +10,11 @@
 #define _USE_MATH_DEFINES
 
 #include <math.h>
+#include <stdlib.h>
+
+/* maximum number of precomputed filters for rational sampling rate
+ * factors */
+#define LANCZOS_MAX_PHASES 4096
 
 
 enum lanczos_window_type {
@@ -51,6 +56,125 @@ static double blackman_kernel(double x, int a) {
 }
 
 
+/* Multiplies the n weights w[0], w[step], ... at the points d, d + dd, ...
+ * with the chosen window. c and s are cosine and sine of d * pi / a and are
+ * advanced by rotation with the angle dd * pi / a. */
+static void apply_window(double *w, int n, int step, double d, double dd,
+                         double c, double s, int a,
+                         enum lanczos_window_type window) {
+    const double rot_cos = cos(M_PI / a);
+    const double rot_sin = dd * sin(M_PI / a);
+    double tmp;
+    int k;
+
+    /* the loops over the weights do not branch */
+    if (window == LANCZOS) {
+        for (k = 0; k < n; k++, d += dd) {
+            w[k * step] *= s * a / (M_PI * d);
+            tmp = c * rot_cos - s * rot_sin;
+            s = s * rot_cos + c * rot_sin;
+            c = tmp;
+        }
+    }
+    else if (window == HANNING) {
+        for (k = 0; k < n; k++) {
+            w[k * step] *= 0.5 * (1.0 + c);
+            tmp = c * rot_cos - s * rot_sin;
+            s = s * rot_cos + c * rot_sin;
+            c = tmp;
+        }
+    }
+    else if (window == BLACKMAN) {
+        for (k = 0; k < n; k++) {
+            w[k * step] *= 21.0 / 50.0 + 0.5 * c +
+                           2.0 / 25.0 * (2.0 * c * c - 1.0);
+            tmp = c * rot_cos - s * rot_sin;
+            s = s * rot_cos + c * rot_sin;
+            c = tmp;
+        }
+    }
+}
+
+
+/* Sinc function times the chosen window at the 2 * a points d = f + a - 1,
+ * f + a - 2, ..., f - a with 0 <= f < 1, i.e. the weights of the input
+ * samples floor(x) - a + 1 ... floor(x) + a for the output sample at x with
+ * fractional part f. The kernel vanishes at the remaining point d = f + a
+ * for f = 0.
+ *
+ * sin(pi * (f + m)) = (-1)^m sin(pi * f) for integer m, so only the window
+ * needs the angle d * pi / a. It is computed directly for the two points
+ * closest to zero and advanced by rotation towards both ends. This gives the
+ * same values as the kernel functions above up to rounding with a few calls
+ * to transcendental functions instead of 2 * a per weight. */
+static void lanczos_weights(double f, int a, enum lanczos_window_type window,
+                            double *weights) {
+    /* sin(pi * f) / pi, accurate also for f close to one */
+    const double sin_f = sin(M_PI * (f > 0.5 ? 1.0 - f : f)) / M_PI;
+    double sign;
+    int k;
+
+    /* (-1)^m for m = a - 1 */
+    sign = (a - 1) % 2 ? -1.0 : 1.0;
+    for (k = 0; k < 2 * a; k++) {
+        weights[k] = sign * sin_f / (f + a - 1 - k);
+        sign = -sign;
+    }
+    /* d = f, f + 1, ..., f + a - 1 and d = f - 1, f - 2, ..., f - a */
+    apply_window(weights + a - 1, a, -1, f, 1.0, cos(f * M_PI / a),
+                 sin(f * M_PI / a), a, window);
+    apply_window(weights + a, a, 1, f - 1.0, -1.0, cos((f - 1.0) * M_PI / a),
+                 sin((f - 1.0) * M_PI / a), a, window);
+    /* d = 0 happens for f = 0, sinc and window are one there */
+    for (k = a - 1; k <= a; k++) {
+        if (fabs(f + a - 1 - k) < 1E-10) {
+            weights[k] = 1.0;
+        }
+    }
+}
+
+
+/* Smallest q <= max_q for which dt = p / q within the accuracy of the
+ * positions of len_out output samples, 0 if there is none. */
+static int rational_denominator(double dt, int len_out, int max_q) {
+    int q;
+
+    for (q = 1; q <= max_q; q++) {
+        if (fabs(dt * q - floor(dt * q + 0.5)) * len_out / q < 1E-9) {
+            return q;
+        }
+    }
+    return 0;
+}
+
+
+/* Weighted sum of the input samples first ... first + 2 * a - 1, samples
+ * outside of the input are zero. Four independent partial sums let the
+ * compiler use SIMD instructions. */
+static double lanczos_dot(const double *y_in, int len_in, long long first,
+                          const double *weights, int a) {
+    double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+    int k_lo = 0, k_hi = 2 * a, k;
+
+    if (first < 0) {
+        k_lo = (int)(-first);
+    }
+    if (first + k_hi > len_in) {
+        k_hi = (int)(len_in - first);
+    }
+    for (k = k_lo; k + 3 < k_hi; k += 4) {
+        sum0 += weights[k] * y_in[first + k];
+        sum1 += weights[k + 1] * y_in[first + k + 1];
+        sum2 += weights[k + 2] * y_in[first + k + 2];
+        sum3 += weights[k + 3] * y_in[first + k + 3];
+    }
+    for (; k < k_hi; k++) {
+        sum0 += weights[k] * y_in[first + k];
+    }
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+
 /* Lanczos resampling with different kernels.
  *
  * Parameters:
@@ -65,38 +189,68 @@ static double blackman_kernel(double x, int a) {
  *     a: The width of the taper in samples on either side.
  *     lanczos_window_type: Which taper window to choose.
  *
- * Output will be written to y_out.
+ * If dt is a ratio p / q with q <= LANCZOS_MAX_PHASES the fractional offsets
+ * of the output samples repeat after q samples. The weights of these q
+ * phases are then computed once and every output sample is a dot product
+ * with one of them (polyphase filter). Otherwise the weights are computed
+ * for each output sample.
+ *
+ * Output will be written to y_out. Returns 1 if memory allocation failed,
+ * 0 otherwise.
  */
-void lanczos_resample(double *y_in, double *y_out, double dt, double offset,
+int lanczos_resample(double *y_in, double *y_out, double dt, double offset,
                       int len_in, int len_out, int a,
                       enum lanczos_window_type window) {
 
-    int idx, i, m;
-    double x, _x;
+    int idx, q, r, p;
+    double x;
+    double *weights;
 
-    for (idx=0; idx < len_out; idx++) {
-        x = dt * idx + offset;
-        for (m=-a; m<=a; m++) {
-            i = (int)floor(x) - m;
-            if (i < 0 || i >= len_in) {
-                continue;
+    if (len_out < 1 || a < 1) {
+        return 0;
+    }
+    q = rational_denominator(dt, len_out, len_out < LANCZOS_MAX_PHASES ?
+                                          len_out : LANCZOS_MAX_PHASES);
+    weights = (double *)malloc((size_t)(q > 0 ? q : 1) * 2 * a *
+                               sizeof(double));
+    if (q > 0 && weights != NULL) {
+        /* offset + idx * p / q = floor(offset) + floor(idx * p / q) +
+         * carry + f with the phase r = idx * p mod q */
+        double offset_floor = floor(offset);
+        double offset_frac = offset - offset_floor;
+        int *carry = (int *)malloc(q * sizeof(int));
+        if (carry != NULL) {
+            p = (int)floor(dt * q + 0.5);
+            for (r = 0; r < q; r++) {
+                double f = offset_frac + (double)r / q;
+                carry[r] = f >= 1.0 ? 1 : 0;
+                lanczos_weights(f - carry[r], a, window,
+                                weights + (size_t)r * 2 * a);
             }
-            _x = x - i;
-            /* Apply kernel and sum up if within 'a' samples on either side. */
-            if (-a <= _x && _x <= a) {
-                if (window == LANCZOS) {
-                    y_out[idx] += y_in[i] * sinc(_x) * lanczos_kernel(_x, a);
-                }
-                else if (window == HANNING) {
-                    y_out[idx] += y_in[i] * sinc(_x) * hanning_kernel(_x, a);
-                }
-                else if (window == BLACKMAN) {
-                    y_out[idx] += y_in[i] * sinc(_x) * blackman_kernel(_x, a);
-                }
+            for (idx = 0; idx < len_out; idx++) {
+                long long n = (long long)idx * p;
+                long long base;
+                r = (int)(n % q);
+                base = (long long)offset_floor + n / q + carry[r];
+                y_out[idx] += lanczos_dot(y_in, len_in, base - a + 1,
+                                          weights + (size_t)r * 2 * a, a);
             }
+            free(carry);
+            free(weights);
+            return 0;
         }
     }
-    return;
+    if (weights == NULL) {
+        return 1;
+    }
+    for (idx = 0; idx < len_out; idx++) {
+        x = dt * idx + offset;
+        lanczos_weights(x - floor(x), a, window, weights);
+        y_out[idx] += lanczos_dot(y_in, len_in, (long long)floor(x) - a + 1,
+                                  weights, a);
+    }
+    free(weights);
+    return 0;
 }
 
 
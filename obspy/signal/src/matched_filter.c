@@ -0,0 +1,321 @@
+/*--------------------------------------------------------------------
+# Filename: matched_filter.c
+#  Purpose: Matched filter detection of many multi channel templates in
+#           continuous data with normalized cross correlation
+# Copyright (C) ObsPy-Developer-Team
+#---------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fft_util.h"
+
+typedef struct _mf_detection {
+    int template_id;
+    long long index;
+    double cc;
+} mf_detection;
+
+/* stacked correlation above the threshold, the detection is its maximum */
+typedef struct _mf_run {
+    int active;
+    long long index;
+    double cc;
+} mf_run;
+
+/* detections found so far, grown as needed */
+typedef struct _mf_found {
+    mf_detection *items;
+    int count;
+    int capacity;
+} mf_found;
+
+static int mf_emit(mf_found *found, int template_id, long long index,
+                   double cc)
+{
+    int ok = 1;
+
+    #pragma omp critical (matched_filter_emit)
+    {
+        if (found->count == found->capacity) {
+            int capacity = found->capacity ? 2 * found->capacity : 256;
+            mf_detection *items = (mf_detection *) realloc(
+                found->items, (size_t) capacity * sizeof(mf_detection));
+            if (items == NULL) {
+                ok = 0;
+            }
+            else {
+                found->items = items;
+                found->capacity = capacity;
+            }
+        }
+        if (ok) {
+            found->items[found->count].template_id = template_id;
+            found->items[found->count].index = index;
+            found->items[found->count].cc = cc;
+            found->count++;
+        }
+    }
+    return ok;
+}
+
+/**
+   Matched filter of ntmpl templates with nchan channels of tlen samples
+   each against nchan channels of continuous data of ndat samples each.
+
+   For every template and every channel the normalized cross correlation
+   with the data is computed, the template and the data window are both
+   demeaned. The correlation functions are computed with FFT overlap-save in
+   blocks and normalized with running sums of the data windows, which are
+   recomputed every tlen samples to avoid drift. They are stacked over all
+   channels with a template of non zero energy, the per channel functions
+   are never stored completely. Data windows of zero variance correlate
+   with zero.
+
+   Stacked functions at or above threshold form detections at their maximum.
+   They are collected in a buffer that grows as needed. Once all are found,
+   allocate_detections is called from the calling thread with their number
+   and has to return the address of an array of as many mf_detection
+   structs, the detections are copied there and their number is returned.
+   The complete stacked functions of ntmpl x (ndat - tlen + 1) values are
+   written to stack if it is not NULL.
+
+   The templates are distributed over several threads if compiled with
+   OpenMP. Returns -1 if memory allocation failed and -2 for invalid
+   dimensions.
+**/
+int matched_filter(const double *data, int nchan, int ndat,
+                   const double *templates, int ntmpl, int tlen,
+                   double threshold, double *stack,
+                   long long (*allocate_detections) (int), int threads)
+{
+    int nout, nfft, nspec, step, i, t;
+    int failed = 0;
+    mf_found found = {NULL, 0, 0};
+    mf_detection *detections;
+    rfft_plan *plan = NULL;
+    double *tspec = NULL, *tnorm = NULL, *dspec = NULL, *inv_den = NULL;
+    int *nused = NULL;
+    mf_run *runs = NULL;
+
+    if (nchan < 1 || tlen < 1 || ndat < tlen) {
+        return -2;
+    }
+    if (ntmpl < 1) {
+        return 0;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    nout = ndat - tlen + 1;
+    /* blocks of four template lengths, shorter for short data */
+    nfft = next_pow_2(4 * tlen);
+    if (nfft > next_pow_2(ndat)) {
+        nfft = next_pow_2(ndat);
+    }
+    if (nfft < 2) {
+        nfft = 2;
+    }
+    nspec = nfft + 2;
+    step = nfft - tlen + 1;
+
+    plan = rfft_plan_create(nfft);
+    tspec = (double *) malloc((size_t) ntmpl * nchan * nspec * sizeof(double));
+    tnorm = (double *) malloc((size_t) ntmpl * nchan * sizeof(double));
+    dspec = (double *) malloc((size_t) nchan * nspec * sizeof(double));
+    inv_den = (double *) malloc((size_t) nchan * step * sizeof(double));
+    nused = (int *) calloc(ntmpl, sizeof(int));
+    runs = (mf_run *) calloc(ntmpl, sizeof(mf_run));
+    if (plan == NULL || tspec == NULL || tnorm == NULL || dspec == NULL ||
+            inv_den == NULL || nused == NULL || runs == NULL) {
+        failed = 1;
+        goto cleanup;
+    }
+
+    /* conjugate spectra of the demeaned templates */
+    #pragma omp parallel for num_threads(threads) schedule(dynamic) if(threads > 1)
+    for (i = 0; i < ntmpl * nchan; i++) {
+        const double *tr = templates + (size_t) i * tlen;
+        double *spec = tspec + (size_t) i * nspec;
+        double *buf;
+        double mean = 0.0, energy = 0.0;
+        int j;
+
+        buf = (double *) calloc(nfft, sizeof(double));
+        if (buf == NULL) {
+            #pragma omp critical (matched_filter_failed)
+            failed = 1;
+            continue;
+        }
+        for (j = 0; j < tlen; j++) {
+            mean += tr[j];
+        }
+        mean /= tlen;
+        for (j = 0; j < tlen; j++) {
+            buf[j] = tr[j] - mean;
+            energy += buf[j] * buf[j];
+        }
+        tnorm[i] = sqrt(energy);
+        rfft_forward(plan, buf, spec);
+        for (j = 0; j <= nfft / 2; j++) {
+            spec[2 * j + 1] = -spec[2 * j + 1];
+        }
+        free(buf);
+    }
+    if (failed) {
+        goto cleanup;
+    }
+    for (t = 0; t < ntmpl; t++) {
+        for (i = 0; i < nchan; i++) {
+            if (tnorm[t * nchan + i] > 0.0) {
+                nused[t]++;
+            }
+        }
+    }
+
+    #pragma omp parallel num_threads(threads) if(threads > 1)
+    {
+        double *buf = (double *) malloc(nspec * sizeof(double));
+        double *seg = (double *) malloc(nfft * sizeof(double));
+        double *acc = (double *) malloc(step * sizeof(double));
+        int s, c, k, j, tp, nvalid;
+
+        if (buf == NULL || seg == NULL || acc == NULL) {
+            #pragma omp critical (matched_filter_failed)
+            failed = 1;
+        }
+        #pragma omp barrier
+        for (s = 0; s < nout && !failed; s += step) {
+            nvalid = nout - s < step ? nout - s : step;
+
+            /* spectra of the data block and normalization of all windows */
+            #pragma omp for schedule(static)
+            for (c = 0; c < nchan; c++) {
+                const double *x = data + (size_t) c * ndat;
+                double *den = inv_den + (size_t) c * step;
+                double ref = 0.0, s1 = 0.0, s2 = 0.0, s2max = 0.0;
+                double var, vin, vout;
+
+                /* remove the offset of the block to keep the sums small */
+                for (j = 0; j < tlen; j++) {
+                    ref += x[s + j];
+                }
+                ref /= tlen;
+                for (j = 0; j < nfft; j++) {
+                    seg[j] = s + j < ndat ? x[s + j] - ref : 0.0;
+                }
+                rfft_forward(plan, seg, dspec + (size_t) c * nspec);
+                for (k = 0; k < nvalid; k++) {
+                    if (k % tlen == 0) {
+                        s1 = s2 = 0.0;
+                        for (j = 0; j < tlen; j++) {
+                            s1 += seg[k + j];
+                            s2 += seg[k + j] * seg[k + j];
+                        }
+                        s2max = s2;
+                    }
+                    else {
+                        vin = seg[k + tlen - 1];
+                        vout = seg[k - 1];
+                        s1 += vin - vout;
+                        s2 += vin * vin - vout * vout;
+                        if (s2 > s2max) {
+                            s2max = s2;
+                        }
+                    }
+                    var = s2 - s1 * s1 / tlen;
+                    /* zero variance or only rounding errors left over */
+                    den[k] = var > 1e-13 * s2max ? 1.0 / sqrt(var) : 0.0;
+                }
+            }
+
+            /* correlate and stack all channels of every template */
+            #pragma omp for schedule(dynamic)
+            for (tp = 0; tp < ntmpl; tp++) {
+                mf_run *run = runs + tp;
+                double value;
+
+                memset(acc, 0, nvalid * sizeof(double));
+                for (c = 0; c < nchan; c++) {
+                    const double *ts = tspec + ((size_t) tp * nchan + c) * nspec;
+                    const double *ds = dspec + (size_t) c * nspec;
+                    const double *den = inv_den + (size_t) c * step;
+                    double norm = tnorm[tp * nchan + c];
+
+                    if (norm <= 0.0) {
+                        continue;
+                    }
+                    for (j = 0; j <= nfft / 2; j++) {
+                        buf[2 * j] = ds[2 * j] * ts[2 * j] -
+                                     ds[2 * j + 1] * ts[2 * j + 1];
+                        buf[2 * j + 1] = ds[2 * j] * ts[2 * j + 1] +
+                                         ds[2 * j + 1] * ts[2 * j];
+                    }
+                    rfft_inverse(plan, buf, seg);
+                    norm = 1.0 / norm;
+                    for (k = 0; k < nvalid; k++) {
+                        acc[k] += seg[k] * den[k] * norm;
+                    }
+                }
+                for (k = 0; k < nvalid; k++) {
+                    value = nused[tp] ? acc[k] / nused[tp] : 0.0;
+                    if (stack) {
+                        stack[(size_t) tp * nout + s + k] = value;
+                    }
+                    if (value >= threshold) {
+                        if (!run->active) {
+                            run->active = 1;
+                            run->index = s + k;
+                            run->cc = value;
+                        }
+                        else if (value > run->cc) {
+                            run->index = s + k;
+                            run->cc = value;
+                        }
+                    }
+                    else if (run->active) {
+                        if (!mf_emit(&found, tp, run->index, run->cc)) {
+                            #pragma omp critical (matched_filter_failed)
+                            failed = 1;
+                        }
+                        run->active = 0;
+                    }
+                }
+            }
+        }
+        free(buf);
+        free(seg);
+        free(acc);
+    }
+    if (failed) {
+        goto cleanup;
+    }
+    for (t = 0; t < ntmpl; t++) {
+        if (runs[t].active &&
+                !mf_emit(&found, t, runs[t].index, runs[t].cc)) {
+            failed = 1;
+            goto cleanup;
+        }
+    }
+    if (found.count > 0) {
+        detections = (mf_detection *) allocate_detections(found.count);
+        if (detections == NULL) {
+            failed = 1;
+            goto cleanup;
+        }
+        memcpy(detections, found.items,
+               (size_t) found.count * sizeof(mf_detection));
+    }
+
+cleanup:
+    rfft_plan_destroy(plan);
+    free(tspec);
+    free(tnorm);
+    free(dspec);
+    free(inv_den);
+    free(nused);
+    free(runs);
+    free(found.items);
+    return failed ? -1 : found.count;
+}
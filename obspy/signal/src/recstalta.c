@@ -7,6 +7,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 void recstalta(double *a, double *charfct, int ndat, int nsta, int nlta) {
     int i;
@@ -25,3 +26,169 @@ void recstalta(double *a, double *charfct, int ndat, int nsta, int nlta) {
 
     return;
 }
+
+
+/* Sample types accepted by recstalta_trigger */
+#define RECSTALTA_FLOAT32 0
+#define RECSTALTA_FLOAT64 1
+#define RECSTALTA_INT32   2
+
+/* State of the trigger detection, same logic as trigger_onset() in
+ * obspy/signal/trigger.py but evaluated sample by sample */
+typedef struct _triggerS {
+    double thres1;
+    double thres2;
+    long long max_len;
+    int max_len_delete;
+    int above1;                 /* previous sample above thres1 */
+    int above2;                 /* previous sample above thres2 */
+    int active;                 /* trigger is on */
+    int deleting;               /* too long trigger waits for its end */
+    long long on;
+    long long *triggers;        /* on and off pairs found so far */
+    int capacity;
+    int count;
+    int failed;                 /* growing the buffer failed */
+} triggerS;
+
+static void trigger_emit(triggerS *t, long long on, long long off)
+{
+    if (t->count == t->capacity) {
+        int capacity = t->capacity ? 2 * t->capacity : 64;
+        long long *triggers = (long long *) realloc(
+            t->triggers, (size_t) capacity * 2 * sizeof(long long));
+        if (triggers == NULL) {
+            t->failed = 1;
+            return;
+        }
+        t->triggers = triggers;
+        t->capacity = capacity;
+    }
+    t->triggers[2 * t->count] = on;
+    t->triggers[2 * t->count + 1] = off;
+    t->count++;
+}
+
+/* called once the characteristic function fell below thres2 after sample i */
+static void trigger_off(triggerS *t, long long i)
+{
+    if (t->active) {
+        trigger_emit(t, t->on, i);
+        t->active = 0;
+    }
+    t->deleting = 0;
+}
+
+static void trigger_sample(triggerS *t, long long i, double cf)
+{
+    int above1 = cf > t->thres1;
+    int above2 = cf > t->thres2;
+
+    if (t->above2 && !above2) {
+        trigger_off(t, i - 1);
+    }
+    if (t->active && i - t->on > t->max_len) {
+        if (t->max_len_delete) {
+            t->deleting = 1;
+        }
+        else {
+            trigger_emit(t, t->on, t->on + t->max_len);
+        }
+        t->active = 0;
+    }
+    if (above1 && !t->above1 && !t->active && !t->deleting) {
+        t->active = 1;
+        t->on = i;
+    }
+    t->above1 = above1;
+    t->above2 = above2;
+}
+
+#define RECSTALTA_LOOP(TYPE) \
+    { \
+        const TYPE *data = (const TYPE *) a; \
+        for (i = 1; i < ndat; i++) { \
+            x = (double) data[i]; \
+            sta = csta * (x * x) + (1 - csta) * sta; \
+            lta = clta * (x * x) + (1 - clta) * lta; \
+            cf = (nlta < ndat && i < nlta) ? 0.0 : sta / lta; \
+            if (charfct) { \
+                charfct[i] = cf; \
+            } \
+            trigger_sample(&t, i, cf); \
+        } \
+    }
+
+/**
+   Recursive STA/LTA with trigger detection in a single pass over the data.
+   Accepts float32, float64 and int32 samples. The characteristic function is
+   only written if charfct is not NULL and is identical to the one of
+   recstalta(). The triggers are collected in a buffer that grows as needed.
+   Once all are found, allocate_triggers is called with their number and has
+   to return the address of an array of as many on and off sample pairs of
+   long long, the triggers are copied there and their number is returned.
+   allocate_triggers may be NULL if only the characteristic function is
+   needed. Returns -1 for an unknown sample type and -2 if memory allocation
+   failed.
+**/
+int recstalta_trigger(const void *a, int dtype, int ndat, int nsta, int nlta,
+                      double *charfct, double thres1, double thres2,
+                      long long max_len, int max_len_delete,
+                      long long (*allocate_triggers) (int))
+{
+    int i;
+    double csta = 1./((double)nsta);
+    double clta = 1./((double)nlta);
+    double sta = 0.0;
+    double lta = 0.0;
+    double x, cf;
+    long long *triggers;
+    triggerS t = {0};
+
+    t.thres1 = thres1;
+    t.thres2 = thres2;
+    t.max_len = max_len;
+    t.max_len_delete = max_len_delete;
+
+    if (ndat < 1) {
+        return 0;
+    }
+    /* the first sample is not part of the recursion */
+    if (charfct) {
+        charfct[0] = 0.0;
+    }
+    trigger_sample(&t, 0, 0.0);
+
+    switch (dtype) {
+        case RECSTALTA_FLOAT32:
+            RECSTALTA_LOOP(float)
+            break;
+        case RECSTALTA_FLOAT64:
+            RECSTALTA_LOOP(double)
+            break;
+        case RECSTALTA_INT32:
+            RECSTALTA_LOOP(int)
+            break;
+        default:
+            free(t.triggers);
+            return -1;
+    }
+    if (t.above2) {
+        trigger_off(&t, ndat - 1);
+    }
+    if (t.failed) {
+        free(t.triggers);
+        return -2;
+    }
+    if (t.count > 0 && allocate_triggers) {
+        triggers = (long long *) allocate_triggers(t.count);
+        if (triggers == NULL) {
+            free(t.triggers);
+            return -2;
+        }
+        memcpy(triggers, t.triggers,
+               (size_t) t.count * 2 * sizeof(long long));
+    }
+    free(t.triggers);
+    return t.count;
+}
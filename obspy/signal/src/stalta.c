@@ -6,6 +6,7 @@
 #---------------------------------------------------------------------*/
 
 #include <math.h>
+#include <stddef.h>
 
 #define OPTIMIZED_VERSION
 
@@ -15,42 +16,60 @@ typedef struct _headS {
     int Nlta;
 } headS;
 
-int stalta(const headS *head, const double *data, double *charfct)
+#ifdef OPTIMIZED_VERSION
+/* Every square is added to the running sums once and subtracted once, so
+ * their rounding errors grow with the number of updates and with the
+ * magnitude of the squares, e.g. of a large event that left the windows.
+ * The sums are recomputed every STALTA_RESYNC LTA windows to bound this
+ * drift, which costs about 1 / STALTA_RESYNC operations per sample. */
+#define STALTA_RESYNC 16
+
+/* Sum of the squares of data[first] ... data[last - 1]. */
+static double window_sum(const double *data, int first, int last)
 {
+    double sum = 0.;
     int i;
-    double sta = 0.;
-    double lta;
-#ifdef OPTIMIZED_VERSION
-    double buf;
-    const double frac = (double) head->Nlta / (double) head->Nsta;
-#else
-    int j;
-#endif
 
-    if (head->N < head->Nlta) {
-        return 1;
+    for (i = first; i < last; ++i) {
+        sum += data[i] * data[i];
     }
+    return sum;
+}
+#endif
 
+static void stalta_trace(const headS *head, const double *data, double *charfct)
+{
+    int i;
 #ifdef OPTIMIZED_VERSION
-    for (i = 0; i < head->Nsta; ++i) {
-        sta += pow(data[i], 2);
-        charfct[i] = 0.;
-    }
-    lta = sta;
-    for (i = head->Nsta; i < head->Nlta; ++i) {
-        buf = pow(data[i], 2);
-        lta += buf;
-        sta += buf - pow(data[i - head->Nsta], 2);
+    const int nsta = head->Nsta;
+    const int nlta = head->Nlta;
+    const double frac = (double) nlta / (double) nsta;
+    double sta, lta, sq, x;
+    int end;
+
+    for (i = 0; i < nlta - 1; ++i) {
         charfct[i] = 0.;
     }
-    charfct[head->Nlta - 1] = sta / lta * frac;
-    for (i = head->Nlta; i < head->N; ++i) {
-        buf = pow(data[i], 2);
-        sta += buf - pow(data[i - head->Nsta], 2);
-        lta += buf - pow(data[i - head->Nlta], 2);
+    for (i = nlta - 1; i < head->N; i = end) {
+        /* exact sums of the windows ending at sample i */
+        sta = window_sum(data, i + 1 - nsta, i + 1);
+        lta = window_sum(data, i + 1 - nlta, i + 1);
         charfct[i] = sta / lta * frac;
+        end = head->N - i > STALTA_RESYNC * nlta ?
+            i + STALTA_RESYNC * nlta : head->N;
+        for (++i; i < end; ++i) {
+            sq = data[i] * data[i];
+            x = data[i - nsta];
+            sta += sq - x * x;
+            x = data[i - nlta];
+            lta += sq - x * x;
+            charfct[i] = sta / lta * frac;
+        }
     }
 #else
+    int j;
+    double sta, lta;
+
     for (i = 0; i < head->Nlta - 1; ++i) {
         charfct[i] = 0.0;
     }
@@ -69,6 +88,34 @@ int stalta(const headS *head, const double *data, double *charfct)
         charfct[i] = sta / lta;
     }
 #endif
+}
+
+int stalta(const headS *head, const double *data, double *charfct)
+{
+    if (head->N < head->Nlta) {
+        return 1;
+    }
+    stalta_trace(head, data, charfct);
+    return 0;
+}
 
+/* Classic STA/LTA of ntr traces of head->N samples each, stored row by row.
+ * The traces are distributed over several threads if compiled with OpenMP. */
+int stalta_batch(const headS *head, const double *data, double *charfct,
+                 int ntr, int threads)
+{
+    int i;
+
+    if (head->N < head->Nlta) {
+        return 1;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    #pragma omp parallel for num_threads(threads) schedule(dynamic) if(threads > 1 && ntr > 1)
+    for (i = 0; i < ntr; i++) {
+        size_t offset = (size_t) i * head->N;
+        stalta_trace(head, data + offset, charfct + offset);
+    }
     return 0;
 }
@@ -12,9 +12,41 @@
 #include <memory.h>
 #include <float.h>
 
+/* Unnormalized cross correlation of tra1 and tra2 for the lags -eff_lag to
+ * eff_lag. corp[eff_lag + k] is the sum of tra1[n + k] * tra2[n] over all
+ * n with 0 <= n + k < ndat1 and 0 <= n < min(ndat1, ndat2). */
+void X_corr_lags(const float *tra1, const float *tra2, double *corp, int eff_lag, int ndat1, int ndat2)
+{
+    int a, b, n;
+    int ndat = ndat1 < ndat2 ? ndat1 : ndat2;
+
+    for (a=0;a<(2*eff_lag+1);a++)
+    {
+        corp[a]= 0;
+        if((eff_lag-a)>= 0)
+        {
+            n = ndat - (eff_lag-a);
+            for (b=0;b<n;b++)
+            {
+                corp[a] += tra2[b+eff_lag-a] * tra1[b];
+            }  /* for b to .. */
+        }else{
+            n = ndat1 - (a-eff_lag);
+            if (n > ndat2)
+            {
+                n = ndat2;
+            }
+            for (b=0;b<n;b++)
+            {
+                corp[a] += tra1[b+a-eff_lag] * tra2[b];
+            }  /* for b to .. */
+        }
+    } /* for a to .. */
+}
+
 int X_corr(float *tr1, float *tr2, double *corp, int param, int ndat1, int ndat2, int *shift, double* coe_p)
 {
-    int a, b;
+    int a;
     int len;
     float *tra1;
     float *tra2;
@@ -57,7 +89,8 @@ int X_corr(float *tr1, float *tr2, double *corp, int param, int ndat1, int ndat2
     }	 
     if (len <= (eff_lag/2))
     {
-        printf("Warning!  window is too small! \n");
+        /* window is too small */
+        memset(corp, 0, (2*eff_lag+1) * sizeof(double));
     }
     else
     {
@@ -121,21 +154,9 @@ int X_corr(float *tr1, float *tr2, double *corp, int param, int ndat1, int ndat2
 
         if(flag == 0)
         {
-            for (a=0;a<(2*eff_lag+1);a++) /* <------------- */
+            X_corr_lags(tra1, tra2, corp, eff_lag, ndat1, ndat2);
+            for (a=0;a<(2*eff_lag+1);a++)
             {
-                corp[a]= 0;
-                if((eff_lag-a)>= 0)
-                {
-                    for (b=0;b<(ndat1 - (eff_lag-a));b++)
-                    {
-                        corp[a] += tra2[b+eff_lag-a] * tra1[b];
-                    }  /* for b to .. */
-                }else{
-                    for (b=0;b<(ndat1 - (a-eff_lag));b++)
-                    {
-                        corp[a] += tra1[b+a-eff_lag] * tra2[b];
-                    }  /* for b to .. */
-                }
                 if (fabs(corp[a]) > cmax)
                 {
                     cmax = fabs(corp[a]);
@@ -143,14 +164,17 @@ int X_corr(float *tr1, float *tr2, double *corp, int param, int ndat1, int ndat2
                     max = a;
                 }
                 lmax = imax;
-            } /* for a to .. */
+            }
             sum1 = sum2 = 0.0;
 
             /* normalize xcorr function */
             for(a=0; a<ndat1;a++)
             {
                 sum1 += (*(tra1+a))*(*(tra1+a));
-                sum2 += (*(tra2+a))*(*(tra2+a));
+                if (a < ndat2)
+                {
+                    sum2 += (*(tra2+a))*(*(tra2+a));
+                }
             }
             sum1 = sqrt(sum1);
             sum2 = sqrt(sum2);
@@ -164,6 +188,7 @@ int X_corr(float *tr1, float *tr2, double *corp, int param, int ndat1, int ndat2
         }
         else
         {
+            memset(corp, 0, (2*eff_lag+1) * sizeof(double));
             *shift = 0;
             *coe_p = 0.0;
         }
@@ -7,11 +7,16 @@ from __future__ import (absolute_import, division, print_function,
                         unicode_literals)
 from future.builtins import *  # NOQA
 
+import os
 import unittest
 
 import numpy as np
 
-from obspy.signal.array_analysis import array_rotation_strain, get_geometry
+from obspy.core.util.misc import TemporaryWorkingDirectory
+from obspy.signal.array_analysis import (SteeringVectors,
+                                         array_rotation_strain, get_geometry,
+                                         get_timeshift)
+from obspy.signal.headers import clibsignal
 
 
 class ArrayTestCase(unittest.TestCase):
@@ -191,6 +196,131 @@ class ArrayTestCase(unittest.TestCase):
         np.testing.assert_almost_equal(la[:, 1].sum(), 0., decimal=8)
         np.testing.assert_almost_equal(la[:, 2].sum(), 0., decimal=8)
 
+    def test_steering_vectors(self):
+        """
+        test the steering vectors and their cache in array_analysis.py
+        """
+        geometry = get_geometry(self.array_coords, coordsys='xy')
+        table = get_timeshift(geometry, -0.3, -0.2, 0.05, 13, 11)
+        nlow, nf, deltaf = 3, 70, 0.125
+        steer = SteeringVectors(table, nlow, nf, deltaf, threads=2)
+        self.assertEqual(steer.steer.shape, (nf, 2, 7, 13 * 11))
+        # the recurrence over frequencies matches cos and sin of the phases
+        freqs = 2 * np.pi * (nlow + np.arange(nf)) * deltaf
+        phase = freqs[:, None, None] * table.reshape(7, -1)[None, :, :]
+        np.testing.assert_allclose(steer.steer[:, 0], np.cos(phase),
+                                   rtol=0, atol=1e-12)
+        np.testing.assert_allclose(steer.steer[:, 1], -np.sin(phase),
+                                   rtol=0, atol=1e-12)
+        # kept in memory and on disk
+        SteeringVectors.clear_cache()
+        cached = SteeringVectors.get(table, nlow, nf, deltaf)
+        self.assertIs(SteeringVectors.get(table, nlow, nf, deltaf), cached)
+        self.assertIsNot(SteeringVectors.get(table, nlow, nf + 1, deltaf),
+                         cached)
+        with TemporaryWorkingDirectory():
+            SteeringVectors.clear_cache()
+            SteeringVectors.get(table, nlow, nf, deltaf, cache_dir='steer')
+            key = SteeringVectors.key(table, nlow, nf, deltaf)
+            filename = os.path.join('steer', 'steer_%s.npz' % key)
+            self.assertEqual(os.listdir('steer'), ['steer_%s.npz' % key])
+            SteeringVectors.clear_cache()
+            loaded = SteeringVectors.get(table, nlow, nf, deltaf,
+                                         cache_dir='steer')
+            np.testing.assert_array_equal(loaded.steer, steer.steer)
+            self.assertEqual((loaded.nlow, loaded.nf, loaded.deltaf),
+                             (nlow, nf, deltaf))
+            # truncated files are computed again and replaced
+            with open(filename, 'rb') as fh:
+                data = fh.read()
+            with open(filename, 'wb') as fh:
+                fh.write(data[:len(data) // 2])
+            SteeringVectors.clear_cache()
+            loaded = SteeringVectors.get(table, nlow, nf, deltaf,
+                                         cache_dir='steer')
+            np.testing.assert_array_equal(loaded.steer, steer.steer)
+            self.assertEqual(os.path.getsize(filename), len(data))
+        # the memory cache is bounded by the size of the steering vectors
+        cache_bytes = SteeringVectors.cache_bytes
+        try:
+            SteeringVectors.clear_cache()
+            SteeringVectors.cache_bytes = steer.steer.nbytes
+            cached = SteeringVectors.get(table, nlow, nf, deltaf)
+            self.assertIs(SteeringVectors.get(table, nlow, nf, deltaf),
+                          cached)
+            SteeringVectors.get(table, nlow, nf, 2 * deltaf)
+            self.assertIsNot(SteeringVectors.get(table, nlow, nf, deltaf),
+                             cached)
+            SteeringVectors.cache_bytes = 0
+            SteeringVectors.get(table, nlow, nf, deltaf)
+            self.assertEqual(len(SteeringVectors._cache), 0)
+        finally:
+            SteeringVectors.cache_bytes = cache_bytes
+            SteeringVectors.clear_cache()
+
+    def test_generalized_beamformer(self):
+        """
+        test the tiled and threaded beamformer against numpy
+        """
+        np.random.seed(4711)
+        geometry = get_geometry(self.array_coords, coordsys='xy')
+        # the grid points are not a multiple of the tile size
+        grdpts_x, grdpts_y = 13, 11
+        table = get_timeshift(geometry, -0.3, -0.2, 0.05, grdpts_x, grdpts_y)
+        nlow, nf, deltaf, nstat = 3, 9, 0.125, 7
+        steer = SteeringVectors(table, nlow, nf, deltaf).steer
+        x = (np.random.randn(nf, nstat, nstat) +
+             1j * np.random.randn(nf, nstat, nstat))
+        R = np.ascontiguousarray(
+            np.einsum('nik,njk->nij', x, x.conj()), dtype=np.complex128)
+        e = steer[:, 0] + 1j * steer[:, 1]
+        beam = np.abs(np.einsum('nig,nij,njg->ng', e.conj(), R, e).real)
+        dpow = 3.5
+        for method in (0, 1):
+            power = beam if method == 0 else 1. / beam
+            for prewhiten in (0, 1):
+                if prewhiten:
+                    scale = power.max(axis=1)[:, None] * nf * nstat
+                else:
+                    scale = 1. if method == 1 else dpow
+                maps = []
+                for threads in (1, 4):
+                    relpow = np.zeros((grdpts_x, grdpts_y))
+                    abspow = np.zeros((grdpts_x, grdpts_y))
+                    errcode = clibsignal.generalizedBeamformer(
+                        relpow, abspow, steer, R, nstat, prewhiten, grdpts_x,
+                        grdpts_y, nf, dpow, method, threads)
+                    self.assertEqual(errcode, 0)
+                    maps.append((relpow, abspow))
+                np.testing.assert_allclose(
+                    maps[0][0].ravel(), (power / scale).sum(axis=0),
+                    rtol=1e-10)
+                np.testing.assert_allclose(
+                    maps[0][1].ravel(), power.sum(axis=0), rtol=1e-10)
+                np.testing.assert_array_equal(maps[0][0], maps[1][0])
+                np.testing.assert_array_equal(maps[0][1], maps[1][1])
+
+    def test_hermitian_pseudo_inverse(self):
+        """
+        test the pseudo inverse used for capon against numpy.linalg.pinv
+        """
+        np.random.seed(815)
+        n = 7
+        matrices = []
+        # full rank and rank deficient cross spectral matrices
+        for rank in (n, n - 3, 1):
+            x = np.random.randn(n, rank) + 1j * np.random.randn(n, rank)
+            matrices.append(np.dot(x, x.conj().T))
+        # indefinite hermitian matrix
+        x = np.random.randn(n, n) + 1j * np.random.randn(n, n)
+        matrices.append(x + x.conj().T)
+        for a in matrices:
+            pinv = np.ascontiguousarray(a, dtype=np.complex128)
+            self.assertEqual(clibsignal.hermitianPseudoInverse(pinv, n), 0)
+            expected = np.linalg.pinv(a, rcond=1e-6)
+            np.testing.assert_allclose(pinv, expected, rtol=0,
+                                       atol=1e-10 * abs(expected).max())
+
 
 def suite():
     return unittest.makeSuite(ArrayTestCase, 'test')
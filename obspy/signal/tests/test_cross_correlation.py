@@ -9,9 +9,12 @@ from future.builtins import *  # NOQA
 import os
 import unittest
 
+import numpy as np
+
 from obspy import UTCDateTime, read
 from obspy.core.util.testing import ImageComparison
-from obspy.signal.cross_correlation import xcorr_pick_correction
+from obspy.signal.cross_correlation import (matched_filter,
+                                             xcorr_pick_correction)
 
 
 class CrossCorrelationTestCase(unittest.TestCase):
@@ -73,6 +76,52 @@ class CrossCorrelationTestCase(unittest.TestCase):
             dt, coeff = xcorr_pick_correction(
                 t1, tr1, t2, tr2, 0.05, 0.2, 0.1, plot=True, filename=ic.name)
 
+    def test_matched_filter(self):
+        """
+        Compare the matched filter against a direct computation of the
+        averaged correlation coefficients and check the detections.
+        """
+        np.random.seed(815)
+        nchan, ndat, tlen = 3, 3000, 50
+        data = np.random.randn(nchan, ndat) * [[1.0], [100.0], [1e-3]]
+        # offsets and a flat stretch must not matter
+        data += [[1e4], [-3.0], [0.0]]
+        data[0, 1000:1100] = data[0, 999]
+        templates = np.array([data[:, 500:500 + tlen],
+                              data[:, 2000:2000 + tlen] * 2.0,
+                              np.random.randn(nchan, tlen)])
+        # channel without data in the third template
+        templates[2, 1] = 0.0
+        expected = np.zeros((len(templates), ndat - tlen + 1))
+        for i, template in enumerate(templates):
+            used = 0
+            for channel, tmpl in zip(data, template):
+                if not np.any(tmpl - tmpl.mean()):
+                    continue
+                used += 1
+                tmpl = tmpl - tmpl.mean()
+                for k in range(ndat - tlen + 1):
+                    window = channel[k:k + tlen] - channel[k:k + tlen].mean()
+                    norm = np.sqrt(np.sum(window ** 2) * np.sum(tmpl ** 2))
+                    if norm > 1e-10:
+                        expected[i, k] += np.sum(window * tmpl) / norm
+            expected[i] /= used
+        for threads in (1, 2):
+            detections, cc = matched_filter(data, templates, 0.8,
+                                            threads=threads, return_cc=True)
+            np.testing.assert_allclose(cc, expected, atol=1e-8)
+            self.assertEqual(detections['template_id'].tolist(), [0, 1])
+            self.assertEqual(detections['index'].tolist(), [500, 2000])
+            np.testing.assert_allclose(detections['cc'], 1.0)
+        # many detections with a low threshold
+        detections = matched_filter(data, templates, 0.0)
+        self.assertGreater(len(detections), 256)
+        self.assertTrue(np.all(np.diff(detections['index']) >= 0))
+        self.assertRaises(ValueError, matched_filter, data[:2], templates,
+                          0.8)
+        self.assertRaises(ValueError, matched_filter, data[:, :10],
+                          templates, 0.8)
+
 
 def suite():
     return unittest.makeSuite(CrossCorrelationTestCase, 'test')
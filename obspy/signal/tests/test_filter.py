@@ -17,7 +17,8 @@ import scipy.signal as sg
 
 from obspy import read
 from obspy.signal.filter import (bandpass, highpass, lowpass, envelope,
-                                 lowpass_cheby_2)
+                                 lowpass_cheby_2, bworth_batch, bandstop,
+                                 StreamingFilter)
 
 
 class FilterTestCase(unittest.TestCase):
@@ -281,6 +282,95 @@ class FilterTestCase(unittest.TestCase):
                     np.testing.assert_allclose(got, expected, rtol=1e-3,
                                                atol=0.9)
 
+    def test_bworth_batch_vs_pitsa(self):
+        """
+        Test the batch Butterworth filters against PITSA. They use the same
+        recursive filters so the number of sections is the same as in PITSA.
+        Every trace of the batch has to be filtered independently.
+        """
+        file = os.path.join(self.path, 'rjob_20051006.gz')
+        with gzip.open(file) as f:
+            data = np.loadtxt(f)
+        samp_rate = 200.0
+        scales = np.array([1.0, -2.0, 0.5, 1e3, 1.0, 3.0])
+        batch = data[np.newaxis, :] * scales[:, np.newaxis]
+        for name, kwargs in (
+                ('bandpass', {'freqmin': 5, 'freqmax': 10, 'sections': 2}),
+                ('bandpassZPHSH', {'freqmin': 5, 'freqmax': 10,
+                                   'sections': 1, 'zerophase': True}),
+                ('lowpass', {'freqmax': 5, 'sections': 2}),
+                ('lowpassZPHSH', {'freqmax': 5, 'sections': 1,
+                                  'zerophase': True}),
+                ('highpass', {'freqmin': 10, 'sections': 2}),
+                ('highpassZPHSH', {'freqmin': 10, 'sections': 1,
+                                   'zerophase': True})):
+            filename = os.path.join(self.path,
+                                    'rjob_20051006_%s.gz' % name)
+            with gzip.open(filename) as f:
+                data_pitsa = np.loadtxt(f)
+            for threads in (1, 4):
+                datcorr = bworth_batch(batch, samp_rate, threads=threads,
+                                       **kwargs)
+                self.assertEqual(datcorr.dtype, np.float32)
+                self.assertEqual(datcorr.shape, batch.shape)
+                for scale, trace in zip(scales, datcorr):
+                    rms = np.sqrt(np.sum((trace - scale * data_pitsa) ** 2) /
+                                  np.sum((scale * data_pitsa) ** 2))
+                    self.assertLess(rms, 1.0e-05)
+        # the input is not modified and a single trace works as well
+        single = bworth_batch(data, samp_rate, freqmin=5, freqmax=10)
+        self.assertEqual(single.shape, (1, len(data)))
+        self.assertEqual(batch[0, 0], data[0])
+        # invalid arguments
+        self.assertRaises(ValueError, bworth_batch, data, samp_rate)
+        self.assertRaises(ValueError, bworth_batch, data, samp_rate,
+                          freqmin=10, freqmax=5)
+        self.assertRaises(ValueError, bworth_batch, data, samp_rate,
+                          freqmin=5, sections=11)
+        self.assertRaises(ValueError, bworth_batch, data, samp_rate,
+                          freqmax=100)
+
+    def test_streaming_filter(self):
+        """
+        Filtering chunks with the streaming filter has to give the same
+        result as filtering all data at once.
+        """
+        file = os.path.join(self.path, 'rjob_20051006.gz')
+        with gzip.open(file) as f:
+            data = np.loadtxt(f)
+        df = 200.0
+        for type, func, options in (
+                ('bandpass', bandpass, {'freqmin': 5, 'freqmax': 10}),
+                ('bandstop', bandstop, {'freqmin': 5, 'freqmax': 10}),
+                ('lowpass', lowpass, {'freq': 5}),
+                ('highpass', highpass, {'freq': 10})):
+            expected = func(data, df=df, corners=4, **options)
+            filt = StreamingFilter(type, df, corners=4, **options)
+            chunks = [filt(chunk)
+                      for chunk in np.array_split(data, [1, 100, 100, 2047])]
+            np.testing.assert_allclose(np.concatenate(chunks), expected,
+                                       rtol=1e-10, atol=1e-10)
+            # after a reset the filter starts from scratch
+            filt.reset()
+            np.testing.assert_allclose(filt(data), expected,
+                                       rtol=1e-10, atol=1e-10)
+        # several channels at once, every channel has its own state
+        batch = data[np.newaxis, :] * np.array([[1.0], [-2.0], [1e3]])
+        expected = bandpass(batch, 5, 10, df)
+        for threads in (1, 2):
+            filt = StreamingFilter('bandpass', df, threads=threads,
+                                   freqmin=5, freqmax=10)
+            got = np.hstack([filt(batch[:, :500]), filt(batch[:, :0]),
+                             filt(batch[:, 500:])])
+            np.testing.assert_allclose(got, expected, rtol=1e-10,
+                                       atol=1e-10)
+            # number of channels must not change
+            self.assertRaises(ValueError, filt, batch[:2, :10])
+        # the input is not modified
+        self.assertEqual(batch[1, 0], -2.0 * data[0])
+        self.assertRaises(ValueError, StreamingFilter, 'notch', df,
+                          freq=5)
+
 
 def suite():
     return unittest.makeSuite(FilterTestCase, 'test')
@@ -126,6 +126,34 @@ class InterpolationTestCase(unittest.TestCase):
         np.testing.assert_allclose(data[220:620], output[200:600], atol=1E-4,
                                    rtol=1E-4)
 
+    def test_lanczos_interpolation_windows(self):
+        """
+        Tests all windows for rational sampling rate factors, which use
+        precomputed polyphase filters, and for irrational ones against a
+        direct evaluation of the kernel.
+        """
+        np.random.seed(42)
+        data = np.random.randn(300)
+        a = 8
+        for window in ("lanczos", "hanning", "blackman"):
+            for new_dt, new_start in ((0.4, 0.0), (2.5, 3.3),
+                                      (np.sqrt(0.2), 1.7)):
+                new_npts = int((len(data) - 1 - new_start) / new_dt)
+                output = lanczos_interpolation(
+                    data, old_start=0.0, old_dt=1.0, new_start=new_start,
+                    new_dt=new_dt, new_npts=new_npts, a=a, window=window)
+                x = new_start + np.arange(new_npts) * new_dt
+                # all samples within a samples on either side
+                idx = np.floor(x)[:, None] + np.arange(-a + 1, a + 1)
+                valid = (idx >= 0) & (idx < len(data))
+                kernel = calculate_lanczos_kernel(
+                    (x[:, None] - idx).ravel(), a, window)["full_kernel"]
+                expected = (kernel.reshape(idx.shape) *
+                            data[np.where(valid, idx, 0).astype(int)] *
+                            valid).sum(axis=1)
+                np.testing.assert_allclose(output, expected, rtol=0,
+                                           atol=1E-11)
+
     def test_plot_lanczos_window(self):
         """
         Tests the plot_lanczos_window function.
@@ -13,6 +13,7 @@ import gzip
 import io
 import os
 import unittest
+from multiprocessing.pool import ThreadPool
 
 import numpy as np
 
@@ -23,7 +24,7 @@ from obspy.io.sac import attach_paz
 from obspy.signal.headers import clibevresp
 from obspy.signal.invsim import (
     cosine_taper, estimate_magnitude, evalresp, simulate_seismometer,
-    evalresp_for_frequencies)
+    evalresp_for_frequencies, clear_resp_cache, parse_resp)
 
 
 # Seismometers defined as in Pitsa with one zero less. The corrected
@@ -467,6 +468,64 @@ class InvSimTestCase(unittest.TestCase):
             self.assertRaises(ValueError, evalresp, **kwargs)
         self.assertIn(b"no response found for", out.stderr.lower())
 
+    def test_evalresp_response_cache(self):
+        """
+        Parsed responses are cached and can be evaluated on several threads.
+        """
+        filename = os.path.join(self.path, "RESP.OB.AAA._.BH_")
+        date = UTCDateTime(2013, 1, 1)
+        freqs = np.linspace(0.0, 5.0, 513)
+        clear_resp_cache()
+        resp = parse_resp(filename, date, station="AAA", channel="BHE",
+                          network="OP", locid="")
+        self.assertEqual(resp.id, "OP.AAA..BHE")
+        self.assertTrue(resp.in_epoch(date))
+        self.assertIs(parse_resp(filename, date + 3600, station="AAA",
+                                 channel="BHE", network="OP", locid=""),
+                      resp)
+        # wildcards are cached for the epoch they resolved to as well
+        wild = parse_resp(filename, date, channel="BHE")
+        self.assertEqual(wild.id, "OP.AAA..BHE")
+        self.assertIs(parse_resp(filename, date + 86400, channel="BHE"),
+                      wild)
+        # same as evalresp's own evaluation
+        with CatchOutput():
+            expected = evalresp_for_frequencies(
+                0.1, freqs, filename, date, station="AAA", channel="BHE",
+                network="OP", locid="", debug=True)
+        np.testing.assert_array_equal(resp.evaluate(freqs), expected)
+
+        other = parse_resp(filename, date, station="AAA", channel="BHN",
+                           network="OP", locid="")
+        self.assertIsNot(other, resp)
+        pool = ThreadPool(4)
+        try:
+            results = pool.map(lambda r: r.evaluate(freqs, units="DIS"),
+                               [resp, other] * 8)
+        finally:
+            pool.close()
+        for i, h in enumerate(results):
+            np.testing.assert_array_equal(h, results[i % 2])
+        self.assertFalse(np.array_equal(results[0], results[1]))
+        clear_resp_cache()
+
+    def test_evalresp_many_frequencies(self):
+        """
+        FIR stages are evaluated by FFT for many equally spaced frequencies,
+        the result has to match evalresp's direct evaluation.
+        """
+        filename = os.path.join(self.path, "RESP.NZ.CRLZ.10.HHZ")
+        date = UTCDateTime(2003, 11, 1)
+        kwargs = {"station": "CRLZ", "channel": "HHZ", "network": "NZ",
+                  "locid": "10", "units": "DIS"}
+        freqs = np.linspace(0.0, 100.0, 20001)
+        with CatchOutput():
+            expected = evalresp_for_frequencies(0.005, freqs, filename, date,
+                                                debug=True, **kwargs)
+        got = evalresp_for_frequencies(0.005, freqs, filename, date, **kwargs)
+        np.testing.assert_allclose(got, expected, rtol=0,
+                                   atol=1e-12 * np.abs(expected).max())
+
     def test_evalresp_spline(self):
         """
         evr_spline was based on GPL plotutils, now replaced by LGPL spline
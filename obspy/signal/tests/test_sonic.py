@@ -22,7 +22,7 @@ class SonicTestCase(unittest.TestCase):
     Test fk analysis, main function is sonic() in array_analysis.py
     """
 
-    def array_processing(self, prewhiten, method):
+    def array_processing(self, prewhiten, method, **kwargs):
         np.random.seed(2348)
 
         geometry = np.array([[0.0, 0.0, 0.0],
@@ -88,7 +88,7 @@ class SonicTestCase(unittest.TestCase):
 
         args = (st, win_len, step_frac, sll_x, slm_x, sll_y, slm_y, sl_s,
                 semb_thres, vel_thres, frqlow, frqhigh, stime, etime)
-        kwargs = dict(prewhiten=prewhiten, coordsys='xy', verbose=False,
+        kwargs.update(prewhiten=prewhiten, coordsys='xy', verbose=False,
                       method=method)
         out = array_processing(*args, **kwargs)
         if False:  # 1 for debugging
@@ -149,6 +149,29 @@ class SonicTestCase(unittest.TestCase):
         # XXX relative tolerance should be lower!
         self.assertTrue(np.allclose(ref, out[:, 1:], rtol=4e-5))
 
+    def test_sonic_threads(self):
+        """
+        The results and power maps do not depend on the number of threads.
+        """
+        for method in (0, 1):
+            results = []
+            for threads in (1, 4):
+                maps = []
+
+                def store(relpow, abspow, offset):
+                    maps.append((relpow.copy(), abspow.copy(), offset))
+
+                out = self.array_processing(prewhiten=0, method=method,
+                                            threads=threads, store=store)
+                results.append((out, maps))
+            (out1, maps1), (out4, maps4) = results
+            np.testing.assert_array_equal(out1, out4)
+            self.assertEqual(len(maps1), len(maps4))
+            for (rel1, abs1, off1), (rel4, abs4, off4) in zip(maps1, maps4):
+                np.testing.assert_array_equal(rel1, rel4)
+                np.testing.assert_array_equal(abs1, abs4)
+                self.assertEqual(off1, off4)
+
     def test_get_spoint(self):
         stime = UTCDateTime(1970, 1, 1, 0, 0)
         etime = UTCDateTime(1970, 1, 1, 0, 0) + 10
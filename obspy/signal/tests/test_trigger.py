@@ -7,7 +7,9 @@ from __future__ import (absolute_import, division, print_function,
 from future.builtins import *  # NOQA
 
 import gzip
+import math
 import os
+import threading
 import unittest
 import warnings
 from ctypes import ArgumentError
@@ -17,7 +19,8 @@ import numpy as np
 from obspy import Stream, UTCDateTime, read
 from obspy.signal.trigger import (
     ar_pick, classic_sta_lta, classic_sta_lta_py, coincidence_trigger, pk_baer,
-    recursive_sta_lta, recursive_sta_lta_py, trigger_onset)
+    recursive_sta_lta, recursive_sta_lta_py, recursive_sta_lta_trigger,
+    trigger_onset)
 from obspy.signal.util import clibsignal
 
 
@@ -65,6 +68,36 @@ class TriggerTestCase(unittest.TestCase):
         self.assertRaises(ArgumentError, clibsignal.recstalta,
                           np.array([1], dtype=np.int32), charfct, ndat, 5, 10)
 
+    def test_rec_sta_lta_trigger(self):
+        """
+        Fused recursive STA/LTA and trigger detection has to give the same
+        triggers as trigger_onset() on the characteristic function, for all
+        supported sample types.
+        """
+        nsta, nlta = 5, 10
+        for dtype in (np.float64, np.float32, np.int32):
+            data = (self.data * 1000).astype(dtype)
+            cft = recursive_sta_lta(data, nsta, nlta)
+            np.testing.assert_array_equal(
+                cft, recursive_sta_lta(data.astype(np.float64), nsta, nlta))
+            for kwargs in ({}, {'max_len': 3}, {'max_len': 3,
+                                                'max_len_delete': True}):
+                expected = trigger_onset(cft, 1.5, 1.0, **kwargs)
+                # many more triggers than the initial buffer size
+                self.assertGreater(len(expected), 64)
+                got = recursive_sta_lta_trigger(data, nsta, nlta, 1.5, 1.0,
+                                                **kwargs)
+                self.assertEqual(got.dtype, np.int64)
+                np.testing.assert_array_equal(got, expected)
+                got, got_cft = recursive_sta_lta_trigger(
+                    data, nsta, nlta, 1.5, 1.0, return_charfct=True,
+                    **kwargs)
+                np.testing.assert_array_equal(got, expected)
+                np.testing.assert_array_equal(got_cft, cft)
+        # no triggers at all
+        got = recursive_sta_lta_trigger(self.data, nsta, nlta, 1e9, 1e9)
+        self.assertEqual(got.shape, (0, 2))
+
     def test_pk_baer(self):
         """
         Test pk_baer against implementation for UNESCO short course
@@ -98,6 +131,31 @@ class TriggerTestCase(unittest.TestCase):
         # self.assertAlmostEqual(stime, 31.2800006866)
         self.assertEqual(int(stime + 0.5), 31)
 
+    def test_ar_pick_in_threads(self):
+        """
+        ar_pick has to be usable from several threads at the same time.
+        """
+        data = []
+        for channel in ['z', 'n', 'e']:
+            file = os.path.join(self.path,
+                                'loc_RJOB20050801145719850.' + channel)
+            data.append(np.loadtxt(file, dtype=np.float32))
+        args = (200.0, 1.0, 20.0, 1.0, 0.1, 4.0, 1.0, 2, 8, 0.1, 0.2)
+        expected = ar_pick(data[0], data[1], data[2], *args)
+        results = []
+
+        def pick():
+            for _ in range(10):
+                results.append(ar_pick(data[0], data[1], data[2], *args))
+        threads = [threading.Thread(target=pick) for _ in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        self.assertEqual(len(results), 40)
+        for result in results:
+            self.assertEqual(result, expected)
+
     def test_trigger_onset(self):
         """
         Test trigger onset function
@@ -431,6 +489,32 @@ class TriggerTestCase(unittest.TestCase):
         ref = np.array([0.38012302, 0.37704431, 0.47674533, 0.67992292])
         self.assertTrue(np.allclose(ref, c2[99:103]))
 
+    def test_classic_sta_lta_accuracy_and_batch(self):
+        """
+        The running sums of the C version are recomputed every 16 LTA
+        windows, so they do not drift after large amplitudes left the
+        windows. Traces can be processed as 2D array.
+        """
+        nsta, nlta = 100, 1000
+        data = np.random.RandomState(815).randn(200000)
+        data[5000:5100] *= 1e6
+        charfct = classic_sta_lta(data, nsta, nlta)
+        squares = data ** 2
+        for i in (nlta - 1 + 16 * nlta, 20000, 50000, 199999):
+            ref = math.fsum(squares[i - nsta + 1:i + 1]) / \
+                math.fsum(squares[i - nlta + 1:i + 1]) * nlta / nsta
+            self.assertAlmostEqual(charfct[i] / ref, 1.0, 12)
+        # several traces at once
+        batch = np.array([data, -2.0 * data, data[::-1]])
+        for threads in (1, 3):
+            result = classic_sta_lta(batch, nsta, nlta, threads=threads)
+            self.assertEqual(result.shape, batch.shape)
+            for trace, cft in zip(batch, result):
+                np.testing.assert_array_equal(
+                    classic_sta_lta(trace, nsta, nlta), cft)
+        self.assertRaises(Exception, classic_sta_lta, batch[:, :nlta - 1],
+                          nsta, nlta)
+
 
 def suite():
     return unittest.makeSuite(TriggerTestCase, 'test')
@@ -9,6 +9,7 @@ from future.builtins import *  # NOQA
 
 import ctypes as C
 import unittest
+import warnings
 
 import numpy as np
 
@@ -57,6 +58,33 @@ class UtilTestCase(unittest.TestCase):
         self.assertEqual(shift, 10)
         self.assertAlmostEqual(corr, 1, 2)
 
+    def test_xcorr_methods(self):
+        """
+        Direct and FFT cross correlation have to agree.
+        """
+        np.random.seed(815)
+        tr1 = np.random.randn(5000).astype(np.float32) + 1.0
+        tr2 = np.concatenate((np.random.randn(37), tr1[:-37])) * 0.5 + 2.0
+        for tr2_ in (tr2, tr2[:4800], np.concatenate((tr2, tr2[:123]))):
+            for shift_len in (0, 10, 100, 1000):
+                results = [xcorr(tr1, tr2_, shift_len, full_xcorr=True,
+                                 method=method)
+                           for method in ('direct', 'fft', 'auto')]
+                for shift, value, corp in results[1:]:
+                    self.assertEqual(shift, results[0][0])
+                    self.assertAlmostEqual(value, results[0][1], 6)
+                    np.testing.assert_allclose(corp, results[0][2],
+                                               atol=1e-6)
+                if shift_len >= 37:
+                    self.assertEqual(results[0][0], -37)
+        # window of support too small
+        with warnings.catch_warnings(record=True) as w:
+            warnings.simplefilter('always')
+            shift, value = xcorr(tr1, tr2, 2200)
+        self.assertEqual((shift, value), (0, 0.0))
+        self.assertEqual(len(w), 1)
+        self.assertRaises(ValueError, xcorr, tr1, tr2, 10, method='foo')
+
     def test_srl_xcorr(self):
         """
         Tests if example in ObsPy paper submitted to the Electronic
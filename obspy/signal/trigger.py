@@ -31,13 +31,15 @@ from future.builtins import *  # NOQA
 
 from collections import deque
 import ctypes as C
+import multiprocessing
 import warnings
 
 import numpy as np
 
 from obspy import UTCDateTime
 from obspy.signal.cross_correlation import templates_max_similarity
-from obspy.signal.headers import clibsignal, head_stalta_t
+from obspy.signal.headers import (RECSTALTA_DTYPES, clibsignal,
+                                   head_stalta_t)
 
 
 def recursive_sta_lta(a, nsta, nlta):
@@ -47,8 +49,9 @@ def recursive_sta_lta(a, nsta, nlta):
     Fast version written in C.
 
     :note: This version directly uses a C version via CTypes
-    :type a: :class:`numpy.ndarray`, dtype=float64
-    :param a: Seismic Trace, numpy.ndarray dtype float64
+    :type a: :class:`numpy.ndarray`
+    :param a: Seismic Trace. Data of type float32, float64 and int32 is
+        used as is, all other types are converted to float64.
     :type nsta: int
     :param nsta: Length of short time average window in samples
     :type nlta: int
@@ -58,15 +61,97 @@ def recursive_sta_lta(a, nsta, nlta):
 
     .. seealso:: [Withers1998]_ (p. 98) and [Trnkoczy2012]_
     """
-    # be nice and adapt type if necessary
-    a = np.ascontiguousarray(a, np.float64)
+    a = _prepare_recstalta_data(a)
     ndat = len(a)
     charfct = np.empty(ndat, dtype=np.float64)
-    # do not use pointer here:
-    clibsignal.recstalta(a, charfct, ndat, nsta, nlta)
+    if ndat == 0:
+        return charfct
+    # thresholds that are never exceeded, only the characteristic function
+    # is computed
+    clibsignal.recstalta_trigger(a, RECSTALTA_DTYPES[a.dtype], ndat, nsta,
+                                 nlta, charfct.ctypes.data, np.inf, np.inf,
+                                 0, 0, None)
     return charfct
 
 
+def recursive_sta_lta_trigger(a, nsta, nlta, thres1, thres2, max_len=9e99,
+                              max_len_delete=False, return_charfct=False):
+    """
+    Recursive STA/LTA with trigger detection.
+
+    Computes the same characteristic function as :func:`recursive_sta_lta`
+    and applies :func:`trigger_onset` to it in a single pass over the data
+    in C. The characteristic function is not stored unless asked for.
+
+    :type a: :class:`numpy.ndarray`
+    :param a: Seismic Trace. Data of type float32, float64 and int32 is
+        used as is, all other types are converted to float64.
+    :type nsta: int
+    :param nsta: Length of short time average window in samples
+    :type nlta: int
+    :param nlta: Length of long time average window in samples
+    :type thres1: float
+    :param thres1: Value above which trigger (of characteristic function)
+        is activated (higher threshold)
+    :type thres2: float
+    :param thres2: Value below which trigger (of characteristic function)
+        is deactivated (lower threshold)
+    :type max_len: int
+    :param max_len: Maximum length of triggered event in samples. A new
+        event will be triggered as soon as the signal reaches again above
+        thres1.
+    :type max_len_delete: bool
+    :param max_len_delete: Drop events longer than max_len.
+    :type return_charfct: bool
+    :param return_charfct: Also return the characteristic function.
+    :rtype: :class:`numpy.ndarray`
+    :return: Trigger on and off times in samples, one row per trigger. If
+        ``return_charfct`` is ``True`` a tuple of the triggers and the
+        characteristic function.
+    """
+    a = _prepare_recstalta_data(a)
+    ndat = len(a)
+    charfct = None
+    charfct_ptr = None
+    if return_charfct:
+        charfct = np.empty(ndat, dtype=np.float64)
+        charfct_ptr = charfct.ctypes.data
+    max_len = int(np.floor(min(max_len, 2 ** 62)))
+    # the triggers are collected in C and copied to an array allocated here
+    # once their number is known
+    buffers = []
+
+    def allocate_triggers(count):
+        buffers.append(np.empty((count, 2), dtype=np.int64))
+        return buffers[-1].ctypes.data
+    alloc = C.CFUNCTYPE(C.c_longlong, C.c_int)(allocate_triggers)
+
+    if ndat:
+        count = clibsignal.recstalta_trigger(
+            a, RECSTALTA_DTYPES[a.dtype], ndat, nsta, nlta, charfct_ptr,
+            thres1, thres2, max_len, int(bool(max_len_delete)), alloc)
+        if count < 0:
+            raise MemoryError("Could not allocate memory for the triggers.")
+    if buffers:
+        triggers = buffers[0]
+    else:
+        triggers = np.empty((0, 2), dtype=np.int64)
+    if return_charfct:
+        return triggers, charfct
+    return triggers
+
+
+def _prepare_recstalta_data(a):
+    """
+    Returns a contiguous array of a sample type supported by the C
+    recursive STA/LTA, only copying the data if necessary.
+    """
+    a = np.asarray(a)
+    if a.dtype not in RECSTALTA_DTYPES:
+        a = a.astype(np.float64)
+    return np.ascontiguousarray(a)
+
+
 def recursive_sta_lta_py(a, nsta, nlta):
     """
     Recursive STA/LTA written in Python.
@@ -166,36 +251,51 @@ def carl_sta_trig(a, nsta, nlta, ratio, quiet):
     return eta
 
 
-def classic_sta_lta(a, nsta, nlta):
+def classic_sta_lta(a, nsta, nlta, threads=None):
     """
     Computes the standard STA/LTA from a given input array a. The length of
     the STA is given by nsta in samples, respectively is the length of the
     LTA given by nlta in samples.
 
-    Fast version written in C.
+    Fast version written in C. The running sums are recomputed every 16 LTA
+    windows so that rounding errors do not accumulate on long traces and
+    after large events. Several traces of equal length can be processed at
+    once by passing a 2D array with one trace per row, the traces are then
+    distributed over several threads if ObsPy has been compiled with OpenMP
+    support.
 
     :type a: NumPy :class:`~numpy.ndarray`
-    :param a: Seismic Trace
+    :param a: Seismic Trace or 2D array of traces
     :type nsta: int
     :param nsta: Length of short time average window in samples
     :type nlta: int
     :param nlta: Length of long time average window in samples
+    :type threads: int
+    :param threads: Number of threads to use for 2D input. Defaults to the
+        number of CPUs.
     :rtype: NumPy :class:`~numpy.ndarray`
-    :return: Characteristic function of classic STA/LTA
+    :return: Characteristic function of classic STA/LTA, of the same shape
+        as the input.
     """
-    data = a
+    # ensure correct type and contiguous of data
+    data = np.ascontiguousarray(a, dtype=np.float64)
+    if data.ndim not in (1, 2):
+        msg = "Input has to be a 1D or 2D array."
+        raise ValueError(msg)
+    if threads is None:
+        threads = multiprocessing.cpu_count()
+    data_2d = data.reshape(-1, data.shape[-1])
     # initialize C struct / NumPy structured array
     head = np.empty(1, dtype=head_stalta_t)
-    head[:] = (len(data), nsta, nlta)
-    # ensure correct type and contiguous of data
-    data = np.ascontiguousarray(data, dtype=np.float64)
+    head[:] = (data_2d.shape[1], nsta, nlta)
     # all memory should be allocated by python
-    charfct = np.empty(len(data), dtype=np.float64)
+    charfct = np.empty(data_2d.shape, dtype=np.float64)
     # run and check the error-code
-    errcode = clibsignal.stalta(head, data, charfct)
+    errcode = clibsignal.stalta_batch(head, data_2d, charfct,
+                                      data_2d.shape[0], threads)
     if errcode != 0:
         raise Exception('ERROR %d stalta: len(data) < nlta' % errcode)
-    return charfct
+    return charfct.reshape(data.shape)
 
 
 def classic_sta_lta_py(a, nsta, nlta):
@@ -12,37 +12,48 @@ import numpy as np
 
 from obspy.core.util.libnames import _load_cdll
 from .helper_classes import SlownessLayer, TimeDist
+from .velocity_layer import VelocityLayer
 
 
 clibtau = _load_cdll("tau")
 
 
-clibtau.tau_branch_calc_time_dist_inner_loop.argtypes = [
+clibtau.tau_branch_calc_time_dist_batch.argtypes = [
+    # layers, record array, 64bit floats. 2D array in memory
+    np.ctypeslib.ndpointer(dtype=SlownessLayer, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # start
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # length
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # max_ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # nbranch
+    C.c_int,
     # ray_params
-    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
                            flags=native_str('C_CONTIGUOUS')),
+    # nray
+    C.c_int,
+    # allow_turn
+    C.c_int,
+    # radius
+    C.c_double,
+    # slowness_tolerance
+    C.c_double,
     # time
     np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
                            flags=native_str('C_CONTIGUOUS')),
     # dist
     np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
                            flags=native_str('C_CONTIGUOUS')),
-    # layer, record array, 64bit floats. 2D array in memory
-    np.ctypeslib.ndpointer(dtype=SlownessLayer, ndim=1,
-                           flags=native_str('C_CONTIGUOUS')),
-    # time_dist, record array, 64bit floats. 2D array in memory
-    np.ctypeslib.ndpointer(dtype=TimeDist, ndim=1,
-                           flags=native_str('C_CONTIGUOUS')),
-    # max_i
-    C.c_int32,
-    # max_j
-    C.c_int32,
-    # max ray param
-    C.c_double,
-    # allow_turn
-    C.c_int32
+    # threads
+    C.c_int
 ]
-clibtau.tau_branch_calc_time_dist_inner_loop.restype = None
+clibtau.tau_branch_calc_time_dist_batch.restype = None
 
 
 clibtau.seismic_phase_calc_time_inner_loop.argtypes = [
@@ -87,3 +98,249 @@ clibtau.bullen_radial_slowness_inner_loop.argtypes = [
     C.c_int
 ]
 clibtau.bullen_radial_slowness_inner_loop.restype = None
+
+
+clibtau.seismic_phase_calc_time_batch.argtypes = [
+    # degrees
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # n
+    C.c_int,
+    # max_distance
+    C.c_double,
+    # dist
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # time
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # count
+    C.c_int,
+    # min_ray_param
+    C.c_double,
+    # max_ray_param
+    C.c_double,
+    # tolerance
+    C.c_double,
+    # max_recursion
+    C.c_int,
+    # layers, record array, 64bit floats. 2D array in memory
+    np.ctypeslib.ndpointer(dtype=SlownessLayer, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # seg_start
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # seg_length
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # seg_mult
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # seg_max_ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # nseg
+    C.c_int,
+    # radius
+    C.c_double,
+    # slowness_tolerance
+    C.c_double,
+    # out_time
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # out_ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # threads
+    C.c_int
+]
+clibtau.seismic_phase_calc_time_batch.restype = C.c_int
+
+
+clibtau.travel_time_table_lookup.argtypes = [
+    # distances
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # ndist
+    C.c_int,
+    # depths
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # ndepth
+    C.c_int,
+    # values
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=3,
+                           flags=native_str('C_CONTIGUOUS')),
+    # nvalues
+    C.c_int,
+    # error
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    # query_depth
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # query_dist
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # n
+    C.c_int,
+    # out
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    # out_error
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # threads
+    C.c_int
+]
+clibtau.travel_time_table_lookup.restype = None
+
+
+clibtau.seismic_phase_calc_path_batch.argtypes = [
+    # layers, record array, 64bit floats. 2D array in memory
+    np.ctypeslib.ndpointer(dtype=SlownessLayer, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # start
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # length
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # down_going
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # max_ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # head_depth
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # head_divisor
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # nleg
+    C.c_int,
+    # phase_dist
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # source_depth
+    C.c_double,
+    # is_kmps
+    C.c_int,
+    # ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # purist_dist
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # n
+    C.c_int,
+    # radius
+    C.c_double,
+    # slowness_tolerance
+    C.c_double,
+    # offsets
+    np.ctypeslib.ndpointer(dtype=np.int64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # out, record array, 64bit floats. 2D array in memory
+    np.ctypeslib.ndpointer(dtype=TimeDist, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # count_only
+    C.c_int,
+    # threads
+    C.c_int
+]
+clibtau.seismic_phase_calc_path_batch.restype = C.c_int
+
+
+clibtau.seismic_phase_calc_pierce_batch.argtypes = [
+    # branch_time
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    # branch_dist
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=2,
+                           flags=native_str('C_CONTIGUOUS')),
+    # model_ray_params
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # nray
+    C.c_int,
+    # down_going
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # max_ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # min_ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # top_depth
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # bot_depth
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # vel_top
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # vel_bot
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # vel_use_p
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # nleg
+    C.c_int,
+    # vel_layers, record array, 64bit floats. 2D array in memory
+    np.ctypeslib.ndpointer(dtype=VelocityLayer, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # vel_fluid_top
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # nvel
+    C.c_int,
+    # phase_ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # phase_dist
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # source_depth
+    C.c_double,
+    # is_kmps
+    C.c_int,
+    # num_head
+    C.c_int,
+    # head_depth
+    C.c_double,
+    # ray_param
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # purist_dist
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # time
+    np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # ray_param_index
+    np.ctypeslib.ndpointer(dtype=np.int32, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # n
+    C.c_int,
+    # radius
+    C.c_double,
+    # slowness_tolerance
+    C.c_double,
+    # offsets
+    np.ctypeslib.ndpointer(dtype=np.int64, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # out, record array, 64bit floats. 2D array in memory
+    np.ctypeslib.ndpointer(dtype=TimeDist, ndim=1,
+                           flags=native_str('C_CONTIGUOUS')),
+    # threads
+    C.c_int
+]
+clibtau.seismic_phase_calc_pierce_batch.restype = C.c_int
@@ -55,6 +55,35 @@ TimeDistGeo = np.dtype([
 ])
 
 
+"""
+Holds the travel time, ray parameter, takeoff and incident angles and the
+derivative of the travel time with respect to the source depth of the
+earliest arrival of a phase, as computed by
+:meth:`~obspy.taup.tau.TauPyModel.get_travel_times_batch`.
+"""
+TravelTime = np.dtype([
+    (native_str('time'), np.float_),
+    (native_str('ray_param'), np.float_),
+    (native_str('takeoff_angle'), np.float_),
+    (native_str('incident_angle'), np.float_),
+    (native_str('dtdh'), np.float_),
+])
+
+
+"""
+Holds the travel time, slowness and derivative of the travel time with
+respect to the source depth interpolated from a
+:class:`~obspy.taup.travel_time_table.TravelTimeTable` together with the
+estimated interpolation error of the travel time.
+"""
+TableTravelTime = np.dtype([
+    (native_str('time'), np.float_),
+    (native_str('slowness'), np.float_),
+    (native_str('dtdh'), np.float_),
+    (native_str('time_error'), np.float_),
+])
+
+
 """
 Tracks critical points (discontinuities or reversals in slowness gradient)
 within slowness and velocity models.
@@ -10,14 +10,15 @@ from future.utils import raise_from
 
 from itertools import count
 import math
+import multiprocessing
 import re
 
 import numpy as np
 
 from obspy.core.util.obspy_types import Enum
 
-from .helper_classes import (Arrival, SlownessModelError, TauModelError,
-                             TimeDist)
+from .helper_classes import (Arrival, SlownessLayer, SlownessModelError,
+                             TauModelError, TimeDist)
 
 from .c_wrappers import clibtau
 
@@ -1034,6 +1035,95 @@ class SeismicPhase(object):
                 self._settings["max_recursion"]))
         return arrivals
 
+    def calc_time_batch(self, degrees, threads=None):
+        """
+        Calculate the earliest arrival of this phase at many distances.
+
+        The arrivals are computed and refined as in :meth:`calc_time` but
+        without creating any :class:`~obspy.taup.helper_classes.Arrival`
+        objects.
+
+        :param degrees: Epicentral distances in degrees.
+        :type degrees: :class:`~numpy.ndarray`
+        :param threads: Number of threads the distances are distributed
+            over. Defaults to the number of CPUs.
+        :type threads: int
+        :returns: Travel times in seconds and ray parameters in seconds per
+            radian of the earliest arrival at each distance, NaN if the phase
+            does not exist at a distance.
+        :rtype: tuple of two :class:`~numpy.ndarray`
+        """
+        degrees = np.ascontiguousarray(degrees, dtype=np.float64).ravel()
+        if threads is None:
+            threads = multiprocessing.cpu_count()
+        layers, start, length, mult, max_ray_param = self._shoot_segments()
+        time = np.empty(len(degrees), dtype=np.float64)
+        ray_param = np.empty(len(degrees), dtype=np.float64)
+        ret = clibtau.seismic_phase_calc_time_batch(
+            degrees, len(degrees), self.max_distance,
+            np.ascontiguousarray(self.dist, dtype=np.float64),
+            np.ascontiguousarray(self.time, dtype=np.float64),
+            np.ascontiguousarray(self.ray_param, dtype=np.float64),
+            len(self.dist), self.min_ray_param, self.max_ray_param,
+            REFINE_DIST_RADIAN_TOL, self._settings["max_recursion"],
+            layers, start, length, mult, max_ray_param, len(start),
+            self.tau_model.radius_of_planet,
+            self.tau_model.s_mod.slowness_tolerance, time, ray_param,
+            threads)
+        if ret != 0:
+            raise RuntimeError('Please contact the developers. This error '
+                               'should not occur.')
+        return time, ray_param
+
+    def _shoot_segments(self):
+        """
+        Slowness layers of all branches a ray of this phase passes through.
+
+        Returns the layers and for every branch the index of its first layer,
+        its number of layers, the number of passes through it and its
+        maximum ray parameter, as needed for shooting rays in
+        :meth:`calc_time_batch`. There are no branches for non-body waves
+        that cannot be refined by shooting rays.
+        """
+        layers = []
+        start = []
+        length = []
+        mult = []
+        max_ray_param = []
+        if not (self.name.endswith('kmps') or
+                any(phase in self.name
+                    for phase in ['Pdiff', 'Sdiff', 'Pn', 'Sn'])):
+            tau_model = self.tau_model
+            s_mod = tau_model.s_mod
+            times_branches = self.calc_branch_mult(tau_model)
+            first = 0
+            # Same order of summation as in shoot_ray().
+            for j in range(tau_model.tau_branches.shape[1]):
+                for k, is_p_wave in enumerate((s_mod.p_wave, s_mod.s_wave)):
+                    if times_branches[k, j] == 0:
+                        continue
+                    br = tau_model.get_tau_branch(j, is_p_wave)
+                    top_layer = s_mod.layer_number_below(br.top_depth,
+                                                         is_p_wave)
+                    bot_layer = s_mod.layer_number_above(br.bot_depth,
+                                                         is_p_wave)
+                    layer = s_mod.get_slowness_layer(
+                        np.arange(top_layer, bot_layer + 1), is_p_wave)
+                    layers.append(layer)
+                    start.append(first)
+                    length.append(len(layer))
+                    mult.append(times_branches[k, j])
+                    max_ray_param.append(br.max_ray_param)
+                    first += len(layer)
+        if layers:
+            layers = np.ascontiguousarray(np.concatenate(layers))
+        else:
+            layers = np.empty(0, dtype=SlownessLayer)
+        return (layers, np.array(start, dtype=np.int32),
+                np.array(length, dtype=np.int32),
+                np.array(mult, dtype=np.float64),
+                np.array(max_ray_param, dtype=np.float64))
+
     def calc_pierce(self, degrees):
         """
         Calculate pierce points for this phase.
@@ -1043,8 +1133,7 @@ class SeismicPhase(object):
         object.
         """
         arrivals = self.calc_time(degrees)
-        for arrival in arrivals:
-            self.calc_pierce_from_arrival(arrival)
+        self.calc_pierce_batch(arrivals, threads=1)
         return arrivals
 
     def calc_pierce_from_arrival(self, curr_arrival):
@@ -1054,223 +1143,275 @@ class SeismicPhase(object):
         The returned arrival is the same as the input argument but now has the
         pierce points filled in.
         """
-        # Find the ray parameter index that corresponds to the arrival ray
-        # parameter in the TauModel, ie it is between ray_num and ray_num+1,
-        # We know that it must be <model.ray_param.length-1 since the last
-        # ray parameter sample is 0 in a spherical model.
-        ray_num = 0
-        for i, rp in enumerate(self.tau_model.ray_params[:-1]):
-            if rp >= curr_arrival.ray_param:
-                ray_num = i
-            else:
-                break
-
-        # Here we use ray parameter and dist info stored within the
-        # SeismicPhase so we can use curr_arrival.ray_param_index, which
-        # may not correspond to ray_num (for model.ray_param).
-        ray_param_a = self.ray_param[curr_arrival.ray_param_index]
-        ray_param_b = self.ray_param[curr_arrival.ray_param_index + 1]
-        dist_a = self.dist[curr_arrival.ray_param_index]
-        dist_b = self.dist[curr_arrival.ray_param_index + 1]
-        dist_ratio = (curr_arrival.purist_dist - dist_a) / (dist_b - dist_a)
-        dist_ray_param = dist_ratio * (ray_param_b - ray_param_a) + ray_param_a
-
-        # + 2 for first point and kmps, if it exists.
-        pierce = np.empty(len(self.branch_seq) + 2, dtype=TimeDist)
-        # First pierce point is always 0 distance at the source depth.
-        pierce[0] = (dist_ray_param, 0, 0, self.tau_model.source_depth)
-        index = 1
-        branch_dist = 0
-        branch_time = 0
-
-        # Loop from 0 but already done 0 [I just copy the comments, sorry!],
-        # so the pierce point when the ray leaves branch i is stored in i + 1.
-        # Use linear interpolation between rays that we know.
-        assert len(self.branch_seq) == len(self.wave_type) == \
-            len(self.down_going)
-        for branch_num, is_p_wave, is_down_going in zip(
-                self.branch_seq, self.wave_type, self.down_going):
-            # Save the turning depths for the ray parameter for both P and
-            # S waves. This way we get the depth correct for any rays that
-            # turn within a layer. We have to do this on a per branch basis
-            # because of converted phases, e.g. SKS.
-            tau_branch = self.tau_model.get_tau_branch(branch_num, is_p_wave)
-            if dist_ray_param > tau_branch.max_ray_param:
-                turn_depth = tau_branch.top_depth
-            elif dist_ray_param <= tau_branch.min_ray_param:
-                turn_depth = tau_branch.bot_depth
-            else:
-                if (is_p_wave or self.tau_model.s_mod.depth_in_fluid((
-                        tau_branch.top_depth + tau_branch.bot_depth) / 2)):
-                    turn_depth = self.tau_model.s_mod.find_depth_from_depths(
-                        dist_ray_param,
-                        tau_branch.top_depth,
-                        tau_branch.bot_depth,
-                        True)
-                else:
-                    turn_depth = self.tau_model.s_mod.find_depth_from_depths(
-                        dist_ray_param,
-                        tau_branch.top_depth,
-                        tau_branch.bot_depth,
-                        is_p_wave)
-
-            if any(x in self.name for x in ["Pdiff", "Pn", "Sdiff", "Sn"]):
-                # Head waves and diffracted waves are a special case.
-                dist_a = tau_branch.dist[ray_num]
-                time_a = tau_branch.time[ray_num]
-                dist_b, time_b = dist_a, time_a
-            else:
-                dist_a = tau_branch.dist[ray_num]
-                time_a = tau_branch.time[ray_num]
-                dist_b = tau_branch.dist[ray_num + 1]
-                time_b = tau_branch.time[ray_num + 1]
-
-            branch_dist += dist_ratio * (dist_b - dist_a) + dist_a
-            prev_branch_time = np.array(branch_time, copy=True)
-            branch_time += dist_ratio * (time_b - time_a) + time_a
-            if is_down_going:
-                branch_depth = min(tau_branch.bot_depth, turn_depth)
-            else:
-                branch_depth = min(tau_branch.top_depth, turn_depth)
-
-            # Make sure ray actually propagates in this branch; leave a little
-            # room for numerical chatter.
-            if abs(prev_branch_time - branch_time) > 1e-10:
-                pierce[index] = (dist_ray_param, branch_time, branch_dist,
-                                 branch_depth)
-                index += 1
-
-        if any(x in self.name for x in ["Pdiff", "Pn", "Sdiff", "Sn"]):
-            pierce, index = self.handle_special_waves(curr_arrival,
-                                                      pierce,
-                                                      index)
-        elif "kmps" in self.name:
-            pierce[index] = (dist_ray_param, curr_arrival.time,
-                             curr_arrival.purist_dist, 0)
-            index += 1
-
-        curr_arrival.pierce = pierce[:index]
+        self.calc_pierce_batch([curr_arrival], threads=1)
         # The arrival is modified in place and must (?) thus be returned.
         return curr_arrival
 
+    def calc_pierce_batch(self, arrivals, threads=None):
+        """
+        Calculate the pierce points of many arrivals of this phase at once.
+
+        The pierce point when the ray leaves a branch is found by linear
+        interpolation between the rays of the model, the turning depth within
+        a branch from the velocity model. All arrivals are done by a single
+        native call.
+
+        :param arrivals: Arrivals of this phase, e.g. from
+            :meth:`calc_time`. Their ``pierce`` attribute is set to their
+            part of the returned array.
+        :type arrivals: list of :class:`~obspy.taup.helper_classes.Arrival`
+        :param threads: Number of threads the arrivals are distributed over.
+            Defaults to the number of CPUs.
+        :type threads: int
+        :returns: The pierce points of all arrivals one after the other and
+            the offsets of the points of every arrival in them, those of
+            arrival ``i`` are ``pierce[offsets[i]:offsets[i + 1]]``.
+        :rtype: tuple of :class:`~numpy.ndarray` (dtype =
+            :const:`~obspy.taup.helper_classes.TimeDist`) and
+            :class:`~numpy.ndarray` (dtype = int64)
+        """
+        if threads is None:
+            threads = multiprocessing.cpu_count()
+        arrivals = list(arrivals)
+        n = len(arrivals)
+        tau_model = self.tau_model
+        s_mod = tau_model.s_mod
+        legs = self._pierce_legs()
+
+        num_head = 0
+        head_depth = 0.0
+        for ps in ["Pn", "Sn", "Pdiff", "Sdiff"]:
+            if ps in self.name:
+                num_head = self.name.count(ps)
+                if ps in ["Pn", "Sn"]:
+                    head_depth = tau_model.moho_depth
+                else:
+                    head_depth = tau_model.cmb_depth
+                break
+
+        vel_layers = np.ascontiguousarray(s_mod.v_mod.layers)
+        vel_fluid_top = s_mod.depth_in_fluid(
+            vel_layers['top_depth']).astype(np.int32)
+        offsets = np.zeros(n + 1, dtype=np.int64)
+        pierce = np.empty(n * 2 * (len(self.branch_seq) + 2), dtype=TimeDist)
+        ret = clibtau.seismic_phase_calc_pierce_batch(
+            legs['time'], legs['dist'],
+            np.ascontiguousarray(tau_model.ray_params, dtype=np.float64),
+            len(tau_model.ray_params), legs['down_going'],
+            legs['max_ray_param'], legs['min_ray_param'], legs['top_depth'],
+            legs['bot_depth'], legs['vel_top'], legs['vel_bot'],
+            legs['vel_use_p'], len(self.branch_seq),
+            vel_layers, np.ascontiguousarray(vel_fluid_top), len(vel_layers),
+            np.ascontiguousarray(self.ray_param, dtype=np.float64),
+            np.ascontiguousarray(self.dist, dtype=np.float64),
+            tau_model.source_depth, int("kmps" in self.name), num_head,
+            head_depth,
+            np.array([a.ray_param for a in arrivals], dtype=np.float64),
+            np.array([a.purist_dist for a in arrivals], dtype=np.float64),
+            np.array([a.time for a in arrivals], dtype=np.float64),
+            np.array([a.ray_param_index for a in arrivals], dtype=np.int32),
+            n, tau_model.radius_of_planet, s_mod.slowness_tolerance, offsets,
+            pierce, threads)
+        if ret != 0:
+            raise SlownessModelError("Turning depth of a ray is not "
+                                     "contained within its branch.")
+
+        pierce = pierce[:offsets[-1]]
+        for i, arrival in enumerate(arrivals):
+            arrival.pierce = pierce[offsets[i]:offsets[i + 1]]
+        return pierce, offsets
+
+    def _pierce_legs(self):
+        """
+        Everything :meth:`calc_pierce_batch` needs to know about the
+        branches of this phase.
+
+        Returns a dictionary of arrays with one entry per branch in
+        ``branch_seq``: its time and distance for the ray parameters of the
+        model, its direction, range of ray parameters and depths and the
+        velocity layers and wave type to find turning depths with.
+        """
+        tau_model = self.tau_model
+        s_mod = tau_model.s_mod
+        v_mod = s_mod.v_mod
+        nleg = len(self.branch_seq)
+        legs = {
+            'time': np.empty((nleg, len(tau_model.ray_params)),
+                             dtype=np.float64),
+            'dist': np.empty((nleg, len(tau_model.ray_params)),
+                             dtype=np.float64),
+            'down_going': np.array(self.down_going, dtype=np.int32),
+            'vel_use_p': np.empty(nleg, dtype=np.int32),
+            'vel_top': np.empty(nleg, dtype=np.int32),
+            'vel_bot': np.empty(nleg, dtype=np.int32)}
+        for key in ('max_ray_param', 'min_ray_param', 'top_depth',
+                    'bot_depth'):
+            legs[key] = np.empty(nleg, dtype=np.float64)
+
+        for i, branch_num, is_p_wave in zip(count(), self.branch_seq,
+                                            self.wave_type):
+            tau_branch = tau_model.get_tau_branch(branch_num, is_p_wave)
+            legs['time'][i] = tau_branch.time
+            legs['dist'][i] = tau_branch.dist
+            for key in ('max_ray_param', 'min_ray_param', 'top_depth',
+                        'bot_depth'):
+                legs[key][i] = getattr(tau_branch, key)
+            # Use P velocities in fluids to get the turning depths right for
+            # converted phases, e.g. SKS.
+            legs['vel_use_p'][i] = is_p_wave or s_mod.depth_in_fluid(
+                (tau_branch.top_depth + tau_branch.bot_depth) / 2)
+            # Velocity layers as in SlownessModel.find_depth_from_depths(),
+            # an empty range if there are none.
+            try:
+                top = v_mod.layer_number_below(tau_branch.top_depth)[0]
+                if v_mod.layers[top]['bot_depth'] == tau_branch.top_depth:
+                    top += 1
+                bot = v_mod.layer_number_above(tau_branch.bot_depth)[0]
+            except LookupError:
+                top, bot = 0, -1
+            legs['vel_top'][i] = top
+            legs['vel_bot'][i] = bot
+        return legs
+
     def calc_path(self, degrees):
         """
         Calculate the paths this phase takes through the planet model.
 
-        Only calls :meth:`calc_path_from_arrival`.
+        Only calls :meth:`calc_path_batch`.
         """
         arrivals = self.calc_time(degrees)
-        for arrival in arrivals:
-            self.calc_path_from_arrival(arrival)
+        self.calc_path_batch(arrivals, threads=1)
         return arrivals
 
     def calc_path_from_arrival(self, curr_arrival):
         """
         Calculate the paths this phase takes through the planet model.
         """
-        # Find the ray parameter index that corresponds to the arrival ray
-        # parameter in the TauModel, i.e. it is between ray_num and
-        # ray_num + 1.
-        temp_time_dist = (curr_arrival.ray_param, 0, 0,
-                          self.tau_model.source_depth)
-        # path_list is a list of lists.
-        path_list = [temp_time_dist]
-        for i, branch_num, is_p_wave, is_down_going in zip(
-                count(), self.branch_seq, self.wave_type, self.down_going):
-            br = self.tau_model.get_tau_branch(branch_num, is_p_wave)
-            temp_time_dist = br.path(curr_arrival.ray_param, is_down_going,
-                                     self.tau_model.s_mod)
-            if len(temp_time_dist):
-                path_list.extend(temp_time_dist)
-                if np.any(temp_time_dist['dist'] < 0):
-                    raise RuntimeError("Path is backtracking, "
-                                       "this is impossible.")
-
-            # Special case for head and diffracted waves:
-            if(branch_num == self.tau_model.cmb_branch - 1 and
-               i < len(self.branch_seq) - 1 and
-               self.branch_seq[i + 1] == self.tau_model.cmb_branch - 1 and
-               ("Pdiff" in self.name or "Sdiff" in self.name)):
-                dist_diff = curr_arrival.purist_dist - self.dist[0]
-                diff_td = (
-                    curr_arrival.ray_param,
-                    dist_diff * curr_arrival.ray_param,
-                    dist_diff,
-                    self.tau_model.cmb_depth)
-                path_list.append(diff_td)
-
-            elif(branch_num == self.tau_model.moho_branch and
-                 i < len(self.branch_seq) - 1 and
-                 self.branch_seq[i + 1] == self.tau_model.moho_branch and
-                 ("Pn" in self.name or "Sn" in self.name)):
-                # Can't have both Pn and Sn in a wave, so one of these is 0.
-                num_found = max(self.name.count("Pn"), self.name.count("Sn"))
-                dist_head = (curr_arrival.purist_dist -
-                             self.dist[0]) / num_found
-                head_td = (
-                    curr_arrival.ray_param,
-                    dist_head * curr_arrival.ray_param,
-                    dist_head,
-                    self.tau_model.moho_depth)
-                path_list.append(head_td)
-
-        if "kmps" in self.name:
-            # kmps phases have no branches, so need to end them at the arrival
-            # distance.
-            head_td = (
-                curr_arrival.ray_param,
-                curr_arrival.purist_dist * curr_arrival.ray_param,
-                curr_arrival.purist_dist,
-                0)
-            path_list.append(head_td)
-
-        curr_arrival.path = np.array(path_list, dtype=TimeDist)
-        np.cumsum(curr_arrival.path['time'], out=curr_arrival.path['time'])
-        np.cumsum(curr_arrival.path['dist'], out=curr_arrival.path['dist'])
-
+        self.calc_path_batch([curr_arrival], threads=1)
         return curr_arrival
 
-    def handle_special_waves(self, curr_arrival, pierce, index):
+    def calc_path_batch(self, arrivals, threads=None):
         """
-        Handle head or diffracted waves.
-
-        It is assumed that a phase can be a diffracted wave or a head wave, but
-        not both. Nor can it be a head wave or diffracted wave for both P and
-        S.
+        Calculate the ray paths of many arrivals of this phase at once.
+
+        The path has one point at the end of every slowness layer and at the
+        turning points of the ray, see :meth:`TauBranch.path
+        <obspy.taup.tau_branch.TauBranch.path>`, plus the head and
+        diffracted wave segments. All arrivals are done by a single native
+        call.
+
+        :param arrivals: Arrivals of this phase, e.g. from
+            :meth:`calc_time`. Their ``path`` attribute is set to their part
+            of the returned array.
+        :type arrivals: list of :class:`~obspy.taup.helper_classes.Arrival`
+        :param threads: Number of threads the arrivals are distributed over.
+            Defaults to the number of CPUs.
+        :type threads: int
+        :returns: The paths of all arrivals one after the other and the
+            offsets of the points of every arrival in them, those of arrival
+            ``i`` are ``path[offsets[i]:offsets[i + 1]]``.
+        :rtype: tuple of :class:`~numpy.ndarray` (dtype =
+            :const:`~obspy.taup.helper_classes.TimeDist`) and
+            :class:`~numpy.ndarray` (dtype = int64)
         """
-        for ps in ["Pn", "Sn", "Pdiff", "Sdiff"]:
-            if ps in self.name:
-                phase_seg = ps
-                break
-        else:
-            raise TauModelError("No head/diff segment in" + str(self.name))
+        if threads is None:
+            threads = multiprocessing.cpu_count()
+        arrivals = list(arrivals)
+        n = len(arrivals)
+        tau_model = self.tau_model
+        layers, start, length, max_ray_param, head_depth, head_divisor = \
+            self._path_legs()
+        ray_param = np.array([a.ray_param for a in arrivals],
+                             dtype=np.float64)
+        purist_dist = np.array([a.purist_dist for a in arrivals],
+                               dtype=np.float64)
+        offsets = np.zeros(n + 1, dtype=np.int64)
+        path = np.empty(0, dtype=TimeDist)
+
+        # Count the points of every path first, then fill them in.
+        for count_only in (1, 0):
+            if not count_only:
+                path = np.empty(offsets[-1], dtype=TimeDist)
+            ret = clibtau.seismic_phase_calc_path_batch(
+                layers, start, length,
+                np.array(self.down_going, dtype=np.int32), max_ray_param,
+                head_depth, head_divisor, len(self.branch_seq),
+                np.ascontiguousarray(self.dist, dtype=np.float64),
+                tau_model.source_depth, int("kmps" in self.name), ray_param,
+                purist_dist, n, tau_model.radius_of_planet,
+                tau_model.s_mod.slowness_tolerance, offsets, path,
+                count_only, threads)
+            if ret == -2:
+                raise RuntimeError("Path is backtracking, "
+                                   "this is impossible.")
+            elif ret != 0:
+                raise SlownessModelError("Ray cannot propagate within a "
+                                         "layer of its path.")
+
+        for i, arrival in enumerate(arrivals):
+            arrival.path = path[offsets[i]:offsets[i + 1]]
+        return path, offsets
+
+    def _path_legs(self):
+        """
+        Slowness layers of the branches of this phase in the order of
+        ``branch_seq``.
+
+        Returns the layers and for every branch the index of its first layer,
+        its number of layers and its maximum ray parameter as well as the
+        depth of a head or diffracted wave segment following it, NaN if
+        there is none, and the number of such segments it is shared with,
+        as needed by :meth:`calc_path_batch`.
+        """
+        tau_model = self.tau_model
+        s_mod = tau_model.s_mod
+        layers = []
+        start = []
+        length = []
+        max_ray_param = []
+        head_depth = []
+        head_divisor = []
+        first = 0
+        for i, branch_num, is_p_wave in zip(count(), self.branch_seq,
+                                            self.wave_type):
+            br = tau_model.get_tau_branch(branch_num, is_p_wave)
+            top_layer = s_mod.layer_number_below(br.top_depth, is_p_wave)
+            bot_layer = s_mod.layer_number_above(br.bot_depth, is_p_wave)
+            layer = s_mod.get_slowness_layer(
+                np.arange(top_layer, bot_layer + 1), is_p_wave)
+            layers.append(layer)
+            start.append(first)
+            length.append(len(layer))
+            max_ray_param.append(br.max_ray_param)
+            first += len(layer)
 
-        if phase_seg in ["Pn", "Sn"]:
-            head_depth = self.tau_model.moho_depth
+            # Special case for head and diffracted waves:
+            next_branch = (self.branch_seq[i + 1]
+                           if i < len(self.branch_seq) - 1 else None)
+            if (branch_num == tau_model.cmb_branch - 1 and
+                    next_branch == tau_model.cmb_branch - 1 and
+                    ("Pdiff" in self.name or "Sdiff" in self.name)):
+                head_depth.append(tau_model.cmb_depth)
+                head_divisor.append(1)
+            elif (branch_num == tau_model.moho_branch and
+                    next_branch == tau_model.moho_branch and
+                    ("Pn" in self.name or "Sn" in self.name)):
+                # Can't have both Pn and Sn in a wave, so one of these is 0.
+                head_depth.append(tau_model.moho_depth)
+                head_divisor.append(max(self.name.count("Pn"),
+                                        self.name.count("Sn")))
+            else:
+                head_depth.append(np.nan)
+                head_divisor.append(1)
+        if layers:
+            layers = np.ascontiguousarray(np.concatenate(layers))
         else:
-            head_depth = self.tau_model.cmb_depth
-
-        num_found = self.name.count(phase_seg)
-        refract_dist = curr_arrival.purist_dist - self.dist[0]
-        refract_time = refract_dist * curr_arrival.ray_param
-
-        # This is a little weird as we are not checking where we are in
-        # the phase name, but simply if the depth matches. This likely
-        # works in most cases, but may not for head/diffracted waves that
-        # undergo a phase change, if that type of phase can even exist.
-        mask = pierce['depth'][:index] == head_depth
-        adjust = np.cumsum(mask)
-        pierce['time'][:index] += adjust * refract_time / num_found
-        pierce['dist'][:index] += adjust * refract_dist / num_found
-
-        head_index = np.where(mask)[0]
-        if len(head_index):
-            head_index += 1
-            td = pierce[head_index]
-            pierce = np.insert(pierce, head_index, td)
-            index += len(head_index)
-
-        return pierce, index
+            layers = np.empty(0, dtype=SlownessLayer)
+        return (layers, np.array(start, dtype=np.int32),
+                np.array(length, dtype=np.int32),
+                np.array(max_ray_param, dtype=np.float64),
+                np.array(head_depth, dtype=np.float64),
+                np.array(head_divisor, dtype=np.float64))
 
     def refine_arrival(self, degrees, ray_index, dist_radian, tolerance,
                        recursion_limit):
@@ -1439,7 +1580,7 @@ class SeismicPhase(object):
             raise_from(RuntimeError('Please contact the developers. This '
                                     'error should not occur.'), e)
 
-        takeoff_angle = np.degrees(math.asin(np.clip(
+        takeoff_angle = np.degrees(np.arcsin(np.clip(
             takeoff_velocity * ray_param /
             (self.tau_model.radius_of_planet - self.source_depth), -1.0, 1.0)))
         if not self.down_going[0]:
@@ -1448,6 +1589,38 @@ class SeismicPhase(object):
 
         return takeoff_angle
 
+    def calc_dtdh(self, ray_param):
+        """
+        Derivative of the travel time with respect to the source depth.
+
+        It is ``-cos(i) / v`` in s/km for the takeoff angle ``i`` and the
+        velocity ``v`` at the source, i.e. negative for rays leaving the
+        source downwards.
+        """
+        if self.name.endswith('kmps'):
+            return 0
+
+        v_mod = self.tau_model.s_mod.v_mod
+        try:
+            if self.down_going[0]:
+                takeoff_velocity = v_mod.evaluate_below(self.source_depth,
+                                                        self.name[0])
+            else:
+                takeoff_velocity = v_mod.evaluate_above(self.source_depth,
+                                                        self.name[0])
+        except (IndexError, LookupError) as e:
+            raise_from(RuntimeError('Please contact the developers. This '
+                                    'error should not occur.'), e)
+
+        sin_takeoff = np.clip(
+            takeoff_velocity * ray_param /
+            (self.tau_model.radius_of_planet - self.source_depth), -1.0, 1.0)
+        dtdh = np.sqrt(1.0 - sin_takeoff ** 2) / takeoff_velocity
+        if self.down_going[0]:
+            dtdh = -dtdh
+
+        return dtdh
+
     def calc_incident_angle(self, ray_param):
         if self.name.endswith('kmps'):
             return 0
@@ -1466,7 +1639,7 @@ class SeismicPhase(object):
             raise_from(RuntimeError('Please contact the developers. This '
                                     'error should not occur.'), e)
 
-        incident_angle = np.degrees(math.asin(np.clip(
+        incident_angle = np.degrees(np.arcsin(np.clip(
             incident_velocity * ray_param /
             (self.tau_model.radius_of_planet - self.receiver_depth),
             -1.0, 1.0)))
@@ -7,7 +7,10 @@
 # Copyright (C) 2015 L. Krischer
 #---------------------------------------------------------------------*/
 #define _USE_MATH_DEFINES  // for Visual Studio
+#include <limits.h>
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -15,10 +18,7 @@
 
 // Simple macros for easy array access.
 // Be careful as these naturally apply to all function in this module.
-#define RAY_PARAMS(I, J) ray_params[(I) * max_j + (J)]
-#define TIME(I, J) time[(I) * max_j + (J)]
-#define DIST(I, J) dist[(I) * max_j + (J)]
-#define TIME_DIST(I, J) time_dist[(I) * 4 + (J)]
+#define LAYER(I, J) layer[(I) * 4 + (J)]
 // Record array...change here if it changes on the Python side.
 enum {
     TD_P,
@@ -26,7 +26,6 @@ enum {
     TD_DIST,
     TD_DEPTH
 };
-#define LAYER(I, J) layer[(I) * 4 + (J)]
 // Record array...change here if it changes on the Python side.
 enum {
     SL_TOP_P,
@@ -36,72 +35,18 @@ enum {
 };
 
 
-/*
-Original Python version:
-
-for i, p in enumerate(ray_params[:, 0]):
-    if p <= self.maxRayParam:
-        m = mask[i]
-        layerMask = layer[m]
-        if len(layerMask):
-            timeDist['time'][i] = np.sum(time[i][m])
-            timeDist['dist'][i] = np.sum(dist[i][m])
-
-            # This check is not part of the C version as it is never
-            # executed so I think it is not needed.
-            if ((layerMask['topP'][-1] - p) *
-                    (p - layerMask['botP'][-1])) > 0:
-                raise SlownessModelError(
-                    "Ray turns in the middle of this layer!")
-*/
-void tau_branch_calc_time_dist_inner_loop(
-    double *ray_params, double *time, double *dist,
-    double *layer, double *time_dist, int max_i, int max_j,
-    double max_ray_param, int allow_turn) {
-
-    int i, j;
-    double p, time_sum, dist_sum;
-
-    for (i=0; i < max_i; i++) {
-        p = RAY_PARAMS(i, 0);
-        if (p > max_ray_param) {
-            continue;
-        }
-
-        time_sum = 0.0;
-        dist_sum = 0.0;
-
-        for (j=0; j < max_j; j++) {
-            if (p > LAYER(j, SL_TOP_P) || p > LAYER(j, SL_BOT_P)) {
-                break;
-            }
-            time_sum += TIME(i, j);
-            dist_sum += DIST(i, j);
-        }
-
-        /* Check if the last element includes a turn. */
-        if (j < max_j && allow_turn) {
-            if ((LAYER(j, SL_TOP_P) - p) * (p - LAYER(j, SL_BOT_P)) > 0) {
-                time_sum += TIME(i, j);
-                dist_sum += DIST(i, j);
-            }
-        }
-
-        TIME_DIST(i, TD_TIME) = time_sum;
-        TIME_DIST(i, TD_DIST) = dist_sum;
-    }
-    return;
-}
-
-
-int seismic_phase_calc_time_inner_loop(
+/* Searches the rays of a phase that bracket the given distance, also
+ * going around the planet several times up to max_distance. Up to
+ * max_results of them are written, the total number is returned. */
+static int seismic_phase_search(
     double degree,
     double max_distance,
-    double *dist,
-    double *ray_param,
+    const double *dist,
+    const double *ray_param,
     double *search_dist_results,
     int *ray_num_results,
-    int count) {
+    int count,
+    int max_results) {
 
     double temp_deg, rad_dist, search_dist;
     int n = 0;
@@ -132,8 +77,10 @@ int seismic_phase_calc_time_inner_loop(
                     count > 2) {
                     continue;
                 }
-                search_dist_results[r] = search_dist;
-                ray_num_results[r] = ray_num;
+                if (r < max_results) {
+                    search_dist_results[r] = search_dist;
+                    ray_num_results[r] = ray_num;
+                }
                 r += 1;
             }
         }
@@ -152,8 +99,10 @@ int seismic_phase_calc_time_inner_loop(
                         count > 2) {
                         continue;
                     }
-                    search_dist_results[r] = search_dist;
-                    ray_num_results[r] = ray_num;
+                    if (r < max_results) {
+                        search_dist_results[r] = search_dist;
+                        ray_num_results[r] = ray_num;
+                    }
                     r += 1;
                 }
             }
@@ -165,6 +114,21 @@ int seismic_phase_calc_time_inner_loop(
 }
 
 
+int seismic_phase_calc_time_inner_loop(
+    double degree,
+    double max_distance,
+    double *dist,
+    double *ray_param,
+    double *search_dist_results,
+    int *ray_num_results,
+    int count) {
+
+    return seismic_phase_search(degree, max_distance, dist, ray_param,
+                                search_dist_results, ray_num_results, count,
+                                INT_MAX);
+}
+
+
 void bullen_radial_slowness_inner_loop(
         double *layer,
         double *p,
@@ -191,3 +155,1115 @@ void bullen_radial_slowness_inner_loop(
         time[i] = (sqrt_top - sqrt_bot) / B;
     }
 }
+
+
+/* Maximum number of arrivals of a phase at a single distance that are
+ * considered by the batch travel time calculation, as in
+ * SeismicPhase.calc_time(). */
+#define MAX_PHASE_ARRIVALS 100
+
+typedef struct _batch_arrival {
+    double time;
+    double dist;
+    double ray_param;
+    int ray_param_index;
+} batch_arrival;
+
+/* Shot rays of a phase, the slowness layers of every branch the phase
+ * passes through together with the number of passes. */
+typedef struct _shoot_segments {
+    const double *layers;
+    const int *start;
+    const int *length;
+    const double *mult;
+    const double *max_ray_param;
+    int count;
+    double radius;
+    double slowness_tolerance;
+} shoot_segments;
+
+
+/* Depth at which the ray parameter p is reached in a slowness layer, see
+ * bullen_depth_for() in slowness_layer.py. */
+static double bullen_depth(const double *layer, double p, double radius) {
+    double top_p = layer[SL_TOP_P], bot_p = layer[SL_BOT_P];
+    double top_depth = layer[SL_TOP_DEPTH], bot_depth = layer[SL_BOT_DEPTH];
+    double b, a, depth, linear;
+
+    if (!((top_p - p) * (p - bot_p) >= 0)) {
+        return NAN;
+    }
+    if (top_depth == bot_depth) {
+        return bot_depth;
+    }
+    if (top_p == p) {
+        return top_depth;
+    }
+    if (bot_p == p) {
+        return bot_depth;
+    }
+    if (bot_p != 0 && bot_depth != radius) {
+        b = log(top_p / bot_p) /
+            log((radius - top_depth) / (radius - bot_depth));
+        a = top_p / pow(radius - top_depth, b);
+        linear = (bot_depth - top_depth) / (bot_p - top_p) * (p - top_p) +
+                 top_depth;
+        if (a != 0 && b != 0) {
+            depth = radius - exp(1.0 / b * log(p / a));
+        }
+        else {
+            depth = linear;
+        }
+        if (top_depth > depth && depth > top_depth - 0.000001) {
+            depth = top_depth;
+        }
+        if (bot_depth < depth && depth < bot_depth + 0.000001) {
+            depth = bot_depth;
+        }
+        if (depth < 0 || isnan(depth) || isinf(depth) || depth < top_depth ||
+                depth > bot_depth) {
+            depth = linear;
+        }
+        if (depth < top_depth && top_depth - depth < 1e-10) {
+            depth = top_depth;
+        }
+        if (depth > bot_depth && depth - bot_depth < 1e-10) {
+            depth = bot_depth;
+        }
+        return depth;
+    }
+    if (top_p != bot_p) {
+        return bot_depth + (p - bot_p) * (top_depth - bot_depth) /
+                           (top_p - bot_p);
+    }
+    return bot_depth;
+}
+
+
+/* Time and distance increments of a ray in a slowness layer, it may turn
+ * inside of the layer. See SlownessModel.layer_time_dist(). */
+static void layer_time_dist(const double *layer, double p, double radius,
+                            double slowness_tolerance,
+                            double *time, double *dist) {
+    double top_p = layer[SL_TOP_P], bot_p = layer[SL_BOT_P];
+    double top_depth = layer[SL_TOP_DEPTH], bot_depth = layer[SL_BOT_DEPTH];
+    double top_radius, bot_radius, vel, top_term, bot_term, b;
+    double sqrt_top, sqrt_bot;
+
+    if (p > bot_p) {
+        bot_depth = bullen_depth(layer, p, radius);
+        bot_p = p;
+    }
+    *time = 0.0;
+    *dist = 0.0;
+    if (top_depth == bot_depth) {
+        return;
+    }
+    if (p == 0 && bot_depth == radius) {
+        *time = top_p;
+        *dist = M_PI / 2;
+        return;
+    }
+    top_radius = radius - top_depth;
+    bot_radius = radius - bot_depth;
+    vel = bot_radius / bot_p;
+    if (fabs(top_radius / top_p - vel) < slowness_tolerance) {
+        top_term = top_radius * top_radius - (p * vel) * (p * vel);
+        if (fabs(top_term) < slowness_tolerance) {
+            top_term = 0.0;
+        }
+        bot_term = 0.0;
+        if (p != bot_p) {
+            bot_term = bot_radius * bot_radius - (p * vel) * (p * vel);
+        }
+        b = sqrt(top_term) - sqrt(bot_term);
+        *time = b / vel;
+        *dist = asin(b * p * vel / (top_radius * bot_radius));
+        return;
+    }
+    if ((bot_depth - top_depth) < 0.0000000001) {
+        return;
+    }
+    b = log(top_p / bot_p) / log(top_radius / bot_radius);
+    sqrt_top = sqrt(top_p * top_p - p * p);
+    sqrt_bot = sqrt(bot_p * bot_p - p * p);
+    *dist = (atan2(p, sqrt_bot) - atan2(p, sqrt_top)) / b;
+    *time = (sqrt_top - sqrt_bot) / b;
+}
+
+
+/* Time and distance of a ray through the nlayers slowness layers of a
+ * branch, down to the first layer it cannot pass completely. If allow_turn
+ * is set, the ray also turns within that layer. */
+static void branch_time_dist(const double *layers, int nlayers, double p,
+                             int allow_turn, double radius,
+                             double slowness_tolerance,
+                             double *time, double *dist) {
+    int j;
+    double t, d;
+    const double *layer;
+
+    *time = 0.0;
+    *dist = 0.0;
+    for (j = 0; j < nlayers; j++) {
+        layer = layers + 4 * j;
+        if (p > layer[SL_TOP_P] || p > layer[SL_BOT_P]) {
+            if (allow_turn &&
+                    (layer[SL_TOP_P] - p) * (p - layer[SL_BOT_P]) > 0) {
+                layer_time_dist(layer, p, radius, slowness_tolerance, &t, &d);
+                *time += t;
+                *dist += d;
+            }
+            break;
+        }
+        layer_time_dist(layer, p, radius, slowness_tolerance, &t, &d);
+        *time += t;
+        *dist += d;
+    }
+}
+
+
+/* Time and distance of a ray with the given ray parameter through all
+ * branches of a phase, see SeismicPhase.shoot_ray(). */
+static void shoot_ray(const shoot_segments *seg, double p,
+                      double *time, double *dist) {
+    int s;
+    double time_sum, dist_sum;
+
+    *time = 0.0;
+    *dist = 0.0;
+    for (s = 0; s < seg->count; s++) {
+        time_sum = 0.0;
+        dist_sum = 0.0;
+        if (p <= seg->max_ray_param[s]) {
+            branch_time_dist(seg->layers + 4 * seg->start[s], seg->length[s],
+                             p, 1, seg->radius, seg->slowness_tolerance,
+                             &time_sum, &dist_sum);
+        }
+        *time += seg->mult[s] * time_sum;
+        *dist += seg->mult[s] * dist_sum;
+    }
+}
+
+
+/**
+   Time and distance increments of many rays through many branches.
+
+   Branch i consists of the length[i] slowness layers starting at layer
+   start[i] of layers, which holds SlownessLayer records. For every branch
+   and each of the nray ray parameters the time and distance of the ray down
+   to the first layer it cannot pass completely are written to time and
+   dist, both of shape nbranch x nray, see TauBranch.calc_time_dist(). Rays
+   turn within that layer if allow_turn is set. Ray parameters larger than
+   max_ray_param[i] get zero time and distance.
+
+   The pairs of branches and ray parameters are distributed over several
+   threads if compiled with OpenMP.
+**/
+void tau_branch_calc_time_dist_batch(
+    const double *layers, const int *start, const int *length,
+    const double *max_ray_param, int nbranch,
+    const double *ray_params, int nray, int allow_turn,
+    double radius, double slowness_tolerance,
+    double *time, double *dist, int threads) {
+
+    int i, n = nbranch * nray;
+
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    #pragma omp parallel for num_threads(threads) schedule(guided) if(threads > 1 && n > 64)
+    for (i = 0; i < n; i++) {
+        int b = i / nray;
+        double p = ray_params[i % nray];
+
+        if (p > max_ray_param[b]) {
+            time[i] = 0.0;
+            dist[i] = 0.0;
+            continue;
+        }
+        branch_time_dist(layers + 4 * (size_t) start[b], length[b], p,
+                         allow_turn, radius, slowness_tolerance,
+                         &time[i], &dist[i]);
+    }
+    return;
+}
+
+
+/* Linear interpolation between two arrivals, see
+ * SeismicPhase.linear_interp_arrival(). Returns -1 if the time is NaN. */
+static int linear_interp_arrival(
+    const double *dist, const double *time, const double *ray_param,
+    double search_dist, const batch_arrival *left,
+    const batch_arrival *right, batch_arrival *result) {
+
+    if (left->ray_param_index == 0 && search_dist == dist[0]) {
+        result->time = time[0];
+        result->dist = search_dist;
+        result->ray_param = ray_param[0];
+        result->ray_param_index = 0;
+        return 0;
+    }
+    if (left->dist == search_dist) {
+        *result = *left;
+        return 0;
+    }
+    result->time = ((search_dist - left->dist) /
+                    (right->dist - left->dist) *
+                    (right->time - left->time)) + left->time;
+    if (isnan(result->time)) {
+        return -1;
+    }
+    result->ray_param = ((search_dist - right->dist) /
+                         (left->dist - right->dist) *
+                         (left->ray_param - right->ray_param)) +
+                        right->ray_param;
+    result->dist = search_dist;
+    result->ray_param_index = left->ray_param_index;
+    return 0;
+}
+
+
+/* Refines an arrival between the rays ray_index and ray_index + 1 of a phase
+ * by shooting rays, see SeismicPhase.refine_arrival(). No rays are shot if
+ * seg is NULL. Returns -1 if no valid arrival could be computed. */
+static int refine_arrival(
+    const double *dist, const double *time, const double *ray_param,
+    int count, int ray_index, double search_dist, double tolerance,
+    int recursion_limit, double min_ray_param, double max_ray_param,
+    const shoot_segments *seg, batch_arrival *result) {
+
+    batch_arrival left, right, estimate, shoot;
+    int i;
+
+    left.time = time[ray_index];
+    left.dist = dist[ray_index];
+    left.ray_param = ray_param[ray_index];
+    left.ray_param_index = ray_index;
+    right.time = time[ray_index + 1];
+    right.dist = dist[ray_index + 1];
+    right.ray_param = ray_param[ray_index + 1];
+    right.ray_param_index = ray_index;
+
+    for (;;) {
+        if (linear_interp_arrival(dist, time, ray_param, search_dist, &left,
+                                  &right, &estimate)) {
+            return -1;
+        }
+        if (recursion_limit <= 0 || seg == NULL) {
+            *result = estimate;
+            return 0;
+        }
+        if (estimate.ray_param < min_ray_param ||
+                max_ray_param < estimate.ray_param) {
+            return -1;
+        }
+        shoot_ray(seg, estimate.ray_param, &shoot.time, &shoot.dist);
+        if (isnan(shoot.time)) {
+            return -1;
+        }
+        shoot.ray_param = estimate.ray_param;
+        for (i = 0; i < count - 2; i++) {
+            if (ray_param[i + 1] < shoot.ray_param) {
+                break;
+            }
+        }
+        shoot.ray_param_index = i;
+
+        if ((left.dist - search_dist) * (search_dist - shoot.dist) > 0) {
+            /* search between left and shoot */
+            right = shoot;
+        }
+        else {
+            /* search between shoot and right */
+            left = shoot;
+        }
+        if (fabs(shoot.dist - estimate.dist) < tolerance) {
+            if (linear_interp_arrival(dist, time, ray_param, search_dist,
+                                      &left, &right, result)) {
+                return -1;
+            }
+            return 0;
+        }
+        recursion_limit--;
+    }
+}
+
+
+/**
+   Earliest arrival of a phase at many distances.
+
+   For every distance in degrees all arrivals of the phase are computed as
+   in SeismicPhase.calc_time() and the time and ray parameter of the
+   earliest one are written to out_time and out_ray_param, NaN if there is
+   no arrival. The phase is given by its sampled rays dist, time and
+   ray_param of length count. Arrivals are refined by shooting rays through
+   the nseg segments of slowness layers unless nseg is 0. Segment i consists
+   of the seg_length[i] layers starting at layer seg_start[i] of layers,
+   which holds SlownessLayer records. The ray passes seg_mult[i] times
+   through it if its ray parameter is not larger than seg_max_ray_param[i].
+
+   The distances are distributed over several threads if compiled with
+   OpenMP. Returns 0 on success or -1 if an arrival could not be refined,
+   in which case the results are undefined.
+**/
+int seismic_phase_calc_time_batch(
+    const double *degrees, int n,
+    double max_distance,
+    const double *dist, const double *time, const double *ray_param,
+    int count,
+    double min_ray_param, double max_ray_param,
+    double tolerance, int max_recursion,
+    const double *layers, const int *seg_start, const int *seg_length,
+    const double *seg_mult, const double *seg_max_ray_param, int nseg,
+    double radius, double slowness_tolerance,
+    double *out_time, double *out_ray_param, int threads) {
+
+    shoot_segments seg;
+    int failed = 0;
+    int i;
+
+    seg.layers = layers;
+    seg.start = seg_start;
+    seg.length = seg_length;
+    seg.mult = seg_mult;
+    seg.max_ray_param = seg_max_ray_param;
+    seg.count = nseg;
+    seg.radius = radius;
+    seg.slowness_tolerance = slowness_tolerance;
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    #pragma omp parallel for num_threads(threads) schedule(dynamic, 16) if(threads > 1)
+    for (i = 0; i < n; i++) {
+        double search_dist[MAX_PHASE_ARRIVALS];
+        int ray_num[MAX_PHASE_ARRIVALS];
+        batch_arrival arrival;
+        int found, k;
+
+        out_time[i] = NAN;
+        out_ray_param[i] = NAN;
+        if (failed) {
+            continue;
+        }
+        found = seismic_phase_search(degrees[i], max_distance, dist,
+                                     ray_param, search_dist, ray_num, count,
+                                     MAX_PHASE_ARRIVALS);
+        if (found > MAX_PHASE_ARRIVALS) {
+            found = MAX_PHASE_ARRIVALS;
+        }
+        for (k = 0; k < found; k++) {
+            if (refine_arrival(dist, time, ray_param, count, ray_num[k],
+                               search_dist[k], tolerance, max_recursion,
+                               min_ray_param, max_ray_param,
+                               nseg > 0 ? &seg : NULL, &arrival)) {
+                #pragma omp critical (seismic_phase_calc_time_batch_failed)
+                failed = 1;
+                break;
+            }
+            if (!(arrival.time >= out_time[i])) {
+                out_time[i] = arrival.time;
+                out_ray_param[i] = arrival.ray_param;
+            }
+        }
+    }
+    return failed ? -1 : 0;
+}
+
+
+/* Index i of the interval grid[i] <= x <= grid[i + 1] of an increasing grid
+ * of len values, -1 if x is outside of the grid. */
+static int grid_interval(const double *grid, int len, double x) {
+    int lo = 0, hi = len - 1, mid;
+
+    if (len < 2 || !(x >= grid[0] && x <= grid[len - 1])) {
+        return -1;
+    }
+    while (hi - lo > 1) {
+        mid = (lo + hi) / 2;
+        if (grid[mid] <= x) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+
+/**
+   Bilinear interpolation of a travel time table of one phase.
+
+   The table holds nvalues grids of ndepth x ndist values at the given
+   source depths and distances in degrees, both increasing, e.g. travel
+   time, slowness and dtdh. error holds one error estimate for each of the
+   (ndepth - 1) x (ndist - 1) cells of the grids. For each of the n queries
+   of source depth and distance the nvalues interpolated values are written
+   to out and the error estimate of the cell to out_error. Distances are
+   mapped to 0 - 180 degrees first. Queries outside of the table give NaN,
+   as do all cells with a missing value at any corner.
+
+   The queries are distributed over several threads if compiled with
+   OpenMP.
+**/
+void travel_time_table_lookup(
+    const double *distances, int ndist,
+    const double *depths, int ndepth,
+    const double *values, int nvalues,
+    const double *error,
+    const double *query_depth, const double *query_dist, int n,
+    double *out, double *out_error, int threads) {
+
+    int i;
+
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    #pragma omp parallel for num_threads(threads) schedule(static) if(threads > 1 && n > 1024)
+    for (i = 0; i < n; i++) {
+        double deg, wd, wh;
+        const double *v;
+        int id, ih, k;
+
+        deg = fmod(fabs(query_dist[i]), 360.0);
+        if (deg > 180.0) {
+            deg = 360.0 - deg;
+        }
+        id = grid_interval(distances, ndist, deg);
+        ih = grid_interval(depths, ndepth, query_depth[i]);
+        if (id < 0 || ih < 0) {
+            for (k = 0; k < nvalues; k++) {
+                out[(size_t) i * nvalues + k] = NAN;
+            }
+            out_error[i] = NAN;
+            continue;
+        }
+        wd = (deg - distances[id]) / (distances[id + 1] - distances[id]);
+        wh = (query_depth[i] - depths[ih]) / (depths[ih + 1] - depths[ih]);
+        for (k = 0; k < nvalues; k++) {
+            v = values + ((size_t) k * ndepth + ih) * ndist + id;
+            /* NaN corners propagate to the result */
+            out[(size_t) i * nvalues + k] =
+                (1.0 - wh) * ((1.0 - wd) * v[0] + wd * v[1]) +
+                wh * ((1.0 - wd) * v[ndist] + wd * v[ndist + 1]);
+        }
+        out_error[i] = error[(size_t) ih * (ndist - 1) + id];
+    }
+    return;
+}
+
+
+// Record array...change here if it changes on the Python side.
+enum {
+    VL_TOP_DEPTH,
+    VL_BOT_DEPTH,
+    VL_TOP_P_VELOCITY,
+    VL_BOT_P_VELOCITY,
+    VL_TOP_S_VELOCITY,
+    VL_BOT_S_VELOCITY,
+    VL_SIZE = 12
+};
+
+/* Errors of the path and pierce point calculations. */
+#define PATH_SLOWNESS_ERROR -1
+#define PATH_BACKTRACKING -2
+
+/* Branches a phase passes through, in the order of
+ * SeismicPhase.branch_seq, with everything needed for ray paths and pierce
+ * points. */
+typedef struct _phase_legs {
+    int count;
+    const int *down_going;
+    const double *max_ray_param;
+    /* ray paths: slowness layers of the branches and additional head or
+     * diffracted segments after a leg, NaN head_depth if there is none */
+    const double *layers;
+    const int *start;
+    const int *length;
+    const double *head_depth;
+    const double *head_divisor;
+    /* pierce points: time and distance of the branches for the ray
+     * parameters of the model and the velocity layers to find turning
+     * depths in */
+    const double *branch_time;
+    const double *branch_dist;
+    const double *model_ray_params;
+    int nray;
+    const double *min_ray_param;
+    const double *top_depth;
+    const double *bot_depth;
+    const double *vel_layers;
+    const int *vel_fluid_top;
+    int nvel;
+    const int *vel_top;
+    const int *vel_bot;
+    const int *vel_use_p;
+    /* the phase */
+    const double *phase_ray_param;
+    const double *phase_dist;
+    double source_depth;
+    int is_kmps;
+    /* number of head or diffracted wave segments in the phase, 0 if there
+     * are none */
+    int num_head;
+    double pierce_head_depth;
+    double radius;
+    double slowness_tolerance;
+} phase_legs;
+
+
+static void put_point(double *out, int i, double p, double time, double dist,
+                      double depth) {
+    if (out == NULL) {
+        return;
+    }
+    out += 4 * i;
+    out[TD_P] = p;
+    out[TD_TIME] = time;
+    out[TD_DIST] = dist;
+    out[TD_DEPTH] = depth;
+}
+
+
+/* Time and distance increments of a ray turning at the bottom of a layer,
+ * see bullen_radial_slowness_inner_loop(). Returns -1 for invalid
+ * results. */
+static int bullen_radial(const double *layer, double p, double radius,
+                         double *time, double *dist) {
+    double B, sqrt_top, sqrt_bot;
+
+    *time = 0.0;
+    *dist = 0.0;
+    if ((layer[SL_BOT_DEPTH] - layer[SL_TOP_DEPTH]) < 0.0000000001) {
+        return 0;
+    }
+    B = log(layer[SL_TOP_P] / layer[SL_BOT_P]) /
+        log((radius - layer[SL_TOP_DEPTH]) / (radius - layer[SL_BOT_DEPTH]));
+    sqrt_top = sqrt(pow(layer[SL_TOP_P], 2) - pow(p, 2));
+    sqrt_bot = sqrt(pow(layer[SL_BOT_P], 2) - pow(p, 2));
+    *dist = (atan2(p, sqrt_bot) - atan2(p, sqrt_top)) / B;
+    *time = (sqrt_top - sqrt_bot) / B;
+    if (*time < 0 || isnan(*time) || *dist < 0 || isnan(*dist)) {
+        return -1;
+    }
+    return 0;
+}
+
+
+/* Ray path of a ray of ray parameter p within a branch, see
+ * TauBranch.path(). The points are written to out starting at point i if
+ * out is not NULL, otherwise they are only counted. Returns the number of
+ * points or an error. */
+static int branch_path(const phase_legs *legs, int leg, double p, double *out,
+                       int i) {
+    const double *layers = legs->layers + 4 * (size_t) legs->start[leg];
+    const double *layer;
+    double turn_layer[4];
+    double t, d;
+    int nlayers = legs->length[leg];
+    int count = 0;
+    int j, k, first, last;
+
+    if (p > legs->max_ray_param[leg]) {
+        return 0;
+    }
+    if (legs->down_going[leg]) {
+        /* the layers down to the first one the ray turns in */
+        last = -1;
+        for (j = 0; j < nlayers && layers[4 * j + SL_BOT_P] >= p; j++) {
+            layer = layers + 4 * j;
+            if (layer[SL_TOP_DEPTH] == layer[SL_BOT_DEPTH]) {
+                continue;
+            }
+            if (out) {
+                if (p > layer[SL_TOP_P]) {
+                    return PATH_SLOWNESS_ERROR;
+                }
+                layer_time_dist(layer, p, legs->radius,
+                                legs->slowness_tolerance, &t, &d);
+                if (d < 0) {
+                    return PATH_BACKTRACKING;
+                }
+                put_point(out, i + count, p, t, d, layer[SL_BOT_DEPTH]);
+            }
+            last = j;
+            count++;
+        }
+        /* Bullen law for the turning layer */
+        j = last + 1;
+        layer = layers + 4 * j;
+        if (j < nlayers && layer[SL_TOP_DEPTH] != layer[SL_BOT_DEPTH]) {
+            if (out) {
+                turn_layer[SL_TOP_P] = layer[SL_TOP_P];
+                turn_layer[SL_TOP_DEPTH] = layer[SL_TOP_DEPTH];
+                turn_layer[SL_BOT_P] = p;
+                turn_layer[SL_BOT_DEPTH] = bullen_depth(layer, p,
+                                                        legs->radius);
+                if (isnan(turn_layer[SL_BOT_DEPTH]) ||
+                        bullen_radial(turn_layer, p, legs->radius, &t, &d)) {
+                    return PATH_SLOWNESS_ERROR;
+                }
+                put_point(out, i + count, p, t, d, turn_layer[SL_BOT_DEPTH]);
+            }
+            count++;
+        }
+    }
+    else {
+        /* skip the deepest layers the ray does not reach, but not the top
+         * layer */
+        for (k = 0; k < nlayers - 1; k++) {
+            layer = layers + 4 * (nlayers - 1 - k);
+            if (!(layer[SL_TOP_P] <= p ||
+                  layer[SL_TOP_DEPTH] == layer[SL_BOT_DEPTH])) {
+                break;
+            }
+        }
+        first = k;
+        layer = layers + 4 * (nlayers - 1 - k);
+        if (layer[SL_BOT_P] < p) {
+            /* Bullen law for the turning layer */
+            if (out) {
+                turn_layer[SL_TOP_P] = layer[SL_TOP_P];
+                turn_layer[SL_TOP_DEPTH] = layer[SL_TOP_DEPTH];
+                turn_layer[SL_BOT_P] = p;
+                turn_layer[SL_BOT_DEPTH] = bullen_depth(layer, p,
+                                                        legs->radius);
+                if (isnan(turn_layer[SL_BOT_DEPTH]) ||
+                        bullen_radial(turn_layer, p, legs->radius, &t, &d)) {
+                    return PATH_SLOWNESS_ERROR;
+                }
+                put_point(out, i + count, p, t, d, layer[SL_TOP_DEPTH]);
+            }
+            count++;
+            first++;
+        }
+        for (k = first; k < nlayers; k++) {
+            layer = layers + 4 * (nlayers - 1 - k);
+            if (layer[SL_TOP_DEPTH] == layer[SL_BOT_DEPTH]) {
+                continue;
+            }
+            if (out) {
+                if (p > layer[SL_TOP_P] || p > layer[SL_BOT_P]) {
+                    return PATH_SLOWNESS_ERROR;
+                }
+                layer_time_dist(layer, p, legs->radius,
+                                legs->slowness_tolerance, &t, &d);
+                if (d < 0) {
+                    return PATH_BACKTRACKING;
+                }
+                put_point(out, i + count, p, t, d, layer[SL_TOP_DEPTH]);
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+
+/* Ray path of an arrival, see SeismicPhase.calc_path_from_arrival(). The
+ * points are written to out if it is not NULL, otherwise they are only
+ * counted. Returns the number of points or an error. */
+static int phase_path(const phase_legs *legs, double p, double purist_dist,
+                      double *out) {
+    int count = 0;
+    int leg, n, k;
+    double head_dist;
+
+    if (p < 0) {
+        return PATH_SLOWNESS_ERROR;
+    }
+    put_point(out, count++, p, 0.0, 0.0, legs->source_depth);
+    for (leg = 0; leg < legs->count; leg++) {
+        n = branch_path(legs, leg, p, out, count);
+        if (n < 0) {
+            return n;
+        }
+        count += n;
+        /* head and diffracted waves */
+        if (!isnan(legs->head_depth[leg])) {
+            head_dist = (purist_dist - legs->phase_dist[0]) /
+                        legs->head_divisor[leg];
+            put_point(out, count++, p, head_dist * p, head_dist,
+                      legs->head_depth[leg]);
+        }
+    }
+    if (legs->is_kmps) {
+        put_point(out, count++, p, purist_dist * p, purist_dist, 0.0);
+    }
+    if (out) {
+        for (k = 1; k < count; k++) {
+            out[4 * k + TD_TIME] += out[4 * (k - 1) + TD_TIME];
+            out[4 * k + TD_DIST] += out[4 * (k - 1) + TD_DIST];
+        }
+    }
+    return count;
+}
+
+
+/* Depth at which the velocity layers top to bot (inclusive) reach the
+ * slowness p, see SlownessModel.find_depth_from_layers(). Returns NaN if
+ * there is no such depth. */
+static double find_depth(const phase_legs *legs, double p, int top, int bot,
+                         int use_p) {
+    const double *layer = NULL;
+    double top_v, bot_v, top_p, bot_p = 0.0, slope, denominator;
+    double radius = legs->radius, tolerance = legs->slowness_tolerance;
+    int v_top = use_p ? VL_TOP_P_VELOCITY : VL_TOP_S_VELOCITY;
+    int v_bot = use_p ? VL_BOT_P_VELOCITY : VL_BOT_S_VELOCITY;
+    int j;
+
+    if (top > bot) {
+        return NAN;
+    }
+    for (j = top; j <= bot; j++) {
+        layer = legs->vel_layers + VL_SIZE * (size_t) j;
+        top_v = layer[v_top];
+        bot_v = layer[v_bot];
+        if (top_v == 0 || bot_v == 0) {
+            return NAN;
+        }
+        top_p = (radius - layer[VL_TOP_DEPTH]) / top_v;
+        bot_p = (radius - layer[VL_BOT_DEPTH]) / bot_v;
+        if (fabs(top_p - p) < tolerance) {
+            return layer[VL_TOP_DEPTH];
+        }
+        if (fabs(p - bot_p) < tolerance) {
+            return layer[VL_BOT_DEPTH];
+        }
+        if ((top_p - p) * (p - bot_p) >= 0) {
+            slope = (bot_v - top_v) /
+                    (layer[VL_BOT_DEPTH] - layer[VL_TOP_DEPTH]);
+            denominator = p * slope + 1;
+            if (denominator == 0) {
+                return NAN;
+            }
+            return (radius + p * (layer[VL_TOP_DEPTH] * slope - top_v)) /
+                   denominator;
+        }
+        /* total reflection at the top of the next layer, S waves above a
+         * fluid use its P velocity */
+        if (j < legs->nvel - 1) {
+            layer = legs->vel_layers + VL_SIZE * (size_t) (j + 1);
+            top_v = layer[v_top];
+            if (!use_p && legs->vel_fluid_top[j + 1]) {
+                top_v = layer[VL_TOP_P_VELOCITY];
+            }
+            if (top_v == 0) {
+                return NAN;
+            }
+            top_p = (radius - layer[VL_TOP_DEPTH]) / top_v;
+            if (bot_p >= p && p >= top_p) {
+                return layer[VL_TOP_DEPTH];
+            }
+        }
+    }
+    /* p is just outside of the bottommost layer */
+    if (fabs(p - bot_p) < tolerance) {
+        return legs->vel_layers[VL_SIZE * (size_t) bot + VL_BOT_DEPTH];
+    }
+    return NAN;
+}
+
+
+/* Pierce points of an arrival, see
+ * SeismicPhase.calc_pierce_from_arrival(). They are written to scratch,
+ * which must hold 2 * (legs->count + 2) points. Returns the number of
+ * points or an error. */
+static int phase_pierce(const phase_legs *legs, double ray_param,
+                        double purist_dist, double time, int ray_param_index,
+                        double *scratch) {
+    const double *branch_time, *branch_dist;
+    double ray_param_a, ray_param_b, dist_a, dist_b, time_a, time_b;
+    double dist_ratio, dist_ray_param, turn_depth, branch_depth;
+    double sum_dist = 0.0, sum_time = 0.0, prev_time;
+    double refract_dist, refract_time, *pt;
+    int ray_num = 0, count = 0, heads = 0, adjust = 0;
+    int leg, i, j;
+
+    /* the model's ray parameters around the one of the arrival */
+    for (i = 0; i < legs->nray - 1; i++) {
+        if (legs->model_ray_params[i] >= ray_param) {
+            ray_num = i;
+        }
+        else {
+            break;
+        }
+    }
+    ray_param_a = legs->phase_ray_param[ray_param_index];
+    ray_param_b = legs->phase_ray_param[ray_param_index + 1];
+    dist_a = legs->phase_dist[ray_param_index];
+    dist_b = legs->phase_dist[ray_param_index + 1];
+    dist_ratio = (purist_dist - dist_a) / (dist_b - dist_a);
+    dist_ray_param = dist_ratio * (ray_param_b - ray_param_a) + ray_param_a;
+
+    put_point(scratch, count++, dist_ray_param, 0.0, 0.0, legs->source_depth);
+    for (leg = 0; leg < legs->count; leg++) {
+        if (dist_ray_param > legs->max_ray_param[leg]) {
+            turn_depth = legs->top_depth[leg];
+        }
+        else if (dist_ray_param <= legs->min_ray_param[leg]) {
+            turn_depth = legs->bot_depth[leg];
+        }
+        else {
+            turn_depth = find_depth(legs, dist_ray_param, legs->vel_top[leg],
+                                    legs->vel_bot[leg], legs->vel_use_p[leg]);
+            if (isnan(turn_depth)) {
+                return PATH_SLOWNESS_ERROR;
+            }
+        }
+
+        branch_time = legs->branch_time + (size_t) leg * legs->nray;
+        branch_dist = legs->branch_dist + (size_t) leg * legs->nray;
+        dist_a = branch_dist[ray_num];
+        time_a = branch_time[ray_num];
+        if (legs->num_head) {
+            dist_b = dist_a;
+            time_b = time_a;
+        }
+        else {
+            dist_b = branch_dist[ray_num + 1];
+            time_b = branch_time[ray_num + 1];
+        }
+        sum_dist += dist_ratio * (dist_b - dist_a) + dist_a;
+        prev_time = sum_time;
+        sum_time += dist_ratio * (time_b - time_a) + time_a;
+        if (legs->down_going[leg]) {
+            branch_depth = legs->bot_depth[leg];
+        }
+        else {
+            branch_depth = legs->top_depth[leg];
+        }
+        if (turn_depth < branch_depth) {
+            branch_depth = turn_depth;
+        }
+        /* the ray actually propagates in this branch */
+        if (fabs(prev_time - sum_time) > 1e-10) {
+            put_point(scratch, count++, dist_ray_param, sum_time, sum_dist,
+                      branch_depth);
+        }
+    }
+
+    if (legs->num_head) {
+        /* spread the refracted distance and time evenly over the head or
+         * diffracted wave segments, which start at pierce points at
+         * pierce_head_depth */
+        refract_dist = purist_dist - legs->phase_dist[0];
+        refract_time = refract_dist * ray_param;
+        for (i = 0; i < count; i++) {
+            pt = scratch + 4 * i;
+            if (pt[TD_DEPTH] == legs->pierce_head_depth) {
+                adjust++;
+            }
+            pt[TD_TIME] += adjust * refract_time / legs->num_head;
+            pt[TD_DIST] += adjust * refract_dist / legs->num_head;
+        }
+        /* the point after each one at the head depth is repeated */
+        for (i = count - 2; i >= 0; i--) {
+            if (scratch[4 * i + TD_DEPTH] == legs->pierce_head_depth) {
+                for (j = count + heads; j > i + 1; j--) {
+                    pt = scratch + 4 * j;
+                    pt[TD_P] = pt[TD_P - 4];
+                    pt[TD_TIME] = pt[TD_TIME - 4];
+                    pt[TD_DIST] = pt[TD_DIST - 4];
+                    pt[TD_DEPTH] = pt[TD_DEPTH - 4];
+                }
+                heads++;
+            }
+        }
+        count += heads;
+    }
+    else if (legs->is_kmps) {
+        put_point(scratch, count++, dist_ray_param, time, purist_dist, 0.0);
+    }
+    return count;
+}
+
+
+/* Prefix sum of the counts in offsets[1] ... offsets[n]. */
+static void cumulate_offsets(long long *offsets, int n) {
+    int i;
+
+    offsets[0] = 0;
+    for (i = 0; i < n; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+}
+
+
+/**
+   Ray paths of many arrivals of a seismic phase.
+
+   The phase passes through nleg branches, in the order of
+   SeismicPhase.branch_seq. Branch i consists of the length[i] slowness
+   layers starting at layer start[i] of layers, which holds SlownessLayer
+   records, with the direction down_going[i] and the largest ray parameter
+   max_ray_param[i]. A head or diffracted wave segment at head_depth[i] of a
+   length of (purist_dist - phase_dist[0]) / head_divisor[i] follows the
+   branch unless head_depth[i] is NaN, see
+   SeismicPhase.calc_path_from_arrival().
+
+   With count_only set, the number of points of the path of arrival j is
+   written to offsets[j + 1] and offsets is turned into the prefix sum of
+   the counts. Otherwise the TimeDist records of the path of arrival j are
+   written to out[offsets[j]] ... out[offsets[j + 1] - 1].
+
+   The arrivals are distributed over several threads if compiled with
+   OpenMP. Returns 0, PATH_SLOWNESS_ERROR if a ray cannot propagate in a
+   layer or PATH_BACKTRACKING for negative distances.
+**/
+int seismic_phase_calc_path_batch(
+    const double *layers, const int *start, const int *length,
+    const int *down_going, const double *max_ray_param,
+    const double *head_depth, const double *head_divisor, int nleg,
+    const double *phase_dist, double source_depth, int is_kmps,
+    const double *ray_param, const double *purist_dist, int n,
+    double radius, double slowness_tolerance, long long *offsets,
+    double *out, int count_only, int threads) {
+
+    phase_legs legs = {0};
+    int i, result = 0;
+
+    legs.count = nleg;
+    legs.layers = layers;
+    legs.start = start;
+    legs.length = length;
+    legs.down_going = down_going;
+    legs.max_ray_param = max_ray_param;
+    legs.head_depth = head_depth;
+    legs.head_divisor = head_divisor;
+    legs.phase_dist = phase_dist;
+    legs.source_depth = source_depth;
+    legs.is_kmps = is_kmps;
+    legs.radius = radius;
+    legs.slowness_tolerance = slowness_tolerance;
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    #pragma omp parallel for num_threads(threads) schedule(guided) if(threads > 1 && n > 1)
+    for (i = 0; i < n; i++) {
+        int count;
+
+        if (count_only) {
+            count = phase_path(&legs, ray_param[i], purist_dist[i], NULL);
+            offsets[i + 1] = count;
+        }
+        else {
+            count = phase_path(&legs, ray_param[i], purist_dist[i],
+                               out + 4 * offsets[i]);
+        }
+        if (count < 0) {
+            #pragma omp critical (calc_path_error)
+            result = count;
+        }
+    }
+    if (count_only && result == 0) {
+        cumulate_offsets(offsets, n);
+    }
+    return result;
+}
+
+
+/**
+   Pierce points of many arrivals of a seismic phase.
+
+   The phase passes through nleg branches, in the order of
+   SeismicPhase.branch_seq. Branch i goes from top_depth[i] down to
+   bot_depth[i] in the direction down_going[i], for ray parameters from
+   min_ray_param[i] to max_ray_param[i]. Rows i of branch_time and
+   branch_dist, of shape nleg x nray, are its time and distance for the
+   nray ray parameters model_ray_params of the model. Rays turning in the
+   branch do so in the velocity layers vel_top[i] ... vel_bot[i] of
+   vel_layers, which holds nvel VelocityLayer records, using the P velocity
+   if vel_use_p[i] is set. vel_fluid_top[j] tells whether the top of
+   velocity layer j is in a fluid.
+
+   Arrival j has the ray parameter ray_param[j], the distance
+   purist_dist[j], the time time[j] and lies between the samples
+   ray_param_index[j] and ray_param_index[j] + 1 of the ray parameters and
+   distances phase_ray_param and phase_dist of the phase. If num_head is
+   not 0, the phase contains that many head or diffracted wave segments at
+   head_depth, see SeismicPhase.calc_pierce_from_arrival().
+
+   The TimeDist records of the pierce points of arrival j are written to
+   out[offsets[j]] ... out[offsets[j + 1] - 1]. out must have room for
+   2 * (nleg + 2) points per arrival and offsets for n + 1 values, see
+   SeismicPhase.calc_pierce_from_arrival().
+
+   The arrivals are distributed over several threads if compiled with
+   OpenMP. Returns 0 or PATH_SLOWNESS_ERROR if no turning depth is found.
+**/
+int seismic_phase_calc_pierce_batch(
+    const double *branch_time, const double *branch_dist,
+    const double *model_ray_params, int nray,
+    const int *down_going, const double *max_ray_param,
+    const double *min_ray_param, const double *top_depth,
+    const double *bot_depth, const int *vel_top, const int *vel_bot,
+    const int *vel_use_p, int nleg,
+    const double *vel_layers, const int *vel_fluid_top, int nvel,
+    const double *phase_ray_param, const double *phase_dist,
+    double source_depth, int is_kmps, int num_head, double head_depth,
+    const double *ray_param, const double *purist_dist, const double *time,
+    const int *ray_param_index, int n,
+    double radius, double slowness_tolerance, long long *offsets,
+    double *out, int threads) {
+
+    phase_legs legs = {0};
+    int stride = 2 * (nleg + 2);
+    int i, result = 0;
+
+    legs.count = nleg;
+    legs.branch_time = branch_time;
+    legs.branch_dist = branch_dist;
+    legs.model_ray_params = model_ray_params;
+    legs.nray = nray;
+    legs.down_going = down_going;
+    legs.max_ray_param = max_ray_param;
+    legs.min_ray_param = min_ray_param;
+    legs.top_depth = top_depth;
+    legs.bot_depth = bot_depth;
+    legs.vel_top = vel_top;
+    legs.vel_bot = vel_bot;
+    legs.vel_use_p = vel_use_p;
+    legs.vel_layers = vel_layers;
+    legs.vel_fluid_top = vel_fluid_top;
+    legs.nvel = nvel;
+    legs.phase_ray_param = phase_ray_param;
+    legs.phase_dist = phase_dist;
+    legs.source_depth = source_depth;
+    legs.is_kmps = is_kmps;
+    legs.num_head = num_head;
+    legs.pierce_head_depth = head_depth;
+    legs.radius = radius;
+    legs.slowness_tolerance = slowness_tolerance;
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    #pragma omp parallel for num_threads(threads) schedule(guided) if(threads > 1 && n > 1)
+    for (i = 0; i < n; i++) {
+        int count = phase_pierce(&legs, ray_param[i], purist_dist[i],
+                                 time[i], ray_param_index[i],
+                                 out + 4 * (size_t) stride * i);
+
+        offsets[i + 1] = count;
+        if (count < 0) {
+            #pragma omp critical (calc_pierce_error)
+            result = count;
+        }
+    }
+    if (result != 0) {
+        return result;
+    }
+    /* pack the points of all arrivals */
+    cumulate_offsets(offsets, n);
+    for (i = 1; i < n; i++) {
+        memmove(out + 4 * offsets[i], out + 4 * (size_t) stride * i,
+                4 * sizeof(double) * (size_t) (offsets[i + 1] - offsets[i]));
+    }
+    return 0;
+}
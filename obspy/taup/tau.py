@@ -8,6 +8,8 @@ from __future__ import (absolute_import, division, print_function,
 from future.builtins import *  # NOQA
 
 import copy
+import hashlib
+import os
 import warnings
 
 import matplotlib.cbook
@@ -15,13 +17,17 @@ from matplotlib.cm import get_cmap
 import matplotlib.text
 import numpy as np
 
-from .helper_classes import Arrival
+from .helper_classes import Arrival, TauModelError, TravelTime
 from .tau_model import TauModel
 from .taup_create import TauPCreate
 from .taup_path import TauPPath
 from .taup_pierce import TauPPierce
+from .seismic_phase import SeismicPhase
 from .taup_time import TauPTime
 from .taup_geo import calc_dist, add_geo_to_arrivals
+from .travel_time_table import (DEFAULT_DEPTHS, DEFAULT_DISTANCES,
+                                TravelTimeTable)
+from .utils import parse_phase_list
 import obspy.geodetics.base as geodetics
 
 
@@ -365,7 +371,7 @@ class TauPyModel(object):
     """
 
     def __init__(self, model="iasp91", verbose=False, planet_flattening=0.0,
-                 cache=None):
+                 cache=None, cache_dir=None):
         """
         Loads an already created TauPy model.
 
@@ -387,6 +393,15 @@ class TauPyModel(object):
             behave correctly. If ``False`` is specified, then no cache will be
             used.
         :type cache: :class:`collections.OrderedDict` or bool
+        :param cache_dir: Directory of an on-disk cache of models split at
+            source depths. Every split model is stored in a file of its own
+            that is memory mapped when it is needed again, also by other
+            processes using the same directory. Several worker processes
+            thus share one copy of the split models and restarting them
+            does not recompute anything. Travel time tables are stored there
+            as well, see :meth:`get_travel_time_table`. The directory is
+            created if needed. Defaults to no on-disk cache.
+        :type cache_dir: str
 
         Usage:
 
@@ -400,7 +415,12 @@ class TauPyModel(object):
         2
         """
         self.verbose = verbose
-        self.model = TauModel.from_file(model, cache=cache)
+        self.model_filename = TauModel.get_filename(model)
+        self.model = TauModel.deserialize(self.model_filename, cache=cache,
+                                          cache_dir=cache_dir)
+        self.cache_dir = cache_dir
+        # Travel time tables by their hash, see get_travel_time_table().
+        self._travel_time_tables = {}
         self.planet_flattening = planet_flattening
 
     def get_travel_times(self, source_depth_in_km, distance_in_degree=None,
@@ -432,6 +452,186 @@ class TauPyModel(object):
         return Arrivals(sorted(tt.arrivals, key=lambda x: x.time),
                         model=self.model)
 
+    def get_travel_times_batch(self, source_depth_in_km, distance_in_degree,
+                               phase_list=("ttall",),
+                               receiver_depth_in_km=0.0, threads=None):
+        """
+        Return travel times of many source depths and distances at once.
+
+        Only the earliest arrival of every phase is computed, refined in the
+        same way as by :meth:`get_travel_times`. The depth corrected model is
+        computed once per distinct source depth and the distances are
+        processed by native loops without creating
+        :class:`~obspy.taup.helper_classes.Arrival` objects, which is much
+        faster for large numbers of predictions.
+
+        >>> from obspy.taup import TauPyModel
+        >>> model = TauPyModel(model="iasp91")
+        >>> tt = model.get_travel_times_batch(
+        ...     [[10.0], [100.0]], [30.0, 60.0, 90.0], phase_list=["P", "S"])
+        >>> tt.shape
+        (2, 3, 2)
+        >>> print(round(tt['time'][0, 2, 0], 2))
+        779.66
+
+        :param source_depth_in_km: Source depths in km.
+        :type source_depth_in_km: float or array_like
+        :param distance_in_degree: Epicentral distances in degrees. It is
+            broadcast against ``source_depth_in_km``, so grids of depths and
+            distances can be given as arrays of shapes ``(n, 1)`` and
+            ``(m,)``.
+        :type distance_in_degree: float or array_like
+        :param phase_list: List of phases for which travel times should be
+            calculated. Aliases like ``"ttall"`` are expanded in the same way
+            as by :meth:`get_travel_times`.
+        :type phase_list: list of str
+        :param receiver_depth_in_km: Receiver depth in km
+        :type receiver_depth_in_km: float
+        :param threads: Number of threads the distances are distributed
+            over. Defaults to the number of CPUs.
+        :type threads: int
+
+        :return: Travel time in s, ray parameter in s/radian, takeoff and
+            incident angle in degrees and derivative of the travel time with
+            respect to the source depth in s/km of the earliest arrival for
+            the broadcast shape of depths and distances with one more axis
+            for the phases in the order of the expanded ``phase_list``. All
+            values are NaN where a phase does not exist.
+        :rtype: :class:`~numpy.ndarray` (dtype =
+            :const:`~obspy.taup.helper_classes.TravelTime`)
+        """
+        depths, distances = np.broadcast_arrays(
+            np.asarray(source_depth_in_km, dtype=np.float64),
+            np.asarray(distance_in_degree, dtype=np.float64))
+        phase_names = parse_phase_list(phase_list)
+        result = np.empty(depths.shape + (len(phase_names),),
+                          dtype=TravelTime)
+        for name in TravelTime.names:
+            result[name] = np.nan
+        depths = depths.ravel()
+        distances = distances.ravel()
+        flat = result.reshape(len(depths), len(phase_names))
+
+        for depth in np.unique(depths):
+            index = np.nonzero(depths == depth)[0]
+            depth_corrected_model = self.model.depth_correct(depth)
+            if receiver_depth_in_km != depth:
+                depth_corrected_model = \
+                    depth_corrected_model.split_branch(receiver_depth_in_km)
+            for i, name in enumerate(phase_names):
+                try:
+                    phase = SeismicPhase(name, depth_corrected_model,
+                                         receiver_depth_in_km)
+                except TauModelError:
+                    continue
+                time, ray_param = phase.calc_time_batch(distances[index],
+                                                        threads=threads)
+                with np.errstate(invalid='ignore'):
+                    takeoff_angle = phase.calc_takeoff_angle(ray_param)
+                    incident_angle = phase.calc_incident_angle(ray_param)
+                    dtdh = phase.calc_dtdh(ray_param)
+                found = ~np.isnan(time)
+                flat['time'][index, i] = time
+                flat['ray_param'][index, i] = ray_param
+                flat['takeoff_angle'][index, i] = np.where(
+                    found, takeoff_angle, np.nan)
+                flat['incident_angle'][index, i] = np.where(
+                    found, incident_angle, np.nan)
+                flat['dtdh'][index, i] = np.where(found, dtdh, np.nan)
+        return result
+
+    def get_travel_time_table(self, phase_list=("P", "S"), distances=None,
+                              depths=None, receiver_depth_in_km=0.0,
+                              filename=None, threads=None):
+        """
+        Return a precomputed travel time table of the given phases.
+
+        Computing a table is done only once for a model and parameters and
+        is much more expensive than a single call of
+        :meth:`get_travel_times`. Tables are kept for the lifetime of the
+        model. Unless ``filename`` is given they are also stored in the
+        ``cache_dir`` of the model if it has one, in a file named after the
+        model and a hash of the model, phases, grids and receiver depth, so
+        tables of other parameters do not replace it. See
+        :class:`~obspy.taup.travel_time_table.TravelTimeTable` for the
+        interpolating lookups.
+
+        :param phase_list: Phases of the table.
+        :type phase_list: list of str
+        :param distances: Increasing epicentral distances in degrees.
+            Defaults to every half degree from 0 to 180 degrees.
+        :type distances: array_like
+        :param depths: Increasing source depths in km. Defaults to every 5 km
+            down to 100 km and every 25 km down to 700 km.
+        :type depths: array_like
+        :param receiver_depth_in_km: Receiver depth in km.
+        :type receiver_depth_in_km: float
+        :param filename: NumPy ``.npz`` file the table is read from if it
+            was computed for the same model, phases, grids and receiver
+            depth and stored in otherwise. ``.npz`` is appended if missing.
+        :type filename: str
+        :param threads: Number of threads the travel times are computed on.
+            Defaults to the number of CPUs.
+        :type threads: int
+        :rtype: :class:`~obspy.taup.travel_time_table.TravelTimeTable`
+        """
+        if distances is None:
+            distances = DEFAULT_DISTANCES
+        if depths is None:
+            depths = DEFAULT_DEPTHS
+        distances = np.asarray(distances, dtype=np.float64)
+        depths = np.asarray(depths, dtype=np.float64)
+        receiver_depth_in_km = float(receiver_depth_in_km)
+        model_name = self.model.s_mod.v_mod.model_name
+        key = self._travel_time_table_hash(phase_list, distances, depths,
+                                           receiver_depth_in_km)
+        if filename is None:
+            if key in self._travel_time_tables:
+                return self._travel_time_tables[key]
+            if self.cache_dir is not None:
+                filename = os.path.join(
+                    self.cache_dir, "%s_%s_travel_times.npz" % (
+                        model_name, key[:16]))
+        if filename is not None and not filename.endswith('.npz'):
+            filename += '.npz'
+        table = None
+        if filename is not None and os.path.exists(filename):
+            try:
+                table = TravelTimeTable.load(filename)
+            except Exception:
+                # Not a readable table, it is computed again and replaced.
+                table = None
+            if table is not None and not table.matches(
+                    model_name, phase_list, distances, depths,
+                    receiver_depth_in_km):
+                table = None
+        if table is None:
+            table = TravelTimeTable.build(
+                self, phase_list, distances, depths,
+                receiver_depth_in_km=receiver_depth_in_km, threads=threads)
+            if filename is not None:
+                try:
+                    table.save(filename)
+                except (IOError, OSError) as e:
+                    msg = "Could not store travel time table in '%s': %s"
+                    warnings.warn(msg % (filename, e))
+        self._travel_time_tables[key] = table
+        return table
+
+    def _travel_time_table_hash(self, phase_list, distances, depths,
+                                receiver_depth_in_km):
+        """
+        Hex digest identifying a travel time table of this model.
+        """
+        sha = hashlib.sha1(self.model.ray_params.tostring())
+        sha.update(self.model.s_mod.p_layers.tostring())
+        sha.update(self.model.s_mod.s_layers.tostring())
+        sha.update(" ".join(sorted(parse_phase_list(phase_list))).encode())
+        sha.update(distances.tostring())
+        sha.update(depths.tostring())
+        sha.update(repr(receiver_depth_in_km).encode())
+        return sha.hexdigest()
+
     def get_pierce_points(self, source_depth_in_km, distance_in_degree,
                           phase_list=("ttall",), receiver_depth_in_km=0.0):
         """
@@ -484,6 +684,130 @@ class TauPyModel(object):
         return Arrivals(sorted(rp.arrivals, key=lambda x: x.time),
                         model=self.model)
 
+    def get_pierce_points_batch(self, source_depth_in_km, distance_in_degree,
+                                phase_list=("ttall",),
+                                receiver_depth_in_km=0.0, threads=None):
+        """
+        Return pierce points of every given phase for many source depths and
+        distances at once.
+
+        The depth corrected model is computed once per distinct source depth
+        and the pierce points of all arrivals of a phase are computed by a
+        single native call.
+
+        >>> from obspy.taup import TauPyModel
+        >>> model = TauPyModel(model="iasp91")
+        >>> events = model.get_pierce_points_batch(
+        ...     [10.0, 100.0], [30.0, 60.0], phase_list=["P"])
+        >>> len(events)
+        2
+        >>> print(events[1][0].pierce[-1]['depth'])
+        0.0
+
+        :param source_depth_in_km: Source depths in km.
+        :type source_depth_in_km: float or array_like
+        :param distance_in_degree: Epicentral distances in degrees, broadcast
+            against ``source_depth_in_km``.
+        :type distance_in_degree: float or array_like
+        :param phase_list: List of phases for which travel times should be
+            calculated. If this is empty, all phases will be used.
+        :type phase_list: list of str
+        :param receiver_depth_in_km: Receiver depth in km
+        :type receiver_depth_in_km: float
+        :param threads: Number of threads the arrivals are distributed over.
+            Defaults to the number of CPUs.
+        :type threads: int
+
+        :return: The arrivals for every pair of the flattened broadcast
+            source depths and distances, as returned by
+            :meth:`get_pierce_points`.
+        :rtype: list of :class:`Arrivals`
+        """
+        return self._get_arrivals_batch(
+            source_depth_in_km, distance_in_degree, phase_list,
+            receiver_depth_in_km, threads, "calc_pierce_batch")
+
+    def get_ray_paths_batch(self, source_depth_in_km, distance_in_degree,
+                            phase_list=("ttall",), receiver_depth_in_km=0.0,
+                            threads=None):
+        """
+        Return ray paths of every given phase for many source depths and
+        distances at once.
+
+        The depth corrected model is computed once per distinct source depth
+        and the paths of all arrivals of a phase are computed by a single
+        native call.
+
+        >>> from obspy.taup import TauPyModel
+        >>> model = TauPyModel(model="iasp91")
+        >>> events = model.get_ray_paths_batch(
+        ...     10.0, [30.0, 60.0, 90.0], phase_list=["P", "S"])
+        >>> len(events)
+        3
+        >>> print(events[2][0].name, events[2][0].path[-1]['depth'])
+        P 0.0
+
+        :param source_depth_in_km: Source depths in km.
+        :type source_depth_in_km: float or array_like
+        :param distance_in_degree: Epicentral distances in degrees, broadcast
+            against ``source_depth_in_km``.
+        :type distance_in_degree: float or array_like
+        :param phase_list: List of phases for which travel times should be
+            calculated. If this is empty, all phases will be used.
+        :type phase_list: list of str
+        :param receiver_depth_in_km: Receiver depth in km
+        :type receiver_depth_in_km: float
+        :param threads: Number of threads the arrivals are distributed over.
+            Defaults to the number of CPUs.
+        :type threads: int
+
+        :return: The arrivals for every pair of the flattened broadcast
+            source depths and distances, as returned by
+            :meth:`get_ray_paths`.
+        :rtype: list of :class:`Arrivals`
+        """
+        return self._get_arrivals_batch(
+            source_depth_in_km, distance_in_degree, phase_list,
+            receiver_depth_in_km, threads, "calc_path_batch")
+
+    def _get_arrivals_batch(self, source_depth_in_km, distance_in_degree,
+                            phase_list, receiver_depth_in_km, threads,
+                            method):
+        """
+        Arrivals for many source depths and distances, with the given batch
+        method of :class:`~obspy.taup.seismic_phase.SeismicPhase` applied to
+        all arrivals of a phase.
+        """
+        depths, distances = np.broadcast_arrays(
+            np.asarray(source_depth_in_km, dtype=np.float64),
+            np.asarray(distance_in_degree, dtype=np.float64))
+        depths = depths.ravel()
+        distances = distances.ravel()
+        phase_names = parse_phase_list(phase_list)
+        events = [[] for _i in range(len(depths))]
+
+        for depth in np.unique(depths):
+            index = np.nonzero(depths == depth)[0]
+            depth_corrected_model = self.model.depth_correct(depth)
+            if receiver_depth_in_km != depth:
+                depth_corrected_model = \
+                    depth_corrected_model.split_branch(receiver_depth_in_km)
+            for name in phase_names:
+                try:
+                    phase = SeismicPhase(name, depth_corrected_model,
+                                         receiver_depth_in_km)
+                except TauModelError:
+                    continue
+                arrivals = []
+                for i in index:
+                    event_arrivals = phase.calc_time(distances[i])
+                    events[i].extend(event_arrivals)
+                    arrivals.extend(event_arrivals)
+                if arrivals:
+                    getattr(phase, method)(arrivals, threads=threads)
+        return [Arrivals(sorted(arrivals, key=lambda x: x.time),
+                         model=self.model) for arrivals in events]
+
     def get_travel_times_geo(self, source_depth_in_km, source_latitude_in_deg,
                              source_longitude_in_deg, receiver_latitude_in_deg,
                              receiver_longitude_in_deg, phase_list=("ttall",)):
@@ -8,6 +8,8 @@ from __future__ import (absolute_import, division, print_function,
 from future.builtins import *  # NOQA
 from future.utils import native_str
 
+import multiprocessing
+
 import numpy as np
 
 from .c_wrappers import clibtau
@@ -16,6 +18,78 @@ from .helper_classes import (SlownessLayer, SlownessModelError,
 from .slowness_layer import bullen_depth_for, bullen_radial_slowness
 
 
+def calc_time_dist_batch(branches, layer_ranges, s_mod, ray_params,
+                         allow_turn_in_layer=False, threads=None):
+    """
+    Time and distance increments of a set of ray parameters for several
+    branches at once.
+
+    The integration over the slowness layers is done in C, the pairs of
+    branches and ray parameters are distributed over several threads.
+
+    :param branches: The branches, with their maximum ray parameter set.
+    :type branches: list of :class:`TauBranch`
+    :param layer_ranges: Numbers of the top and bottom slowness layers of
+        every branch, inclusive.
+    :type layer_ranges: list of tuple of int
+    :param s_mod: The slowness model of the branches.
+    :type s_mod: :class:`~obspy.taup.slowness_model.SlownessModel`
+    :param ray_params: The ray parameters.
+    :type ray_params: :class:`~numpy.ndarray`
+    :param allow_turn_in_layer: Whether to include the layer a ray turns in.
+    :type allow_turn_in_layer: bool
+    :param threads: Number of threads. Defaults to the number of CPUs.
+    :type threads: int
+    :returns: Times and distances of shape
+        ``(len(branches), len(ray_params))``, zero for ray parameters larger
+        than the maximum one of a branch.
+    :rtype: tuple of :class:`~numpy.ndarray`
+    """
+    if threads is None:
+        threads = multiprocessing.cpu_count()
+    ray_params = np.ascontiguousarray(ray_params, dtype=np.float64).ravel()
+    layers = []
+    start = np.empty(len(branches), dtype=np.int32)
+    length = np.empty(len(branches), dtype=np.int32)
+    max_ray_param = np.empty(len(branches), dtype=np.float64)
+    first = 0
+    for i, (branch, (top_layer_num, bot_layer_num)) in \
+            enumerate(zip(branches, layer_ranges)):
+        layer = s_mod.get_slowness_layer(
+            np.arange(top_layer_num, bot_layer_num + 1), branch.is_p_wave)
+        layers.append(layer)
+        start[i] = first
+        length[i] = len(layer)
+        max_ray_param[i] = branch.max_ray_param
+        first += len(layer)
+    if layers:
+        layers = np.ascontiguousarray(np.concatenate(layers))
+    else:
+        layers = np.empty(0, dtype=SlownessLayer)
+
+    time = np.empty((len(branches), len(ray_params)), dtype=np.float64)
+    dist = np.empty_like(time)
+    clibtau.tau_branch_calc_time_dist_batch(
+        layers, start, length, max_ray_param, len(branches), ray_params,
+        len(ray_params), allow_turn_in_layer, s_mod.radius_of_planet,
+        s_mod.slowness_tolerance, time, dist, threads)
+    return time, dist
+
+
+def create_branches(branches, layer_ranges, s_mod, ray_params, threads=None):
+    """
+    Calculates tau for several branches prepared with
+    :meth:`TauBranch.set_bounds` in one go.
+    """
+    time, dist = calc_time_dist_batch(branches, layer_ranges, s_mod,
+                                      ray_params, threads=threads)
+    for branch, branch_time, branch_dist in zip(branches, time, dist):
+        # Own copies, inserting ray parameters resizes the arrays.
+        branch.time = branch_time.copy()
+        branch.dist = branch_dist.copy()
+        branch.tau = branch.time - ray_params * branch.dist
+
+
 class TauBranch(object):
     """
     Provides storage and methods for distance, time and tau increments for a
@@ -45,6 +119,17 @@ class TauBranch(object):
         Calculates tau for this branch, between slowness layers top_layer_num
         and bot_layer_num, inclusive.
         """
+        layer_range = self.set_bounds(s_mod, min_p_so_far)
+        create_branches([self], [layer_range], s_mod, ray_params)
+
+    def set_bounds(self, s_mod, min_p_so_far):
+        """
+        Find the slowness layers of this branch and set its ray parameter
+        limits, the first step of :meth:`create_branch`.
+
+        Returns the numbers of the top and bottom slowness layers to be
+        passed on to :func:`create_branches`.
+        """
         top_layer_num = s_mod.layer_number_below(self.top_depth,
                                                  self.is_p_wave)
         bot_layer_num = s_mod.layer_number_above(self.bot_depth,
@@ -81,36 +166,17 @@ class TauBranch(object):
         self.min_ray_param = s_mod.get_min_ray_param(self.bot_depth,
                                                      self.is_p_wave)
 
-        time_dist = self.calc_time_dist(s_mod, top_layer_num, bot_layer_num,
-                                        ray_params)
-        self.time = time_dist['time']
-        self.dist = time_dist['dist']
-        self.tau = self.time - ray_params * self.dist
+        return top_layer_num, bot_layer_num
 
     def calc_time_dist(self, s_mod, top_layer_num, bot_layer_num, ray_params,
                        allow_turn_in_layer=False):
+        time, dist = calc_time_dist_batch(
+            [self], [(top_layer_num, bot_layer_num)], s_mod, ray_params,
+            allow_turn_in_layer)
         time_dist = np.zeros(shape=ray_params.shape, dtype=TimeDist)
         time_dist['p'] = ray_params
-
-        layer_num = np.arange(top_layer_num, bot_layer_num + 1)
-        layer = s_mod.get_slowness_layer(layer_num, self.is_p_wave)
-
-        plen = len(ray_params)
-        llen = len(layer_num)
-        ray_params = np.repeat(ray_params, llen).reshape((plen, llen))
-        layer_num = np.tile(layer_num, plen).reshape((plen, llen))
-
-        # Ignore some errors because we pass in a few invalid combinations that
-        # are masked out later.
-        with np.errstate(divide='ignore', invalid='ignore'):
-            time, dist = s_mod.layer_time_dist(
-                ray_params, layer_num, self.is_p_wave, check=False,
-                allow_turn=True)
-
-        clibtau.tau_branch_calc_time_dist_inner_loop(
-            ray_params, time, dist, layer, time_dist, ray_params.shape[0],
-            ray_params.shape[1], self.max_ray_param, allow_turn_in_layer)
-
+        time_dist['time'] = time[0]
+        time_dist['dist'] = dist[0]
         return time_dist
 
     def insert(self, ray_param, s_mod, index):
@@ -8,26 +8,40 @@ from __future__ import (absolute_import, division, print_function,
 from future.builtins import *  # NOQA
 from future.utils import native_str
 
+import ast
 from collections import OrderedDict
+import hashlib
 import os
 from copy import deepcopy
 from itertools import count
 from math import pi
+from struct import calcsize, pack, unpack
+import tempfile
+import warnings
 
 import numpy as np
 
 from .helper_classes import DepthRange, SlownessModelError, TauModelError
 from .slowness_model import SlownessModel
-from .tau_branch import TauBranch
+from .tau_branch import TauBranch, create_branches
 from .velocity_model import VelocityModel
 
 
+# Files of the on-disk depth cache start with the magic bytes, the file
+# format version and the length of the array layout that follows.
+DEPTH_CACHE_HEADER = native_str('<8sHQ')
+DEPTH_CACHE_MAGIC = b'TAUPDCAC'
+DEPTH_CACHE_VERSION = 1
+# Alignment of the arrays in the files in bytes.
+DEPTH_CACHE_ALIGNMENT = 16
+
+
 class TauModel(object):
     """
     Provides storage of all the TauBranches comprising a model.
     """
     def __init__(self, s_mod, radius_of_planet, is_spherical=True, cache=None,
-                 debug=False, skip_calc=False):
+                 debug=False, skip_calc=False, cache_dir=None):
         self.debug = debug
         # Depth for which tau model as constructed.
         self.source_depth = 0.0
@@ -64,6 +78,8 @@ class TauModel(object):
             self._depth_cache = cache
         else:
             self._depth_cache = None
+        # Directory of the on-disk depth cache shared between processes.
+        self._depth_cache_dir = cache_dir
 
         if not skip_calc:
             self.calc_tau_inc_from()
@@ -118,6 +134,8 @@ class TauModel(object):
         self.ray_params = temp_ray_params[:ray_num]
         if self.debug:
             print("Number of slowness samples for tau:" + str(ray_num))
+        # The branches are integrated all at once after setting them up.
+        layer_ranges = []
         for wave_num, is_p_wave in enumerate([True, False]):
             # The minimum slowness seen so far.
             min_p_so_far = self.s_mod.get_slowness_layer(0, is_p_wave)['top_p']
@@ -137,8 +155,9 @@ class TauModel(object):
                     TauBranch(top_crit_depth['depth'], bot_crit_depth['depth'],
                               is_p_wave)
                 self.tau_branches[wave_num, crit_num].debug = self.debug
-                self.tau_branches[wave_num, crit_num].create_branch(
-                    self.s_mod, min_p_so_far, self.ray_params)
+                layer_ranges.append(
+                    self.tau_branches[wave_num, crit_num].set_bounds(
+                        self.s_mod, min_p_so_far))
                 # Update minPSoFar. Note that the new minPSoFar could be at
                 # the start of a discontinuity over a high slowness zone,
                 # so we need to check the top, bottom and the layer just
@@ -154,6 +173,8 @@ class TauModel(object):
                     self.s_mod.layer_number_above(bot_crit_depth['depth'],
                                                   is_p_wave), is_p_wave)
                 min_p_so_far = min(min_p_so_far, bot_s_layer['bot_p'])
+        create_branches(self.tau_branches.ravel(), layer_ranges, self.s_mod,
+                        self.ray_params)
         # Here we decide which branches are the closest to the Moho, CMB,
         # and IOCB by comparing the depth of the top of the branch with the
         # depths in the Velocity Model.
@@ -235,15 +256,48 @@ class TauModel(object):
                 self._depth_cache.popitem(last=False)
             return value
         else:
-            return self._load_from_depth_cache()
+            return self._load_from_depth_cache(depth)
 
     def _load_from_depth_cache(self, depth):
+        if self._depth_cache_dir is not None:
+            filename = self._depth_cache_filename(depth)
+            try:
+                arrays = _read_depth_cache_file(filename)
+                if arrays is not None:
+                    return TauModel._from_arrays(arrays, cache=False)
+            except (IndexError, KeyError, TypeError, ValueError):
+                # A well-formed file with a wrong layout, it is replaced.
+                pass
         depth_corrected = self.split_branch(depth)
         depth_corrected.source_depth = depth
         depth_corrected.source_branch = depth_corrected.find_branch(depth)
         depth_corrected.validate()
+        if self._depth_cache_dir is not None:
+            try:
+                if not os.path.isdir(self._depth_cache_dir):
+                    os.makedirs(self._depth_cache_dir)
+                _write_depth_cache_file(filename,
+                                        depth_corrected._to_arrays())
+            except EnvironmentError as e:
+                msg = "Could not store depth corrected model in '%s': %s"
+                warnings.warn(msg % (filename, e))
         return depth_corrected
 
+    def _depth_cache_filename(self, depth):
+        """
+        Name of the file of the model corrected to the given source depth in
+        the on-disk depth cache.
+
+        The name includes a hash of the ray parameters and slowness layers
+        so different models of the same name do not share files.
+        """
+        sha = hashlib.sha1(self.ray_params.tostring())
+        sha.update(self.s_mod.p_layers.tostring())
+        sha.update(self.s_mod.s_layers.tostring())
+        name = "%s_%s_%r.taupdc" % (self.s_mod.v_mod.model_name,
+                                    sha.hexdigest()[:16], float(depth))
+        return os.path.join(self._depth_cache_dir, name)
+
     def split_branch(self, depth):
         """
         Returns a new TauModel with the branches containing depth split at
@@ -307,14 +361,18 @@ class TauModel(object):
                                               index_p)
                 new_tau_branches[1, i].insert(p_wave_ray_param, out_s_mod,
                                               index_p)
+        layer_ranges = []
         for pOrS in range(2):
             new_tau_branches[pOrS, branch_to_split] = TauBranch(
                 self.tau_branches[pOrS, branch_to_split].top_depth, depth,
                 pOrS == 0)
-            new_tau_branches[pOrS, branch_to_split].create_branch(
-                out_s_mod,
-                self.tau_branches[pOrS, branch_to_split].max_ray_param,
-                out_ray_params)
+            layer_ranges.append(
+                new_tau_branches[pOrS, branch_to_split].set_bounds(
+                    out_s_mod,
+                    self.tau_branches[pOrS, branch_to_split].max_ray_param))
+        create_branches(new_tau_branches[:, branch_to_split], layer_ranges,
+                        out_s_mod, out_ray_params)
+        for pOrS in range(2):
             new_tau_branches[pOrS, branch_to_split + 1] = \
                 self.tau_branches[pOrS, branch_to_split].difference(
                     new_tau_branches[pOrS, branch_to_split],
@@ -473,6 +531,14 @@ class TauModel(object):
             moho_depth <type 'float'>
             radius_of_planet <type 'float'>
         """
+        # finally save the collection of (structured) arrays to a binary file
+        np.savez_compressed(filename, **self._to_arrays())
+
+    def _to_arrays(self):
+        """
+        Collect the contents of the model in a dictionary of (structured)
+        arrays, see :meth:`serialize`.
+        """
         # a) handle simple contents
         keys = ['cmb_branch', 'cmb_depth', 'debug', 'iocb_branch',
                 'iocb_depth', 'moho_branch', 'moho_depth', 'no_discon_depths',
@@ -536,93 +602,18 @@ class TauModel(object):
             velocity_model[key] = getattr(self.s_mod.v_mod, key)
         arrays['v_mod'] = velocity_model
         arrays['v_mod.layers'] = self.s_mod.v_mod.layers
-
-        # finally save the collection of (structured) arrays to a binary file
-        np.savez_compressed(filename, **arrays)
+        return arrays
 
     @staticmethod
-    def deserialize(filename, cache=None):
+    def deserialize(filename, cache=None, cache_dir=None):
         """
         Deserialize model from numpy npz binary file.
         """
         # XXX: Make this a with statement when old NumPy support is dropped.
         npz = np.load(filename)
         try:
-            model = TauModel(s_mod=None,
-                             radius_of_planet=float(npz["radius_of_planet"]),
-                             cache=cache, skip_calc=True)
-            complex_contents = [
-                'tau_branches', 's_mod', 'v_mod',
-                's_mod.p_layers', 's_mod.s_layers', 's_mod.critical_depths',
-                's_mod.fluid_layer_depths',
-                's_mod.high_slowness_layer_depths_p',
-                's_mod.high_slowness_layer_depths_s', 'v_mod.layers']
-
-            # a) handle simple contents
-            for key in npz.keys():
-                # we have multiple, dynamic key names for individual tau
-                # branches now, skip them all
-                if key in complex_contents or key.startswith('tau_branches'):
-                    continue
-                arr = npz[key]
-                if arr.ndim == 0:
-                    arr = arr[()]
-                setattr(model, key, arr)
-
-            # b) handle .tau_branches
-            tau_branch_keys = [key for key in npz.keys()
-                               if key.startswith('tau_branches_')]
-            j, i = tau_branch_keys[0].split("__")[1:]
-            i = int(i.split("/")[1])
-            j = int(j.split("/")[1])
-            branches = np.empty(shape=(i, j), dtype=np.object_)
-            for key in tau_branch_keys:
-                j_, i_ = key.split("__")[1:]
-                i_ = int(i_.split("/")[0])
-                j_ = int(j_.split("/")[0])
-                branches[i_][j_] = TauBranch._from_array(npz[key])
-            # no idea how numpy lays out empty arrays of object type,
-            # make a copy just in case..
-            branches = np.copy(branches)
-            setattr(model, "tau_branches", branches)
-
-            # c) handle simple contents of .s_mod
-            slowness_model = SlownessModel(v_mod=None,
-                                           skip_model_creation=True)
-            setattr(model, "s_mod", slowness_model)
-            for key in npz['s_mod'].dtype.names:
-                # restore scalar types from 0d array
-                arr = npz['s_mod'][key]
-                if arr.ndim == 0:
-                    arr = arr.flatten()[0]
-                setattr(slowness_model, key, arr)
-
-            # d) handle complex contents of .s_mod
-            for key in ['p_layers', 's_layers', 'critical_depths']:
-                setattr(slowness_model, key, npz['s_mod.' + key])
-            for key in ['fluid_layer_depths', 'high_slowness_layer_depths_p',
-                        'high_slowness_layer_depths_s']:
-                arr_ = npz['s_mod.' + key]
-                if len(arr_) == 0:
-                    data = []
-                else:
-                    data = [DepthRange._from_array(x) for x in arr_]
-                setattr(slowness_model, key, data)
-
-            # e) handle .s_mod.v_mod
-            velocity_model = VelocityModel(
-                model_name=native_str(npz["v_mod"]["model_name"]),
-                radius_of_planet=float(npz["v_mod"]["radius_of_planet"]),
-                min_radius=float(npz["v_mod"]["min_radius"]),
-                max_radius=float(npz["v_mod"]["max_radius"]),
-                moho_depth=float(npz["v_mod"]["moho_depth"]),
-                cmb_depth=float(npz["v_mod"]["cmb_depth"]),
-                iocb_depth=float(npz["v_mod"]["iocb_depth"]),
-                is_spherical=bool(npz["v_mod"]["is_spherical"]),
-                layers=None
-            )
-            setattr(slowness_model, "v_mod", velocity_model)
-            setattr(velocity_model, 'layers', npz['v_mod.layers'])
+            model = TauModel._from_arrays(npz, cache=cache,
+                                          cache_dir=cache_dir)
         finally:
             if hasattr(npz, 'close'):
                 npz.close()
@@ -631,10 +622,192 @@ class TauModel(object):
         return model
 
     @staticmethod
-    def from_file(model_name, cache=None):
+    def _from_arrays(npz, cache=None, cache_dir=None):
+        """
+        Reconstruct a model from the arrays of :meth:`_to_arrays`, given as
+        an opened npz file or a dictionary.
+        """
+        model = TauModel(s_mod=None,
+                         radius_of_planet=float(npz["radius_of_planet"]),
+                         cache=cache, skip_calc=True, cache_dir=cache_dir)
+        complex_contents = [
+            'tau_branches', 's_mod', 'v_mod',
+            's_mod.p_layers', 's_mod.s_layers', 's_mod.critical_depths',
+            's_mod.fluid_layer_depths',
+            's_mod.high_slowness_layer_depths_p',
+            's_mod.high_slowness_layer_depths_s', 'v_mod.layers']
+
+        # a) handle simple contents
+        for key in npz.keys():
+            # we have multiple, dynamic key names for individual tau
+            # branches now, skip them all
+            if key in complex_contents or key.startswith('tau_branches'):
+                continue
+            arr = npz[key]
+            if arr.ndim == 0:
+                arr = arr[()]
+            setattr(model, key, arr)
+
+        # b) handle .tau_branches
+        tau_branch_keys = [key for key in npz.keys()
+                           if key.startswith('tau_branches_')]
+        j, i = tau_branch_keys[0].split("__")[1:]
+        i = int(i.split("/")[1])
+        j = int(j.split("/")[1])
+        branches = np.empty(shape=(i, j), dtype=np.object_)
+        for key in tau_branch_keys:
+            j_, i_ = key.split("__")[1:]
+            i_ = int(i_.split("/")[0])
+            j_ = int(j_.split("/")[0])
+            branches[i_][j_] = TauBranch._from_array(npz[key])
+        # no idea how numpy lays out empty arrays of object type,
+        # make a copy just in case..
+        branches = np.copy(branches)
+        setattr(model, "tau_branches", branches)
+
+        # c) handle simple contents of .s_mod
+        slowness_model = SlownessModel(v_mod=None,
+                                       skip_model_creation=True)
+        setattr(model, "s_mod", slowness_model)
+        for key in npz['s_mod'].dtype.names:
+            # restore scalar types from 0d array
+            arr = npz['s_mod'][key]
+            if arr.ndim == 0:
+                arr = arr.flatten()[0]
+            setattr(slowness_model, key, arr)
+
+        # d) handle complex contents of .s_mod
+        for key in ['p_layers', 's_layers', 'critical_depths']:
+            setattr(slowness_model, key, npz['s_mod.' + key])
+        for key in ['fluid_layer_depths', 'high_slowness_layer_depths_p',
+                    'high_slowness_layer_depths_s']:
+            arr_ = npz['s_mod.' + key]
+            if len(arr_) == 0:
+                data = []
+            else:
+                data = [DepthRange._from_array(x) for x in arr_]
+            setattr(slowness_model, key, data)
+
+        # e) handle .s_mod.v_mod
+        velocity_model = VelocityModel(
+            model_name=native_str(npz["v_mod"]["model_name"]),
+            radius_of_planet=float(npz["v_mod"]["radius_of_planet"]),
+            min_radius=float(npz["v_mod"]["min_radius"]),
+            max_radius=float(npz["v_mod"]["max_radius"]),
+            moho_depth=float(npz["v_mod"]["moho_depth"]),
+            cmb_depth=float(npz["v_mod"]["cmb_depth"]),
+            iocb_depth=float(npz["v_mod"]["iocb_depth"]),
+            is_spherical=bool(npz["v_mod"]["is_spherical"]),
+            layers=None
+        )
+        setattr(slowness_model, "v_mod", velocity_model)
+        setattr(velocity_model, 'layers', npz['v_mod.layers'])
+        return model
+
+    @staticmethod
+    def get_filename(model_name):
+        """
+        Return the filename of an internal model or a custom model file.
+        """
         if os.path.exists(model_name):
-            filename = model_name
-        else:
-            filename = os.path.join(os.path.dirname(__file__), "data",
-                                    model_name.lower() + ".npz")
-        return TauModel.deserialize(filename, cache=cache)
+            return model_name
+        return os.path.join(os.path.dirname(__file__), "data",
+                            model_name.lower() + ".npz")
+
+    @staticmethod
+    def from_file(model_name, cache=None, cache_dir=None):
+        filename = TauModel.get_filename(model_name)
+        return TauModel.deserialize(filename, cache=cache,
+                                    cache_dir=cache_dir)
+
+
+def _align(size):
+    return -(-size // DEPTH_CACHE_ALIGNMENT) * DEPTH_CACHE_ALIGNMENT
+
+
+def _read_depth_cache_file(filename):
+    """
+    Memory map the arrays of a depth corrected model written by
+    :func:`_write_depth_cache_file`. The arrays are read-only views of the
+    file, shared between all processes using it.
+
+    Returns ``None`` if the file does not exist or is damaged. A layout
+    that does not describe arrays raises an IndexError, TypeError
+    or ValueError.
+    """
+    header_size = calcsize(DEPTH_CACHE_HEADER)
+    try:
+        buf = np.memmap(filename, dtype=np.uint8, mode='r')
+    except (EnvironmentError, ValueError):
+        return None
+    if len(buf) < header_size:
+        return None
+    magic, version, layout_size = unpack(DEPTH_CACHE_HEADER,
+                                         buf[:header_size].tostring())
+    if magic != DEPTH_CACHE_MAGIC or version != DEPTH_CACHE_VERSION or \
+            len(buf) < header_size + layout_size:
+        return None
+    try:
+        layout = ast.literal_eval(
+            buf[header_size:header_size + layout_size].tostring().decode(
+                'ascii'))
+    except (ValueError, SyntaxError, UnicodeDecodeError):
+        return None
+    start = _align(header_size + layout_size)
+
+    arrays = {}
+    for key, descr, shape, offset in layout:
+        dtype = np.dtype(descr)
+        count = int(np.prod(shape))
+        if start + offset + count * dtype.itemsize > len(buf):
+            return None
+        if count == 0:
+            arrays[key] = np.empty(shape, dtype=dtype)
+            continue
+        arrays[key] = np.frombuffer(buf, dtype=dtype, count=count,
+                                    offset=start + offset).reshape(shape)
+    return arrays
+
+
+def _write_depth_cache_file(filename, arrays):
+    """
+    Write the arrays of a depth corrected model to a file that can be
+    memory mapped with :func:`_read_depth_cache_file`.
+
+    The file is written under a temporary name and renamed afterwards, so
+    processes sharing the cache never see incomplete files.
+    """
+    arrays = [(key, np.asarray(value, order='C'))
+              for key, value in sorted(arrays.items())]
+    layout = []
+    offset = 0
+    for key, arr in arrays:
+        layout.append((key, np.lib.format.dtype_to_descr(arr.dtype),
+                       arr.shape, offset))
+        offset += _align(arr.nbytes)
+    layout = repr(layout).encode('ascii')
+    header = pack(DEPTH_CACHE_HEADER, DEPTH_CACHE_MAGIC, DEPTH_CACHE_VERSION,
+                  len(layout))
+
+    fd, temp_filename = tempfile.mkstemp(
+        dir=os.path.dirname(filename) or '.', suffix='.tmp')
+    try:
+        with os.fdopen(fd, 'wb') as fh:
+            fh.write(header)
+            fh.write(layout)
+            fh.write(b'\0' * (_align(len(header) + len(layout)) -
+                              len(header) - len(layout)))
+            for _, arr in arrays:
+                fh.write(arr.tostring())
+                fh.write(b'\0' * (_align(arr.nbytes) - arr.nbytes))
+        try:
+            os.rename(temp_filename, filename)
+        except OSError:
+            # Another process was faster (Windows does not replace files).
+            if not os.path.exists(filename):
+                raise
+            os.remove(temp_filename)
+    except Exception:
+        if os.path.exists(temp_filename):
+            os.remove(temp_filename)
+        raise
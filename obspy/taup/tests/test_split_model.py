@@ -7,11 +7,18 @@ from __future__ import (absolute_import, division, print_function,
                         unicode_literals)
 from future.builtins import *  # NOQA
 
+import os
 import unittest
+import warnings
+from struct import pack
 
 import numpy as np
 
-from obspy.taup.tau_model import TauModel
+from obspy.core.util.misc import TemporaryWorkingDirectory
+from obspy.taup.tau_branch import calc_time_dist_batch
+from obspy.taup.tau_model import (DEPTH_CACHE_HEADER, DEPTH_CACHE_MAGIC,
+                                   DEPTH_CACHE_VERSION, TauModel,
+                                   _write_depth_cache_file)
 
 
 class SplitTauModelTestCase(unittest.TestCase):
@@ -117,6 +124,133 @@ class SplitTauModelTestCase(unittest.TestCase):
                                        above.dist[i] + below.dist[i],
                                        delta=0.000000001)
 
+    def test_branch_integration(self):
+        """
+        The batch integration of the branches in C has to agree with
+        summing the layers in Python, independent of the number of threads.
+        """
+        tau_model = TauModel.from_file('iasp91')
+        rebuilt = TauModel(tau_model.s_mod, tau_model.radius_of_planet,
+                           cache=False)
+        s_mod = rebuilt.s_mod
+        for branch in rebuilt.tau_branches.ravel():
+            layer_num = np.arange(
+                s_mod.layer_number_below(branch.top_depth, branch.is_p_wave),
+                s_mod.layer_number_above(branch.bot_depth,
+                                         branch.is_p_wave) + 1)
+            layers = s_mod.get_slowness_layer(layer_num, branch.is_p_wave)
+            for i in range(0, len(rebuilt.ray_params), 7):
+                p = rebuilt.ray_params[i]
+                time = dist = 0.0
+                # Layers down to the first one the ray cannot pass.
+                mask = np.cumprod((layers['top_p'] >= p) &
+                                  (layers['bot_p'] >= p)).astype(np.bool_)
+                if p <= branch.max_ray_param and np.any(mask):
+                    t, d = s_mod.layer_time_dist(p, layer_num[mask],
+                                                 branch.is_p_wave)
+                    time = np.sum(t)
+                    dist = np.sum(d)
+                self.assertAlmostEqual(branch.time[i], time, delta=1e-9)
+                self.assertAlmostEqual(branch.dist[i], dist, delta=1e-12)
+                self.assertAlmostEqual(branch.tau[i], time - p * dist,
+                                       delta=1e-9)
+
+        s_mod = tau_model.s_mod
+        branches = tau_model.tau_branches.ravel()
+        layer_ranges = [
+            (s_mod.layer_number_below(br.top_depth, br.is_p_wave),
+             s_mod.layer_number_above(br.bot_depth, br.is_p_wave))
+            for br in branches]
+        single = calc_time_dist_batch(branches, layer_ranges, s_mod,
+                                      tau_model.ray_params, threads=1)
+        for threads in (2, 5):
+            multi = calc_time_dist_batch(branches, layer_ranges, s_mod,
+                                         tau_model.ray_params,
+                                         threads=threads)
+            np.testing.assert_array_equal(multi[0], single[0])
+            np.testing.assert_array_equal(multi[1], single[1])
+
+    def test_depth_cache_dir(self):
+        """
+        Depth corrected models are stored in and memory mapped from the
+        on-disk cache.
+        """
+        def compare(model_a, model_b):
+            np.testing.assert_array_equal(model_a.ray_params,
+                                          model_b.ray_params)
+            self.assertEqual(model_a.source_branch, model_b.source_branch)
+            for br_a, br_b in zip(model_a.tau_branches.ravel(),
+                                  model_b.tau_branches.ravel()):
+                self.assertEqual(br_a.top_depth, br_b.top_depth)
+                self.assertEqual(br_a.bot_depth, br_b.bot_depth)
+                np.testing.assert_array_equal(br_a.time, br_b.time)
+                np.testing.assert_array_equal(br_a.dist, br_b.dist)
+                np.testing.assert_array_equal(br_a.tau, br_b.tau)
+            np.testing.assert_array_equal(model_a.s_mod.p_layers,
+                                          model_b.s_mod.p_layers)
+            np.testing.assert_array_equal(model_a.s_mod.s_layers,
+                                          model_b.s_mod.s_layers)
+
+        uncached = TauModel.from_file('iasp91', cache=False)
+        with TemporaryWorkingDirectory():
+            tau_model = TauModel.from_file('iasp91', cache=False,
+                                           cache_dir='depth_cache')
+            computed = tau_model.depth_correct(123.4)
+            self.assertEqual(len(os.listdir('depth_cache')), 1)
+            compare(computed, uncached.depth_correct(123.4))
+
+            # Another model instance maps the stored one.
+            other = TauModel.from_file('iasp91', cache=False,
+                                       cache_dir='depth_cache')
+            stored = other.depth_correct(123.4)
+            self.assertFalse(stored.ray_params.flags.writeable)
+            self.assertFalse(stored.tau_branches[0, 0].time.flags.writeable)
+            self.assertEqual(stored.source_depth, 123.4)
+            compare(stored, computed)
+            # Splitting the stored model again for a buried receiver works on
+            # copies.
+            compare(stored.split_branch(50.0), computed.split_branch(50.0))
+
+            # Damaged files are replaced.
+            filename = tau_model._depth_cache_filename(200.0)
+            with open(filename, 'wb') as fh:
+                fh.write(b'damaged')
+            compare(tau_model.depth_correct(200.0),
+                    uncached.depth_correct(200.0))
+            compare(other.depth_correct(200.0),
+                    uncached.depth_correct(200.0))
+            self.assertEqual(len(os.listdir('depth_cache')), 2)
+
+            # So are well-formed files with a wrong layout.
+            for depth, layout in ((300.0, b"[('x', 'nonsense', (1,), 0)]"),
+                                  (400.0, b"[(1, 2)]")):
+                filename = tau_model._depth_cache_filename(depth)
+                with open(filename, 'wb') as fh:
+                    fh.write(pack(DEPTH_CACHE_HEADER, DEPTH_CACHE_MAGIC,
+                                  DEPTH_CACHE_VERSION, len(layout)))
+                    fh.write(layout)
+            _write_depth_cache_file(tau_model._depth_cache_filename(500.0),
+                                    {'x': np.arange(3.0)})
+            # no tau branches at all
+            _write_depth_cache_file(tau_model._depth_cache_filename(600.0),
+                                    {'radius_of_planet': np.array(6371.0)})
+            for depth in (300.0, 400.0, 500.0, 600.0):
+                compare(tau_model.depth_correct(depth),
+                        uncached.depth_correct(depth))
+
+        # Without write permissions the model is computed with a warning.
+        with TemporaryWorkingDirectory():
+            with open('depth_cache', 'wb') as fh:
+                fh.write(b'not a directory')
+            tau_model = TauModel.from_file('iasp91', cache=False,
+                                           cache_dir='depth_cache')
+            with warnings.catch_warnings(record=True) as w:
+                warnings.simplefilter('always')
+                computed = tau_model.depth_correct(123.4)
+            self.assertTrue(any('Could not store' in str(x.message)
+                                for x in w))
+            compare(computed, uncached.depth_correct(123.4))
+
 
 def suite():
     return unittest.makeSuite(SplitTauModelTestCase, 'test')
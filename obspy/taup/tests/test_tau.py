@@ -810,6 +810,101 @@ class TauPyModelTestCase(unittest.TestCase):
 
         self._compare_arrivals_with_file(arrivals, "buried_receivers.txt")
 
+    def test_travel_times_batch(self):
+        """
+        Batch travel times have to agree with the earliest arrivals of
+        get_travel_times().
+        """
+        m = TauPyModel(model="iasp91")
+        phases = ["P", "S", "PcP", "PKIKP", "Pn", "Pdiff", "4kmps"]
+        depths = np.array([0.0, 10.0, 150.0, 10.0])
+        distances = np.array([2.0, 35.0, 75.0, 110.0, 150.0])
+        for threads in (1, 3):
+            tt = m.get_travel_times_batch(depths[:, None], distances,
+                                          phase_list=phases,
+                                          receiver_depth_in_km=5.0,
+                                          threads=threads)
+            self.assertEqual(tt.shape, (4, 5, 7))
+            for i, depth in enumerate(depths):
+                for j, distance in enumerate(distances):
+                    arrivals = m.get_travel_times(
+                        depth, distance, phase_list=phases,
+                        receiver_depth_in_km=5.0)
+                    for k, phase in enumerate(phases):
+                        arrs = [arr for arr in arrivals if arr.name == phase]
+                        if not arrs:
+                            self.assertTrue(np.isnan(tt['time'][i, j, k]))
+                            continue
+                        arr = arrs[0]
+                        np.testing.assert_allclose(
+                            [tt['time'][i, j, k], tt['ray_param'][i, j, k],
+                             tt['takeoff_angle'][i, j, k],
+                             tt['incident_angle'][i, j, k]],
+                            [arr.time, arr.ray_param, arr.takeoff_angle,
+                             arr.incident_angle], rtol=1e-8, atol=1e-8)
+        # paired depths and distances
+        tt = m.get_travel_times_batch(depths, distances[:4], ["P"])
+        self.assertEqual(tt.shape, (4, 1))
+        self.assertAlmostEqual(
+            tt['time'][1, 0],
+            m.get_travel_times(10.0, 35.0, ["P"])[0].time, 8)
+
+    def test_paths_and_pierce_points_batch(self):
+        """
+        Batch ray paths and pierce points have to agree with those of
+        get_ray_paths() and get_pierce_points() and with the paths of the
+        individual branches.
+        """
+        m = TauPyModel(model="iasp91")
+        phases = ["P", "PcP", "PKiKP", "SKS", "Pn", "Pdiff", "4kmps"]
+        depths = np.array([[10.0], [150.0]])
+        distances = np.array([2.0, 35.0, 110.0, 150.0])
+        paths = m.get_ray_paths(10.0, 110.0, phase_list=phases)
+        for threads in (1, 3):
+            path_events = m.get_ray_paths_batch(depths, distances, phases,
+                                                threads=threads)
+            pierce_events = m.get_pierce_points_batch(
+                depths, distances, phases, threads=threads)
+            self.assertEqual(len(path_events), 8)
+            self.assertEqual(len(pierce_events), 8)
+            for i, (depth, distance) in enumerate(
+                    zip(np.repeat(depths, 4), np.tile(distances, 2))):
+                expected = m.get_ray_paths(depth, distance, phases)
+                self.assertEqual([a.name for a in path_events[i]],
+                                 [a.name for a in expected])
+                for arr, exp in zip(path_events[i], expected):
+                    np.testing.assert_array_equal(arr.path, exp.path)
+                expected = m.get_pierce_points(depth, distance, phases)
+                self.assertEqual([a.name for a in pierce_events[i]],
+                                 [a.name for a in expected])
+                for arr, exp in zip(pierce_events[i], expected):
+                    np.testing.assert_array_equal(arr.pierce, exp.pierce)
+        self.assertEqual([a.name for a in paths],
+                         [a.name for a in path_events[2]])
+
+        # Compare with the paths of the individual branches.
+        for arr in paths:
+            phase = arr.phase
+            tau_model = phase.tau_model
+            parts = [np.array([(arr.ray_param, 0, 0,
+                                tau_model.source_depth)],
+                              dtype=arr.path.dtype)]
+            for branch_num, is_p_wave, is_down_going in zip(
+                    phase.branch_seq, phase.wave_type, phase.down_going):
+                br = tau_model.get_tau_branch(branch_num, is_p_wave)
+                parts.append(br.path(arr.ray_param, is_down_going,
+                                     tau_model.s_mod))
+            expected = np.concatenate(parts)
+            if arr.name in ("P", "PcP", "PKiKP", "SKS"):
+                np.testing.assert_allclose(arr.path['depth'],
+                                           expected['depth'])
+                np.testing.assert_allclose(arr.path['time'],
+                                           np.cumsum(expected['time']),
+                                           rtol=1e-10)
+                np.testing.assert_allclose(arr.path['dist'],
+                                           np.cumsum(expected['dist']),
+                                           rtol=1e-10, atol=1e-14)
+
     def test_different_models(self):
         """
         Open all included models and make sure that they can produce
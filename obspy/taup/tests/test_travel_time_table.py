@@ -0,0 +1,188 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+Tests the travel time tables.
+"""
+from __future__ import (absolute_import, division, print_function,
+                        unicode_literals)
+from future.builtins import *  # NOQA
+
+import os
+import unittest
+
+import numpy as np
+
+from obspy.core.util.base import NamedTemporaryFile
+from obspy.core.util.misc import TemporaryWorkingDirectory
+from obspy.taup.tau import TauPyModel
+from obspy.taup.travel_time_table import TravelTimeTable
+
+
+class TravelTimeTableTestCase(unittest.TestCase):
+    """
+    Test suite for the TravelTimeTable class.
+    """
+    def setUp(self):
+        self.model = TauPyModel('iasp91')
+        self.distances = np.arange(30.0, 51.0)
+        self.depths = np.array([0.0, 10.0, 50.0, 100.0])
+
+    def test_lookup(self):
+        """
+        Interpolated travel times have to be close to the exact ones and
+        exact on the grid.
+        """
+        table = TravelTimeTable.build(self.model, ["P", "S"],
+                                      distances=self.distances,
+                                      depths=self.depths)
+        self.assertEqual(table.phase_names, ["P", "S"])
+        self.assertEqual(table.time.shape, (2, 4, 21))
+        self.assertEqual(table.time_error.shape, (2, 3, 20))
+        self.assertTrue(np.all(table.max_time_error < 0.5))
+
+        # grid nodes
+        tt = table.lookup("S", 50.0, 40.0)
+        arrival = self.model.get_travel_times(50.0, 40.0, ["S"])[0]
+        self.assertAlmostEqual(float(tt['time']), arrival.time, 8)
+        self.assertAlmostEqual(float(tt['slowness']),
+                               arrival.ray_param_sec_degree, 8)
+
+        # between grid nodes
+        depths = np.array([3.0, 33.0, 75.0, 99.0])
+        distances = np.array([30.5, 37.3, 44.8, 49.9])
+        tt = table.lookup("P", depths, distances, threads=2)
+        self.assertEqual(tt.shape, (4,))
+        for i in range(4):
+            arrival = self.model.get_travel_times(depths[i], distances[i],
+                                                  ["P"])[0]
+            self.assertLess(abs(tt['time'][i] - arrival.time), 0.5)
+            self.assertLess(abs(tt['time'][i] - arrival.time),
+                            10 * tt['time_error'][i] + 0.01)
+
+        # grids of queries and distances mapped to 0 - 180 degrees
+        tt = table.lookup("P", depths[:, None], [-35.0, 325.0, 35.0])
+        self.assertEqual(tt.shape, (4, 3))
+        np.testing.assert_allclose(tt['time'][:, 0], tt['time'][:, 2])
+        np.testing.assert_allclose(tt['time'][:, 1], tt['time'][:, 2])
+
+        # outside of the table
+        tt = table.lookup("P", [10.0, 150.0], [60.0, 40.0])
+        self.assertTrue(np.all(np.isnan(tt['time'])))
+        self.assertRaises(ValueError, table.lookup, "PcP", 10.0, 40.0)
+
+    def test_dtdh(self):
+        """
+        The depth derivative has to match the travel times at neighbouring
+        depths.
+        """
+        table = TravelTimeTable.build(self.model, ["P", "pP"],
+                                      distances=self.distances,
+                                      depths=self.depths)
+        for phase in ("P", "pP"):
+            dtdh = float(table.lookup(phase, 50.0, 40.0)['dtdh'])
+            t1 = self.model.get_travel_times(49.5, 40.0, [phase])[0].time
+            t2 = self.model.get_travel_times(50.5, 40.0, [phase])[0].time
+            self.assertAlmostEqual(dtdh, t2 - t1, 3)
+        # the upgoing leg of pP gets longer with depth
+        self.assertLess(table.lookup("P", 50.0, 40.0)['dtdh'], 0)
+        self.assertGreater(table.lookup("pP", 50.0, 40.0)['dtdh'], 0)
+
+    def test_stored_table(self):
+        """
+        Tables are stored and only recomputed for other parameters.
+        """
+        with NamedTemporaryFile(suffix=".npz") as tf:
+            table = self.model.get_travel_time_table(
+                ["P"], distances=self.distances, depths=self.depths,
+                filename=tf.name)
+            stored = TravelTimeTable.load(tf.name)
+            self.assertEqual(stored.model_name, table.model_name)
+            self.assertEqual(stored.phase_names, ["P"])
+            np.testing.assert_array_equal(stored.time, table.time)
+            np.testing.assert_array_equal(stored.time_error,
+                                          table.time_error)
+            self.assertTrue(stored.matches(table.model_name, ["P"],
+                                           self.distances, self.depths,
+                                           0.0))
+            self.assertFalse(stored.matches(table.model_name, ["P", "S"],
+                                            self.distances, self.depths,
+                                            0.0))
+
+            table = self.model.get_travel_time_table(
+                ["P", "S"], distances=self.distances, depths=self.depths,
+                filename=tf.name)
+            self.assertEqual(TravelTimeTable.load(tf.name).phase_names,
+                             ["P", "S"])
+
+    def test_cached_table(self):
+        """
+        Without a file name tables are kept in memory and stored in the
+        cache directory of the model under names keyed by their parameters.
+        """
+        table = self.model.get_travel_time_table(
+            ["P"], distances=self.distances, depths=self.depths)
+        self.assertIs(self.model.get_travel_time_table(
+            ["P"], distances=self.distances, depths=self.depths), table)
+
+        with TemporaryWorkingDirectory():
+            model = TauPyModel('iasp91', cache_dir='cache')
+            table_p = model.get_travel_time_table(
+                ["P"], distances=self.distances, depths=self.depths)
+            table_ps = model.get_travel_time_table(
+                ["P", "S"], distances=self.distances, depths=self.depths)
+            model.get_travel_time_table(
+                ["P"], distances=self.distances, depths=self.depths[:2])
+            files = [name for name in os.listdir('cache')
+                     if name.endswith('_travel_times.npz')]
+            self.assertEqual(len(files), 3)
+            # Another model instance reads the stored tables.
+            other = TauPyModel('iasp91', cache_dir='cache')
+            stored = other.get_travel_time_table(
+                ["S", "P"], distances=self.distances, depths=self.depths)
+            self.assertEqual(sorted(stored.phase_names), ["P", "S"])
+            np.testing.assert_array_equal(stored.time, table_ps.time)
+            stored = other.get_travel_time_table(
+                ["P"], distances=self.distances, depths=self.depths)
+            np.testing.assert_array_equal(stored.time, table_p.time)
+            self.assertEqual(files, [
+                name for name in os.listdir('cache')
+                if name.endswith('_travel_times.npz')])
+
+            # Truncated files are computed again and replaced.
+            sizes = {}
+            for name in files:
+                filename = os.path.join('cache', name)
+                sizes[name] = os.path.getsize(filename)
+                with open(filename, 'r+b') as fh:
+                    fh.truncate(sizes[name] // 2)
+            other = TauPyModel('iasp91', cache_dir='cache')
+            stored = other.get_travel_time_table(
+                ["P", "S"], distances=self.distances, depths=self.depths)
+            np.testing.assert_array_equal(stored.time, table_ps.time)
+            other.get_travel_time_table(
+                ["P"], distances=self.distances, depths=self.depths)
+            other.get_travel_time_table(
+                ["P"], distances=self.distances, depths=self.depths[:2])
+            for name in files:
+                filename = os.path.join('cache', name)
+                self.assertEqual(os.path.getsize(filename), sizes[name])
+                TravelTimeTable.load(filename)
+
+            # The suffix is added to file names without it.
+            table = model.get_travel_time_table(
+                ["P"], distances=self.distances, depths=self.depths,
+                filename='table')
+            self.assertTrue(os.path.exists('table.npz'))
+            self.assertFalse(os.path.exists('table'))
+            stored = other.get_travel_time_table(
+                ["P"], distances=self.distances, depths=self.depths,
+                filename='table.npz')
+            np.testing.assert_array_equal(stored.time, table.time)
+
+
+def suite():
+    return unittest.makeSuite(TravelTimeTableTestCase, 'test')
+
+
+if __name__ == '__main__':
+    unittest.main(defaultTest='suite')
@@ -0,0 +1,314 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+Precomputed travel time tables with fast interpolating lookups.
+"""
+from __future__ import (absolute_import, division, print_function,
+                        unicode_literals)
+from future.builtins import *  # NOQA
+
+import math
+import multiprocessing
+import os
+import tempfile
+
+import numpy as np
+
+from .c_wrappers import clibtau
+from .helper_classes import TableTravelTime
+from .utils import parse_phase_list
+
+
+# Default grids of the tables, in degrees and km.
+DEFAULT_DISTANCES = np.linspace(0.0, 180.0, 361)
+DEFAULT_DEPTHS = np.concatenate([np.arange(0.0, 100.0, 5.0),
+                                 np.arange(100.0, 700.1, 25.0)])
+
+# Travel time, slowness and dtdh are interpolated.
+_TABLE_VALUES = ('time', 'slowness', 'dtdh')
+
+
+def _check_grid(grid, name):
+    grid = np.array(grid, dtype=np.float64)
+    if grid.ndim != 1 or len(grid) < 2 or np.any(np.diff(grid) <= 0):
+        msg = "%s must be a 1D array of at least two increasing values."
+        raise ValueError(msg % name)
+    return grid
+
+
+class TravelTimeTable(object):
+    """
+    Travel times of a set of phases sampled on a grid of source depths and
+    epicentral distances.
+
+    The table holds the travel time (s), the slowness (s/degree) and the
+    derivative of the travel time with respect to the source depth (s/km)
+    of the earliest arrival of every phase. Values in between are
+    interpolated bilinearly in C, which takes on the order of a microsecond
+    per value.
+
+    The interpolation error of the travel time is estimated while building
+    the table by comparing the interpolated with the exact travel time at
+    the centre of every grid cell. The estimates are returned along with
+    the interpolated values. Cells at which a phase starts or ends or in
+    which its earliest branch changes have large errors.
+
+    Tables are built with :meth:`build` or
+    :meth:`~obspy.taup.tau.TauPyModel.get_travel_time_table`, the latter
+    keeps them and stores them in the cache directory of the model.
+
+    >>> from obspy.taup import TauPyModel
+    >>> model = TauPyModel(model="iasp91")
+    >>> table = TravelTimeTable.build(model, ["P"],
+    ...                               distances=np.arange(80.0, 101.0),
+    ...                               depths=[0.0, 10.0, 20.0])
+    >>> tt = table.lookup("P", 10.0, 90.0)
+    >>> print(round(float(tt['time']), 2))
+    779.66
+    >>> print(float(tt['time_error']) < 0.1)
+    True
+    """
+    def __init__(self, model_name, phase_names, distances, depths,
+                 receiver_depth, time, slowness, dtdh, time_error):
+        """
+        :param model_name: Name of the model the table was computed with.
+        :type model_name: str
+        :param phase_names: Names of the phases in the table.
+        :type phase_names: list of str
+        :param distances: Increasing epicentral distances in degrees.
+        :type distances: :class:`~numpy.ndarray`
+        :param depths: Increasing source depths in km.
+        :type depths: :class:`~numpy.ndarray`
+        :param receiver_depth: Receiver depth in km.
+        :type receiver_depth: float
+        :param time: Travel times in s, NaN if a phase does not exist.
+        :type time: :class:`~numpy.ndarray` (shape = ``(len(phase_names),
+            len(depths), len(distances))``)
+        :param slowness: Slowness in s/degree.
+        :type slowness: :class:`~numpy.ndarray`, same shape as ``time``
+        :param dtdh: Derivative of the travel time with respect to the source
+            depth in s/km.
+        :type dtdh: :class:`~numpy.ndarray`, same shape as ``time``
+        :param time_error: Estimated interpolation error of the travel time
+            in s for every grid cell.
+        :type time_error: :class:`~numpy.ndarray` (shape =
+            ``(len(phase_names), len(depths) - 1, len(distances) - 1)``)
+        """
+        self.model_name = model_name
+        self.phase_names = list(phase_names)
+        self.distances = _check_grid(distances, "distances")
+        self.depths = _check_grid(depths, "depths")
+        self.receiver_depth = float(receiver_depth)
+        shape = (len(self.phase_names), len(self.depths),
+                 len(self.distances))
+        # All values of one phase are contiguous in memory.
+        self._values = np.empty((shape[0], len(_TABLE_VALUES)) + shape[1:],
+                                dtype=np.float64)
+        for i, values in enumerate((time, slowness, dtdh)):
+            values = np.asarray(values, dtype=np.float64)
+            if values.shape != shape:
+                msg = "%s must have the shape %s." % (_TABLE_VALUES[i], shape)
+                raise ValueError(msg)
+            self._values[:, i] = values
+        self.time_error = np.ascontiguousarray(time_error, dtype=np.float64)
+        if self.time_error.shape != (shape[0], shape[1] - 1, shape[2] - 1):
+            msg = "time_error must have one value per grid cell."
+            raise ValueError(msg)
+
+    @property
+    def time(self):
+        return self._values[:, 0]
+
+    @property
+    def slowness(self):
+        return self._values[:, 1]
+
+    @property
+    def dtdh(self):
+        return self._values[:, 2]
+
+    @property
+    def max_time_error(self):
+        """
+        Largest estimated interpolation error of the travel time of every
+        phase, over all cells in which it exists at all corners.
+        """
+        error = np.where(np.isnan(self.time_error), 0.0, self.time_error)
+        return error.reshape(len(self.phase_names), -1).max(axis=1)
+
+    @classmethod
+    def build(cls, model, phase_list=("P", "S"), distances=None, depths=None,
+              receiver_depth_in_km=0.0, threads=None):
+        """
+        Compute a travel time table with a model.
+
+        :param model: The model to compute the travel times with.
+        :type model: :class:`~obspy.taup.tau.TauPyModel`
+        :param phase_list: Phases of the table. Aliases like ``"ttbasic"``
+            are expanded.
+        :type phase_list: list of str
+        :param distances: Increasing epicentral distances in degrees.
+            Defaults to every half degree from 0 to 180 degrees.
+        :type distances: array_like
+        :param depths: Increasing source depths in km. Defaults to every 5 km
+            down to 100 km and every 25 km down to 700 km.
+        :type depths: array_like
+        :param receiver_depth_in_km: Receiver depth in km.
+        :type receiver_depth_in_km: float
+        :param threads: Number of threads the travel times are computed on.
+            Defaults to the number of CPUs.
+        :type threads: int
+        :rtype: :class:`TravelTimeTable`
+        """
+        if distances is None:
+            distances = DEFAULT_DISTANCES
+        if depths is None:
+            depths = DEFAULT_DEPTHS
+        distances = _check_grid(distances, "distances")
+        depths = _check_grid(depths, "depths")
+        phase_names = parse_phase_list(phase_list)
+
+        grid = model.get_travel_times_batch(
+            depths[:, None], distances, phase_names,
+            receiver_depth_in_km=receiver_depth_in_km, threads=threads)
+        grid = grid.transpose(2, 0, 1)
+        # Exact travel times at the cell centres for the error estimates.
+        centres = model.get_travel_times_batch(
+            (depths[:-1, None] + depths[1:, None]) / 2.0,
+            (distances[:-1] + distances[1:]) / 2.0, phase_names,
+            receiver_depth_in_km=receiver_depth_in_km, threads=threads)
+        centres = centres['time'].transpose(2, 0, 1)
+
+        time = grid['time']
+        interpolated = (time[:, :-1, :-1] + time[:, :-1, 1:] +
+                        time[:, 1:, :-1] + time[:, 1:, 1:]) / 4.0
+        with np.errstate(invalid='ignore'):
+            time_error = np.abs(centres - interpolated)
+        # The phase vanishes inside of the cell.
+        time_error[np.isnan(centres) & ~np.isnan(interpolated)] = np.inf
+
+        return cls(model.model.s_mod.v_mod.model_name, phase_names,
+                   distances, depths, receiver_depth_in_km, time,
+                   grid['ray_param'] * math.pi / 180.0, grid['dtdh'],
+                   time_error)
+
+    def lookup(self, phase, source_depth_in_km, distance_in_degree,
+               threads=None):
+        """
+        Interpolate the travel times of a phase.
+
+        :param phase: Name of the phase.
+        :type phase: str
+        :param source_depth_in_km: Source depths in km.
+        :type source_depth_in_km: float or array_like
+        :param distance_in_degree: Epicentral distances in degrees, broadcast
+            against ``source_depth_in_km``.
+        :type distance_in_degree: float or array_like
+        :param threads: Number of threads for large numbers of values.
+            Defaults to the number of CPUs.
+        :type threads: int
+        :return: Travel time in s, slowness in s/degree, derivative of the
+            travel time with respect to the source depth in s/km and the
+            estimated interpolation error of the travel time in s, all NaN
+            outside of the table or where the phase does not exist.
+        :rtype: :class:`~numpy.ndarray` (dtype =
+            :const:`~obspy.taup.helper_classes.TableTravelTime`)
+        """
+        try:
+            index = self.phase_names.index(phase)
+        except ValueError:
+            msg = "Phase '%s' is not part of the table." % phase
+            raise ValueError(msg)
+        if threads is None:
+            threads = multiprocessing.cpu_count()
+        depths, distances = np.broadcast_arrays(
+            np.asarray(source_depth_in_km, dtype=np.float64),
+            np.asarray(distance_in_degree, dtype=np.float64))
+        shape = depths.shape
+        depths = np.ascontiguousarray(depths.ravel())
+        distances = np.ascontiguousarray(distances.ravel())
+        n = len(depths)
+        values = np.empty((n, len(_TABLE_VALUES)), dtype=np.float64)
+        time_error = np.empty(n, dtype=np.float64)
+
+        clibtau.travel_time_table_lookup(
+            self.distances, len(self.distances), self.depths,
+            len(self.depths), self._values[index], len(_TABLE_VALUES),
+            self.time_error[index], depths, distances, n, values,
+            time_error, threads)
+
+        result = np.empty(n, dtype=TableTravelTime)
+        for i, name in enumerate(_TABLE_VALUES):
+            result[name] = values[:, i]
+        result['time_error'] = time_error
+        return result.reshape(shape)
+
+    def matches(self, model_name, phase_list, distances, depths,
+                receiver_depth_in_km):
+        """
+        Check whether the table was computed for the given parameters.
+        """
+        return (self.model_name == model_name and
+                sorted(self.phase_names) ==
+                sorted(parse_phase_list(phase_list)) and
+                np.array_equal(self.distances, distances) and
+                np.array_equal(self.depths, depths) and
+                self.receiver_depth == receiver_depth_in_km)
+
+    def save(self, filename):
+        """
+        Store the table in a NumPy ``.npz`` file.
+
+        The file is written under a temporary name in the same directory and
+        renamed afterwards, so processes sharing a directory never see
+        incomplete files. The directory is created if needed and the name is
+        used as given, without appending ``.npz``.
+        """
+        directory = os.path.dirname(filename) or '.'
+        if not os.path.isdir(directory):
+            os.makedirs(directory)
+        fd, temp_filename = tempfile.mkstemp(dir=directory, suffix='.tmp')
+        try:
+            with os.fdopen(fd, 'wb') as fh:
+                np.savez(fh, model_name=np.array(self.model_name),
+                         phase_names=np.array(self.phase_names),
+                         distances=self.distances, depths=self.depths,
+                         receiver_depth=np.array(self.receiver_depth),
+                         time=self.time, slowness=self.slowness,
+                         dtdh=self.dtdh, time_error=self.time_error)
+            try:
+                getattr(os, 'replace', os.rename)(temp_filename, filename)
+            except OSError:
+                # Another process was faster (Python 2 on Windows does not
+                # replace files).
+                if not os.path.exists(filename):
+                    raise
+                os.remove(temp_filename)
+        except Exception:
+            if os.path.exists(temp_filename):
+                os.remove(temp_filename)
+            raise
+
+    @classmethod
+    def load(cls, filename):
+        """
+        Read a table stored with :meth:`save`.
+        """
+        npz = np.load(filename)
+        try:
+            table = cls(str(npz['model_name']),
+                        [str(name) for name in npz['phase_names']],
+                        npz['distances'], npz['depths'],
+                        float(npz['receiver_depth']), npz['time'],
+                        npz['slowness'], npz['dtdh'], npz['time_error'])
+        finally:
+            if hasattr(npz, 'close'):
+                npz.close()
+            else:
+                del npz
+        return table
+
+
+if __name__ == '__main__':
+    import doctest
+    doctest.testmod(exclude_empty=True)
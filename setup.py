@@ -497,6 +497,49 @@ def export_symbols(*path):
     return [s.strip() for s in lines if s.strip() != '']
 
 
+# helper function returning the compiler and linker arguments needed to build
+# an extension with OpenMP support. If the compiler does not support OpenMP
+# nothing is returned and the OpenMP pragmas are simply ignored.
+_OPENMP_KWARGS = []
+
+
+def openmp_kwargs():
+    if not _OPENMP_KWARGS:
+        _OPENMP_KWARGS.append(_detect_openmp())
+    return dict(_OPENMP_KWARGS[0])
+
+
+def _detect_openmp():
+    if IS_MSVC:
+        return {'extra_compile_args': ['/openmp']}
+    if os.environ.get('OBSPY_NO_OPENMP'):
+        return {}
+    import shutil
+    import tempfile
+    from distutils.ccompiler import new_compiler
+    from distutils.errors import CompileError, LinkError
+    from distutils.sysconfig import customize_compiler
+
+    compiler = new_compiler()
+    customize_compiler(compiler)
+    tmpdir = tempfile.mkdtemp()
+    try:
+        source = os.path.join(tmpdir, 'test_openmp.c')
+        with open(source, 'w') as fh:
+            fh.write('#include <omp.h>\n'
+                     'int main(void) { return omp_get_max_threads() < 1; }\n')
+        objects = compiler.compile([source], output_dir=tmpdir,
+                                   extra_postargs=['-fopenmp'])
+        compiler.link_executable(objects, os.path.join(tmpdir, 'test_openmp'),
+                                 extra_postargs=['-fopenmp'])
+    except (CompileError, LinkError):
+        return {}
+    finally:
+        shutil.rmtree(tmpdir, ignore_errors=True)
+    return {'extra_compile_args': ['-fopenmp'],
+            'extra_link_args': ['-fopenmp']}
+
+
 # adds --with-system-libs command-line option if possible
 def add_features():
     if 'setuptools' not in sys.modules:
@@ -539,7 +582,8 @@ def configuration(parent_package="", top_path=None):
 
     # LIBMSEED
     path = os.path.join("obspy", "io", "mseed", "src")
-    files = [os.path.join(path, "obspy-readbuffer.c")]
+    files = [os.path.join(path, "obspy-readbuffer.c"),
+             os.path.join(path, "obspy-steim.c")]
     if not EXTERNAL_LIBS:
         files += glob.glob(os.path.join(path, "libmseed", "*.c"))
     # compiler specific options
@@ -554,6 +598,12 @@ def configuration(parent_package="", top_path=None):
             export_symbols(path, 'obspy-readbuffer.def')
     if EXTERNAL_LIBS:
         kwargs['libraries'] = ['mseed']
+    else:
+        # let the bundled libmseed use ObsPy's Steim2 encoder
+        kwargs.setdefault('define_macros', []).append(
+            ('OBSPY_STEIM_ENCODER', '1'))
+    # record decoding can be distributed over several threads
+    kwargs.update(openmp_kwargs())
     config.add_extension(_get_lib_name("mseed", add_extension_suffix=False),
                          files, **kwargs)
 
@@ -565,6 +615,8 @@ def configuration(parent_package="", top_path=None):
     if IS_MSVC:
         # get export symbols
         kwargs['export_symbols'] = export_symbols(path, 'libsegy.def')
+    # long sample arrays are converted on several threads
+    kwargs.update(openmp_kwargs())
     config.add_extension(_get_lib_name("segy", add_extension_suffix=False),
                          files, **kwargs)
 
@@ -576,6 +628,8 @@ def configuration(parent_package="", top_path=None):
     if IS_MSVC:
         # get export symbols
         kwargs['export_symbols'] = export_symbols(path, 'libsignal.def')
+    # batch filtering can be distributed over several threads
+    kwargs.update(openmp_kwargs())
     config.add_extension(_get_lib_name("signal", add_extension_suffix=False),
                          files, **kwargs)
 
@@ -585,6 +639,8 @@ def configuration(parent_package="", top_path=None):
         files = glob.glob(os.path.join(path, "evalresp", "_obspy*.c"))
     else:
         files = glob.glob(os.path.join(path, "evalresp", "*.c"))
+    # FIR stages are evaluated by FFT for many frequencies
+    files.append(os.path.join(path, "fft_util.c"))
     # compiler specific options
     kwargs = {}
     if IS_MSVC:
@@ -605,6 +661,8 @@ def configuration(parent_package="", top_path=None):
     if IS_MSVC:
         # get export symbols
         kwargs['export_symbols'] = export_symbols(path, 'libtau.def')
+    # batch travel times can be distributed over several threads
+    kwargs.update(openmp_kwargs())
     config.add_extension(_get_lib_name("tau", add_extension_suffix=False),
                          files, **kwargs)
 